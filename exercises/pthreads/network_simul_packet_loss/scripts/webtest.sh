@@ -0,0 +1,213 @@
+#!/bin/bash
+# Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+#
+# Builds the web server, starts it on a temporary directory, and runs each
+# test against it. A test is a function named test_*, that fails by returning
+# non-zero. Options are environment variables: PORT, the port where the
+# server listens, and MODE, threads or epoll. Exits with error if a test fails
+set -euo pipefail
+
+PROJECT=$(cd "$(dirname "$0")/.." && pwd)
+PORT=${PORT:-18080}
+MODE=${MODE:-threads}
+WORK=$(mktemp -d)
+SERVER_PID=
+
+# stop_server: stops the server, if it is running, and removes the work files
+stop_server() {
+    if [[ -n $SERVER_PID ]]; then
+        kill "$SERVER_PID" 2> /dev/null || true
+        wait "$SERVER_PID" 2> /dev/null || true
+    fi
+    rm -rf "$WORK"
+}
+trap stop_server EXIT
+
+# request <uri> [curl options...]: prints the body of the response
+request() {
+    local uri=$1
+    shift
+    curl -sS --max-time 10 "$@" "http://localhost:$PORT$uri"
+}
+
+# server_alive: fails if the server process finished
+server_alive() {
+    if ! kill -0 "$SERVER_PID" 2> /dev/null; then
+        local status=0
+        wait "$SERVER_PID" || status=$?
+        SERVER_PID=
+        echo "  the server finished with exit code $status" >&2
+        return 1
+    fi
+}
+
+# A client that closes its connection while a large file is sent with
+# sendfile() must not kill the server with SIGPIPE
+test_sendfile_closed_by_client() {
+    local attempt
+    for attempt in 1 2 3 4 5; do
+        exec 3<> "/dev/tcp/localhost/$PORT"
+        printf 'GET /static/big.bin HTTP/1.1\r\nHost: localhost\r\n\r\n' >&3
+        # Read a few bytes only, the unread data makes the kernel reset the
+        # connection when it is closed
+        head -c 65536 <&3 > /dev/null
+        exec 3<&-
+        sleep 0.2
+        server_alive || return 1
+    done
+    # The server keeps serving other clients
+    [[ $(request /static/small.txt) == small ]]
+}
+
+# Clients that stop reading their responses must not hold the handlers of the
+# event loop longer than the idle timeout of the server. In threads mode, the
+# kernel bounds the sends with SO_SNDTIMEO less precisely
+test_send_to_stalled_clients() {
+    [[ $MODE == epoll ]] || return 0
+    # As many stalled clients as handlers, see the arguments of the server
+    exec 4<> "/dev/tcp/localhost/$PORT" 5<> "/dev/tcp/localhost/$PORT"
+    printf 'GET /static/big.bin HTTP/1.1\r\nHost: localhost\r\n\r\n' >&4
+    printf 'GET /static/big.bin HTTP/1.1\r\nHost: localhost\r\n\r\n' >&5
+    sleep 0.5
+    local body
+    body=$(request /static/small.txt --max-time 15) || true
+    exec 4<&- 5<&-
+    [[ $body == small ]]
+}
+
+# cpu_ticks: prints the processor time that the server used, in clock ticks
+cpu_ticks() {
+    awk '{print $14 + $15}' "/proc/$SERVER_PID/stat"
+}
+
+# When the server runs out of file descriptors, the pending connection
+# requests must not make the event loop spin. They are accepted once the
+# server has descriptors again
+test_accept_out_of_files() {
+    [[ $MODE == epoll ]] && command -v prlimit > /dev/null || return 0
+    local limit before after
+    limit=$(prlimit --pid "$SERVER_PID" --nofile --output SOFT --noheadings)
+    # Room for only one more client
+    prlimit --pid "$SERVER_PID" \
+        --nofile="$(($(ls "/proc/$SERVER_PID/fd" | wc -l) + 1)):"
+    exec 4<> "/dev/tcp/localhost/$PORT" 5<> "/dev/tcp/localhost/$PORT" \
+        6<> "/dev/tcp/localhost/$PORT"
+    sleep 0.5
+    before=$(cpu_ticks)
+    sleep 2
+    after=$(cpu_ticks)
+    exec 4<&- 5<&- 6<&-
+    prlimit --pid "$SERVER_PID" --nofile="$limit:"
+    # Less than a quarter of the processor
+    (( after - before < $(getconf CLK_TCK) / 2 )) ||
+        { echo "  the server used $((after - before)) ticks" >&2; return 1; }
+    [[ $(request /static/small.txt) == small ]]
+}
+
+# metric <name> <labels>: prints the value of the metric, 0 if it is missing
+metric() {
+    request /metrics | awk -v key="$1{$2}" '$1 == key {print $2; found = 1}
+        END {if (!found) print 0}'
+}
+
+# A request whose route handler declines it, e.g: a missing static file, is
+# counted with the requests that matched no route
+test_metrics_declined_route() {
+    local labels='method="*",route="unmatched",code="404"'
+    local before after
+    before=$(metric http_requests_total "$labels")
+    request /static/missing.txt -o /dev/null
+    after=$(metric http_requests_total "$labels")
+    [[ $after == $((before + 1)) ]] ||
+        { echo "  unmatched 404s went from $before to $after" >&2; return 1; }
+    [[ $(metric http_requests_total \
+        'method="GET",route="/static/*path",code="404"') == 0 ]]
+}
+
+# A symbolic link within the directory must not reach files outside of it
+test_static_symlink_outside() {
+    local code
+    code=$(request /static/outside/secret.txt -o /dev/null -w '%{http_code}')
+    [[ $code == 404 ]] || { echo "  got status $code" >&2; return 1; }
+    # Links whose target is within the directory are still followed
+    [[ $(request /static/inside.txt) == small ]]
+}
+
+# submit <form> [curl options...]: prints the status code of a heatsim job
+# submission
+submit() {
+    local form=$1
+    shift
+    request /heatsim/submit --data "$form" "$@" -o /dev/null -w '%{http_code}'
+}
+
+# Jobs change files of the server, so they are not submitted by a GET that any
+# page could trigger, nor by a form of another site
+test_heatsim_submit_post_only() {
+    local jobs code
+    jobs=$(request /heatsim/jobs | grep -c '"id"' || true)
+    code=$(request "/heatsim/submit?folder=$WORK/heatsim&job=slow.txt" \
+        -o /dev/null -w '%{http_code}')
+    [[ $code == 405 ]] || { echo "  GET got status $code" >&2; return 1; }
+    code=$(submit "folder=$WORK/heatsim&job=slow.txt" \
+        -H 'Origin: http://evil.example')
+    [[ $code == 403 ]] ||
+        { echo "  cross-site POST got status $code" >&2; return 1; }
+    [[ $(request /heatsim/jobs | grep -c '"id"' || true) == "$jobs" ]] ||
+        { echo "  a rejected submission was queued" >&2; return 1; }
+}
+
+# A job must not be queued while another one writes the same report, even if
+# its folder is written differently. It is accepted again once that finishes
+test_heatsim_same_report() {
+    local job="folder=$WORK/heatsim&job=slow.txt"
+    local code
+    code=$(submit "$job")
+    [[ $code == 202 ]] || { echo "  first got status $code" >&2; return 1; }
+    code=$(submit "folder=$WORK/heatsim/.&job=slow.txt")
+    [[ $code == 409 ]] || { echo "  second got status $code" >&2; return 1; }
+    for _ in $(seq 600); do
+        if ! request /heatsim/jobs/1 | grep -q '"state": "\(queued\|running\)"'
+        then
+            break
+        fi
+        sleep 0.1
+    done
+    request /heatsim/jobs/1 | grep -q '"state": "done"' ||
+        { echo "  the first job did not finish" >&2; return 1; }
+    code=$(submit "$job")
+    [[ $code == 202 ]] || { echo "  third got status $code" >&2; return 1; }
+}
+
+make -s -C "$PROJECT" DEFS=-DWEBSERVER >&2
+mkdir -p "$WORK/www"
+echo small > "$WORK/www/small.txt"
+echo secret > "$WORK/secret.txt"
+ln -s .. "$WORK/www/outside"
+ln -s small.txt "$WORK/www/inside.txt"
+# Larger than the cached files, so it is sent from disk with sendfile()
+head -c $((200 * 1024 * 1024)) /dev/zero > "$WORK/www/big.bin"
+# A plate that takes a few seconds to reach the equilibrium
+mkdir "$WORK/heatsim"
+cp "$PROJECT/src/heatsim/../tests/job001/plate002.bin" "$WORK/heatsim"
+printf 'plate002.bin\t60\t0.08\t450\t0.0000075\n' > "$WORK/heatsim/slow.txt"
+(cd "$WORK" && exec "$PROJECT/bin/$(basename "$PROJECT")" "$PORT" 2 \
+    "$MODE" > "$WORK/server.log" 2>&1) &
+SERVER_PID=$!
+for _ in $(seq 50); do
+    if request /static/small.txt > /dev/null 2>&1; then
+        break
+    fi
+    sleep 0.1
+done
+
+failed=0
+for test in $(declare -F | sed -n 's/^declare -f \(test_.*\)$/\1/p'); do
+    if server_alive && $test; then
+        echo "webtest: $test: passed" >&2
+    else
+        echo "webtest: $test: FAILED" >&2
+        failed=1
+    fi
+done
+exit $failed
@@ -1,6 +1,10 @@
 // Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
 
+#include <strings.h>
+
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 
 #include "Log.hpp"
@@ -11,6 +15,7 @@ const char* const Log::MESSAGE_TYPE_TEXT[] = {
   "Info",
   "Warning",
   "Error",
+  "Off",
 };
 
 Log& Log::getInstance() {
@@ -38,24 +43,199 @@ void Log::start(const std::string& logFilename) {
     this->filename = logFilename;
     this->output.rdbuf(this->file.rdbuf());
   }
+
+  // The level and the policy may be changed without recompiling
+  if (const char* level = std::getenv("LOG_LEVEL")) {
+    for (int type = DEBUG; type <= OFF; ++type) {
+      if (::strcasecmp(level, MESSAGE_TYPE_TEXT[type]) == 0) {
+        this->setLevel(static_cast<MessageType>(type));
+      }
+    }
+  }
+  if (const char* policy = std::getenv("LOG_OVERFLOW")) {
+    if (::strcasecmp(policy, "drop") == 0) {
+      this->setOverflowPolicy(DROP);
+    } else if (::strcasecmp(policy, "block") == 0) {
+      this->setOverflowPolicy(BLOCK);
+    }
+  }
+
+  // Start the writer thread with an empty ring
+  assert(!this->running);
+  if (!this->ring) {
+    this->ring.reset(new Record[RING_CAPACITY]);
+  }
+  for (size_t index = 0; index < RING_CAPACITY; ++index) {
+    this->ring[index].sequence.store(index, std::memory_order_relaxed);
+  }
+  this->enqueuePosition.store(0, std::memory_order_relaxed);
+  this->dequeuePosition = 0;
+  this->stopping.store(false);
+  this->failed.store(false);
+  this->startThread();
+  this->running.store(true);
 }
 
 void Log::stop() {
+  if (this->running.exchange(false)) {
+    // Later messages are written by their threads. The writer finishes after
+    // it writes the records in the ring, including the ones of the producers
+    // that saw it running before this point
+    this->stopping.store(true);
+    this->wakeWriter();
+    this->waitToFinish();
+  }
   this->file.close();
 }
 
-void Log::write(Log::MessageType type, const std::string& category
-  , const std::string& text) {
-  this->mutex.lock();
+void Log::push(std::string_view record) {
+  if (this->failed.load(std::memory_order_relaxed)) {
+    throw std::runtime_error("could not write log file: " + this->filename);
+  }
 
-  this->output << MESSAGE_TYPE_TEXT[type]
-    << '\t' << category
-    << '\t' << text << std::endl;
+  // Announce this producer before checking that the writer is running. Pairs
+  // with stop(): either this thread sees the log stopped, or the writer sees
+  // this producer and waits for its record
+  this->producers.fetch_add(1);
+  if (!this->running.load()) {
+    this->producers.fetch_sub(1);
+    // Without the writer thread, the calling thread writes the record
+    if (!this->writeOutput(record)) {
+      throw std::runtime_error("could not write log file: " + this->filename);
+    }
+    return;
+  }
 
-  bool error = !this->output;
-  this->mutex.unlock();
+  // Keep the end of line of truncated records
+  std::string truncated;
+  if (record.length() > RECORD_CAPACITY) {
+    truncated.assign(record.substr(0, RECORD_CAPACITY - 4));
+    truncated += "...\n";
+    record = truncated;
+  }
 
-  if (error) {
-    throw std::runtime_error("could not write log file: " + this->filename);
+  while (!this->tryEnqueue(record)) {
+    if (this->overflowPolicy.load(std::memory_order_relaxed) == DROP) {
+      this->dropped.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+    // The ring is full. Wait until the writer thread makes room
+    this->blockedProducers.fetch_add(1);
+    this->wakeWriter();
+    this->roomAvailable.wait();
+  }
+  // The writer may be waiting for this producer to finish
+  this->producers.fetch_sub(1);
+  this->wakeWriter();
+}
+
+bool Log::tryEnqueue(std::string_view record) {
+  // Bounded queue of Dmitry Vyukov. Producers claim a position with a compare
+  // and swap, and publish the record through its sequence number
+  size_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+  Record* slot = nullptr;
+  while (true) {
+    slot = &this->ring[position & (RING_CAPACITY - 1)];
+    const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence == position) {
+      if (this->enqueuePosition.compare_exchange_weak(position, position + 1
+          , std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (sequence < position) {
+      // The writer has not taken the record of the previous lap yet
+      return false;
+    } else {
+      position = this->enqueuePosition.load(std::memory_order_relaxed);
+    }
   }
+
+  std::memcpy(slot->text, record.data(), record.length());
+  slot->length = record.length();
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+void Log::dequeue(std::string& batch) {
+  while (batch.length() + RECORD_CAPACITY <= BATCH_CAPACITY) {
+    Record& slot = this->ring[this->dequeuePosition & (RING_CAPACITY - 1)];
+    if (slot.sequence.load(std::memory_order_acquire)
+        != this->dequeuePosition + 1) {
+      return;
+    }
+    batch.append(slot.text, slot.length);
+    // The record is free again for the producers of the next lap
+    slot.sequence.store(this->dequeuePosition + RING_CAPACITY
+      , std::memory_order_release);
+    ++this->dequeuePosition;
+  }
+}
+
+void Log::releaseProducers() {
+  // Each blocked producer waits exactly once for each time it was counted
+  for (size_t count = this->blockedProducers.exchange(0); count > 0;
+      --count) {
+    this->roomAvailable.signal();
+  }
+}
+
+void Log::wakeWriter() {
+  // Pairs with the fence of the writer: either the writer sees the record,
+  // or this thread sees that the writer is sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->sleeping.load(std::memory_order_relaxed)
+      && this->sleeping.exchange(false)) {
+    this->wakeUp.signal();
+  }
+}
+
+int Log::run() {
+  std::string batch;
+  batch.reserve(BATCH_CAPACITY);
+  while (true) {
+    // Write all the records available at once. Their records are free now,
+    // so the blocked producers may enqueue while the batch is written
+    this->dequeue(batch);
+    this->releaseProducers();
+    if (const size_t dropped = this->dropped.exchange(0)) {
+      batch += MESSAGE_TYPE_TEXT[WARNING];
+      batch += "\tlog\t" + std::to_string(dropped) + " messages dropped\n";
+    }
+    if (!batch.empty()) {
+      if (!this->writeOutput(batch)) {
+        this->failed.store(true);
+      }
+      batch.clear();
+      continue;
+    }
+
+    // The ring is empty. Finish if asked and no producer that saw the writer
+    // running is still pushing a record, or wait for more records
+    if (this->isFinished()) {
+      break;
+    }
+    this->sleeping.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const Record& next
+      = this->ring[this->dequeuePosition & (RING_CAPACITY - 1)];
+    if (next.sequence.load(std::memory_order_acquire)
+        == this->dequeuePosition + 1 || this->blockedProducers.load() > 0
+        || this->isFinished()) {
+      // Something changed meanwhile. If a producer already took the flag, it
+      // signals the semaphore, and the signal must be consumed
+      if (!this->sleeping.exchange(false)) {
+        this->wakeUp.wait();
+      }
+      continue;
+    }
+    this->wakeUp.wait();
+  }
+  return EXIT_SUCCESS;
+}
+
+bool Log::writeOutput(std::string_view text) {
+  const std::lock_guard<std::mutex> lock(this->mutex);
+  this->output.write(text.data(), text.length());
+  this->output.flush();
+  return static_cast<bool>(this->output);
 }
@@ -3,12 +3,19 @@
 #ifndef LOG_HPP
 #define LOG_HPP
 
+#include <atomic>
+#include <cstddef>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "common.hpp"
+#include "Semaphore.hpp"
+#include "Thread.hpp"
 
 /**
  * @brief Singleton thread-safe log manager
@@ -29,10 +36,9 @@
  * methods are unfeasible.
  * 
  * This class implements a minimalist log manager that is able to write messages
- * coming from several execution threads. Messages are automatically serialized
- * by a mutex, avoiding corrupting the log file. The class implements the
- * singleton software pattern. In order to use it, just include the header file,
- * and append messages to the log:
+ * coming from several execution threads. The class implements the singleton
+ * software pattern. In order to use it, just include the header file, and
+ * append messages to the log:
  * 
  * @code {.cpp}
  * #include "Log.hpp"
@@ -58,8 +64,16 @@
  * modules of your system. For example, "gui", "database", "user". Think you
  * can use these words to filter messages later when you analyze the logs.
  * 
- * Finally the third argument of Log::append() is a text. Use the shortest text
- * that provides a meaningful description of what happened.
+ * Finally the remaining arguments of Log::append() are the text. Use the
+ * shortest text that provides a meaningful description of what happened. The
+ * text may be given in parts, such as strings, characters and numbers, that are
+ * concatenated only if the message is written. Messages of types below the
+ * level set with setLevel() are discarded before they are formatted. Use
+ * isEnabled() to avoid computing the parts of messages that are discarded:
+ *
+ * @code {.cpp}
+ * Log::append(Log::INFO, "request", method, ' ', uri, " from port ", port);
+ * @endcode
  * 
  * Do not use tabulator characters inside any of the arguments of Log::append().
  * Internally messages are stored in TSV (tab-separated values) format. By
@@ -79,8 +93,19 @@
  *   Log::getInstance().stop();
  * }
  * @endcode
+ *
+ * Before start() and after stop(), messages are written by the calling thread,
+ * serialized by a mutex. While the log is started, messages are formatted by
+ * the calling thread into a record of a bounded ring buffer, without locks.
+ * A writer thread takes the records from the ring and writes them in batches,
+ * flushing the output once per batch. If the ring is full, the calling thread
+ * waits on a semaphore until the writer makes room (BLOCK policy), or the
+ * message is dropped (DROP policy). Dropped messages are counted and reported
+ * in the log. Texts longer than a record are truncated. The writer thread does
+ * not finish while a thread that saw it running is still pushing a record, so
+ * no message is lost by stop().
 */
-class Log {
+class Log : public Thread {
   DISABLE_COPY(Log);
 
  public:
@@ -90,12 +115,40 @@ class Log {
     INFO,
     WARNING,
     ERROR,
+    /// Only used as level, to discard all messages
+    OFF,
   };
   /// The respective texts for the message types
   static const char* const MESSAGE_TYPE_TEXT[];
+  /// What to do with a message when the ring buffer is full
+  enum OverflowPolicy {
+    /// Wait until the writer thread makes room in the ring
+    BLOCK,
+    /// Discard the message and count it
+    DROP,
+  };
+  /// Number of records in the ring buffer. It must be a power of two
+  static constexpr size_t RING_CAPACITY = 4096;
+  /// Maximum length of a formatted message, including its end of line
+  static constexpr size_t RECORD_CAPACITY = 496;
+  /// Bytes of records that the writer thread sends to the output at once
+  static constexpr size_t BATCH_CAPACITY = 64 * 1024;
 
  private:
-  /// All write operations are mutually exclusive.
+  /// A formatted message in the ring buffer
+  struct alignas(64) Record {
+    /// Equals the position of the record when it is free for a producer, or
+    /// the position + 1 when it holds a message for the writer thread
+    std::atomic<size_t> sequence;
+    /// Length of the text
+    size_t length;
+    /// The formatted message, ending with a new line
+    char text[RECORD_CAPACITY];
+  };
+
+ private:
+  /// Writes to the output from the calling threads, before start() or after
+  /// stop(), are mutually exclusive with the batches of the writer thread.
   std::mutex mutex;
   /// The output stream where all output will be sent.
   /// This can point to file or std::cout.
@@ -104,38 +157,139 @@ class Log {
   std::string filename;
   /// The log file if using named files.
   std::ofstream file;
+  /// Messages of types below this level are discarded
+  std::atomic<MessageType> level{DEBUG};
+  /// What to do with messages when the ring is full
+  std::atomic<OverflowPolicy> overflowPolicy{BLOCK};
+  /// True while the writer thread takes the messages
+  std::atomic<bool> running{false};
+  /// Number of threads pushing a record to the ring. The writer thread does
+  /// not finish until they are done, even if the log was stopped meanwhile
+  std::atomic<size_t> producers{0};
+  /// Asks the writer thread to write the remaining records and finish
+  std::atomic<bool> stopping{false};
+  /// True if the writer thread could not write a batch
+  std::atomic<bool> failed{false};
+  /// Number of messages dropped since the writer thread reported them
+  std::atomic<size_t> dropped{0};
+  /// Formatted messages waiting for the writer thread
+  std::unique_ptr<Record[]> ring;
+  /// Position of the next record to be claimed by a producer. It is in its
+  /// own cache line, because producers update it, and the writer does not
+  alignas(64) std::atomic<size_t> enqueuePosition{0};
+  /// Position of the next record to be written. Only the writer uses it
+  alignas(64) size_t dequeuePosition = 0;
+  /// True when the writer thread is about to wait for messages
+  std::atomic<bool> sleeping{false};
+  /// The writer thread waits here when the ring is empty
+  Semaphore wakeUp{0};
+  /// Number of producers waiting for room in the full ring
+  std::atomic<size_t> blockedProducers{0};
+  /// Producers wait here when the ring is full, with the BLOCK policy
+  Semaphore roomAvailable{0};
 
  public:
   /// Get access to the unique instance of this Singleton class.
   static Log& getInstance();
-  /// Open the log file for appending.
+  /// Open the log file for appending, and start the writer thread.
+  /// The environment variables LOG_LEVEL (debug, info, warning, error, off)
+  /// and LOG_OVERFLOW (block, drop) override the level and the policy.
   /// @param logFilename If no filename is given, standard output is used.
   /// @throw std::runtime_error if file could not be open.
   void start(const std::string& logFilename = std::string());
-  /// Closes the log file.
+  /// Writes the pending messages, stops the writer thread, and closes the log
+  /// file.
   void stop();
+  /// Discard the messages of types below the given one
+  inline void setLevel(MessageType level) {
+    this->level.store(level, std::memory_order_relaxed);
+  }
+  /// Set what to do with messages when the ring buffer is full
+  inline void setOverflowPolicy(OverflowPolicy policy) {
+    this->overflowPolicy.store(policy, std::memory_order_relaxed);
+  }
+  /// Return true if messages of the given type are written
+  static inline bool isEnabled(MessageType type) {
+    return type >= Log::getInstance().level.load(std::memory_order_relaxed);
+  }
   /// Appends a record to the log file.
   /// @throw std::runtime_error if record could not be written.
   /// @see append
-  void write(MessageType type, const std::string& category
-    , const std::string& text);
+  template <typename... Parts>
+  void write(MessageType type, std::string_view category
+      , const Parts&... parts) {
+    if (type < this->level.load(std::memory_order_relaxed)) {
+      return;
+    }
+    // Each thread formats in its own buffer, that keeps its capacity
+    static thread_local std::string record;
+    record.assign(MESSAGE_TYPE_TEXT[type]);
+    record += '\t';
+    record += category;
+    record += '\t';
+    (Log::format(record, parts), ...);
+    record += '\n';
+    this->push(record);
+  }
   /// Appends a record to the log file.
   /// This is a convenience static method that calls write.
   /// @param type A constant: DEBUG, INFO, WARNING, ERROR.
   /// @param category Any text that is useful for distinguishing messages, such
   /// as the name of the module or class, e.g: producer or socket
-  /// @param text Text should not contain tab characters ('\\t')
+  /// @param parts Texts, characters or numbers that are concatenated. Texts
+  /// should not contain tab characters ('\\t')
   /// @throw std::runtime_error if record could not be written
-  static inline void append(MessageType type, const std::string& category
-      , const std::string& text) {
-    return Log::getInstance().write(type, category, text);
+  template <typename... Parts>
+  static inline void append(MessageType type, std::string_view category
+      , const Parts&... parts) {
+    return Log::getInstance().write(type, category, parts...);
   }
 
+ protected:
+  /// Writer thread. Takes the records from the ring and writes them in
+  /// batches until stop() is called
+  int run() override;
+
  private:
   /// Singleton. Implement code in start() method instead.
   Log();
   /// Singleton. Implement code in stop() method instead.
   ~Log() = default;
+  /// Concatenate a text part of a message
+  static inline void format(std::string& record, std::string_view text) {
+    record += text;
+  }
+  /// Concatenate a character part of a message
+  static inline void format(std::string& record, char character) {
+    record += character;
+  }
+  /// Concatenate a number part of a message
+  template <typename Number>
+  requires std::is_arithmetic_v<Number>
+  static inline void format(std::string& record, Number number) {
+    record += std::to_string(number);
+  }
+  /// Send a formatted record to the writer thread, or write it if the writer
+  /// thread is not running
+  /// @throw std::runtime_error if record could not be written
+  void push(std::string_view record);
+  /// Copy the record to the ring buffer
+  /// @return false if the ring is full
+  bool tryEnqueue(std::string_view record);
+  /// Move the records in the ring to the batch, until the batch is full
+  void dequeue(std::string& batch);
+  /// Wake the writer thread if it is waiting for records
+  void wakeWriter();
+  /// Let the producers waiting for room in the ring try again
+  void releaseProducers();
+  /// Return true if the writer thread was asked to finish, and no producer
+  /// is pushing a record anymore
+  inline bool isFinished() const {
+    return this->stopping.load() && this->producers.load() == 0;
+  }
+  /// Write the text to the output, serialized by the mutex
+  /// @return false if the output failed
+  bool writeOutput(std::string_view text);
 };
 
 #endif  // LOG_HPP
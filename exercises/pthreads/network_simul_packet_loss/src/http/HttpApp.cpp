@@ -2,6 +2,20 @@
 
 #include "HttpApp.hpp"
 
+bool HttpApp::registerRoutes(HttpRouter& router) {
+  // Default base class implementation is chained
+  (void)router;
+  return false;
+}
+
+bool HttpApp::handleHttpRequest(HttpRequest& httpRequest,
+    HttpResponse& httpResponse) {
+  // Default base class implementation leaves the request to the next app
+  (void)httpRequest;
+  (void)httpResponse;
+  return false;
+}
+
 void HttpApp::start() {
   // Default base class implementation does nothing
 }
@@ -7,6 +7,7 @@
 
 class HttpRequest;
 class HttpResponse;
+class HttpRouter;
 
 /**
 @brief Base class for all web applications that can be registered with the
@@ -22,13 +23,21 @@ class HttpApp {
   HttpApp() = default;
   /// Destructor
   ~HttpApp() = default;
+  /// Called by the web server when the application is registered, in order
+  /// to register the routes of the application
+  /// @return true if the application registered its routes, false if it has
+  /// to be asked for each request that does not match a route. The default
+  /// implementation does not register routes
+  virtual bool registerRoutes(HttpRouter& router);
   /// Called by the web server when the web server is started
   virtual void start();
-  /// Handle HTTP requests. @see HttpServer::handleHttpRequest()
+  /// Handle HTTP requests. Only called if registerRoutes() returned false.
+  /// @see HttpServer::handleHttpRequest()
   /// @return true If this application handled the request, false otherwise
-  /// and another chained application should handle it
+  /// and another chained application should handle it. The default
+  /// implementation handles none
   virtual bool handleHttpRequest(HttpRequest& httpRequest,
-    HttpResponse& httpResponse) = 0;
+    HttpResponse& httpResponse);
   /// Called when the web server stops, in order to allow the web application
   /// clean up and finish as well
   virtual void stop();
@@ -0,0 +1,186 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "HttpApp.hpp"
+#include "HttpConnectionHandler.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "HttpRouter.hpp"
+#include "HttpServer.hpp"
+#include "Log.hpp"
+#include "NetworkAddress.hpp"
+
+HttpConnectionHandler::HttpConnectionHandler(Queue<Socket>* connectionQueue
+  , HttpServer& server)
+  : Consumer<Socket>(connectionQueue, Socket())
+  , server(server)
+  , counters(server.getMetrics().addThread(
+      server.getRouter().getRouteCount())) {
+}
+
+int HttpConnectionHandler::run() {
+  this->consumeForever();
+  return EXIT_SUCCESS;
+}
+
+void HttpConnectionHandler::consume(Socket client) {
+  // Waiting for the next request, or for the client to read a response,
+  // fails when the client is idle for too long
+  client.setReceiveTimeout(this->server.getIdleTimeout());
+  client.setSendTimeout(this->server.getIdleTimeout());
+
+  // While the same client asks for HTTP requests in the same connection. The
+  // connection is closed when the last copy of the socket is released
+  while (this->serveRequest(client)) {
+  }
+  this->server.releaseConnection();
+}
+
+bool HttpConnectionHandler::serveRequest(Socket& client) {
+  // Create an object that parses the HTTP request from the socket
+  HttpRequest httpRequest(client);
+
+  // If the request is not valid or an error happened
+  if (!httpRequest.parse()) {
+    // Requests rejected by their header, e.g: a too long body, are answered
+    if (httpRequest.getErrorCode() != 0) {
+      HttpResponse httpResponse(client);
+      this->serveRequestError(httpRequest, httpResponse);
+      this->counters.record(this->server.getRouter().getRouteCount()
+        , httpResponse.getStatusCode(), httpRequest.getLength()
+        , httpResponse.getLength(), 0);
+    }
+    // Non-valid requests are normal after a previous valid request, e.g: the
+    // client closed the connection. Stop waiting for more requests
+    return false;
+  }
+
+  // The time to answer the request does not include waiting for it
+  const std::chrono::steady_clock::time_point start
+    = std::chrono::steady_clock::now();
+
+  // A complete HTTP client request was received. Create an object for the
+  // server responds to that client's request
+  HttpResponse httpResponse(client);
+
+  // Tell the client if the connection persists after this response
+  const bool keepAlive = httpRequest.isKeepAlive()
+    && client.countRequest() < this->server.getMaxRequestsPerConnection();
+  httpResponse.setHeader("Connection", keepAlive ? "keep-alive" : "close");
+
+  // Give subclass a chance to respond the HTTP request
+  this->routeNumber = this->server.getRouter().getRouteCount();
+  const bool handled = this->handleHttpRequest(httpRequest, httpResponse);
+
+  // Count the request, even if the response could not be sent
+  this->counters.record(this->routeNumber, httpResponse.getStatusCode()
+    , httpRequest.getLength(), httpResponse.getLength()
+    , std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count());
+
+  // If subclass did not handle the request or the connection does not
+  // persist, the socket will not be more used
+  return handled && keepAlive;
+}
+
+bool HttpConnectionHandler::handleHttpRequest(HttpRequest& httpRequest,
+    HttpResponse& httpResponse) {
+  // Print IP and port from client. The IP is not converted to text if the
+  // messages are discarded
+  if (Log::isEnabled(Log::INFO)) {
+    const NetworkAddress& address = httpRequest.getNetworkAddress();
+    Log::append(Log::INFO, "connection", "connection established with client "
+      , address.getIP(), " port ", address.getPort());
+  }
+
+  // Print HTTP request
+  Log::append(Log::INFO, "request", httpRequest.getMethod(), ' '
+    , httpRequest.getURI(), ' ', httpRequest.getHttpVersion());
+
+  return this->route(httpRequest, httpResponse);
+}
+
+bool HttpConnectionHandler::route(HttpRequest& httpRequest
+  , HttpResponse& httpResponse) {
+  // Find the application that registered a route for the request
+  const HttpRouter::Route* matched
+    = this->server.getRouter().findRoute(httpRequest);
+  if (matched) {
+    this->routeNumber = matched->number;
+    if (matched->handler(httpRequest, httpResponse)) {
+      return true;
+    }
+    // The handler declined, e.g: a missing static file. The request is not
+    // counted for its route, but as the ones that matched no route
+    this->routeNumber = this->server.getRouter().getRouteCount();
+  }
+
+  // Traverse the chain of applications that have no routes
+  const std::vector<HttpApp*>& applications
+    = this->server.getChainedApplications();
+  for (size_t index = 0; index < applications.size(); ++index) {
+    // If this application handles the request
+    HttpApp* app = applications[index];
+    if (app->handleHttpRequest(httpRequest, httpResponse)) {
+      return true;
+    }
+  }
+
+  // Unrecognized request
+  return this->serveNotFound(httpRequest, httpResponse);
+}
+
+bool HttpConnectionHandler::serveNotFound(HttpRequest& httpRequest
+  , HttpResponse& httpResponse) {
+  (void)httpRequest;
+
+  // Set HTTP response metadata (headers)
+  httpResponse.setStatusCode(404);
+  httpResponse.setHeader("Server", "AttoServer v1.0");
+  httpResponse.setHeader("Content-type", "text/html; charset=ascii");
+
+  // Build the body of the response
+  std::string title = "Not found";
+  httpResponse.body() << "<!DOCTYPE html>\n"
+    << "<html lang=\"en\">\n"
+    << "  <meta charset=\"ascii\"/>\n"
+    << "  <title>" << title << "</title>\n"
+    << "  <style>body {font-family: monospace} h1 {color: red}</style>\n"
+    << "  <h1>" << title << "</h1>\n"
+    << "  <p>The requested resouce was not found on this server.</p>\n"
+    << "  <hr><p><a href=\"/\">Homepage</a></p>\n"
+    << "</html>\n";
+
+  // Send the response to the client (user agent)
+  return httpResponse.send();
+}
+
+bool HttpConnectionHandler::serveRequestError(HttpRequest& httpRequest
+  , HttpResponse& httpResponse) {
+  // The rest of the request is not received, so the connection cannot persist
+  httpResponse.setStatusCode(httpRequest.getErrorCode());
+  httpResponse.setHeader("Connection", "close");
+  httpResponse.setHeader("Server", "AttoServer v1.0");
+  httpResponse.setHeader("Content-type", "text/html; charset=ascii");
+
+  // Build the body of the response
+  const bool tooLarge = httpRequest.getErrorCode() == 413;
+  std::string title = tooLarge ? "Payload too large" : "Bad request";
+  httpResponse.body() << "<!DOCTYPE html>\n"
+    << "<html lang=\"en\">\n"
+    << "  <meta charset=\"ascii\"/>\n"
+    << "  <title>" << title << "</title>\n"
+    << "  <style>body {font-family: monospace} h1 {color: red}</style>\n"
+    << "  <h1>" << title << "</h1>\n"
+    << "  <p>" << (tooLarge ? "The request body is longer than this server"
+      " accepts." : "The request could not be understood by this server.")
+    << "</p>\n"
+    << "  <hr><p><a href=\"/\">Homepage</a></p>\n"
+    << "</html>\n";
+
+  return httpResponse.send();
+}
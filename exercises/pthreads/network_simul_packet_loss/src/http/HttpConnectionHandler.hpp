@@ -0,0 +1,76 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef HTTPCONNECTIONHANDLER_HPP
+#define HTTPCONNECTIONHANDLER_HPP
+
+#include "Consumer.hpp"
+#include "HttpMetrics.hpp"
+#include "Socket.hpp"
+
+class HttpApp;
+class HttpRequest;
+class HttpResponse;
+class HttpServer;
+
+/**
+@brief A thread that serves the client connections accepted by HttpServer
+The server pushes the accepted sockets onto a queue shared by all handlers.
+Each handler takes a connection, answers the HTTP requests the client sends
+through it, and takes the next one. The connection persists until the client
+asks to close it, stays idle longer than the idle timeout of the server, or
+sends the maximum number of requests per connection. A default-constructed
+socket, that has no file descriptor, is the stop condition of the handlers.
+Each handler counts the requests it serves in its own counters of the
+HttpMetrics of the server
+*/
+class HttpConnectionHandler : public Consumer<Socket> {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(HttpConnectionHandler);
+
+ protected:
+  /// The server that owns the chain of web applications
+  HttpServer& server;
+  /// Counters of the requests served by this handler
+  HttpMetrics::ThreadCounters& counters;
+  /// Number of the route that handled the current request. The route count
+  /// of the router if the request matched none, or its handler declined it
+  size_t routeNumber = 0;
+
+ public:
+  /// Constructor. All handlers of a server share the same queue
+  HttpConnectionHandler(Queue<Socket>* connectionQueue, HttpServer& server);
+  /// Consume connections until the stop condition is dequeued
+  int run() override;
+  /// Serve the HTTP requests of the client until it closes the connection
+  void consume(Socket client) override;
+
+ protected:
+  /// Parse the next HTTP request of the client and answer it
+  /// @return true if the client may send further requests through the same
+  /// connection, false if the request was not valid, it was not handled, the
+  /// client asked to close the connection, or it reached the maximum number
+  /// of requests
+  bool serveRequest(Socket& client);
+  /// Called each time an HTTP request is received. Handler should analyze
+  /// the request object and assemble a response with the response object.
+  /// Finally send the response calling the httpResponse.send() method.
+  /// @return true on success and the handler will continue handling further
+  /// HTTP requests, or false if handler should stop accepting requests from
+  /// this client (e.g: HTTP/1.0)
+  virtual bool handleHttpRequest(HttpRequest& httpRequest,
+    HttpResponse& httpResponse);
+  /// Route, that provide an answer according to the URI value
+  /// For example, home page is handled different than a number
+  bool route(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Sends a page for a non found resouce in this server. This method is called
+  /// if none of the registered web applications handled the request.
+  /// If you want to override this method, create a web app, e.g NotFoundWebApp
+  /// that reacts to all URIs, and chain it as the last web app
+  bool serveNotFound(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Sends a page for a request that HttpRequest::parse() rejected, with the
+  /// status code it tells, e.g: 413 for a too long body. The connection is
+  /// closed after it
+  bool serveRequestError(HttpRequest& httpRequest, HttpResponse& httpResponse);
+};
+
+#endif  // HTTPCONNECTIONHANDLER_HPP
@@ -0,0 +1,21 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include "HttpEventHandler.hpp"
+#include "HttpRequest.hpp"
+#include "HttpServer.hpp"
+
+HttpEventHandler::HttpEventHandler(Queue<Socket>* requestQueue
+  , HttpServer& server)
+  : HttpConnectionHandler(requestQueue, server) {
+}
+
+void HttpEventHandler::consume(Socket client) {
+  // Parsing never blocks, because only complete requests are parsed
+  bool keepOpen = true;
+  do {
+    keepOpen = this->serveRequest(client);
+  } while (keepOpen
+    && HttpRequest::findRequestLength(client.getPendingInput()) > 0);
+
+  this->server.resumeClient(client, keepOpen);
+}
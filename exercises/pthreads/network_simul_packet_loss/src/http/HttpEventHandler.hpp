@@ -0,0 +1,27 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef HTTPEVENTHANDLER_HPP
+#define HTTPEVENTHANDLER_HPP
+
+#include "HttpConnectionHandler.hpp"
+
+/**
+@brief A worker thread of the event loop mode of HttpServer
+The event loop queues a client once its socket buffers at least one complete
+HTTP request. The worker answers all the complete requests in the buffer,
+e.g: pipelined requests, and gives the client back to the event loop. Hence,
+idle clients do not hold a thread. The event loop closes them when they are
+idle longer than the idle timeout
+*/
+class HttpEventHandler : public HttpConnectionHandler {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(HttpEventHandler);
+
+ public:
+  /// Constructor. All workers of a server share the same queue
+  HttpEventHandler(Queue<Socket>* requestQueue, HttpServer& server);
+  /// Answer the buffered requests of the client and resume it in the loop
+  void consume(Socket client) override;
+};
+
+#endif  // HTTPEVENTHANDLER_HPP
@@ -3,6 +3,7 @@
 #include <cassert>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 #include "HttpMessage.hpp"
 #include "NetworkAddress.hpp"
@@ -10,8 +11,7 @@
 const char* const HttpMessage::lineSeparator = "\r\n";
 
 HttpMessage::HttpMessage(const Socket& socket)
-  : socket{socket}
-  , sharedBody{new std::stringstream()} {
+  : socket{socket} {
 }
 
 HttpMessage::~HttpMessage() {
@@ -34,7 +34,7 @@ std::string HttpMessage::getHeader(const std::string& key
 std::string HttpMessage::guessContentType() const {
   // This is a naive incomplete implementation. See file signatures for a more
   // exhaustive scope: https://en.wikipedia.org/wiki/List_of_file_signatures
-  const std::string& content = this->body().str();
+  const std::string_view content = this->body().view();
 
   // If body is empty, no way to guess
   if (content.empty()) {
@@ -58,5 +58,12 @@ std::string HttpMessage::guessContentType() const {
 }
 
 bool HttpMessage::operator==(const HttpMessage& other) const {
-  return this->sharedBody == other.sharedBody;
+  return &this->getSharedBody() == &other.getSharedBody();
+}
+
+std::stringstream& HttpMessage::getSharedBody() const {
+  if (!this->sharedBody) {
+    this->sharedBody = std::make_shared<std::stringstream>();
+  }
+  return *this->sharedBody;
 }
@@ -63,8 +63,9 @@ class HttpMessage {
   std::string httpVersion = "HTTP/1.1";
   /// HTTP message headers (pairs key=value)
   Headers headers;
-  /// Body contents is a shared buffer for all copies of this message object
-  std::shared_ptr<std::stringstream> sharedBody;
+  /// Body contents is a shared buffer for all copies of this message object.
+  /// It is created on first use, so messages without body do not allocate it
+  mutable std::shared_ptr<std::stringstream> sharedBody;
 
  public:
   /// Constructor
@@ -86,16 +87,20 @@ class HttpMessage {
   std::string getHeader(const std::string& key
     , const std::string& defaultvalue = "");
   /// Get read-only access to the body object
-  inline const std::stringstream& body() const { return *this->sharedBody; }
+  inline const std::stringstream& body() const { return this->getSharedBody(); }
   /// Get read/write access to the body contents
-  inline std::stringstream& body() { return *this->sharedBody; }
+  inline std::stringstream& body() { return this->getSharedBody(); }
   /// Return the length of the body in bytes
-  inline size_t getBodyLength() const { return this->body().str().length(); }
+  inline size_t getBodyLength() const { return this->body().view().length(); }
   /// Tries to guess the type of content from the body
   /// @return A MIME type text, or empty string if body is empty
   std::string guessContentType() const;
   /// @return true if this object has the same message than the other's
   bool operator==(const HttpMessage& other) const;
+
+ protected:
+  /// Create the body buffer if it does not exist yet
+  std::stringstream& getSharedBody() const;
 };
 
 #endif  // HTTPMESSAGE_H
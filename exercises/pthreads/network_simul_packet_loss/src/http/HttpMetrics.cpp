@@ -0,0 +1,71 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <algorithm>
+#include <cassert>
+
+#include "HttpMetrics.hpp"
+
+HttpMetrics::ThreadCounters::ThreadCounters(size_t routeCount)
+  : routes(routeCount + 1) {
+}
+
+void HttpMetrics::ThreadCounters::record(size_t route, int statusCode,
+    size_t bytesReceived, size_t bytesSent, uint64_t duration) {
+  assert(route < this->routes.size());
+  RouteCounters<std::atomic<uint64_t>>& counters = this->routes[route];
+  const size_t code = statusCode >= minStatusCode && statusCode <= maxStatusCode
+    ? statusCode - minStatusCode : counters.statusCodes.size() - 1;
+  increment(counters.statusCodes[code], 1);
+  // The first bucket whose bound is not less than the duration
+  const size_t bucket = std::lower_bound(durationBounds.begin()
+    , durationBounds.end(), duration) - durationBounds.begin();
+  increment(counters.durations[bucket], 1);
+  increment(counters.durationSum, duration);
+  increment(counters.bytesReceived, bytesReceived);
+  increment(counters.bytesSent, bytesSent);
+}
+
+void HttpMetrics::ThreadCounters::addTo(
+    std::vector<RouteCounters<uint64_t>>& totals) const {
+  const size_t count = std::min(totals.size(), this->routes.size());
+  for (size_t route = 0; route < count; ++route) {
+    const RouteCounters<std::atomic<uint64_t>>& counters = this->routes[route];
+    RouteCounters<uint64_t>& total = totals[route];
+    for (size_t index = 0; index < total.statusCodes.size(); ++index) {
+      total.statusCodes[index] += counters.statusCodes[index].load(
+        std::memory_order_relaxed);
+    }
+    for (size_t index = 0; index < total.durations.size(); ++index) {
+      total.durations[index] += counters.durations[index].load(
+        std::memory_order_relaxed);
+    }
+    total.durationSum += counters.durationSum.load(std::memory_order_relaxed);
+    total.bytesReceived += counters.bytesReceived.load(
+      std::memory_order_relaxed);
+    total.bytesSent += counters.bytesSent.load(std::memory_order_relaxed);
+  }
+}
+
+HttpMetrics::HttpMetrics() {
+}
+
+HttpMetrics::~HttpMetrics() {
+}
+
+HttpMetrics::ThreadCounters& HttpMetrics::addThread(size_t routeCount) {
+  const std::lock_guard<std::mutex> lock(this->mutex);
+  this->threads.emplace_back(new ThreadCounters(routeCount));
+  return *this->threads.back();
+}
+
+std::vector<HttpMetrics::RouteCounters<uint64_t>> HttpMetrics::getTotals(
+    size_t routeCount) {
+  // The counters of the threads may be a bit behind each other, but every
+  // one of them only grows
+  std::vector<RouteCounters<uint64_t>> totals(routeCount + 1);
+  const std::lock_guard<std::mutex> lock(this->mutex);
+  for (const std::unique_ptr<ThreadCounters>& thread : this->threads) {
+    thread->addTo(totals);
+  }
+  return totals;
+}
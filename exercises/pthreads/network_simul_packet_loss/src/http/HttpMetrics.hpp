@@ -0,0 +1,105 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef HTTPMETRICS_HPP
+#define HTTPMETRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common.hpp"
+
+/**
+@brief Counts the requests served by the connection handlers
+For each route, the handlers count the requests by status code, the bytes
+received and sent, and the time taken to answer them, in a histogram. The
+requests that matched no route are counted as an extra route, after the
+registered ones.
+
+Each handler thread writes its own counters, so the request path takes no
+locks, and threads do not share cache lines. Since each counter has a single
+writer, it is incremented with a relaxed load and store, instead of an atomic
+read-modify-write. The counters of all the threads are added when they are
+read, e.g: by MetricsWebApp.
+*/
+class HttpMetrics {
+  DISABLE_COPY(HttpMetrics);
+
+ public:
+  /// Upper bounds of the buckets of the histogram of durations, in
+  /// microseconds. A last bucket counts the longer durations
+  static constexpr std::array<uint64_t, 14> durationBounds = {250, 500, 1000
+    , 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000
+    , 2500000, 10000000};
+  /// Lowest status code counted by its value. Invalid codes are counted as 0
+  static constexpr int minStatusCode = 100;
+  /// Highest status code counted by its value
+  static constexpr int maxStatusCode = 599;
+
+  /// Sums of the requests of a route
+  template <typename Counter>
+  struct RouteCounters {
+    /// Number of requests by status code, from minStatusCode. The last
+    /// element counts the invalid codes
+    std::array<Counter, maxStatusCode - minStatusCode + 2> statusCodes{};
+    /// Number of requests by the bucket of their duration
+    std::array<Counter, durationBounds.size() + 1> durations{};
+    /// Sum of the durations in microseconds
+    Counter durationSum{};
+    /// Bytes of the requests, header and body
+    Counter bytesReceived{};
+    /// Bytes of the responses, header and body
+    Counter bytesSent{};
+  };
+
+  /// Counters of a handler thread, one set by route
+  class alignas(64) ThreadCounters {
+    DISABLE_COPY(ThreadCounters);
+
+   protected:
+    /// Counters by route number
+    std::vector<RouteCounters<std::atomic<uint64_t>>> routes;
+
+   public:
+    /// Constructor
+    explicit ThreadCounters(size_t routeCount);
+    /// Count a request. Only the owner thread calls this method
+    void record(size_t route, int statusCode, size_t bytesReceived,
+      size_t bytesSent, uint64_t duration);
+    /// Add the counters of this thread to the totals
+    void addTo(std::vector<RouteCounters<uint64_t>>& totals) const;
+
+   protected:
+    /// Add to a counter that has a single writer
+    static inline void increment(std::atomic<uint64_t>& counter,
+        uint64_t value) {
+      counter.store(counter.load(std::memory_order_relaxed) + value
+        , std::memory_order_relaxed);
+    }
+  };
+
+ protected:
+  /// Protects the list of threads
+  std::mutex mutex;
+  /// Counters of each handler thread
+  std::vector<std::unique_ptr<ThreadCounters>> threads;
+
+ public:
+  /// Constructor
+  HttpMetrics();
+  /// Destructor
+  ~HttpMetrics();
+  /// Create the counters of a handler thread
+  /// @param routeCount Number of registered routes. An extra route counts
+  /// the requests that matched none
+  /// @return The counters. They live as long as this object
+  ThreadCounters& addThread(size_t routeCount);
+  /// Add the counters of all the threads
+  /// @return The totals by route number
+  std::vector<RouteCounters<uint64_t>> getTotals(size_t routeCount);
+};
+
+#endif  // HTTPMETRICS_HPP
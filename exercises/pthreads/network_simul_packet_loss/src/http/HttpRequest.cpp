@@ -1,14 +1,48 @@
 // Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <charconv>
 #include <stdexcept>
 #include <string>
-#include <sstream>
-#include <vector>
 
 #include "HttpRequest.hpp"
 #include "Socket.hpp"
 
+/// Returns true if both texts are equal ignoring case
+static bool equalsIgnoreCase(std::string_view text1, std::string_view text2) {
+  if (text1.length() != text2.length()) {
+    return false;
+  }
+  for (size_t index = 0; index < text1.length(); ++index) {
+    if (::tolower(static_cast<unsigned char>(text1[index]))
+        != ::tolower(static_cast<unsigned char>(text2[index]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Returns true if the text contains the lowercase word, ignoring case
+static bool containsIgnoreCase(std::string_view text, std::string_view word) {
+  for (size_t start = 0; start + word.length() <= text.length(); ++start) {
+    if (equalsIgnoreCase(text.substr(start, word.length()), word)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Remove spaces and tabs from both ends of the text
+static std::string_view trim(std::string_view text) {
+  const size_t start = text.find_first_not_of(" \t");
+  if (start == std::string_view::npos) {
+    return std::string_view();
+  }
+  return text.substr(start, text.find_last_not_of(" \t") - start + 1);
+}
+
 HttpRequest::HttpRequest(const Socket& socket)
   : HttpMessage(socket) {
 }
@@ -17,92 +51,301 @@ HttpRequest::~HttpRequest() {
 }
 
 bool HttpRequest::parse() {
-  return this->parseRequestLine()
-    && this->parseHeader()
-    && this->parseBody();
-}
+  // Receive until the header is complete. Only new data is searched
+  size_t headerLength = 0;
+  size_t searched = 0;
+  while (true) {
+    const std::string_view pending = this->socket.getPendingInput();
+    headerLength = HttpRequest::findHeaderLength(pending, searched);
+    if (headerLength > 0) {
+      break;
+    }
+    // The end of the last line searched may be the start of the empty line
+    searched = pending.length() > 2 ? pending.length() - 3 : 0;
+    if (pending.length() > HttpRequest::maxHeaderSize
+        || !this->socket.receive()) {
+      return false;
+    }
+  }
 
-bool HttpRequest::parseRequestLine() {
-  // Try to read a line from the socket
-  std::string line;
-  if (!this->socket.readLine(line)) {
+  // Usually the whole request arrived at once and it is parsed here
+  std::string_view pending = this->socket.getPendingInput();
+  if (!this->parseHeader(pending.substr(0, headerLength))) {
     return false;
   }
 
-  // Extract the request fields from the line
-  std::istringstream requestLine(line);
-  if (!(requestLine >> this->method >> this->uri >> this->httpVersion)) {
+  // Take the request out of the buffer, receiving the rest of the body. The
+  // Content-Length is at most maxBodySize, so the sum cannot overflow
+  // TODO(any): Multi-part requests are not supported. See Transfer-Encoding
+  // https://tools.ietf.org/html/rfc7230#section-3.3
+  const size_t requestLength = headerLength + this->contentLength;
+  const bool buffered = pending.length() >= requestLength;
+  std::string_view request;
+  try {
+    if (!this->socket.read(request, requestLength)) {
+      return false;
+    }
+  } catch (const std::exception& error) {
+    // E.g: no memory for the body. Only this connection is affected
     return false;
   }
-
+  // The buffer may move to receive the body, then the views are parsed again
+  if (!buffered && !this->parseHeader(request.substr(0, headerLength))) {
+    return false;
+  }
+  this->content = request.substr(headerLength);
+  this->length = requestLength;
   return true;
 }
 
-bool HttpRequest::parseHeader() {
-  while (true) {
-    // Try to read a line from the socket
-    std::string line;
-    if (!this->socket.readLine(line)) {
-      return false;
+size_t HttpRequest::findHeaderLength(std::string_view data, size_t from) {
+  for (size_t position = data.find('\n', from);
+      position != std::string_view::npos;
+      position = data.find('\n', position + 1)) {
+    // An empty line is "\n" or "\r\n" after the end of the previous line
+    if (position + 1 < data.length() && data[position + 1] == '\n') {
+      return position + 2;
     }
+    if (position + 2 < data.length() && data[position + 1] == '\r'
+        && data[position + 2] == '\n') {
+      return position + 3;
+    }
+  }
+  return 0;
+}
 
-    // Remove trailing '\r' if any
-    if (line.length() > 0 && line[line.length() - 1] == '\r') {
-      line.erase(line.length() - 1);
+size_t HttpRequest::findRequestLength(std::string_view data,
+    size_t headerLength) {
+  const size_t headerEnd = headerLength > 0 ? headerLength
+    : HttpRequest::findHeaderLength(data);
+  if (headerEnd == 0) {
+    return 0;
+  }
+
+  // Look for the Content-Length fields, ignoring case, and check them as
+  // parseField() does. If the header will be rejected, its body is not
+  // waited for
+  const std::string_view field = "\ncontent-length:";
+  size_t bodyLength = 0;
+  bool found = false;
+  for (size_t start = data.find('\n'); start != std::string_view::npos
+      && start + field.length() < headerEnd;
+      start = data.find('\n', start + 1)) {
+    if (equalsIgnoreCase(data.substr(start, field.length()), field)) {
+      const size_t value = start + field.length();
+      std::string_view line = data.substr(value
+        , data.find('\n', value) - value);
+      if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+      }
+      if (found || HttpRequest::parseContentLength(trim(line), bodyLength)) {
+        return headerEnd;
+      }
+      found = true;
     }
+  }
 
-    // If empty line is found, the header is completely loaded
-    if (line.empty()) {
-      return true;
+  // The body is at most maxBodySize, so the sum cannot overflow
+  return bodyLength <= data.length() - headerEnd ? headerEnd + bodyLength : 0;
+}
+
+std::string_view HttpRequest::getHeader(std::string_view name) const {
+  for (size_t index = 0; index < this->fieldCount; ++index) {
+    if (equalsIgnoreCase(this->fields[index].name, name)) {
+      return this->fields[index].value;
     }
+  }
+  return std::string_view();
+}
 
-    // A header is a pair "Key: value"
-    size_t pos = line.find(':');
-    if (pos == line.npos) {
-      // Header has a non-valid entry
-      return false;
+std::string_view HttpRequest::getQueryParameter(std::string_view name) const {
+  for (size_t index = 0; index < this->queryFieldCount; ++index) {
+    if (this->queryFields[index].name == name) {
+      return this->queryFields[index].value;
     }
+  }
+  return std::string_view();
+}
 
-    // Get the key
-    const std::string& key = line.substr(0, pos);
+std::string_view HttpRequest::getFormParameter(std::string_view name) const {
+  // The form is encoded as a query string: "name=value" pairs joined by '&'
+  std::string_view rest = this->content;
+  while (!rest.empty()) {
+    const size_t ampersand = std::min(rest.find('&'), rest.length());
+    const std::string_view pair = rest.substr(0, ampersand);
+    rest.remove_prefix(std::min(ampersand + 1, rest.length()));
+    const size_t equal = pair.find('=');
+    if (pair.substr(0, equal) == name) {
+      return equal == std::string_view::npos ? std::string_view()
+        : pair.substr(equal + 1);
+    }
+  }
+  return std::string_view();
+}
 
-    // Ignore whitespace after colon such as "Key: value"
-    if (pos + 1 < line.length() && ::isspace(line[pos + 1])) {
-      ++pos;
+std::string_view HttpRequest::getPathParameter(std::string_view name) const {
+  for (size_t index = 0; index < this->pathParameterCount; ++index) {
+    if (this->pathParameters[index].name == name) {
+      return this->pathParameters[index].value;
     }
+  }
+  return std::string_view();
+}
+
+void HttpRequest::setPathParameters(const Header* parameters, size_t count) {
+  assert(count <= HttpRequest::maxPathParameterCount);
+  std::copy(parameters, parameters + count, this->pathParameters.begin());
+  this->pathParameterCount = count;
+}
 
-    // Get the value
-    const std::string& value = line.substr(pos + 1);
-    // Insert the (key, value) pair in the headers associative array
-    // REMARK: if a key is repeated, the new value overwrites the older one
-    this->headers[key] = value;
+std::string HttpRequest::decodeComponent(std::string_view text) {
+  std::string result;
+  result.reserve(text.length());
+  for (size_t index = 0; index < text.length(); ++index) {
+    int value = 0;
+    if (text[index] == '+') {
+      result += ' ';
+    } else if (text[index] == '%' && index + 2 < text.length()
+        && std::from_chars(text.data() + index + 1, text.data() + index + 3
+          , value, 16).ptr == text.data() + index + 3 && value >= 0) {
+      result += static_cast<char>(value);
+      index += 2;
+    } else {
+      result += text[index];
+    }
   }
+  return result;
 }
 
-bool HttpRequest::parseBody() {
-  // TODO(any): Multi-part requests are not supported. See Transfer-Encoding
-  // https://tools.ietf.org/html/rfc7230#section-3.3
+bool HttpRequest::isKeepAlive() const {
+  // The Connection field is a list of case-insensitive options
+  if (this->version == "HTTP/1.0") {
+    return containsIgnoreCase(this->connection, "keep-alive");
+  }
+  return !containsIgnoreCase(this->connection, "close");
+}
 
-  // String conversions may fail
-  try {
-    // If client provided a Content-length field, read the body
-    const std::string& value = this->getHeader("Content-Length");
-    if (value.length() > 0) {
-      // Convert the Content-Length value, an exception is raised on error
-      size_t size = std::stoull(value);
-      // Create a buffer, an exception is raised if no enough memory
-      std::vector<char> buffer(size);
-      // Read the body from the socket
-      if (!this->socket.read(buffer.data(), size)) {
+bool HttpRequest::parseHeader(std::string_view header) {
+  this->errorCode = 0;
+  this->fieldCount = 0;
+  this->pathParameterCount = 0;
+  this->host = this->connection = std::string_view();
+  this->contentLength = 0;
+
+  size_t start = 0;
+  bool requestLine = true;
+  while (start < header.length()) {
+    size_t end = header.find('\n', start);
+    assert(end != std::string_view::npos);
+    std::string_view line = header.substr(start, end - start);
+    start = end + 1;
+
+    // Remove trailing '\r' if any
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+
+    if (requestLine) {
+      if (!this->parseRequestLine(line)) {
         return false;
       }
-      // Use the data loaded into the buffer as the body of the message
-      // TODO(any): stringstream is not suitable to manage large/binary data
-      this->body().str(buffer.data());
+      requestLine = false;
+    } else if (line.empty()) {
+      // The empty line is the end of the header
+      return true;
+    } else if (!this->parseField(line)) {
+      return false;
     }
-  } catch (const std::exception& error) {
+  }
+  return false;
+}
+
+bool HttpRequest::parseRequestLine(std::string_view line) {
+  // The three fields are separated by whitespace
+  std::string_view* const parts[] = {&this->method, &this->uri, &this->version};
+  for (std::string_view* part : parts) {
+    const size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+      return false;
+    }
+    line.remove_prefix(start);
+    const size_t end = std::min(line.find_first_of(" \t"), line.length());
+    *part = line.substr(0, end);
+    line.remove_prefix(end);
+  }
+  this->parseUri();
+  return true;
+}
+
+void HttpRequest::parseUri() {
+  const size_t question = this->uri.find('?');
+  this->path = this->uri.substr(0, question);
+  this->query = question == std::string_view::npos ? std::string_view()
+    : this->uri.substr(question + 1);
+
+  // Parameters are separated by '&', and their values by '='
+  this->queryFieldCount = 0;
+  std::string_view rest = this->query;
+  while (!rest.empty() && this->queryFieldCount < HttpRequest::maxQueryCount) {
+    const size_t ampersand = std::min(rest.find('&'), rest.length());
+    const std::string_view pair = rest.substr(0, ampersand);
+    rest.remove_prefix(std::min(ampersand + 1, rest.length()));
+    if (pair.empty()) {
+      continue;
+    }
+    const size_t equal = pair.find('=');
+    Header& field = this->queryFields[this->queryFieldCount++];
+    field.name = pair.substr(0, equal);
+    field.value = equal == std::string_view::npos ? std::string_view()
+      : pair.substr(equal + 1);
+  }
+}
+
+bool HttpRequest::parseField(std::string_view line) {
+  // A header is a pair "Key: value"
+  const size_t colon = line.find(':');
+  if (colon == std::string_view::npos
+      || this->fieldCount == HttpRequest::maxHeaderCount) {
+    // Header has a non-valid entry, or too many of them
     return false;
   }
 
+  Header& field = this->fields[this->fieldCount++];
+  field.name = line.substr(0, colon);
+  field.value = trim(line.substr(colon + 1));
+
+  // Classify the fields the server looks at for each request. If a field is
+  // repeated, the last one is used, except Content-Length. Repeating it may
+  // make the server and a proxy disagree on where the next request starts
+  if (equalsIgnoreCase(field.name, "Content-Length")) {
+    for (size_t index = 0; index + 1 < this->fieldCount; ++index) {
+      if (equalsIgnoreCase(this->fields[index].name, field.name)) {
+        this->errorCode = 400;
+        return false;
+      }
+    }
+    this->errorCode = HttpRequest::parseContentLength(field.value
+      , this->contentLength);
+    return this->errorCode == 0;
+  }
+  if (equalsIgnoreCase(field.name, "Connection")) {
+    this->connection = field.value;
+  } else if (equalsIgnoreCase(field.name, "Host")) {
+    this->host = field.value;
+  }
   return true;
 }
+
+int HttpRequest::parseContentLength(std::string_view value, size_t& length) {
+  const char* const end = value.data() + value.length();
+  const std::from_chars_result result
+    = std::from_chars(value.data(), end, length);
+  // A number too long for size_t is also too long for the server
+  if (result.ec == std::errc::result_out_of_range && result.ptr == end) {
+    return 413;
+  }
+  if (result.ec != std::errc() || result.ptr != end) {
+    return 400;
+  }
+  return length > HttpRequest::maxBodySize ? 413 : 0;
+}
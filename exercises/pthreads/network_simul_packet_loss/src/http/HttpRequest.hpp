@@ -3,7 +3,9 @@
 #ifndef HTTPREQUEST_H
 #define HTTPREQUEST_H
 
+#include <array>
 #include <string>
+#include <string_view>
 
 #include "HttpMessage.hpp"
 
@@ -12,43 +14,166 @@ class Socket;
 /**
  * @brief Manages request messages coming from clients.
  * @details See https://jeisson.ecci.ucr.ac.cr/appweb/material/#http_messages
+ *
+ * The request is parsed in place, in a single pass over the input buffer of
+ * the socket. Method, URI, version, headers and body are views into that
+ * buffer, so parsing a request does not allocate memory. The views are valid
+ * until the next read from the socket, that is, while the request is served.
+ * Copy them if they are needed later.
  */
 class HttpRequest : public HttpMessage {
  public:
   /// Objects of this class can be copied, but avoid innecesary copies
   DECLARE_RULE4(HttpRequest, default);
+  /// Largest request header accepted. Longer ones make parsing fail
+  static constexpr size_t maxHeaderSize = 65536;
+  /// Largest request body accepted. Requests that announce a longer one are
+  /// rejected before their body is received
+  static constexpr size_t maxBodySize = 1048576;
+  /// Maximum number of header fields in a request
+  static constexpr size_t maxHeaderCount = 64;
+  /// Maximum number of query parameters kept. Further ones are ignored
+  static constexpr size_t maxQueryCount = 64;
+  /// Maximum number of parameters captured from the path by a route
+  static constexpr size_t maxPathParameterCount = 16;
+
+  /// A "Name: value" field of the request header
+  struct Header {
+    /// Name of the field, e.g: "Accept"
+    std::string_view name;
+    /// Value of the field without surrounding whitespace
+    std::string_view value;
+  };
 
  protected:
   /// HTTP method: GET, POST, HEADERS, DELETE, UPDATE, ...
-  std::string method;
+  std::string_view method;
   /// URI /path?query=string#fragment
-  std::string uri;
+  std::string_view uri;
+  /// HTTP version used by the client, e.g: HTTP/1.1
+  std::string_view version;
+  /// The part of the URI before the '?'
+  std::string_view path;
+  /// The part of the URI after the '?', empty if there is no query
+  std::string_view query;
+  /// Query parameters "name=value" in the order the client sent them. Their
+  /// names and values are not decoded
+  std::array<Header, maxQueryCount> queryFields;
+  /// Number of used entries of the query fields array
+  size_t queryFieldCount = 0;
+  /// Parameters captured from the path by the route that matched, e.g:
+  /// {"id", "13"} for the route "/jobs/:id" and the path "/jobs/13"
+  std::array<Header, maxPathParameterCount> pathParameters;
+  /// Number of used entries of the path parameters array
+  size_t pathParameterCount = 0;
+  /// Header fields in the order the client sent them
+  std::array<Header, maxHeaderCount> fields;
+  /// Number of used entries of the fields array
+  size_t fieldCount = 0;
+  /// Value of the Host field, classified while parsing
+  std::string_view host;
+  /// Value of the Connection field, classified while parsing
+  std::string_view connection;
+  /// Value of the Content-Length field, 0 if it was not sent
+  size_t contentLength = 0;
+  /// The body of the request, Content-Length bytes after the header
+  std::string_view content;
+  /// Bytes of the request received from the client, header and body
+  size_t length = 0;
+  /// Status code to answer a request that parse() rejected, e.g: 413, or 0
+  /// if the connection must be closed without an answer
+  int errorCode = 0;
 
  public:
   /// Constructor
   explicit HttpRequest(const Socket& socket);
   /// Destructor
   ~HttpRequest();
-  /// Parses an HTTP request from the data sent from the socket
-  /// @return true on success, false on error or connection closed by peer
+  /// Parses an HTTP request from the data sent from the socket. It never
+  /// throws
+  /// @return true on success, false on error or connection closed by peer.
+  /// If the request was rejected, @a getErrorCode() tells the status code to
+  /// answer it
   bool parse();
+  /// Find out if the given data starts with a complete HTTP request, that is,
+  /// its header and all the body announced by its Content-Length. This is
+  /// used to parse requests only after they arrived through non-blocking
+  /// sockets. The Content-Length fields are checked as parse() does
+  /// @param headerLength The length of the header if it was already found
+  /// with @a findHeaderLength(), 0 to search it
+  /// @return The length in bytes of the first request, 0 if it is incomplete.
+  /// The length of the header if parse() will reject it, e.g: its body is
+  /// longer than maxBodySize or it has several Content-Length fields
+  static size_t findRequestLength(std::string_view data,
+    size_t headerLength = 0);
+  /// Find the end of the header, that is the first empty line, searching from
+  /// the given position. Lines may end with "\r\n" or "\n"
+  /// @return The length in bytes of the header including the empty line, 0 if
+  /// the header is incomplete
+  static size_t findHeaderLength(std::string_view data, size_t from = 0);
   /// Get access to the HTTP method used by client
-  inline const std::string& getMethod() const { return this->method; }
+  inline std::string_view getMethod() const { return this->method; }
   /// Get access to the resource address (URI) asked by client
-  inline const std::string& getURI() const { return this->uri; }
+  inline std::string_view getURI() const { return this->uri; }
   /// Get access to the HTTP version used by client
-  inline const std::string& getHttpVersion() const { return this->httpVersion; }
+  inline std::string_view getHttpVersion() const { return this->version; }
+  /// Get the path of the URI, without the query string
+  inline std::string_view getPath() const { return this->path; }
+  /// Get the query string of the URI, without the '?'
+  inline std::string_view getQuery() const { return this->query; }
+  /// Get the value of the first query parameter with the given name. The
+  /// value is not decoded, @see decodeComponent()
+  /// @return The value, or an empty view if the client did not send it
+  std::string_view getQueryParameter(std::string_view name) const;
+  /// Get the value of the first parameter with the given name of a form sent
+  /// in the body as "application/x-www-form-urlencoded", e.g: by a POST. The
+  /// value is not decoded, @see decodeComponent()
+  /// @return The value, or an empty view if the client did not send it
+  std::string_view getFormParameter(std::string_view name) const;
+  /// Get the value of a parameter captured from the path by the route, e.g:
+  /// "id" for "/jobs/:id". The value is not decoded
+  /// @return The value, or an empty view if the route has no such parameter
+  std::string_view getPathParameter(std::string_view name) const;
+  /// Set the parameters captured from the path. Called by the router
+  void setPathParameters(const Header* parameters, size_t count);
+  /// Decode %XX escapes and '+' of a URI component, e.g: a query value
+  static std::string decodeComponent(std::string_view text);
+  /// Get the value of a header field, ignoring case of the name
+  /// @return The value, or an empty view if the client did not send it
+  std::string_view getHeader(std::string_view name) const;
+  /// Get the value of the Host field
+  inline std::string_view getHost() const { return this->host; }
+  /// Get the number of bytes of the body announced by the client
+  inline size_t getContentLength() const { return this->contentLength; }
+  /// Get the body sent by the client. Requests do not fill body()
+  inline std::string_view getBody() const { return this->content; }
+  /// Get the bytes of the request received from the client, header and body
+  inline size_t getLength() const { return this->length; }
+  /// Get the status code to answer a request that parse() rejected, e.g: 400
+  /// for a non-valid Content-Length, or 0 if there is no answer
+  inline int getErrorCode() const { return this->errorCode; }
+  /// Returns true if the client wants to send further requests through the
+  /// same connection. HTTP/1.1 connections persist unless the client sends
+  /// "Connection: close". HTTP/1.0 ones only with "Connection: keep-alive"
+  bool isKeepAlive() const;
 
  protected:
-  /// Parse the request line from the socket
-  /// @return true on success, false on error or connection closed by peer
-  bool parseRequestLine();
-  /// Parse the message header, containing pairs "key: value" of metadata
-  /// @return true on success, false on error or connection closed by peer
-  bool parseHeader();
-  /// Parse the optional message body content, if any
-  /// @return true on success, false on error or connection closed by peer
-  bool parseBody();
+  /// Parse the request line and the header fields in a single pass
+  /// @param header The header, including the empty line that ends it
+  /// @return true on success, false if the header is not valid
+  bool parseHeader(std::string_view header);
+  /// Parse the request line, e.g: "GET /index.html HTTP/1.1"
+  /// @return true on success, false if the line is not valid
+  bool parseRequestLine(std::string_view line);
+  /// Split the URI in path and query, and the query in its parameters
+  void parseUri();
+  /// Parse a "Name: value" line and classify well-known fields
+  /// @return true on success, false if the line is not valid
+  bool parseField(std::string_view line);
+  /// Parse the value of a Content-Length field
+  /// @return 0 if it is valid, 400 if it is not a number, or 413 if it is
+  /// longer than maxBodySize
+  static int parseContentLength(std::string_view value, size_t& length);
 };
 
 #endif  // HTTPREQUEST_H
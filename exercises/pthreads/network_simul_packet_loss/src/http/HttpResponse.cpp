@@ -3,6 +3,7 @@
 #include <cassert>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 #include "HttpResponse.hpp"
 #include "Socket.hpp"
@@ -39,61 +40,108 @@ bool HttpResponse::setStatusCode(int statusCode,
   return false;
 }
 
+void HttpResponse::setBodyFile(int fileDescriptor, size_t length
+  , off_t offset) {
+  this->bodyFile = fileDescriptor;
+  this->bodyFileOffset = offset;
+  this->bodyFileLength = length;
+}
+
+void HttpResponse::setBodyView(std::string_view body) {
+  this->bodyView = body;
+}
+
+void HttpResponse::setHeaderLines(std::string_view lines) {
+  this->headerLines = lines;
+}
+
 bool HttpResponse::send() {
   const std::string& sep = HttpMessage::lineSeparator;
 
-  // Send status line, e.g: "HTTP/1.0 200 Tuanis\r\n"
-  this->socket << this->buildStatusLine() << sep;
+  // Build the status line, e.g: "HTTP/1.0 200 Tuanis\r\n", and the header in
+  // a buffer that is usually small compared to the body
+  std::string header;
+  header.reserve(256);
+  header.append(this->httpVersion).append(1, ' ')
+    .append(std::to_string(this->statusCode)).append(1, ' ')
+    .append(this->reasonPhrase).append(sep);
 
-  // Send message header
+  // Build message header
   for (HttpMessage::Headers::const_iterator itr = this->headers.begin();
     itr != this->headers.end(); ++itr) {
-    // Send a metadata pair of key: value, e.g: "Server: My Web Server"
-    this->socket << itr->first << ": " << itr->second << sep;
+    // A metadata pair of key: value, e.g: "Server: My Web Server"
+    header.append(itr->first).append(": ").append(itr->second).append(sep);
   }
 
-  // Build and send Content-Type and Content-Length from body
-  if (!this->sendBodyMetadata()) {
-    return false;
+  // Header lines formatted by the application, e.g: cached with a file
+  header.append(this->headerLines);
+
+  // 1xx, 204, and 304 responses have no body. See RFC-7230
+  // https://tools.ietf.org/html/rfc7230#section-3.3
+  const bool hasBody = this->statusCode >= 200 && this->statusCode != 204
+    && this->statusCode != 304;
+
+  // Build Content-Type and Content-Length from body
+  if (hasBody) {
+    this->appendBodyMetadata(header);
   }
 
   // HTTP Messages must separate header and body by an empty line
-  this->socket << sep;
+  header.append(sep);
 
-  // Send the body contents
-  // TODO(any): body must be skipped in responses to HEAD/CONNECT request
-  // methods and for 1xx, 204, and 304 responses. See RFC-7230
-  // https://tools.ietf.org/html/rfc7230#section-3.3
-  // TODO(any): stringstream is not suitable for binary data
-  this->socket << this->body().str();
+  // TODO(any): body must be skipped in responses to CONNECT requests
+  struct iovec buffers[2] = {{header.data(), header.length()}, {nullptr, 0}};
+  this->length = header.length();
+  if (!hasBody || this->bodySkipped) {
+    return this->socket.send(buffers, 1);
+  }
+
+  // A file body is sent by the kernel after the header
+  if (this->bodyFile >= 0) {
+    this->length += this->bodyFileLength;
+    return this->socket.send(buffers, 1, /*more*/ true)
+      && this->socket.sendFile(this->bodyFile, this->bodyFileOffset
+        , this->bodyFileLength);
+  }
 
-  // Flush de bytes to the peer
-  return this->socket.send();
+  // The body is sent from the body view or the body stream storage, together
+  // with the header in a single system call
+  int count = 1;
+  if (this->bodyView.data()) {
+    buffers[1] = {const_cast<char*>(this->bodyView.data())
+      , this->bodyView.length()};
+    count = 2;
+  } else if (this->sharedBody) {
+    const std::string_view body = this->sharedBody->view();
+    buffers[1] = {const_cast<char*>(body.data()), body.length()};
+    count = 2;
+  }
+  this->length += buffers[1].iov_len;
+  return this->socket.send(buffers, count);
 }
 
-bool HttpResponse::sendBodyMetadata() {
+void HttpResponse::appendBodyMetadata(std::string& header) const {
   const std::string& sep = HttpMessage::lineSeparator;
 
   // Check Content-Type was provided
-  const std::string& contentType = this->getHeader("Content-Type");
-  if (contentType.empty()) {
-    // No Content-Type was set, guess one and send it to client
-    const std::string& guess = this->guessContentType();
-    if (guess.length() > 0 && !(this->socket << guess << sep)) {
-      // return false;
+  if (this->headers.find("Content-Type") == this->headers.end()) {
+    // No Content-Type was set, guess one from the body stream
+    const std::string& guess = this->bodyFile >= 0 || this->bodyView.data()
+      || !this->sharedBody ? std::string() : this->guessContentType();
+    if (guess.length() > 0) {
+      header.append("Content-Type: ").append(guess).append(sep);
     }
   }
 
   // Check Content-length was provided
-  const std::string& contentLength = this->getHeader("Content-Length");
-  if (contentLength.empty()) {
+  if (this->headers.find("Content-Length") == this->headers.end()) {
     // No Content-length was set, send the body length
-    if (!(this->socket << "Content-Length: " << this->getBodyLength() << sep)) {
-      // return false;
-    }
+    const size_t length = this->bodyFile >= 0 ? this->bodyFileLength
+      : this->bodyView.data() ? this->bodyView.length()
+      : this->sharedBody ? this->getBodyLength() : 0;
+    header.append("Content-Length: ").append(std::to_string(length))
+      .append(sep);
   }
-
-  return true;
 }
 
 std::string HttpResponse::buildStatusLine() const {
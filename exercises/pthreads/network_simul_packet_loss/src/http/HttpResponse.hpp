@@ -3,8 +3,11 @@
 #ifndef HTTPRESPONSE_H
 #define HTTPRESPONSE_H
 
+#include <sys/types.h>
+
 #include <map>
 #include <string>
+#include <string_view>
 #include <sstream>
 
 #include "HttpMessage.hpp"
@@ -30,6 +33,23 @@ class HttpResponse : public HttpMessage {
   int statusCode = 200;
   /// Status text, e.g: "OK" for 200, and "Internal server error" for 500
   std::string reasonPhrase;
+  /// Open file whose contents are sent as body instead of the body stream,
+  /// or -1 if the body stream is used. This object does not close it
+  int bodyFile = -1;
+  /// Position of the first byte of the body within the body file
+  off_t bodyFileOffset = 0;
+  /// Amount of bytes of the body file to send
+  size_t bodyFileLength = 0;
+  /// Memory whose contents are sent as body instead of the body stream, or
+  /// a null view if not used. This object does not own it
+  std::string_view bodyView;
+  /// Header lines already formatted by the application, e.g: cached with a
+  /// file. This object does not own them
+  std::string_view headerLines;
+  /// True if the body metadata is sent, but not the body, e.g: for HEAD
+  bool bodySkipped = false;
+  /// Bytes of the status line, header, and body given to send()
+  size_t length = 0;
 
  public:
   /// Constructor
@@ -49,18 +69,41 @@ class HttpResponse : public HttpMessage {
   /// reject the status code and return false;
   /// @return true if the statusCode is accepted, false if it is rejected
   bool setStatusCode(int statusCode, const std::string& reasonPhrase = "");
+  /// Get the status code, e.g: 200
+  inline int getStatusCode() const { return this->statusCode; }
   /// Build the status line, e.g: "HTTP/1.1 200 OK" or "HTTP/1.0 404 Not found"
   /// Text is built from values of the member attributes of this object
   std::string buildStatusLine() const;
-  /// Send this response to the peer through the Socket
+  /// Send a region of an open file as body, instead of the body stream. The
+  /// kernel copies the file to the socket, so it is suitable for large files.
+  /// The file must remain open until @a send() returns. Content-Type cannot
+  /// be guessed from a file, so set it if known
+  void setBodyFile(int fileDescriptor, size_t length, off_t offset = 0);
+  /// Send the given memory as body, instead of the body stream. The memory
+  /// must remain valid until @a send() returns. Content-Type cannot be
+  /// guessed from it, so set it if known
+  void setBodyView(std::string_view body);
+  /// Send the given lines after the headers, e.g: "ETag: \"1a\"\r\n". Each
+  /// line must end with a line separator. The text must remain valid until
+  /// @a send() returns
+  void setHeaderLines(std::string_view lines);
+  /// Send the metadata of the body, but not the body, as responses to HEAD
+  /// requests must do
+  inline void skipBody() { this->bodySkipped = true; }
+  /// Send this response to the peer through the Socket. The status line and
+  /// headers are built in a small buffer, and they are sent together with the
+  /// body without copying the body
   /// @return true on success, false on error or connection closed by peer
   bool send();
+  /// Get the bytes of the status line, header, and body of the last call to
+  /// @a send(), or 0 if it was not called
+  inline size_t getLength() const { return this->length; }
 
  protected:
-  /// Build the "Content-Type" and "Content-Length" metadata to the peer if
-  /// there are already in the headers associative array. It tries to get these
-  /// values by looking at the body object
-  bool sendBodyMetadata();
+  /// Append the "Content-Type" and "Content-Length" metadata to the given
+  /// header text if they are not already in the headers associative array.
+  /// It tries to get these values by looking at the body object or file
+  void appendBodyMetadata(std::string& header) const;
 };
 
 #endif  // HTTPRESPONSE_H
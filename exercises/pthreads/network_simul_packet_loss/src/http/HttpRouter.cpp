@@ -0,0 +1,140 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <stdexcept>
+#include <string>
+
+#include "HttpRouter.hpp"
+
+HttpRouter::HttpRouter() {
+}
+
+HttpRouter::~HttpRouter() {
+}
+
+void HttpRouter::addRoute(const std::string& method,
+    const std::string& pattern, const Handler& handler) {
+  // Walk the pattern creating the nodes of its segments
+  Node* node = &this->root;
+  size_t parameters = 0;
+  size_t start = 0;
+  while (start < pattern.length()) {
+    size_t end = pattern.find('/', start);
+    if (end == std::string::npos) {
+      end = pattern.length();
+    }
+    const std::string segment = pattern.substr(start, end - start);
+    start = end + 1;
+    if (segment.empty()) {
+      continue;
+    }
+
+    // Parameters and wildcards of a node must have a single name
+    if (segment[0] == ':' || segment[0] == '*') {
+      std::unique_ptr<Node>& child
+        = segment[0] == ':' ? node->parameter : node->wildcard;
+      std::string& name
+        = segment[0] == ':' ? node->parameterName : node->wildcardName;
+      if (segment.length() == 1 || (child && name != segment.substr(1))
+          || ++parameters > HttpRequest::maxPathParameterCount
+          || (segment[0] == '*' && start < pattern.length())) {
+        throw std::invalid_argument("invalid route pattern " + pattern);
+      }
+      if (!child) {
+        child.reset(new Node());
+        name = segment.substr(1);
+      }
+      node = child.get();
+    } else {
+      std::unique_ptr<Node>& child = node->children[segment];
+      if (!child) {
+        child.reset(new Node());
+      }
+      node = child.get();
+    }
+  }
+
+  const Route route = {handler, this->routeNames.size()};
+  if (!node->routes.emplace(method, route).second) {
+    throw std::invalid_argument("route already registered " + method + ' '
+      + pattern);
+  }
+  this->routeNames.emplace_back(method, pattern);
+}
+
+const HttpRouter::Route* HttpRouter::findRoute(HttpRequest& httpRequest)
+    const {
+  Captures captures;
+  const Route* route = this->match(this->root, httpRequest.getPath(), 0
+    , httpRequest.getMethod(), captures);
+  if (route) {
+    httpRequest.setPathParameters(captures.values.data(), captures.count);
+  }
+  return route;
+}
+
+const HttpRouter::Route* HttpRouter::match(const Node& node,
+    std::string_view path, size_t position, std::string_view method,
+    Captures& captures) const {
+  // Skip the separators before the next segment
+  while (position < path.length() && path[position] == '/') {
+    ++position;
+  }
+
+  // At the end of the path, this node must have a route for the method. A
+  // wildcard also matches an empty rest of the path
+  if (position == path.length()) {
+    if (const Route* route = HttpRouter::getNodeRoute(node, method)) {
+      return route;
+    }
+    if (node.wildcard) {
+      if (const Route* route
+          = HttpRouter::getNodeRoute(*node.wildcard, method)) {
+        captures.values[captures.count++]
+          = {node.wildcardName, path.substr(position)};
+        return route;
+      }
+    }
+    return nullptr;
+  }
+
+  size_t end = path.find('/', position);
+  if (end == std::string_view::npos) {
+    end = path.length();
+  }
+  const std::string_view segment = path.substr(position, end - position);
+
+  // Try the literal segment first, then the parameter, and the wildcard
+  const auto& literal = node.children.find(segment);
+  if (literal != node.children.end()) {
+    if (const Route* route
+        = this->match(*literal->second, path, end, method, captures)) {
+      return route;
+    }
+  }
+  if (node.parameter) {
+    captures.values[captures.count++] = {node.parameterName, segment};
+    if (const Route* route
+        = this->match(*node.parameter, path, end, method, captures)) {
+      return route;
+    }
+    --captures.count;
+  }
+  if (node.wildcard) {
+    if (const Route* route
+        = HttpRouter::getNodeRoute(*node.wildcard, method)) {
+      captures.values[captures.count++]
+        = {node.wildcardName, path.substr(position)};
+      return route;
+    }
+  }
+  return nullptr;
+}
+
+const HttpRouter::Route* HttpRouter::getNodeRoute(const Node& node,
+    std::string_view method) {
+  auto found = node.routes.find(method);
+  if (found == node.routes.end()) {
+    found = node.routes.find("*");
+  }
+  return found == node.routes.end() ? nullptr : &found->second;
+}
@@ -0,0 +1,119 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef HTTPROUTER_H
+#define HTTPROUTER_H
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "HttpRequest.hpp"
+
+class HttpResponse;
+
+/**
+@brief Finds the handler of a request by its method and path
+Applications register routes before the server starts. A route is a method and
+a path pattern, e.g: "GET /heatsim/jobs/:id". Patterns are compiled into a
+tree with a node per path segment, so finding the route of a request walks
+the path once, instead of asking each application in turn. Segments of a
+pattern may be:
+
+- A literal, e.g: "jobs", that matches the same segment.
+- A parameter, e.g: ":id", that matches any segment, and captures it.
+- A wildcard as last segment, e.g: "*path", that matches the rest of the path,
+  even if it is empty, and captures it.
+
+Literals are preferred over parameters, and parameters over wildcards. Empty
+segments are ignored, so "/heatsim/" matches the pattern "/heatsim". The
+method "*" matches any method. The router is not modified while the server
+runs, so connection handlers use it concurrently without locks.
+*/
+class HttpRouter {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(HttpRouter);
+
+ public:
+  /// Serves a request. Returns false if the request was not served, and
+  /// another application should do it
+  typedef std::function<bool(HttpRequest&, HttpResponse&)> Handler;
+  /// A registered route
+  struct Route {
+    /// Serves the requests of the route
+    Handler handler;
+    /// Number of the route in order of registration, from 0
+    size_t number;
+  };
+
+ protected:
+  /// A segment of the patterns. The root node is the empty path
+  struct Node {
+    /// Nodes of the literal segments that follow this one
+    std::map<std::string, std::unique_ptr<Node>, std::less<>> children;
+    /// Node of the parameter segment that follows this one, if any
+    std::unique_ptr<Node> parameter;
+    /// Name of the parameter segment, without the ':'
+    std::string parameterName;
+    /// Node of the wildcard segment that follows this one, if any
+    std::unique_ptr<Node> wildcard;
+    /// Name of the wildcard segment, without the '*'
+    std::string wildcardName;
+    /// Routes of the patterns that end at this node, by method
+    std::map<std::string, Route, std::less<>> routes;
+  };
+
+  /// Parameters captured while walking the tree
+  struct Captures {
+    /// Name and value of each captured parameter
+    std::array<HttpRequest::Header, HttpRequest::maxPathParameterCount> values;
+    /// Number of used entries of the values array
+    size_t count = 0;
+  };
+
+ protected:
+  /// The node of the empty path
+  Node root;
+  /// Method and pattern of each route, by number
+  std::vector<std::pair<std::string, std::string>> routeNames;
+
+ public:
+  /// Constructor
+  HttpRouter();
+  /// Destructor
+  ~HttpRouter();
+  /// Register a handler for the requests with the given method and path
+  /// @throw std::invalid_argument if the pattern is not valid, or it is
+  /// registered already for the method
+  void addRoute(const std::string& method, const std::string& pattern,
+    const Handler& handler);
+  /// Find the route of the request, and set the parameters captured from
+  /// its path
+  /// @return The route, or null if no route matches the request
+  const Route* findRoute(HttpRequest& httpRequest) const;
+  /// Get the number of registered routes
+  inline size_t getRouteCount() const { return this->routeNames.size(); }
+  /// Get the method of the route with the given number, e.g: "GET"
+  inline const std::string& getRouteMethod(size_t number) const {
+    return this->routeNames[number].first;
+  }
+  /// Get the pattern of the route with the given number, e.g: "/fact/:numbers"
+  inline const std::string& getRoutePattern(size_t number) const {
+    return this->routeNames[number].second;
+  }
+
+ protected:
+  /// Match the path from the given position with the subtree of the node
+  /// @return The matched route, or null
+  const Route* match(const Node& node, std::string_view path,
+    size_t position, std::string_view method, Captures& captures) const;
+  /// Get the route of the node for the method, or for any method
+  static const Route* getNodeRoute(const Node& node, std::string_view method);
+};
+
+#endif  // HTTPROUTER_H
@@ -1,24 +1,32 @@
 // Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
 
+#include <algorithm>
 #include <cassert>
+#include <csignal>
+#include <cstdlib>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 #include "HttpApp.hpp"
-#include "HttpServer.hpp"
+#include "HttpConnectionHandler.hpp"
+#include "HttpEventHandler.hpp"
 #include "HttpRequest.hpp"
-#include "HttpResponse.hpp"
+#include "HttpServer.hpp"
 #include "Log.hpp"
 #include "NetworkAddress.hpp"
 #include "Socket.hpp"
 
-// TODO(you): Implement connection handlers argument
 const char* const usage =
-  "Usage: webserv [port] [handlers]\n"
+  "Usage: webserv [port] [handlers] [threads|epoll]\n"
   "\n"
   "  port        Network port to listen incoming HTTP requests, default "
     DEFAULT_PORT "\n"
-  "  handlers     Number of connection handler theads\n";
+  "  handlers    Number of connection handler theads, default number of "
+    "cores\n"
+  "  threads     Serve each connection on a handler thread (default)\n"
+  "  epoll       Serve all connections from an event loop, and their requests\n"
+  "              on the handler threads\n";
 
 HttpServer::HttpServer() {
 }
@@ -33,12 +41,21 @@ void HttpServer::listenForever(const char* port) {
 void HttpServer::chainWebApp(HttpApp* application) {
   assert(application);
   this->applications.push_back(application);
+  if (!application->registerRoutes(this->router)) {
+    this->chainedApplications.push_back(application);
+  }
 }
 
 int HttpServer::run(int argc, char* argv[]) {
   bool stopApps = false;
+  bool stopHandlers = false;
   try {
     if (this->analyzeArguments(argc, argv)) {
+      // A client that closes its connection while a response is being sent,
+      // e.g: a file with sendfile(), must make that write fail with EPIPE
+      // instead of killing the whole server with SIGPIPE
+      std::signal(SIGPIPE, SIG_IGN);
+
       // Start the log service
       Log::getInstance().start();
 
@@ -46,6 +63,10 @@ int HttpServer::run(int argc, char* argv[]) {
       this->startApps();
       stopApps = true;
 
+      // Start the threads that will serve the accepted connections
+      this->startHandlers();
+      stopHandlers = true;
+
       // Start waiting for connections
       // TODO(you): Log the main thread id
       this->listenForConnections(this->port);
@@ -59,12 +80,22 @@ int HttpServer::run(int argc, char* argv[]) {
       // that stops the acceptAllConnections() invocation and enters in the
       // catch below. Then, the main thread can continue stopping apps,
       /// finishing the server and any further cleaning it requires.
-      this->acceptAllConnections();
+      /// In event loop mode, pollAllConnections() just returns
+      if (this->eventLoop) {
+        this->pollAllConnections();
+      } else {
+        this->acceptAllConnections();
+      }
     }
   } catch (const std::runtime_error& error) {
     std::cerr << "error: " << error.what() << std::endl;
   }
 
+  // Pending connections are served while the applications are still running
+  if (stopHandlers) {
+    this->stopHandlers();
+  }
+
   // If applications were started
   if (stopApps) {
     this->stopApps();
@@ -109,103 +140,94 @@ bool HttpServer::analyzeArguments(int argc, char* argv[]) {
     this->port = argv[1];
   }
 
-  return true;
-}
+  // By default, one connection handler per core
+  this->handlerCount = std::max(std::thread::hardware_concurrency(), 1u);
+  if (argc >= 3) {
+    char* end = nullptr;
+    const long handlerCount = std::strtol(argv[2], &end, 10);  // NOLINT
+    if (*end != '\0' || handlerCount <= 0) {
+      std::cerr << "error: invalid handler count: " << argv[2] << std::endl
+        << usage;
+      return false;
+    }
+    this->handlerCount = static_cast<size_t>(handlerCount);
+  }
 
-void HttpServer::handleClientConnection(Socket& client) {
-  // TODO(you): Make this method concurrent. Store client connections (sockets)
-  // into a collection (e.g thread-safe queue) and stop in web server
-
-  // TODO(you): Move following loop to a consumer HttpConnectionHandler class
-
-  // While the same client asks for HTTP requests in the same connection
-  while (true) {
-    // Create an object that parses the HTTP request from the socket
-    HttpRequest httpRequest(client);
-
-    // If the request is not valid or an error happened
-    if (!httpRequest.parse()) {
-      // Non-valid requests are normal after a previous valid request. Do not
-      // close the connection yet, because the valid request may take time to
-      // be processed. Just stop waiting for more requests
-      break;
+  if (argc >= 4) {
+    const std::string mode = argv[3];
+    if (mode != "threads" && mode != "epoll") {
+      std::cerr << "error: unknown mode: " << mode << std::endl << usage;
+      return false;
     }
+    this->eventLoop = mode == "epoll";
+  }
 
-    // A complete HTTP client request was received. Create an object for the
-    // server responds to that client's request
-    HttpResponse httpResponse(client);
+  // A single thread accepts connections in event loop mode. While it serves
+  // other events, clients must wait in the backlog instead of being refused
+  if (this->eventLoop) {
+    this->connectionQueueCapacity = SOMAXCONN;
+  }
 
-    // Give subclass a chance to respond the HTTP request
-    const bool handled = this->handleHttpRequest(httpRequest, httpResponse);
+  return true;
+}
 
-    // If subclass did not handle the request or the client used HTTP/1.0
-    if (!handled || httpRequest.getHttpVersion() == "HTTP/1.0") {
-      // The socket will not be more used, close the connection
-      client.close();
-      break;
+void HttpServer::startHandlers() {
+  for (size_t index = 0; index < this->handlerCount; ++index) {
+    if (this->eventLoop) {
+      this->handlers.push_back(new HttpEventHandler(&this->connectionQueue
+        , *this));
+    } else {
+      this->handlers.push_back(new HttpConnectionHandler(
+        &this->connectionQueue, *this));
     }
-
-    // This version handles just one client request per connection
-    // TODO(you): Remove this break after parallelizing this method
-    break;
+    this->handlers[index]->startThread();
   }
+  Log::append(Log::INFO, "webserver", std::to_string(this->handlerCount)
+    + (this->eventLoop ? " event" : " connection") + " handlers started");
 }
 
-// TODO(you): Move the following methods to your HttpConnectionHandler
-
-bool HttpServer::handleHttpRequest(HttpRequest& httpRequest,
-    HttpResponse& httpResponse) {
-  // Print IP and port from client
-  const NetworkAddress& address = httpRequest.getNetworkAddress();
-  Log::append(Log::INFO, "connection",
-    std::string("connection established with client ") + address.getIP()
-    + " port " + std::to_string(address.getPort()));
-
-  // Print HTTP request
-  Log::append(Log::INFO, "request", httpRequest.getMethod()
-    + ' ' + httpRequest.getURI()
-    + ' ' + httpRequest.getHttpVersion());
-
-  return this->route(httpRequest, httpResponse);
+void HttpServer::stopHandlers() {
+  // The stop conditions are queued after the pending connections, so they are
+  // served before the handlers finish
+  for (size_t index = 0; index < this->handlers.size(); ++index) {
+    this->connectionQueue.enqueue(Socket());
+  }
+  for (HttpConnectionHandler* handler : this->handlers) {
+    handler->waitToFinish();
+    delete handler;
+  }
+  this->handlers.clear();
+  Log::append(Log::INFO, "webserver", "connection handlers stopped");
 }
 
-// TODO(you): Provide HttpConnectionHandler access to the array of web apps
+void HttpServer::handleClientConnection(Socket& client) {
+  // A connection handler will serve the client's requests, and release it
+  this->connectionCount.fetch_add(1, std::memory_order_relaxed);
+  this->connectionQueue.enqueue(client);
+}
 
-bool HttpServer::route(HttpRequest& httpRequest, HttpResponse& httpResponse) {
-  // Traverse the chain of applications
-  for (size_t index = 0; index < this->applications.size(); ++index) {
-    // If this application handles the request
-    HttpApp* app = this->applications[index];
-    if (app->handleHttpRequest(httpRequest, httpResponse)) {
-      return true;
-    }
+void HttpServer::handleClientData(Socket& client) {
+  // Only the data that arrived since the last call is searched for the end of
+  // the header. Hence, a slow client does not make the loop rescan it
+  const std::string_view pending = client.getPendingInput();
+  const size_t headerLength = HttpRequest::findHeaderLength(pending
+    , client.getScannedInput());
+  if (headerLength == 0) {
+    // The end of the last line searched may be the start of the empty line.
+    // Wait for the rest of the header, unless it is too long
+    client.setScannedInput(pending.length() > 2 ? pending.length() - 3 : 0);
+    this->resumeClient(client, pending.length() <= HttpRequest::maxHeaderSize);
+    return;
   }
 
-  // Unrecognized request
-  return this->serveNotFound(httpRequest, httpResponse);
-}
-
-bool HttpServer::serveNotFound(HttpRequest& httpRequest
-  , HttpResponse& httpResponse) {
-  (void)httpRequest;
-
-  // Set HTTP response metadata (headers)
-  httpResponse.setStatusCode(404);
-  httpResponse.setHeader("Server", "AttoServer v1.0");
-  httpResponse.setHeader("Content-type", "text/html; charset=ascii");
-
-  // Build the body of the response
-  std::string title = "Not found";
-  httpResponse.body() << "<!DOCTYPE html>\n"
-    << "<html lang=\"en\">\n"
-    << "  <meta charset=\"ascii\"/>\n"
-    << "  <title>" << title << "</title>\n"
-    << "  <style>body {font-family: monospace} h1 {color: red}</style>\n"
-    << "  <h1>" << title << "</h1>\n"
-    << "  <p>The requested resouce was not found on this server.</p>\n"
-    << "  <hr><p><a href=\"/\">Homepage</a></p>\n"
-    << "</html>\n";
-
-  // Send the response to the client (user agent)
-  return httpResponse.send();
+  // The header is found again at once while the body arrives
+  client.setScannedInput(headerLength >= 3 ? headerLength - 3 : 0);
+  if (HttpRequest::findRequestLength(pending, headerLength) > 0) {
+    // An event handler will answer the buffered requests. A header that
+    // announces a too long body is answered without waiting for it
+    this->connectionQueue.enqueue(client);
+  } else {
+    // Wait for the rest of the body, that is at most HttpRequest::maxBodySize
+    this->resumeClient(client);
+  }
 }
@@ -5,13 +5,16 @@
 
 #include <vector>
 
+#include "HttpMetrics.hpp"
+#include "HttpRouter.hpp"
+#include "Queue.hpp"
+#include "Socket.hpp"
 #include "TcpServer.hpp"
-#include "HttpRequest.hpp"
-#include "HttpResponse.hpp"
 
 #define DEFAULT_PORT "8080"
 
 class HttpApp;
+class HttpConnectionHandler;
 
 /**
 @brief Implements a minimalist web server.
@@ -53,10 +56,34 @@ that the request was not intended for the lottery application, and the server
 repeats the process with the following application in the chain: the pets
 application. If no application manages the request, a 404 Not-found response
 is sent to the client.
+
+Asking each application in turn is slow if many are chained. Hence,
+applications may register their routes with the HttpRouter of the server
+instead, e.g: "GET /fact/:numbers", when they are chained. Requests are looked
+up in the router first, and only the applications that did not register
+routes are asked in turn.
+
+Accepted client connections are pushed onto a queue, and served by a pool of
+HttpConnectionHandler threads. Hence, a slow client only holds its handler,
+while the other handlers keep serving the remaining clients.
+
+Optionally, the server runs an event loop with non-blocking sockets instead.
+The loop buffers the data that clients send, and queues a client only when a
+complete request arrived. Then, a small pool of HttpEventHandler threads
+answer the requests. Idle keep-alive clients do not hold any thread.
+
+The handlers count the requests they serve in the HttpMetrics of the server,
+by route, status code, bytes and duration. Along with the number of clients
+waiting in the queue and the open connections, they can be published by a
+web application, e.g: MetricsWebApp.
 */
 class HttpServer : public TcpServer {
   DISABLE_COPY(HttpServer);
 
+ public:
+  /// Default number of requests that a client may send through a connection
+  static const size_t defaultMaxRequestsPerConnection = 1000;
+
  protected:
   /// Lookup criteria for searching network information about this host
   struct addrinfo hints;
@@ -68,13 +95,33 @@ class HttpServer : public TcpServer {
   /// call the httpResponse.send() and the chain stops. If no web app serves
   /// the request, the not found page will be served.
   std::vector<HttpApp*> applications;
+  /// Handlers of the routes registered by the applications
+  HttpRouter router;
+  /// Applications that did not register routes. They are asked in turn for
+  /// the requests that do not match a route
+  std::vector<HttpApp*> chainedApplications;
+  /// Number of connection handler threads, by default the number of cores
+  size_t handlerCount = 0;
+  /// True if connections are served by an event loop (epoll) instead of a
+  /// thread per connection
+  bool eventLoop = false;
+  /// Requests that a client may send through a connection before it is
+  /// closed. Hence, clients are spread among handlers now and then
+  size_t maxRequestsPerConnection = defaultMaxRequestsPerConnection;
+  /// Accepted client connections waiting for a connection handler. In event
+  /// loop mode, clients with complete requests waiting for a handler
+  Queue<Socket> connectionQueue;
+  /// Threads that serve the accepted client connections
+  std::vector<HttpConnectionHandler*> handlers;
+  /// Counters of the requests served by the handlers
+  HttpMetrics metrics;
 
  public:
   /// Constructor
   HttpServer();
   /// Destructor
   ~HttpServer();
-  /// Registers a web application to the chain
+  /// Registers a web application, and its routes if it has
   void chainWebApp(HttpApp* application);
   /// Start the web server for listening client connections and HTTP requests
   int run(int argc, char* argv[]);
@@ -86,6 +133,25 @@ class HttpServer : public TcpServer {
   /// For each accepted connection request, the virtual onConnectionAccepted()
   /// will be called. Inherited classes must override that method
   void listenForever(const char* port);
+  /// Get the routes registered by the web applications
+  inline const HttpRouter& getRouter() const { return this->router; }
+  /// Get the chain of registered web applications that have no routes
+  inline const std::vector<HttpApp*>& getChainedApplications() const {
+    return this->chainedApplications;
+  }
+  /// Get the number of requests that a client may send through a connection
+  inline size_t getMaxRequestsPerConnection() const {
+    return this->maxRequestsPerConnection;
+  }
+  /// Get the counters of the requests served by the handlers
+  inline HttpMetrics& getMetrics() { return this->metrics; }
+  /// Get the number of clients waiting for a handler
+  inline size_t getQueueDepth() { return this->connectionQueue.getCount(); }
+  /// Called by a connection handler when it finished with a client, in order
+  /// to count the open connections
+  inline void releaseConnection() {
+    this->connectionCount.fetch_sub(1, std::memory_order_relaxed);
+  }
 
  protected:
   /// Analyze the command line arguments
@@ -97,24 +163,17 @@ class HttpServer : public TcpServer {
   /// Stop all running applications, given them a chance to clean their data
   /// structures
   void stopApps();
+  /// Create the connection handler threads and start them
+  void startHandlers();
+  /// Let the connection handlers finish the queued connections and wait for
+  /// them
+  void stopHandlers();
   /// This method is called each time a client connection request is accepted.
+  /// The connection is queued for the connection handlers
   void handleClientConnection(Socket& client) override;
-  /// Called each time an HTTP request is received. Web server should analyze
-  /// the request object and assemble a response with the response object.
-  /// Finally send the response calling the httpResponse.send() method.
-  /// @return true on success and the server will continue handling further
-  /// HTTP requests, or false if server should stop accepting requests from
-  /// this client (e.g: HTTP/1.0)
-  virtual bool handleHttpRequest(HttpRequest& httpRequest,
-    HttpResponse& httpResponse);
-  /// Route, that provide an answer according to the URI value
-  /// For example, home page is handled different than a number
-  bool route(HttpRequest& httpRequest, HttpResponse& httpResponse);
-  /// Sends a page for a non found resouce in this server. This method is called
-  /// if none of the registered web applications handled the request.
-  /// If you want to override this method, create a web app, e.g NotFoundWebApp
-  /// that reacts to all URIs, and chain it as the last web app
-  bool serveNotFound(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Called by the event loop each time a client sent data. The client is
+  /// queued for the handlers when a complete request arrived
+  void handleClientData(Socket& client) override;
 };
 
 #endif  // HTTPSERVER_H
@@ -0,0 +1,126 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+
+#include "LatencyHistogram.hpp"
+
+LatencyHistogram::LatencyHistogram()
+  : counts(LatencyHistogram::getIndex(maxValue) + 1, 0) {
+}
+
+void LatencyHistogram::recordValue(int64_t value) {
+  this->recordValues(value, 1);
+}
+
+void LatencyHistogram::recordValues(int64_t value, uint64_t count) {
+  value = std::clamp(value, int64_t(0), maxValue);
+  this->counts[LatencyHistogram::getIndex(value)] += count;
+  this->totalCount += count;
+  this->totalSum += static_cast<double>(value) * count;
+  this->minValue = std::min(this->minValue, value);
+  this->maxRecorded = std::max(this->maxRecorded, value);
+}
+
+void LatencyHistogram::recordCorrectedValues(int64_t value, uint64_t count,
+    int64_t expectedInterval) {
+  this->recordValues(value, count);
+  if (expectedInterval <= 0) {
+    return;
+  }
+  // The requests that should have been sent while waiting for this one would
+  // have waited for the rest of it
+  for (int64_t missing = value - expectedInterval; missing >= expectedInterval;
+      missing -= expectedInterval) {
+    this->recordValues(missing, count);
+  }
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+  assert(this->counts.size() == other.counts.size());
+  for (size_t index = 0; index < this->counts.size(); ++index) {
+    this->counts[index] += other.counts[index];
+  }
+  this->totalCount += other.totalCount;
+  this->totalSum += other.totalSum;
+  this->minValue = std::min(this->minValue, other.minValue);
+  this->maxRecorded = std::max(this->maxRecorded, other.maxRecorded);
+}
+
+LatencyHistogram LatencyHistogram::getCorrected(int64_t expectedInterval)
+    const {
+  LatencyHistogram corrected;
+  for (size_t index = 0; index < this->counts.size(); ++index) {
+    if (this->counts[index]) {
+      const int64_t value = std::min(LatencyHistogram::getHighestValue(index)
+        , this->maxRecorded);
+      corrected.recordCorrectedValues(value, this->counts[index]
+        , expectedInterval);
+    }
+  }
+  return corrected;
+}
+
+int64_t LatencyHistogram::getMin() const {
+  return this->totalCount ? this->minValue : 0;
+}
+
+double LatencyHistogram::getMean() const {
+  return this->totalCount ? this->totalSum / this->totalCount : 0.0;
+}
+
+int64_t LatencyHistogram::getValueAtPercentile(double percentile) const {
+  if (this->totalCount == 0) {
+    return 0;
+  }
+  // Find the bucket that holds the value with this rank
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  const uint64_t rank = std::max(uint64_t(1), static_cast<uint64_t>(
+    std::ceil(percentile / 100.0 * this->totalCount)));
+  uint64_t count = 0;
+  for (size_t index = 0; index < this->counts.size(); ++index) {
+    count += this->counts[index];
+    if (count >= rank) {
+      return std::min(LatencyHistogram::getHighestValue(index)
+        , this->maxRecorded);
+    }
+  }
+  return this->maxRecorded;
+}
+
+void LatencyHistogram::printPercentiles(std::ostream& output,
+    const char* unit) const {
+  for (const double percentile : {50.0, 75.0, 90.0, 99.0, 99.9, 99.99
+      , 100.0}) {
+    output << std::setw(10) << std::fixed << std::setprecision(3) << percentile
+      << '%' << std::setw(12) << this->getValueAtPercentile(percentile) << ' '
+      << unit << '\n';
+  }
+  output << std::setw(11) << "mean" << std::setw(12) << std::setprecision(1)
+    << this->getMean() << ' ' << unit << '\n';
+}
+
+size_t LatencyHistogram::getIndex(int64_t value) {
+  // The first bucket counts the small values one by one
+  if (value < subBucketCount) {
+    return static_cast<size_t>(value);
+  }
+  // Other buckets count a power of two in subBucketHalfCount parts
+  const int magnitude = 63 - __builtin_clzll(static_cast<uint64_t>(value));
+  const int bucket = magnitude - subBucketMagnitude + 1;
+  const int64_t subBucket = value >> bucket;
+  return static_cast<size_t>(subBucketCount + (bucket - 1) * subBucketHalfCount
+    + (subBucket - subBucketHalfCount));
+}
+
+int64_t LatencyHistogram::getHighestValue(size_t index) {
+  if (index < static_cast<size_t>(subBucketCount)) {
+    return static_cast<int64_t>(index);
+  }
+  const int64_t rest = static_cast<int64_t>(index) - subBucketCount;
+  const int bucket = static_cast<int>(rest / subBucketHalfCount) + 1;
+  const int64_t subBucket = rest % subBucketHalfCount + subBucketHalfCount;
+  return ((subBucket + 1) << bucket) - 1;
+}
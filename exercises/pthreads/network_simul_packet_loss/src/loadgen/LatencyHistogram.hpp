@@ -0,0 +1,86 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+@brief Counts latencies in buckets of bounded relative error
+Latencies are integers, e.g: microseconds. As the HdrHistogram of Gil Tene,
+values are grouped by their power of two, and each group is split in
+subBucketHalfCount linear sub-buckets. Hence, a value and the highest value of
+its bucket differ less than 1/subBucketHalfCount, about 0.8%, from 1 to
+maxValue, with a fixed amount of memory. Recording a value is a few integer
+operations, without allocations or locks. Each thread records in its own
+histogram, and the histograms are added at the end.
+
+If a client waits for each response before sending the next request, a slow
+response delays the requests that would have been sent meanwhile. Their
+latencies are never measured, and the percentiles look better than they are
+(coordinated omission). getCorrected() adds the latencies of those missing
+requests, given the interval expected between requests.
+*/
+class LatencyHistogram {
+ public:
+  /// Magnitude of the number of linear sub-buckets of each power of two
+  static constexpr int subBucketMagnitude = 8;
+  /// Number of linear sub-buckets of the first bucket
+  static constexpr int64_t subBucketCount = 1 << subBucketMagnitude;
+  /// Number of linear sub-buckets of each of the other buckets
+  static constexpr int64_t subBucketHalfCount = subBucketCount / 2;
+  /// Largest value that can be recorded. Larger ones are recorded as this
+  static constexpr int64_t maxValue = (int64_t(1) << 36) - 1;
+
+ protected:
+  /// Number of recorded values by bucket
+  std::vector<uint64_t> counts;
+  /// Number of recorded values
+  uint64_t totalCount = 0;
+  /// Sum of the recorded values, for the mean
+  double totalSum = 0.0;
+  /// Smallest recorded value
+  int64_t minValue = maxValue;
+  /// Largest recorded value
+  int64_t maxRecorded = 0;
+
+ public:
+  /// Constructor
+  LatencyHistogram();
+  /// Count a value
+  void recordValue(int64_t value);
+  /// Add the counts of other histogram to this one
+  void add(const LatencyHistogram& other);
+  /// Get a copy of this histogram with the values of the measurements that
+  /// were missed, if a measurement was expected every given interval
+  LatencyHistogram getCorrected(int64_t expectedInterval) const;
+  /// Get the number of recorded values
+  inline uint64_t getTotalCount() const { return this->totalCount; }
+  /// Get the smallest recorded value, or 0 if none
+  int64_t getMin() const;
+  /// Get the largest recorded value
+  inline int64_t getMax() const { return this->maxRecorded; }
+  /// Get the mean of the recorded values, or 0 if none
+  double getMean() const;
+  /// Get the value at the given percentile, e.g: 99.9. The value is the
+  /// highest of its bucket, so the percentile is never underestimated
+  int64_t getValueAtPercentile(double percentile) const;
+  /// Print the values at the usual percentiles, in the given unit
+  void printPercentiles(std::ostream& output, const char* unit) const;
+
+ protected:
+  /// Count a value several times
+  void recordValues(int64_t value, uint64_t count);
+  /// Count a value several times, and the values of the measurements that
+  /// were missed because it exceeded the expected interval between them
+  void recordCorrectedValues(int64_t value, uint64_t count,
+    int64_t expectedInterval);
+  /// Get the index of the bucket that counts the value
+  static size_t getIndex(int64_t value);
+  /// Get the highest value counted by the bucket
+  static int64_t getHighestValue(size_t index);
+};
+
+#endif  // LATENCYHISTOGRAM_HPP
@@ -0,0 +1,190 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <strings.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#include "LoadClient.hpp"
+#include "Socket.hpp"
+
+void LoadStatistics::add(const LoadStatistics& other) {
+  this->responses += other.responses;
+  this->errors += other.errors;
+  this->connections += other.connections;
+  for (size_t index = 0; index < std::size(this->statusClasses); ++index) {
+    this->statusClasses[index] += other.statusClasses[index];
+  }
+  this->bytes += other.bytes;
+  this->latency.add(other.latency);
+  this->serviceTime.add(other.serviceTime);
+}
+
+LoadClient::LoadClient(const LoadSettings& settings,
+    const std::vector<std::string>& requests, size_t number,
+    Clock::time_point startTime)
+  : settings{settings}
+  , requests{requests}
+  , startTime{startTime}
+  , endTime{startTime + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(settings.seconds))}
+  , interval{Clock::duration::zero()}
+  , requestMix(settings.weights.begin(), settings.weights.end())
+  , randomGenerator(static_cast<unsigned>(number + 1)) {
+  // At a fixed rate, each client sends connections / rate requests per
+  // second. The clients are staggered, so the requests are evenly spread
+  if (settings.rate > 0.0) {
+    this->interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(settings.connections / settings.rate));
+    this->startTime += this->interval * number / settings.connections;
+  }
+}
+
+int LoadClient::run() {
+  const bool fixedRate = this->settings.rate > 0.0;
+  Clock::time_point scheduled = this->startTime;
+  // A server slower than the rate is not given extra time to catch up
+  while ((!fixedRate || scheduled < this->endTime)
+      && Clock::now() < this->endTime) {
+    // A request behind its schedule is sent right away
+    if (fixedRate) {
+      std::this_thread::sleep_until(scheduled);
+    }
+    const std::string& request
+      = this->requests[this->requestMix(this->randomGenerator)];
+    const Clock::time_point sent = Clock::now();
+    if (this->sendRequest(request)) {
+      const Clock::time_point received = Clock::now();
+      this->statistics.serviceTime.recordValue(std::chrono::duration_cast<
+        std::chrono::microseconds>(received - sent).count());
+      if (fixedRate) {
+        this->statistics.latency.recordValue(std::chrono::duration_cast<
+          std::chrono::microseconds>(received - scheduled).count());
+      }
+    }
+    scheduled += this->interval;
+  }
+  this->disconnect();
+  return EXIT_SUCCESS;
+}
+
+bool LoadClient::sendRequest(const std::string& request) {
+  if (!this->connect()) {
+    return false;
+  }
+  // The request is sent from the prepared text, without copying it
+  struct iovec buffer = {const_cast<char*>(request.data()), request.length()};
+  bool close = false;
+  if (!this->socket.send(&buffer, 1) || !this->receiveResponse(close)) {
+    ++this->statistics.errors;
+    this->disconnect();
+    return false;
+  }
+  if (close || !this->settings.keepAlive) {
+    this->disconnect();
+  }
+  return true;
+}
+
+bool LoadClient::connect() {
+  if (this->connected) {
+    return true;
+  }
+  try {
+    this->socket = this->client.connect(this->settings.server.c_str()
+      , this->settings.port.c_str());
+    this->socket.setReceiveTimeout(receiveTimeout);
+    this->connected = true;
+    ++this->statistics.connections;
+    return true;
+  } catch (const std::runtime_error& error) {
+    // Do not spin while the server refuses connections
+    ++this->statistics.errors;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return false;
+  }
+}
+
+void LoadClient::disconnect() {
+  if (this->connected) {
+    this->client.close();
+    this->connected = false;
+  }
+}
+
+bool LoadClient::receiveResponse(bool& close) {
+  // Status line, e.g: "HTTP/1.1 200 OK"
+  std::string_view line;
+  if (!this->socket.readLine(line)) {
+    return false;
+  }
+  uint64_t bytes = line.length() + 1;
+  int status = 0;
+  const size_t space = line.find(' ');
+  if (space == std::string_view::npos || std::from_chars(line.data() + space
+      + 1, line.data() + line.length(), status).ec != std::errc()) {
+    return false;
+  }
+
+  // Headers, until an empty line
+  size_t contentLength = std::string_view::npos;
+  while (true) {
+    if (!this->socket.readLine(line)) {
+      return false;
+    }
+    bytes += line.length() + 1;
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (line.empty()) {
+      break;
+    }
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      continue;
+    }
+    const std::string_view name = line.substr(0, colon);
+    std::string_view value = line.substr(colon + 1);
+    value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+    if (LoadClient::equalsIgnoreCase(name, "Content-Length")) {
+      std::from_chars(value.data(), value.data() + value.length()
+        , contentLength);
+    } else if (LoadClient::equalsIgnoreCase(name, "Connection")) {
+      close = LoadClient::equalsIgnoreCase(value, "close");
+    }
+  }
+
+  // Body. Without a length, it ends when the server closes the connection
+  if (contentLength != std::string_view::npos) {
+    std::string_view body;
+    if (contentLength > 0 && !this->socket.read(body, contentLength)) {
+      return false;
+    }
+    bytes += contentLength;
+  } else {
+    char buffer[4096];
+    bytes += this->socket.getPendingInput().length();
+    ssize_t received = 0;
+    while ((received = this->socket.readAvailable(buffer, sizeof buffer)) > 0) {
+      bytes += received;
+    }
+    close = true;
+  }
+
+  ++this->statistics.responses;
+  ++this->statistics.statusClasses[status >= 100 && status < 600
+    ? status / 100 : 0];
+  this->statistics.bytes += bytes;
+  return true;
+}
+
+bool LoadClient::equalsIgnoreCase(std::string_view text,
+    std::string_view other) {
+  return text.length() == other.length()
+    && ::strncasecmp(text.data(), other.data(), text.length()) == 0;
+}
@@ -0,0 +1,138 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef LOADCLIENT_HPP
+#define LOADCLIENT_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.hpp"
+#include "LatencyHistogram.hpp"
+#include "TcpClient.hpp"
+#include "Thread.hpp"
+
+/// Parameters of a load test, shared by all the clients
+struct LoadSettings {
+  /// Address or name of the web server
+  std::string server = "localhost";
+  /// Port where the web server listens
+  std::string port = "8080";
+  /// Number of concurrent connections, one per client thread
+  size_t connections = 10;
+  /// Duration of the test in seconds
+  double seconds = 10.0;
+  /// Requests per second of all the clients, or 0 to send each request as
+  /// soon as the previous response arrives (closed loop)
+  double rate = 0.0;
+  /// Send several requests through each connection
+  bool keepAlive = true;
+  /// URIs to be requested
+  std::vector<std::string> uris;
+  /// Relative frequency of each URI
+  std::vector<double> weights;
+};
+
+/// Measurements of a client. The clients are added at the end of the test
+struct LoadStatistics {
+  /// Number of responses received
+  uint64_t responses = 0;
+  /// Number of failed connections, sends, and receives, including timeouts
+  uint64_t errors = 0;
+  /// Number of connections established with the server
+  uint64_t connections = 0;
+  /// Number of responses by the first digit of their status code
+  uint64_t statusClasses[6] = {};
+  /// Bytes of the received responses, including headers
+  uint64_t bytes = 0;
+  /// Microseconds from the moment each request should have been sent, by the
+  /// rate, to its response. Only measured at a fixed rate
+  LatencyHistogram latency;
+  /// Microseconds from the moment each request was actually sent to its
+  /// response
+  LatencyHistogram serviceTime;
+
+  /// Add the measurements of other client to these
+  void add(const LoadStatistics& other);
+};
+
+/**
+@brief A thread that sends HTTP requests through a connection and measures
+their latencies
+Each client opens its own connection with TcpClient, and waits for each
+response before sending the next request. At a fixed rate, each request has
+a scheduled time. If a slow response delays the next requests, their latency
+is measured from their scheduled time, not from the moment they were sent.
+Hence, the latencies include the time the requests waited behind the slow one,
+as a user would have. In closed loop, the requests are sent as soon as
+possible, and only their service time is measured.
+*/
+class LoadClient : public Thread {
+  DISABLE_COPY(LoadClient);
+
+ public:
+  /// Seconds to wait for a response before counting it as an error
+  static constexpr int receiveTimeout = 5;
+  /// Clocks used to measure the latencies
+  typedef std::chrono::steady_clock Clock;
+
+ protected:
+  /// Parameters of the test
+  const LoadSettings& settings;
+  /// Requests ready to be sent, one for each URI of the settings
+  const std::vector<std::string>& requests;
+  /// Time when this client sends its first request
+  Clock::time_point startTime;
+  /// Time when this client stops sending requests
+  Clock::time_point endTime;
+  /// Time between the requests of this client at a fixed rate
+  Clock::duration interval;
+  /// Connects with the server
+  TcpClient client;
+  /// Connection with the server, if connected
+  Socket socket;
+  /// True if the connection is established and can be used for a request
+  bool connected = false;
+  /// Chooses the URI of each request by its weight
+  std::discrete_distribution<size_t> requestMix;
+  /// Random numbers of this client, for the mix
+  std::minstd_rand randomGenerator;
+  /// Measurements of this client
+  LoadStatistics statistics;
+
+ public:
+  /// Constructor
+  /// @param number Index of this client, from 0, used to stagger the clients
+  /// at a fixed rate
+  LoadClient(const LoadSettings& settings,
+    const std::vector<std::string>& requests, size_t number,
+    Clock::time_point startTime);
+  /// Get the measurements of this client. Call it after waitToFinish()
+  inline const LoadStatistics& getStatistics() const {
+    return this->statistics;
+  }
+
+ protected:
+  /// Send requests until the end of the test
+  int run() override;
+  /// Send a request and wait for its response
+  /// @return true if a response was received
+  bool sendRequest(const std::string& request);
+  /// Connect with the server if there is no connection
+  /// @return true if the connection is established
+  bool connect();
+  /// Close the connection, if any
+  void disconnect();
+  /// Read the status line, headers, and body of a response
+  /// @param close Set to true if the server closes the connection after this
+  /// response
+  /// @return true on success, false on error or connection closed by server
+  bool receiveResponse(bool& close);
+  /// Return true if the texts are equal, ignoring the case of the letters
+  static bool equalsIgnoreCase(std::string_view text, std::string_view other);
+};
+
+#endif  // LOADCLIENT_HPP
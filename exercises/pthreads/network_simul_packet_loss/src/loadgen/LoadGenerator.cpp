@@ -0,0 +1,212 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <charconv>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "LoadGenerator.hpp"
+#include "Log.hpp"
+#include "NetworkAddress.hpp"
+#include "TcpClient.hpp"
+
+const char* const usage =
+  "Usage: loadgen server port [connections] [seconds] [rate] [keepalive|close]"
+    " [uri...]\n"
+  "\n"
+  "  server       Name or IP address of the web server\n"
+  "  port         Port where the web server listens\n"
+  "  connections  Number of concurrent connections, default 10\n"
+  "  seconds      Duration of the test, default 10\n"
+  "  rate         Total requests per second, or 0 to send each request as soon"
+    "\n"
+  "               as the previous one is answered (default)\n"
+  "  keepalive    Send all the requests of a client through a connection"
+    " (default)\n"
+  "  close        Open a connection for each request\n"
+  "  uri          Requested URIs, default /. A weight may precede an URI, e.g:"
+    "\n"
+  "               3:/fact/12 is requested three times more often than URIs"
+    " with\n"
+  "               weight 1\n";
+
+LoadGenerator::LoadGenerator() {
+}
+
+LoadGenerator::~LoadGenerator() {
+  for (LoadClient* client : this->clients) {
+    delete client;
+  }
+}
+
+int LoadGenerator::run(int argc, char* argv[]) {
+  if (!this->analyzeArguments(argc, argv)) {
+    return EXIT_FAILURE;
+  }
+  // Clients reconnect often. Do not log each closed connection
+  Log::getInstance().setLevel(Log::WARNING);
+
+  try {
+    this->prepareRequests();
+  } catch (const std::runtime_error& error) {
+    std::cerr << "error: " << error.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // Give some time to create the threads before the first requests
+  const LoadClient::Clock::time_point startTime = LoadClient::Clock::now()
+    + std::chrono::milliseconds(100);
+  for (size_t index = 0; index < this->settings.connections; ++index) {
+    this->clients.push_back(new LoadClient(this->settings, this->requests
+      , index, startTime));
+    this->clients[index]->startThread();
+  }
+
+  LoadStatistics total;
+  for (LoadClient* client : this->clients) {
+    client->waitToFinish();
+    total.add(client->getStatistics());
+  }
+  const std::chrono::duration<double> elapsed = LoadClient::Clock::now()
+    - startTime;
+  this->printReport(total, elapsed.count());
+  return EXIT_SUCCESS;
+}
+
+bool LoadGenerator::analyzeArguments(int argc, char* argv[]) {
+  for (int index = 1; index < argc; ++index) {
+    const std::string argument = argv[index];
+    if (argument.find("help") != std::string::npos) {
+      std::cout << usage;
+      return false;
+    }
+  }
+  if (argc < 3) {
+    std::cerr << usage;
+    return false;
+  }
+  this->settings.server = argv[1];
+  this->settings.port = argv[2];
+
+  if (argc >= 4) {
+    char* end = nullptr;
+    const long connections = std::strtol(argv[3], &end, 10);  // NOLINT
+    if (*end != '\0' || connections <= 0) {
+      std::cerr << "error: invalid connection count: " << argv[3] << std::endl
+        << usage;
+      return false;
+    }
+    this->settings.connections = static_cast<size_t>(connections);
+  }
+
+  if (argc >= 5) {
+    char* end = nullptr;
+    this->settings.seconds = std::strtod(argv[4], &end);
+    if (*end != '\0' || !(this->settings.seconds > 0.0)) {
+      std::cerr << "error: invalid duration: " << argv[4] << std::endl
+        << usage;
+      return false;
+    }
+  }
+
+  if (argc >= 6) {
+    char* end = nullptr;
+    this->settings.rate = std::strtod(argv[5], &end);
+    if (*end != '\0' || !(this->settings.rate >= 0.0)) {
+      std::cerr << "error: invalid rate: " << argv[5] << std::endl << usage;
+      return false;
+    }
+  }
+
+  if (argc >= 7) {
+    const std::string mode = argv[6];
+    if (mode != "keepalive" && mode != "close") {
+      std::cerr << "error: unknown mode: " << mode << std::endl << usage;
+      return false;
+    }
+    this->settings.keepAlive = mode == "keepalive";
+  }
+
+  // The URIs of the mix, with optional weights, e.g: 3:/fact/12
+  for (int index = 7; index < argc; ++index) {
+    const std::string_view argument = argv[index];
+    const size_t slash = argument.find('/');
+    const size_t colon = argument.find(':');
+    double weight = 1.0;
+    if (colon != std::string_view::npos && colon < slash) {
+      if (std::from_chars(argument.data(), argument.data() + colon, weight).ptr
+          != argument.data() + colon || !(weight > 0.0)) {
+        std::cerr << "error: invalid weight: " << argument << std::endl
+          << usage;
+        return false;
+      }
+    }
+    const std::string_view uri = argument.substr(colon < slash ? colon + 1
+      : 0);
+    if (uri.empty() || uri[0] != '/') {
+      std::cerr << "error: invalid uri: " << argument << std::endl << usage;
+      return false;
+    }
+    this->settings.uris.emplace_back(uri);
+    this->settings.weights.push_back(weight);
+  }
+  if (this->settings.uris.empty()) {
+    this->settings.uris.push_back("/");
+    this->settings.weights.push_back(1.0);
+  }
+  return true;
+}
+
+void LoadGenerator::prepareRequests() {
+  // Fail before starting the clients if the server is not available. The
+  // clients connect to its IP, so the name is resolved only once
+  TcpClient client;
+  client.connect(this->settings.server.c_str(), this->settings.port.c_str());
+  const std::string host = this->settings.server + ':' + this->settings.port;
+  this->settings.server = client.getServerAddress().getIP();
+  client.close();
+
+  for (const std::string& uri : this->settings.uris) {
+    this->requests.push_back("GET " + uri + " HTTP/1.1\r\nHost: " + host
+      + (this->settings.keepAlive ? "" : "\r\nConnection: close")
+      + "\r\n\r\n");
+  }
+}
+
+void LoadGenerator::printReport(const LoadStatistics& total, double seconds)
+    const {
+  std::cout << std::fixed << std::setprecision(1)
+    << this->settings.connections << " connections, " << seconds << " s, "
+    << (this->settings.keepAlive ? "keep-alive" : "a connection per request")
+    << ", ";
+  if (this->settings.rate > 0.0) {
+    std::cout << this->settings.rate << " requests/s scheduled\n";
+  } else {
+    std::cout << "closed loop\n";
+  }
+
+  std::cout << "  Requests     " << total.responses << " ("
+    << total.responses / seconds << " per second)\n"
+    << "  Errors       " << total.errors << '\n'
+    << "  Connections  " << total.connections << '\n'
+    << "  Status       1xx " << total.statusClasses[1] << ", 2xx "
+    << total.statusClasses[2] << ", 3xx " << total.statusClasses[3]
+    << ", 4xx " << total.statusClasses[4] << ", 5xx "
+    << total.statusClasses[5] << ", other " << total.statusClasses[0] << '\n'
+    << "  Received     " << total.bytes << " bytes ("
+    << total.bytes / seconds / 1e6 << " MB per second)\n";
+
+  // In closed loop, a client was expected to send a request every mean
+  // service time. Longer responses hid the requests that would have been sent
+  std::cout << "\nLatency, corrected for coordinated omission\n";
+  if (this->settings.rate > 0.0) {
+    total.latency.printPercentiles(std::cout, "us");
+  } else {
+    total.serviceTime.getCorrected(static_cast<int64_t>(
+      total.serviceTime.getMean())).printPercentiles(std::cout, "us");
+  }
+  std::cout << "\nService time, not corrected\n";
+  total.serviceTime.printPercentiles(std::cout, "us");
+}
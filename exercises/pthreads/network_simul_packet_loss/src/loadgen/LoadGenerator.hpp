@@ -0,0 +1,59 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef LOADGENERATOR_HPP
+#define LOADGENERATOR_HPP
+
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "LoadClient.hpp"
+
+/**
+@brief Measures the throughput and latencies of a web server
+A load generator opens a number of concurrent connections with a web server,
+each one served by a LoadClient thread, and sends requests through them for a
+number of seconds. The requests are chosen at random from a mix of URIs with
+weights, e.g: "3:/fact/12 1:/static/index.html" sends the first URI three
+times more often than the second one. The requests are sent at a fixed total
+rate, or as fast as the server answers them (closed loop).
+
+At the end, the generator adds the measurements of all the clients, and
+reports the requests per second and the percentiles of the latencies. The
+latencies are corrected for coordinated omission: at a fixed rate they are
+measured from the time each request should have been sent, and in closed loop
+the requests missed during slow responses are estimated from the mean.
+*/
+class LoadGenerator {
+  DISABLE_COPY(LoadGenerator);
+
+ protected:
+  /// Parameters of the test
+  LoadSettings settings;
+  /// Prepared HTTP requests, one for each URI
+  std::vector<std::string> requests;
+  /// One client for each connection
+  std::vector<LoadClient*> clients;
+
+ public:
+  /// Constructor
+  LoadGenerator();
+  /// Destructor
+  ~LoadGenerator();
+  /// Run the load test with the given command-line arguments
+  /// @return The exit code of the program
+  int run(int argc, char* argv[]);
+
+ protected:
+  /// Analyze the command-line arguments into the settings
+  /// @return true if the test can run, false if the usage was printed or the
+  /// arguments are not valid
+  bool analyzeArguments(int argc, char* argv[]);
+  /// Check that the server is available, and build the requests
+  /// @throw std::runtime_error if the server cannot be reached
+  void prepareRequests();
+  /// Print the measurements of all the clients
+  void printReport(const LoadStatistics& total, double seconds) const;
+};
+
+#endif  // LOADGENERATOR_HPP
@@ -0,0 +1,13 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+// HTTP load generator to measure the web server
+
+#ifdef LOADGEN
+
+#include "LoadGenerator.hpp"
+
+/// Start the load test
+int main(int argc, char* argv[]) {
+  return LoadGenerator().run(argc, argv);
+}
+
+#endif  // LOADGEN
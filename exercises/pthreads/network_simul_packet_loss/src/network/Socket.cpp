@@ -2,12 +2,20 @@
 
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cctype>
+#include <cerrno>
 #include <cstring>
 #include <stdexcept>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "Log.hpp"
@@ -28,9 +36,25 @@ struct SharedSocket {
   int socketFileDescriptor = -1;
   /// Buffer to extract data before a read of received data
   std::ostringstream output;
-  /// Buffer to store data in memory before sending to the peer
-  /// TODO(any): istringstream is not suitable to manage large/binary data
-  std::istringstream input;
+  /// Data received from the peer. Bytes in [inputStart, inputEnd) were not
+  /// read yet, and bytes after inputEnd are free to receive more data. The
+  /// buffer is allocated on the first receive, and reused for the life of the
+  /// connection
+  std::vector<char> input;
+  /// Index of the first received byte not read yet
+  size_t inputStart = 0;
+  /// Index after the last received byte
+  size_t inputEnd = 0;
+  /// Number of pending bytes already searched, e.g: for the end of a header.
+  /// It is reset when pending data is read
+  size_t inputScanned = 0;
+  /// True if the last receive failed or the peer closed the connection
+  bool inputFailed = false;
+  /// Number of requests received through this connection
+  size_t requestCount = 0;
+  /// Milliseconds that a send waits for the peer to accept more data, or -1
+  /// to wait forever
+  int sendTimeout = -1;
 
  public:
   /// Constructor
@@ -49,12 +73,22 @@ struct SharedSocket {
       // Close connection with client
       ::close(this->socketFileDescriptor);
 
-      const NetworkAddress& address = this->getNetworkAddress();
-      Log::append(Log::INFO, "socket", std::string("connection -----closed")
-        + address.getIP() + " port " + std::to_string(address.getPort()));
+      if (Log::isEnabled(Log::INFO)) {
+        const NetworkAddress& address = this->getNetworkAddress();
+        Log::append(Log::INFO, "socket", "connection -----closed"
+          , address.getIP(), " port ", address.getPort());
+      }
 
       ::memset(&this->peerAddress, 0, sizeof(this->peerAddress));
       this->socketFileDescriptor = -1;
+      // A client may connect again with the same socket, e.g: TcpClient.
+      // Data of the old connection must not be read from the new one
+      this->output.str("");
+      this->output.clear();
+      this->inputStart = this->inputEnd = 0;
+      this->inputScanned = 0;
+      this->inputFailed = false;
+      this->requestCount = 0;
     }
   }
 
@@ -77,6 +111,64 @@ struct SharedSocket {
   NetworkAddress getNetworkAddress() const {
     return NetworkAddress(this->getSockAddr());
   }
+
+  /// Get the received data not read yet
+  std::string_view getPendingInput() const {
+    return std::string_view(this->input.data() + this->inputStart
+      , this->inputEnd - this->inputStart);
+  }
+
+  /// Mark the given amount of pending bytes as read
+  void consumeInput(size_t size) {
+    assert(this->inputStart + size <= this->inputEnd);
+    this->inputStart += size;
+    // The data searched before belongs to what was read
+    this->inputScanned = 0;
+  }
+
+  /// Make room for at least the given amount of bytes after the pending data.
+  /// Pending data is moved to the start of the buffer before growing it, so a
+  /// connection that reads its data as it arrives never reallocates
+  /// @return The free space where data can be received
+  std::pair<char*, size_t> reserveInput(size_t minimum) {
+    if (this->inputStart == this->inputEnd) {
+      this->inputStart = this->inputEnd = 0;
+    }
+    if (this->input.size() - this->inputEnd < minimum) {
+      const size_t pending = this->inputEnd - this->inputStart;
+      if (this->inputStart > 0) {
+        std::memmove(this->input.data(), this->input.data() + this->inputStart
+          , pending);
+        this->inputStart = 0;
+        this->inputEnd = pending;
+      }
+      if (this->input.size() - this->inputEnd < minimum) {
+        this->input.resize(std::max(std::max(this->input.size() * 2
+          , Socket::initialInputCapacity), this->inputEnd + minimum));
+      }
+    }
+    return {this->input.data() + this->inputEnd
+      , this->input.size() - this->inputEnd};
+  }
+
+  /// Tell if a failed send may be retried. A non-blocking socket may be full,
+  /// in that case wait until it accepts more data. A peer that does not read
+  /// its data within the send timeout makes the send fail with ETIMEDOUT
+  bool waitWritable() const {
+    if (errno == EINTR) {
+      return true;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      struct pollfd writable = {this->socketFileDescriptor, POLLOUT, 0};
+      const int result = ::poll(&writable, 1, this->sendTimeout);
+      if (result == 0) {
+        errno = ETIMEDOUT;
+        return false;
+      }
+      return result > 0 || errno == EINTR;
+    }
+    return false;
+  }
 };
 
 // Socket class ---------------------------------------------------------------
@@ -121,24 +213,42 @@ bool Socket::operator<(const Socket& other) const {
 }
 
 bool Socket::readLine(std::string& line, char separator) {
-  while (!std::getline(this->sharedSocket->input, line, separator)) {
+  std::string_view view;
+  if (!this->readLine(view, separator)) {
+    return false;  // error
+  }
+  line.assign(view);
+  return true;  // success read
+}
+
+bool Socket::readLine(std::string_view& line, char separator) {
+  SharedSocket& shared = *this->sharedSocket;
+  size_t searched = 0;
+  while (true) {
+    // Look for the separator only in the data that was not searched before
+    const std::string_view pending = shared.getPendingInput();
+    const size_t position = pending.find(separator, searched);
+    if (position != std::string_view::npos) {
+      line = pending.substr(0, position);
+      shared.consumeInput(position + 1);
+      return true;  // success read
+    }
+    searched = pending.length();
     if (!this->receive()) {
       return false;  // error
     }
-    // receive() clears stream error flags, and retry
   }
-  return true;  // success read
 }
 
 bool Socket::receive() {
-  const size_t capacity = 65535;
-  std::vector<char> buffer(capacity);
-  ssize_t res = this->readAvailable(buffer.data(), buffer.size());
-  if (res > 0) {
-    this->sharedSocket->input.str(buffer.data());
-    this->sharedSocket->input.clear();
+  const std::pair<char*, size_t> space
+    = this->sharedSocket->reserveInput(Socket::minimumReceiveSize);
+  const ssize_t result = this->readAvailable(space.first, space.second);
+  if (result > 0) {
+    this->sharedSocket->inputEnd += result;
     return true;
   }
+  this->sharedSocket->inputFailed = true;
   return false;
 }
 
@@ -147,7 +257,13 @@ ssize_t Socket::readAvailable(char* buffer, size_t capacity) {
 }
 
 ssize_t Socket::read(char* buffer, size_t size) {
-  ssize_t received = 0;
+  // Take first the bytes already received into the input buffer, e.g: the
+  // body of a request that arrived with its header
+  const std::string_view pending = this->sharedSocket->getPendingInput();
+  ssize_t received = std::min(pending.length(), size);
+  std::memcpy(buffer, pending.data(), received);
+  this->sharedSocket->consumeInput(received);
+
   while (size_t(received) < size) {
     const ssize_t result =
       this->readAvailable(buffer + received, size - received);
@@ -165,40 +281,193 @@ ssize_t Socket::read(char* buffer, size_t size) {
   return received;
 }
 
+bool Socket::read(std::string_view& data, size_t size) {
+  SharedSocket& shared = *this->sharedSocket;
+  while (shared.inputEnd - shared.inputStart < size) {
+    // Receive the missing bytes straight into the buffer
+    const size_t missing = size - (shared.inputEnd - shared.inputStart);
+    const std::pair<char*, size_t> space = shared.reserveInput(missing);
+    const ssize_t result = this->readAvailable(space.first, space.second);
+    if (result <= 0) {
+      shared.inputFailed = true;
+      return false;
+    }
+    shared.inputEnd += result;
+  }
+  data = shared.getPendingInput().substr(0, size);
+  shared.consumeInput(size);
+  return true;
+}
+
+ssize_t Socket::receiveAvailable() {
+  SharedSocket& shared = *this->sharedSocket;
+  ssize_t received = 0;
+  while (true) {
+    const std::pair<char*, size_t> space
+      = shared.reserveInput(Socket::minimumReceiveSize);
+    const ssize_t result = ::recv(shared.socketFileDescriptor, space.first
+      , space.second, MSG_DONTWAIT);
+    if (result <= 0) {
+      // Report the closed connection or error only if nothing was received
+      if (received == 0) {
+        received = result;
+      }
+      break;
+    }
+    shared.inputEnd += result;
+    received += result;
+    // A short read means the socket is empty, spare the call that says so
+    if (size_t(result) < space.second) {
+      break;
+    }
+  }
+  return received;
+}
+
+std::string_view Socket::getPendingInput() const {
+  return this->sharedSocket->getPendingInput();
+}
+
+size_t Socket::getScannedInput() const {
+  return this->sharedSocket->inputScanned;
+}
+
+void Socket::setScannedInput(size_t scanned) {
+  assert(scanned <= this->getPendingInput().length());
+  this->sharedSocket->inputScanned = scanned;
+}
+
+bool Socket::setReceiveTimeout(int seconds) {
+  struct timeval timeout = {seconds, 0};
+  return ::setsockopt(this->sharedSocket->socketFileDescriptor, SOL_SOCKET
+    , SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+bool Socket::setSendTimeout(int seconds) {
+  // Blocking sends are limited by the socket, and non-blocking ones by poll()
+  this->sharedSocket->sendTimeout = seconds > 0 ? seconds * 1000 : -1;
+  struct timeval timeout = {seconds, 0};
+  return ::setsockopt(this->sharedSocket->socketFileDescriptor, SOL_SOCKET
+    , SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+size_t Socket::countRequest() {
+  return ++this->sharedSocket->requestCount;
+}
+
 bool Socket::send() {
-  const std::string& text = this->sharedSocket->output.str();
-  const char* buffer = text.c_str();
-  const size_t length = text.length();
-  ssize_t sent = 0;
+  const std::string_view text = this->sharedSocket->output.view();
+  struct iovec buffer = {const_cast<char*>(text.data()), text.length()};
+  const bool sent = this->send(&buffer, 1);
+  if (sent) {
+    this->sharedSocket->output.str("");
+  }
+  return sent;
+}
+
+bool Socket::send(struct iovec* buffers, int count, bool more) {
+  struct msghdr message;
+  ::memset(&message, 0, sizeof(message));
+  message.msg_iov = buffers;
+  message.msg_iovlen = count;
+  // sendmsg() is writev() for sockets, but it also accepts flags. A peer that
+  // closed the connection must make this call fail instead of raising SIGPIPE
+  const int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
 
   // Try and retry to send the data until all data is sent to peer
-  while (true) {
-    const ssize_t result =
-      ::send(this->sharedSocket->socketFileDescriptor, buffer + sent
-        , length - sent, 0);
+  while (message.msg_iovlen > 0) {
+    ssize_t result =
+      ::sendmsg(this->sharedSocket->socketFileDescriptor, &message, flags);
 
     // If an error happened
     if (result < 0) {
+      if (this->sharedSocket->waitWritable()) {
+        continue;
+      }
       return false;
     }
 
-    sent += result;
-    if (size_t(sent) >= length) {
-      this->sharedSocket->output.str("");
-      return true;  // success: all data was sent
+    // Skip the buffers that were sent completely, and resume the partial one
+    while (message.msg_iovlen > 0
+        && size_t(result) >= message.msg_iov->iov_len) {
+      result -= message.msg_iov->iov_len;
+      ++message.msg_iov;
+      --message.msg_iovlen;
+    }
+    if (message.msg_iovlen > 0) {
+      message.msg_iov->iov_base =
+        static_cast<char*>(message.msg_iov->iov_base) + result;
+      message.msg_iov->iov_len -= result;
     }
   }
+  return true;  // success: all data was sent
+}
+
+bool Socket::sendFile(int fileDescriptor, off_t offset, size_t length) {
+  // Try and retry to send the file until all the region is sent to peer
+  while (length > 0) {
+    const ssize_t result = ::sendfile(this->sharedSocket->socketFileDescriptor
+      , fileDescriptor, &offset, length);
+
+    // If an error happened
+    if (result < 0) {
+      if (this->sharedSocket->waitWritable()) {
+        continue;
+      }
+      return false;
+    }
+    // The file is shorter than expected, the promised length cannot be met
+    if (result == 0) {
+      return false;
+    }
+    length -= result;
+  }
+  return true;
 }
 
 Socket::operator bool() const {
-  return this->sharedSocket->input.good() && this->sharedSocket->output.good();
+  return !this->sharedSocket->inputFailed && this->sharedSocket->output.good();
+}
+
+bool Socket::readToken(std::string_view& token) {
+  SharedSocket& shared = *this->sharedSocket;
+  // Skip whitespace, even across several receives
+  while (true) {
+    const std::string_view pending = shared.getPendingInput();
+    size_t start = 0;
+    while (start < pending.length() && ::isspace(pending[start])) {
+      ++start;
+    }
+    shared.consumeInput(start);
+    if (start < pending.length()) {
+      break;
+    }
+    if (!this->receive()) {
+      return false;
+    }
+  }
+  // The token ends at a whitespace, or where the peer closes the connection
+  size_t length = 0;
+  while (true) {
+    const std::string_view pending = shared.getPendingInput();
+    while (length < pending.length() && !::isspace(pending[length])) {
+      ++length;
+    }
+    if (length < pending.length() || !this->receive()) {
+      token = shared.getPendingInput().substr(0, length);
+      shared.consumeInput(length);
+      return true;
+    }
+  }
 }
 
 /// Expands the extraction operator>> with the given data type
 #define IMPL_EXTRACT_OP(type) \
   Socket& Socket::operator>>(type value) { \
-    while ( !(this->sharedSocket->input >> value) ) { \
-      if ( !this->receive() ) { return *this; } \
+    std::string_view token; \
+    if (this->readToken(token)) { \
+      std::istringstream text{std::string(token)}; \
+      if (!(text >> value)) { this->sharedSocket->inputFailed = true; } \
     } \
     return *this; \
   }
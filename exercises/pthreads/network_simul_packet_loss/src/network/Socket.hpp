@@ -4,9 +4,12 @@
 #define SOCKET_H
 
 #include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <sstream>
 
 #include "common.hpp"
@@ -24,6 +27,10 @@ class Socket {
  public:
   /// Objects of this class can be copied, but avoid innecesary copies
   DECLARE_RULE4(Socket, default);
+  /// Bytes allocated for the input buffer of a connection on its first read
+  static constexpr size_t initialInputCapacity = 16384;
+  /// Free bytes in the input buffer required to call recv()
+  static constexpr size_t minimumReceiveSize = 4096;
   /// Other network classes require to access internal attributes
   friend class TcpServer;
   friend class TcpClient;
@@ -44,14 +51,33 @@ class Socket {
   NetworkAddress getNetworkAddress() const;
   /// Closes the network connection with peer
   void close();
-  /// Read a line of data received from peer
+  /// Read a line of data received from peer. The separator is not included
   /// @return true on success, false on error or connection closed by peer
   bool readLine(std::string& line, char separator = '\n');
+  /// Read a line of data received from peer without copying it. The view
+  /// points into the input buffer, and it is valid until the next read
+  /// @return true on success, false on error or connection closed by peer
+  bool readLine(std::string_view& line, char separator = '\n');
   /// Send output buffer to the peer
   /// @return true on success, false on error or connection closed by peer
   bool send();
-  /// Receive some data from peer. The read data is stored in the internal
-  /// @a input buffer. This function blocks the caller
+  /// Send the given buffers to the peer in order with a single system call,
+  /// without copying them into the output buffer (scatter/gather output).
+  /// The array is modified to resume partial writes where they stopped
+  /// @param more true if more data follows shortly, e.g: a file sent with
+  /// @a sendFile(), so the kernel may merge them in the same packets
+  /// @return true on success, false on error or connection closed by peer
+  bool send(struct iovec* buffers, int count, bool more = false);
+  /// Send a region of an open file to the peer. The kernel copies the file
+  /// contents to the socket, so they never pass through user space. Unlike
+  /// @a send(), sendfile() has no flag to avoid SIGPIPE. The caller must
+  /// ignore that signal, e.g: HttpServer::run()
+  /// @return true on success, false on error, connection closed by peer, or
+  /// if the file is shorter than requested
+  bool sendFile(int fileDescriptor, off_t offset, size_t length);
+  /// Receive some data from peer. The read data is appended to the internal
+  /// @a input buffer, after the data not read yet. This function blocks the
+  /// caller
   /// @return true if a least a byte was read, false on error or connection
   /// closed by peer
   bool receive();
@@ -67,6 +93,41 @@ class Socket {
   /// @return The amount of bytes read, 0 on connection closed by peer, -1 on
   /// error and global errno is set to the error code
   ssize_t read(char* buffer, size_t size);
+  /// Read the requested amount of bytes without copying them. The view points
+  /// into the input buffer, and it is valid until the next read. This
+  /// function blocks the caller thread until the total amount of bytes are
+  /// received
+  /// @return true on success, false on error or connection closed by peer
+  bool read(std::string_view& data, size_t size);
+  /// Append the data available in the socket to the internal @a input buffer,
+  /// keeping the data not read yet. This function never blocks the caller,
+  /// even if the socket is in blocking mode
+  /// @return The amount of bytes appended, 0 on connection closed by peer, -1
+  /// on error and global errno is set to the error code, e.g: EAGAIN if no
+  /// data was available
+  ssize_t receiveAvailable();
+  /// Get the data in the internal @a input buffer not read yet. The view is
+  /// valid until the next read
+  std::string_view getPendingInput() const;
+  /// Get the number of pending bytes that were already searched, e.g: by the
+  /// event loop for the end of a request header. Hence, a search resumes
+  /// where the previous one stopped when more data arrives. It is 0 after
+  /// pending data is read
+  size_t getScannedInput() const;
+  /// Remember the number of pending bytes already searched
+  void setScannedInput(size_t scanned);
+  /// Make blocking reads fail with EAGAIN if no data arrives in the given
+  /// time. 0 waits forever
+  /// @return true on success, false on error
+  bool setReceiveTimeout(int seconds);
+  /// Make sends fail with ETIMEDOUT if the peer does not accept more data in
+  /// the given time, even if the socket is non-blocking. 0 waits forever
+  /// @return true on success, false on error
+  bool setSendTimeout(int seconds);
+  /// Count a request received through this connection, e.g: to limit the
+  /// number of requests that a client may send through it
+  /// @return The number of requests received, including this one
+  size_t countRequest();
   /// Evaluates this object within a boolean context as true if previous
   /// read and write operations were successful
   explicit operator bool() const;
@@ -114,6 +175,10 @@ class Socket {
   DECL_INSERT_OP(const std::string&)
 
  protected:
+  /// Read the next whitespace-separated token from the input buffer, used by
+  /// the extraction operators. The view is valid until the next read
+  /// @return true on success, false on error or connection closed by peer
+  bool readToken(std::string_view& token);
   /// Get the socket file descriptor, the number that identifies the socket
   int getSocketFileDescriptor() const;
   /// Set the socket file descriptor. This operation is only made by network
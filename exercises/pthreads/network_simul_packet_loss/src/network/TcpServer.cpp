@@ -1,16 +1,21 @@
 // Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
 
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <cassert>
 #include <cerrno>
+#include <cstdint>
 #include <cstring>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "TcpServer.hpp"
 #include "NetworkAddress.hpp"
@@ -26,6 +31,14 @@ TcpServer::TcpServer() {
 
 TcpServer::~TcpServer() {
   this->stopListening();
+  // Closed here because handler threads may resume clients after the event
+  // loop returned, and they write to the wake up file
+  if (this->eventFile >= 0) {
+    ::close(this->eventFile);
+  }
+  if (this->wakeUpFile >= 0) {
+    ::close(this->wakeUpFile);
+  }
   ::freeaddrinfo(this->availableAddresses);
 }
 
@@ -39,6 +52,13 @@ void TcpServer::stopListening() {
   if (this->connectionRequestSocket >= 0) {
     ::close(this->connectionRequestSocket);
   }
+  // Wake up the event loop, if any
+  this->stopping = true;
+  if (this->wakeUpFile >= 0) {
+    const uint64_t one = 1;
+    ssize_t written = ::write(this->wakeUpFile, &one, sizeof(one));
+    (void)written;
+  }
 }
 
 void TcpServer::listenForConnections(const char* port) {
@@ -134,6 +154,210 @@ void TcpServer::acceptConnectionRequest() {
   this->handleClientConnection(client);
 }
 
+void TcpServer::pollAllConnections() {
+  assert(this->connectionRequestSocket >= 0);
+  assert(this->eventFile == -1);
+  this->eventFile = ::epoll_create1(EPOLL_CLOEXEC);
+  this->wakeUpFile = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (this->eventFile == -1 || this->wakeUpFile == -1) {
+    throw std::runtime_error("could not create the event loop");
+  }
+
+  // The listening socket must not block when the pending requests run out
+  const int flags = ::fcntl(this->connectionRequestSocket, F_GETFL);
+  ::fcntl(this->connectionRequestSocket, F_SETFL, flags | O_NONBLOCK);
+
+  // Watch for connection requests and for wake ups
+  for (int file : {this->connectionRequestSocket, this->wakeUpFile}) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = file;
+    if (::epoll_ctl(this->eventFile, EPOLL_CTL_ADD, file, &event) == -1) {
+      throw std::runtime_error("could not watch the listening socket");
+    }
+  }
+
+  // Connected clients by socket file descriptor. Only this thread changes it,
+  // so a client is closed only here, and its number is not reused by the
+  // operating system while it is still in the map
+  std::map<int, WatchedClient> clients;
+  std::vector<struct epoll_event> events(TcpServer::maxEventsPerWait);
+  // Idle clients are looked for once per second, and connection requests
+  // that could not be accepted are tried again at the same time
+  std::chrono::steady_clock::time_point nextSweep
+    = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  bool acceptPaused = false;
+  while (!this->stopping) {
+    const int waitTime = this->idleTimeout > 0 || acceptPaused ? 1000 : -1;
+    const int count = ::epoll_wait(this->eventFile, events.data()
+      , static_cast<int>(events.size()), waitTime);
+    if (count == -1 && errno != EINTR) {
+      throw std::runtime_error("could not wait for events");
+    }
+
+    for (int index = 0; index < count; ++index) {
+      const int file = events[index].data.fd;
+      if (file == this->wakeUpFile) {
+        uint64_t wakeUps = 0;
+        ssize_t result = ::read(this->wakeUpFile, &wakeUps, sizeof(wakeUps));
+        (void)result;
+        continue;
+      }
+      if (file == this->connectionRequestSocket) {
+        if (!this->acceptPendingConnections(clients)) {
+          // Watching the socket now would wake up the loop for the same
+          // requests at once, using all the processor until a client closes
+          this->watchConnectionRequests(false);
+          acceptPaused = true;
+          nextSweep = std::chrono::steady_clock::now()
+            + std::chrono::seconds(1);
+        }
+        continue;
+      }
+
+      // A client sent data or closed the connection. Its socket is not
+      // watched anymore until it is resumed (EPOLLONESHOT)
+      const std::map<int, WatchedClient>::iterator itr = clients.find(file);
+      assert(itr != clients.end());
+      Socket& client = itr->second.socket;
+      const ssize_t received = client.receiveAvailable();
+      if (received == 0 || (received == -1 && errno != EAGAIN
+          && errno != EWOULDBLOCK)) {
+        // Closing the socket removes it from the epoll instance
+        client.close();
+        clients.erase(itr);
+        continue;
+      }
+      // The client is not idle while its data is handled
+      itr->second.deadline = std::chrono::steady_clock::time_point::max();
+      this->handleClientData(client);
+    }
+
+    this->watchResumedClients(clients);
+    if ((this->idleTimeout > 0 || acceptPaused)
+        && std::chrono::steady_clock::now() >= nextSweep) {
+      if (this->idleTimeout > 0) {
+        this->closeIdleClients(clients);
+      }
+      if (acceptPaused) {
+        this->watchConnectionRequests(true);
+        acceptPaused = false;
+      }
+      nextSweep = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    }
+    this->connectionCount.store(clients.size(), std::memory_order_relaxed);
+  }
+}
+
+bool TcpServer::acceptPendingConnections(
+    std::map<int, WatchedClient>& clients) {
+  while (true) {
+    Socket client;
+    socklen_t clientAddressSize = sizeof(struct sockaddr_storage);
+    const int file = ::accept4(this->connectionRequestSocket
+      , client.getSockAddr(), &clientAddressSize, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (file == -1) {
+      if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS
+          || errno == ENOMEM) {
+        return false;
+      }
+      // A client that gave up affects only its request. EAGAIN means all
+      // pending requests were accepted
+      if (errno == ECONNABORTED || errno == EINTR) {
+        continue;
+      }
+      return true;
+    }
+
+    client.setSocketFileDescriptor(file);
+    // A client that stops reading its responses must not hold a handler
+    // thread that sends to it
+    client.setSendTimeout(this->idleTimeout);
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = file;
+    // If it cannot be watched, the last copy of the client closes it here
+    if (::epoll_ctl(this->eventFile, EPOLL_CTL_ADD, file, &event) == 0) {
+      clients[file] = WatchedClient{client, this->getIdleDeadline()};
+    }
+  }
+}
+
+void TcpServer::watchConnectionRequests(bool watch) {
+  // The socket stays in the epoll instance, but without events it is ignored
+  struct epoll_event event = {};
+  event.events = watch ? static_cast<uint32_t>(EPOLLIN) : 0;
+  event.data.fd = this->connectionRequestSocket;
+  if (::epoll_ctl(this->eventFile, EPOLL_CTL_MOD, this->connectionRequestSocket
+      , &event) == -1) {
+    throw std::runtime_error("could not watch the listening socket");
+  }
+}
+
+void TcpServer::handleClientData(Socket& client) {
+  this->resumeClient(client);
+}
+
+void TcpServer::resumeClient(const Socket& client, bool keepOpen) {
+  // The event loop thread is the only one that watches and closes clients
+  {
+    const std::lock_guard<std::mutex> lock(this->resumedMutex);
+    this->resumedClients.emplace_back(client, keepOpen);
+  }
+  const uint64_t one = 1;
+  ssize_t written = ::write(this->wakeUpFile, &one, sizeof(one));
+  (void)written;
+}
+
+void TcpServer::watchResumedClients(std::map<int, WatchedClient>& clients) {
+  std::vector<std::pair<Socket, bool>> resumed;
+  {
+    const std::lock_guard<std::mutex> lock(this->resumedMutex);
+    resumed.swap(this->resumedClients);
+  }
+
+  for (std::pair<Socket, bool>& client : resumed) {
+    const int file = client.first.getSocketFileDescriptor();
+    const std::map<int, WatchedClient>::iterator itr = clients.find(file);
+    assert(itr != clients.end());
+    if (!client.second) {
+      client.first.close();
+      clients.erase(itr);
+      continue;
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = file;
+    if (::epoll_ctl(this->eventFile, EPOLL_CTL_MOD, file, &event) == -1) {
+      // A client that is not watched would never be served nor closed
+      client.first.close();
+      clients.erase(itr);
+      continue;
+    }
+    itr->second.deadline = this->getIdleDeadline();
+  }
+}
+
+void TcpServer::closeIdleClients(std::map<int, WatchedClient>& clients) {
+  const std::chrono::steady_clock::time_point now
+    = std::chrono::steady_clock::now();
+  for (std::map<int, WatchedClient>::iterator itr = clients.begin();
+      itr != clients.end(); ) {
+    if (itr->second.deadline <= now) {
+      itr->second.socket.close();
+      itr = clients.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+}
+
+std::chrono::steady_clock::time_point TcpServer::getIdleDeadline() const {
+  return this->idleTimeout > 0
+    ? std::chrono::steady_clock::now() + std::chrono::seconds(this->idleTimeout)
+    : std::chrono::steady_clock::time_point::max();
+}
+
 NetworkAddress TcpServer::getNetworkAddress() const {
   assert(this->selectedAddress);
   return NetworkAddress(this->selectedAddress->ai_addr);
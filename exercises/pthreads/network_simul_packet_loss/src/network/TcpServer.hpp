@@ -5,10 +5,17 @@
 
 #include <netdb.h>
 
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include "common.hpp"
+#include "Socket.hpp"
 
 class NetworkAddress;
-class Socket;
 
 class TcpServer {
   DISABLE_COPY(TcpServer);
@@ -16,6 +23,10 @@ class TcpServer {
  public:
   /// Default number of pending connection requests allowed in the queue
   static const int defaultConnectionQueueCapacity = 10;
+  /// Maximum number of events that the event loop takes from epoll at once
+  static const int maxEventsPerWait = 64;
+  /// Default seconds that an idle client connection is kept open
+  static const int defaultIdleTimeout = 5;
 
  protected:
   /// Lookup criteria for searching network information about this host
@@ -29,6 +40,33 @@ class TcpServer {
   /// Maximum number of pending connection requests allowed in the queue
   /// This queue is called backlog in the Unix sockets manual (man listen)
   int connectionQueueCapacity = defaultConnectionQueueCapacity;
+  /// Seconds that a client connection may stay idle before it is closed.
+  /// 0 keeps idle connections open forever
+  int idleTimeout = defaultIdleTimeout;
+  /// The epoll instance watching the connections in event loop mode
+  int eventFile = -1;
+  /// Written to wake up the event loop when clients are resumed or the server
+  /// stops listening
+  int wakeUpFile = -1;
+  /// True when stopListening() was called
+  std::atomic<bool> stopping{false};
+  /// Clients given back to the event loop, and if they should be kept open
+  std::vector<std::pair<Socket, bool>> resumedClients;
+  /// Protects the resumed clients, because any thread may resume a client
+  std::mutex resumedMutex;
+  /// Number of open client connections. In event loop mode, the clients
+  /// watched by the loop. Otherwise, subclasses count the accepted clients
+  /// until they are released
+  std::atomic<size_t> connectionCount{0};
+
+  /// A client connection watched by the event loop
+  struct WatchedClient {
+    /// The connection with the client
+    Socket socket;
+    /// When the connection is closed if the client stays idle. It is the
+    /// maximum time point while the data of the client is being handled
+    std::chrono::steady_clock::time_point deadline;
+  };
 
  public:
   /// Constructor
@@ -56,6 +94,26 @@ class TcpServer {
   /// Calls the pure virtual method @a handleClientConnection() to handle it.
   /// If queue is empty, the caller thread will be blocked
   void acceptConnectionRequest();
+  /// Serve all connections from an event loop instead of accepting them one
+  /// by one. Sockets are non-blocking, and the caller thread waits with epoll
+  /// for connection requests and data from all clients at once. Each time a
+  /// client sends data, it is appended to the input buffer of its socket and
+  /// the virtual method @a handleClientData() is called. This method returns
+  /// when stopListening() is called
+  /// @throw std::runtime_error on any error condition
+  void pollAllConnections();
+  /// Watch the client again in the event loop, after @a handleClientData()
+  /// or a thread working on its behalf finished with the data. The idle
+  /// timeout of the client starts again. This method may be called from any
+  /// thread
+  /// @param keepOpen If false, the event loop closes the connection
+  void resumeClient(const Socket& client, bool keepOpen = true);
+  /// Get the seconds that a client connection may stay idle
+  inline int getIdleTimeout() const { return this->idleTimeout; }
+  /// Get the number of open client connections
+  inline size_t getConnectionCount() const {
+    return this->connectionCount.load(std::memory_order_relaxed);
+  }
   /// Get the network address (IP and port) where this server is listening
   NetworkAddress getNetworkAddress() const;
 
@@ -68,6 +126,24 @@ class TcpServer {
   /// Inherited classes must override this method, process the connection
   /// request, and finally close the connection socket
   virtual void handleClientConnection(Socket& client) = 0;
+  /// This method is called by the event loop each time a client sent data.
+  /// The client is not watched until @a resumeClient() is called for it. By
+  /// default, the data is left in the socket and the client is resumed
+  virtual void handleClientData(Socket& client);
+  /// Accept all pending connection requests and watch them in the event loop
+  /// @return false if the process ran out of file descriptors or memory. The
+  /// remaining requests stay pending, and the listening socket is ready again
+  /// at once, so it must not be watched until some resources are released
+  bool acceptPendingConnections(std::map<int, WatchedClient>& clients);
+  /// Watch the listening socket in the event loop, or stop watching it
+  /// @throw std::runtime_error if the epoll instance cannot be changed
+  void watchConnectionRequests(bool watch);
+  /// Watch again the clients resumed since the last call, or close them
+  void watchResumedClients(std::map<int, WatchedClient>& clients);
+  /// Close the watched clients that were idle longer than the idle timeout
+  void closeIdleClients(std::map<int, WatchedClient>& clients);
+  /// Get the time point when a client that is idle from now must be closed
+  std::chrono::steady_clock::time_point getIdleDeadline() const;
 };
 
 #endif  // TCPSERVER_H
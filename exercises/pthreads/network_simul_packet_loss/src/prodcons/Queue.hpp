@@ -61,6 +61,15 @@ class Queue {
     return result;
   }
 
+  /// Get the number of elements in the queue, e.g: for monitoring. The count
+  /// may change right after it is returned
+  size_t getCount() {
+    this->mutex.lock();
+    const size_t count = this->queue.size();
+    this->mutex.unlock();
+    return count;
+  }
+
   bool isEmpty(){
     this->mutex.lock();
     bool empty = this->queue.empty();
@@ -0,0 +1,85 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <algorithm>
+
+#include "FactCache.hpp"
+
+FactCache::FactCache(size_t memoryBudget, size_t shardCount)
+  : shardCount{std::max(shardCount, size_t(1))}
+  , shardBudget{memoryBudget / std::max(shardCount, size_t(1))}
+  , shards{new Shard[this->shardCount]} {
+}
+
+bool FactCache::find(uint64_t number,
+    PrimeFactorizer::Factorization& factors) {
+  Shard& shard = this->getShard(number);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto& found = shard.index.find(number);
+  if (found == shard.index.end()) {
+    ++shard.statistics.misses;
+    return false;
+  }
+
+  // Move the entry to the front as the most recently used
+  ++shard.statistics.hits;
+  shard.recentEntries.splice(shard.recentEntries.begin()
+    , shard.recentEntries, found->second);
+  factors = found->second->second;
+  return true;
+}
+
+void FactCache::insert(uint64_t number,
+    const PrimeFactorizer::Factorization& factors) {
+  const size_t size = FactCache::getEntrySize(factors);
+  if (size > this->shardBudget) {
+    return;
+  }
+
+  Shard& shard = this->getShard(number);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  // Other thread may have factored the same number concurrently
+  if (shard.index.count(number) > 0) {
+    return;
+  }
+
+  // Evict the least recently used entries until the new one fits
+  while (!shard.recentEntries.empty()
+      && shard.statistics.bytes + size > this->shardBudget) {
+    const Entry& oldest = shard.recentEntries.back();
+    shard.statistics.bytes -= FactCache::getEntrySize(oldest.second);
+    shard.index.erase(oldest.first);
+    shard.recentEntries.pop_back();
+  }
+
+  shard.recentEntries.emplace_front(number, factors);
+  shard.index[number] = shard.recentEntries.begin();
+  shard.statistics.bytes += size;
+  shard.statistics.entries = shard.index.size();
+}
+
+std::vector<FactCache::Statistics> FactCache::getStatistics() {
+  std::vector<Statistics> statistics(this->shardCount);
+  for (size_t index = 0; index < this->shardCount; ++index) {
+    std::lock_guard<std::mutex> lock(this->shards[index].mutex);
+    statistics[index] = this->shards[index].statistics;
+    statistics[index].entries = this->shards[index].index.size();
+  }
+  return statistics;
+}
+
+FactCache::Shard& FactCache::getShard(uint64_t number) {
+  // Mix the bits of the number, so consecutive numbers use different shards
+  // and multiples of the shard count do not share one (splitmix64 finalizer)
+  number = (number ^ (number >> 30)) * 0xbf58476d1ce4e5b9ull;
+  number = (number ^ (number >> 27)) * 0x94d049bb133111ebull;
+  number ^= number >> 31;
+  return this->shards[number % this->shardCount];
+}
+
+size_t FactCache::getEntrySize(const PrimeFactorizer::Factorization& factors) {
+  // A list node has two links, and a hash table node has a link, the key,
+  // the iterator and the cached hash
+  return sizeof(Entry) + 2 * sizeof(void*)
+    + sizeof(void*) + sizeof(uint64_t) + sizeof(void*) + sizeof(size_t)
+    + factors.size() * sizeof(PrimeFactorizer::Factorization::value_type);
+}
@@ -0,0 +1,93 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef FACTCACHE_HPP
+#define FACTCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "PrimeFactorizer.hpp"
+
+/**
+@brief A concurrent cache of factorizations, evicting the least recently used
+The numbers are distributed among shards by a hash, and each shard has its own
+mutex, LRU list and share of the memory budget. Threads that look up numbers
+of different shards do not wait for each other
+*/
+class FactCache {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(FactCache);
+
+ public:
+  /// Default amount of bytes used by the cached factorizations
+  static constexpr size_t defaultMemoryBudget = 16 * 1024 * 1024;
+  /// Default amount of shards. More shards reduce contention
+  static constexpr size_t defaultShardCount = 16;
+
+  /// Counters of a shard
+  struct Statistics {
+    /// Lookups that found the number
+    uint64_t hits = 0;
+    /// Lookups that did not find the number
+    uint64_t misses = 0;
+    /// Numbers in the shard
+    size_t entries = 0;
+    /// Estimated bytes used by the shard
+    size_t bytes = 0;
+  };
+
+ protected:
+  /// A number and its factorization
+  typedef std::pair<uint64_t, PrimeFactorizer::Factorization> Entry;
+
+  /// A part of the cache protected by its own mutex. Shards are aligned to
+  /// cache lines, so locking one does not slow down the neighbors
+  struct alignas(64) Shard {
+    /// Protects the attributes of this shard
+    std::mutex mutex;
+    /// Cached entries, the most recently used first
+    std::list<Entry> recentEntries;
+    /// Find an entry by number
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    /// Counters of this shard
+    Statistics statistics;
+  };
+
+ protected:
+  /// Amount of shards
+  size_t shardCount = defaultShardCount;
+  /// Bytes each shard may use
+  size_t shardBudget = defaultMemoryBudget / defaultShardCount;
+  /// The shards of the cache
+  std::unique_ptr<Shard[]> shards;
+
+ public:
+  /// Constructor
+  /// @param memoryBudget Bytes that the cached factorizations may use,
+  /// approximately. It is divided evenly among the shards
+  explicit FactCache(size_t memoryBudget = defaultMemoryBudget,
+    size_t shardCount = defaultShardCount);
+  /// Copy the factorization of the number if it is cached
+  /// @return true if found
+  bool find(uint64_t number, PrimeFactorizer::Factorization& factors);
+  /// Add the factorization of a number, evicting the least recently used
+  /// ones of its shard if the shard exceeds its budget
+  void insert(uint64_t number, const PrimeFactorizer::Factorization& factors);
+  /// Get a copy of the counters of each shard
+  std::vector<Statistics> getStatistics();
+
+ protected:
+  /// Get the shard where the number is stored
+  Shard& getShard(uint64_t number);
+  /// Estimate the bytes used by an entry, including the container nodes
+  static size_t getEntrySize(const PrimeFactorizer::Factorization& factors);
+};
+
+#endif  // FACTCACHE_HPP
@@ -2,14 +2,21 @@
 
 #include <algorithm>
 #include <cassert>
-#include <iostream>
-#include <regex>
-#include <stdexcept>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 
+#include "FactCache.hpp"
 #include "FactWebApp.hpp"
+#include "FactWorker.hpp"
 #include "HttpRequest.hpp"
 #include "HttpResponse.hpp"
+#include "HttpRouter.hpp"
+#include "Log.hpp"
 
 FactWebApp::FactWebApp() {
 }
@@ -18,27 +25,61 @@ FactWebApp::~FactWebApp() {
 }
 
 void FactWebApp::start() {
-  // TODO(you): Start producers, consumers, assemblers...
-}
+  size_t workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+  if (const char* workers = std::getenv("FACT_WORKERS")) {
+    const int64_t value = std::atoll(workers);
+    workerCount = value > 0 ? value : workerCount;
+  }
 
-void FactWebApp::stop() {
-  // TODO(you): Stop producers, consumers, assemblers...
+  size_t cacheBudget = FactCache::defaultMemoryBudget;
+  if (const char* megabytes = std::getenv("FACT_CACHE_MB")) {
+    const int64_t value = std::atoll(megabytes);
+    cacheBudget = value >= 0 ? value * 1024 * 1024 : cacheBudget;
+  }
+  this->cache = new FactCache(cacheBudget);
+
+  for (size_t index = 0; index < workerCount; ++index) {
+    this->workers.push_back(new FactWorker(&this->taskQueue, *this->cache));
+    this->workers[index]->startThread();
+  }
+  Log::append(Log::INFO, "fact", std::to_string(workerCount)
+    + " workers started, cache of " + std::to_string(cacheBudget) + " bytes");
 }
 
-bool FactWebApp::handleHttpRequest(HttpRequest& httpRequest,
-    HttpResponse& httpResponse) {
-  // If the home page was asked
-  if (httpRequest.getMethod() == "GET" && httpRequest.getURI() == "/") {
-    return this->serveHomepage(httpRequest, httpResponse);
+void FactWebApp::stop() {
+  // The stop conditions are queued after the pending numbers, so they are done
+  for (size_t index = 0; index < this->workers.size(); ++index) {
+    this->taskQueue.enqueue(FactTask());
+  }
+  for (FactWorker* worker : this->workers) {
+    worker->waitToFinish();
+    delete worker;
   }
+  this->workers.clear();
 
-  // If the request starts with "fact/" is for this web app
-  if (httpRequest.getURI().rfind("/fact", 0) == 0) {
-    return this->serveFactorization(httpRequest, httpResponse);
+  uint64_t hits = 0, misses = 0;
+  for (const FactCache::Statistics& shard : this->cache->getStatistics()) {
+    hits += shard.hits;
+    misses += shard.misses;
   }
+  delete this->cache;
+  this->cache = nullptr;
+  Log::append(Log::INFO, "fact", "workers stopped, cache hits "
+    + std::to_string(hits) + " misses " + std::to_string(misses));
+}
 
-  // Unrecognized request
-  return false;
+bool FactWebApp::registerRoutes(HttpRouter& router) {
+  router.addRoute("GET", "/", [this](HttpRequest& httpRequest
+      , HttpResponse& httpResponse) {
+    return this->serveHomepage(httpRequest, httpResponse);
+  });
+  const HttpRouter::Handler& serveFactorization = [this](
+      HttpRequest& httpRequest, HttpResponse& httpResponse) {
+    return this->serveFactorization(httpRequest, httpResponse);
+  };
+  router.addRoute("GET", "/fact", serveFactorization);
+  router.addRoute("GET", "/fact/:numbers", serveFactorization);
+  return true;
 }
 
 // TODO(you): Fix code redundancy in the following methods
@@ -60,8 +101,8 @@ bool FactWebApp::serveHomepage(HttpRequest& httpRequest
     << "  <style>body {font-family: monospace}</style>\n"
     << "  <h1>" << title << "</h1>\n"
     << "  <form method=\"get\" action=\"/fact\">\n"
-    << "    <label for=\"number\">Number</label>\n"
-    << "    <input type=\"number\" name=\"number\" required/>\n"
+    << "    <label for=\"number\">Numbers separated by commas</label>\n"
+    << "    <input type=\"text\" name=\"number\" required/>\n"
     << "    <button type=\"submit\">Factorize</button>\n"
     << "  </form>\n"
     << "</html>\n";
@@ -72,54 +113,170 @@ bool FactWebApp::serveHomepage(HttpRequest& httpRequest
 
 bool FactWebApp::serveFactorization(HttpRequest& httpRequest
   , HttpResponse& httpResponse) {
-  (void)httpRequest;
+  // If numbers were asked in the form "/fact/200,13" or
+  // "/fact?number=200,13"
+  // TODO(you): Use arbitrary precision for numbers larger than uint64_t
+  std::string list;
+  std::vector<std::string_view> numbers;
+  if (!FactWebApp::parseNumbers(httpRequest, list, numbers)) {
+    return this->serveInvalidRequest(httpResponse);
+  }
+
+  // Factorization is done by the workers, this thread waits for them
+  std::vector<PrimeFactorizer::Factorization> factors;
+  std::vector<bool> valid;
+  this->factorize(numbers, factors, valid);
 
   // Set HTTP response metadata (headers)
   httpResponse.setHeader("Server", "AttoServer v1.0");
   httpResponse.setHeader("Content-type", "text/html; charset=ascii");
 
-  // If a number was asked in the form "/fact/1223"
-  // or "/fact?number=1223"
-  // TODO(you): URI can be a multi-value list, e.g: 100,2784,-53,200771728
-  // TODO(you): Use arbitrary precision for numbers larger than int64_t
-  // TODO(you): Modularize this method
-  std::smatch matches;
-  std::regex inQuery("^/fact(/|\\?number=)(\\d+)$");
-  if (std::regex_search(httpRequest.getURI(), matches, inQuery)) {
-    assert(matches.length() >= 3);
-    const int64_t number = std::stoll(matches[2]);
-
-    // TODO(you): Factorization must not be done by factorization threads
-    // Build the body of the response
-    std::string title = "Prime factorization of " + std::to_string(number);
-    httpResponse.body() << "<!DOCTYPE html>\n"
-      << "<html lang=\"en\">\n"
-      << "  <meta charset=\"ascii\"/>\n"
-      << "  <title>" << title << "</title>\n"
-      << "  <style>body {font-family: monospace} .err {color: red}</style>\n"
-      << "  <h1>" << title << "</h1>\n"
-      << "  <h2>200</h2>\n"
-      << "  <p>200 = 2<sup>3</sup> 5<sup>2</sup></p>\n"
-      << "  <h2 class=\"err\">-3</h2>\n"
-      << "  <p>-3: invalid number</p>\n"
-      << "  <h2>13</h2>\n"
-      << "  <p>-13 is prime</p>\n"
-      << "  <hr><p><a href=\"/\">Back</a></p>\n"
-      << "</html>\n";
-  } else {
-    // Build the body for an invalid request
-    std::string title = "Invalid request";
-    httpResponse.body() << "<!DOCTYPE html>\n"
-      << "<html lang=\"en\">\n"
-      << "  <meta charset=\"ascii\"/>\n"
-      << "  <title>" << title << "</title>\n"
-      << "  <style>body {font-family: monospace} .err {color: red}</style>\n"
-      << "  <h1 class=\"err\">" << title << "</h1>\n"
-      << "  <p>Invalid request for factorization</p>\n"
-      << "  <hr><p><a href=\"/\">Back</a></p>\n"
-      << "</html>\n";
+  // Build the body of the response, with the results in request order
+  std::string title = "Prime factorization of " + FactWebApp::escapeHtml(list);
+  httpResponse.body() << "<!DOCTYPE html>\n"
+    << "<html lang=\"en\">\n"
+    << "  <meta charset=\"ascii\"/>\n"
+    << "  <title>" << title << "</title>\n"
+    << "  <style>body {font-family: monospace} .err {color: red}</style>\n"
+    << "  <h1>" << title << "</h1>\n";
+  for (size_t index = 0; index < numbers.size(); ++index) {
+    FactWebApp::renderFactorization(httpResponse, numbers[index]
+      , valid[index], factors[index]);
   }
+  httpResponse.body() << "  <hr><p><a href=\"/\">Back</a></p>\n"
+    << "</html>\n";
 
   // Send the response to the client (user agent)
   return httpResponse.send();
 }
+
+bool FactWebApp::serveInvalidRequest(HttpResponse& httpResponse) {
+  // Set HTTP response metadata (headers)
+  httpResponse.setHeader("Server", "AttoServer v1.0");
+  httpResponse.setHeader("Content-type", "text/html; charset=ascii");
+
+  // Build the body for an invalid request
+  std::string title = "Invalid request";
+  httpResponse.body() << "<!DOCTYPE html>\n"
+    << "<html lang=\"en\">\n"
+    << "  <meta charset=\"ascii\"/>\n"
+    << "  <title>" << title << "</title>\n"
+    << "  <style>body {font-family: monospace} .err {color: red}</style>\n"
+    << "  <h1 class=\"err\">" << title << "</h1>\n"
+    << "  <p>Invalid request for factorization</p>\n"
+    << "  <hr><p><a href=\"/\">Back</a></p>\n"
+    << "</html>\n";
+
+  // Send the response to the client (user agent)
+  return httpResponse.send();
+}
+
+bool FactWebApp::parseNumbers(const HttpRequest& httpRequest,
+    std::string& list, std::vector<std::string_view>& numbers) {
+  // Find the list in the path, or in the number parameter of the query.
+  // Forms encode commas as "%2C" and spaces as "+"
+  std::string_view encoded = httpRequest.getPathParameter("numbers");
+  if (encoded.empty()) {
+    encoded = httpRequest.getQueryParameter("number");
+  }
+  list = HttpRequest::decodeComponent(encoded);
+
+  // Split the list by commas, ignoring spaces and empty items
+  size_t start = 0;
+  while (start < list.length()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.length();
+    }
+    std::string_view number(list.data() + start, end - start);
+    while (!number.empty() && number.front() == ' ') {
+      number.remove_prefix(1);
+    }
+    while (!number.empty() && number.back() == ' ') {
+      number.remove_suffix(1);
+    }
+    if (!number.empty()) {
+      numbers.push_back(number);
+    }
+    start = end + 1;
+  }
+  return !numbers.empty() && numbers.size() <= maxNumbersPerRequest;
+}
+
+void FactWebApp::factorize(const std::vector<std::string_view>& numbers,
+    std::vector<PrimeFactorizer::Factorization>& factors,
+    std::vector<bool>& valid) {
+  // Only natural numbers that fit in 64 bits are factored
+  FactBatch batch;
+  batch.numbers.resize(numbers.size());
+  batch.results.resize(numbers.size());
+  valid.resize(numbers.size());
+  std::vector<bool> queued(numbers.size());
+  size_t pending = 0;
+  for (size_t index = 0; index < numbers.size(); ++index) {
+    const std::string_view number = numbers[index];
+    const std::from_chars_result result = std::from_chars(number.data()
+      , number.data() + number.length(), batch.numbers[index]);
+    valid[index] = result.ec == std::errc()
+      && result.ptr == number.data() + number.length();
+    // Cached numbers are answered by this thread, the others are queued
+    queued[index] = valid[index]
+      && !this->cache->find(batch.numbers[index], batch.results[index]);
+    pending += queued[index];
+  }
+
+  // The counter is set before queuing, so no worker finds it at zero early
+  batch.pending = pending;
+  if (pending > 0) {
+    for (size_t index = 0; index < numbers.size(); ++index) {
+      if (queued[index]) {
+        this->taskQueue.enqueue(FactTask{&batch, index});
+      }
+    }
+    batch.done.wait();
+  }
+  factors = std::move(batch.results);
+}
+
+void FactWebApp::renderFactorization(HttpResponse& httpResponse,
+    std::string_view number, bool valid,
+    const PrimeFactorizer::Factorization& factors) {
+  std::stringstream& body = httpResponse.body();
+  const std::string& text = FactWebApp::escapeHtml(number);
+  if (!valid) {
+    body << "  <h2 class=\"err\">" << text << "</h2>\n"
+      << "  <p>" << text << ": invalid number</p>\n";
+    return;
+  }
+
+  body << "  <h2>" << text << "</h2>\n";
+  if (factors.empty()) {
+    body << "  <p>" << text << ": has no prime factors</p>\n";
+  } else if (factors.size() == 1 && factors[0].second == 1) {
+    body << "  <p>" << text << " is prime</p>\n";
+  } else {
+    body << "  <p>" << text << " =";
+    for (const std::pair<uint64_t, int>& factor : factors) {
+      body << ' ' << factor.first;
+      if (factor.second > 1) {
+        body << "<sup>" << factor.second << "</sup>";
+      }
+    }
+    body << "</p>\n";
+  }
+}
+
+std::string FactWebApp::escapeHtml(std::string_view text) {
+  std::string escaped;
+  escaped.reserve(text.length());
+  for (const char character : text) {
+    switch (character) {
+      case '<': escaped += "&lt;"; break;
+      case '>': escaped += "&gt;"; break;
+      case '&': escaped += "&amp;"; break;
+      case '"': escaped += "&quot;"; break;
+      default: escaped += character; break;
+    }
+  }
+  return escaped;
+}
@@ -3,29 +3,53 @@
 #ifndef FACTWEBAPP_HPP
 #define FACTWEBAPP_HPP
 
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "HttpApp.hpp"
+#include "PrimeFactorizer.hpp"
+#include "Queue.hpp"
+
+class FactCache;
+class FactWorker;
+struct FactTask;
 
 /**
 @brief A web application that calculates prime factors
+A request may ask for a comma-separated list of numbers, e.g:
+"/fact?number=200,-3,13". The numbers are factored in parallel by a pool of
+warm worker threads, and the results are shown in the order they were asked
 */
 class FactWebApp : public HttpApp {
   /// Objects of this class cannot be copied
   DISABLE_COPY(FactWebApp);
 
+ public:
+  /// Largest amount of numbers accepted in a request
+  static constexpr size_t maxNumbersPerRequest = 1000;
+
+ protected:
+  /// Numbers waiting for a worker
+  Queue<FactTask> taskQueue;
+  /// Warm threads that factor the numbers
+  std::vector<FactWorker*> workers;
+  /// Recent factorizations, consulted before queuing numbers to workers
+  FactCache* cache = nullptr;
+
  public:
   /// Constructor
   FactWebApp();
   /// Destructor
   ~FactWebApp();
-  /// Called by the web server when the web server is started
+  /// Register the home page and the factorization routes
+  bool registerRoutes(HttpRouter& router) override;
+  /// Create the cache and start the workers. Their count is taken from the
+  /// FACT_WORKERS environment variable, one per core by default. The cache
+  /// budget is taken from FACT_CACHE_MB, 16 by default
   void start() override;
-  /// Handle HTTP requests. @see HttpServer::handleHttpRequest()
-  /// @return true If this application handled the request, false otherwise
-  /// and another chained application should handle it
-  bool handleHttpRequest(HttpRequest& httpRequest,
-    HttpResponse& httpResponse) override;
-  /// Called when the web server stops, in order to allow the web application
-  /// clean up and finish as well
+  /// Let the workers finish the queued numbers, wait for them, and release
+  /// the cache
   void stop() override;
 
  protected:
@@ -37,6 +61,27 @@ class FactWebApp : public HttpApp {
   /// @return true if the factorization was handled, false if it must be
   /// handled by another application
   bool serveFactorization(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Sends a page for a request that does not ask for valid numbers
+  bool serveInvalidRequest(HttpResponse& httpResponse);
+  /// Extract the comma-separated list of numbers from the path parameter
+  /// "numbers", e.g: "/fact/200,13", or the query, e.g: "?number=200%2C13"
+  /// @return false if the request does not contain a list of numbers
+  static bool parseNumbers(const HttpRequest& httpRequest, std::string& list,
+    std::vector<std::string_view>& numbers);
+  /// Factor the valid numbers in parallel on the workers, except the cached
+  /// ones
+  /// @param factors Set to the factorization of each valid number, at the
+  /// index of the number
+  /// @param valid Set to false for each text that is not a natural number
+  void factorize(const std::vector<std::string_view>& numbers,
+    std::vector<PrimeFactorizer::Factorization>& factors,
+    std::vector<bool>& valid);
+  /// Write the factorization of a number as HTML to the response body
+  static void renderFactorization(HttpResponse& httpResponse,
+    std::string_view number, bool valid,
+    const PrimeFactorizer::Factorization& factors);
+  /// Escape the characters that have a meaning in HTML
+  static std::string escapeHtml(std::string_view text);
 };
 
 #endif  // FACTWEBAPP_HPP
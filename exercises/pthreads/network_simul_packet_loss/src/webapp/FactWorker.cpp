@@ -0,0 +1,27 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <cstdlib>
+
+#include "FactCache.hpp"
+#include "FactWorker.hpp"
+
+FactWorker::FactWorker(Queue<FactTask>* taskQueue, FactCache& cache)
+  : Consumer<FactTask>(taskQueue, FactTask())
+  , cache(cache) {
+}
+
+int FactWorker::run() {
+  this->consumeForever();
+  return EXIT_SUCCESS;
+}
+
+void FactWorker::consume(FactTask task) {
+  FactBatch& batch = *task.batch;
+  const uint64_t number = batch.numbers[task.index];
+  batch.results[task.index] = PrimeFactorizer::factorize(number);
+  this->cache.insert(number, batch.results[task.index]);
+  // The request may destroy the batch as soon as it is signaled
+  if (--batch.pending == 0) {
+    batch.done.signal();
+  }
+}
@@ -0,0 +1,65 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef FACTWORKER_HPP
+#define FACTWORKER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Consumer.hpp"
+#include "PrimeFactorizer.hpp"
+#include "Semaphore.hpp"
+
+class FactCache;
+
+/// The numbers of a request, factored in parallel by the workers. Each
+/// result is stored at the index of its number, so they keep request order
+struct FactBatch {
+  /// Numbers to factor
+  std::vector<uint64_t> numbers;
+  /// Factorization of each number
+  std::vector<PrimeFactorizer::Factorization> results;
+  /// Numbers not factored yet
+  std::atomic<size_t> pending{0};
+  /// Signaled by the worker that factors the last pending number
+  Semaphore done{0};
+};
+
+/// A number of a batch to be factored by a worker
+struct FactTask {
+  /// The batch that contains the number, or null to stop the worker
+  FactBatch* batch = nullptr;
+  /// Index of the number within the batch
+  size_t index = 0;
+  /// Tasks are compared to detect the stop condition
+  inline bool operator==(const FactTask& other) const {
+    return this->batch == other.batch && this->index == other.index;
+  }
+};
+
+/**
+@brief A warm thread that factors numbers queued by FactWebApp
+A task without batch is the stop condition of the worker
+*/
+class FactWorker : public Consumer<FactTask> {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(FactWorker);
+
+ protected:
+  /// Factorizations are stored here to answer repeated numbers
+  FactCache& cache;
+
+ public:
+  /// Constructor. All workers of an application share the same queue and
+  /// cache
+  FactWorker(Queue<FactTask>* taskQueue, FactCache& cache);
+  /// Consume tasks until the stop condition is dequeued
+  int run() override;
+  /// Factor the number of the task, cache it, and wake the request if it was
+  /// the last
+  void consume(FactTask task) override;
+};
+
+#endif  // FACTWORKER_HPP
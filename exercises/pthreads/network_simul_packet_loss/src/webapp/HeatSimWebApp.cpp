@@ -0,0 +1,370 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <cassert>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "HeatSimWebApp.hpp"
+#include "HeatSimWorker.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "HttpRouter.hpp"
+#include "Log.hpp"
+#include "NetworkAddress.hpp"
+
+extern "C" {
+#include "heat_simulation.h"
+}
+
+HeatSimWebApp::HeatSimWebApp() {
+}
+
+HeatSimWebApp::~HeatSimWebApp() {
+}
+
+void HeatSimWebApp::start() {
+  // Workers run whole jobs, each job shares the cores among its plates
+  size_t workerCount = 1;
+  if (const char* workers = std::getenv("HEATSIM_WORKERS")) {
+    const int64_t value = std::atoll(workers);
+    workerCount = value > 0 ? value : 1;
+  }
+  const size_t cores = std::thread::hardware_concurrency();
+  this->defaultThreads = cores > workerCount ? cores / workerCount : 1;
+  this->maxThreads = cores > 0 ? cores : 1;
+
+  for (size_t index = 0; index < workerCount; ++index) {
+    this->workers.push_back(new HeatSimWorker(&this->jobQueue, *this));
+    this->workers[index]->startThread();
+  }
+  Log::append(Log::INFO, "heatsim", std::to_string(workerCount)
+    + " workers started");
+}
+
+void HeatSimWebApp::stop() {
+  // The stop conditions are queued after the pending jobs, so they are done
+  for (size_t index = 0; index < this->workers.size(); ++index) {
+    this->jobQueue.enqueue(0);
+  }
+  for (HeatSimWorker* worker : this->workers) {
+    worker->waitToFinish();
+    delete worker;
+  }
+  this->workers.clear();
+  Log::append(Log::INFO, "heatsim", "workers stopped");
+}
+
+bool HeatSimWebApp::registerRoutes(HttpRouter& router) {
+  router.addRoute("*", "/heatsim", this->onlyLocal(
+    &HeatSimWebApp::serveHomepage));
+  // Submitting changes files of the server, so it is not done by a GET that
+  // any page could trigger, e.g: with an <img> whose src is this route
+  router.addRoute("POST", "/heatsim/submit", this->onlyLocal(
+    &HeatSimWebApp::serveSubmit));
+  router.addRoute("*", "/heatsim/submit", this->onlyLocal(
+    &HeatSimWebApp::serveSubmitMethod));
+  router.addRoute("*", "/heatsim/jobs", this->onlyLocal(
+    &HeatSimWebApp::serveJobs));
+  router.addRoute("*", "/heatsim/jobs/:id", this->onlyLocal(
+    &HeatSimWebApp::serveJobs));
+  router.addRoute("*", "/heatsim/*resource", this->onlyLocal(
+    &HeatSimWebApp::serveUnknown));
+  return true;
+}
+
+HttpRouter::Handler HeatSimWebApp::onlyLocal(
+    bool (HeatSimWebApp::*serve)(HttpRequest&, HttpResponse&)) {
+  return [this, serve](HttpRequest& httpRequest, HttpResponse& httpResponse) {
+    const std::string ip = httpRequest.getNetworkAddress().getIP();
+    if (ip != "127.0.0.1" && ip != "::1" && ip != "::ffff:127.0.0.1") {
+      return this->serveError(httpResponse, 403, "only local clients allowed");
+    }
+    return (this->*serve)(httpRequest, httpResponse);
+  };
+}
+
+bool HeatSimWebApp::serveUnknown(HttpRequest& httpRequest,
+    HttpResponse& httpResponse) {
+  (void)httpRequest;
+  return this->serveError(httpResponse, 404, "unknown heatsim resource");
+}
+
+bool HeatSimWebApp::serveHomepage(HttpRequest& httpRequest
+  , HttpResponse& httpResponse) {
+  (void)httpRequest;
+
+  // Set HTTP response metadata (headers)
+  httpResponse.setHeader("Server", "AttoServer v1.1");
+  httpResponse.setHeader("Content-type", "text/html; charset=ascii");
+
+  // Build the body of the response
+  std::string title = "Heat simulation";
+  httpResponse.body() << "<!DOCTYPE html>\n"
+    << "<html lang=\"en\">\n"
+    << "  <meta charset=\"ascii\"/>\n"
+    << "  <title>" << title << "</title>\n"
+    << "  <style>body {font-family: monospace}</style>\n"
+    << "  <h1>" << title << "</h1>\n"
+    << "  <form method=\"post\" action=\"/heatsim/submit\">\n"
+    << "    <label for=\"folder\">Folder</label>\n"
+    << "    <input type=\"text\" name=\"folder\" required/>\n"
+    << "    <label for=\"job\">Job file</label>\n"
+    << "    <input type=\"text\" name=\"job\" required/>\n"
+    << "    <label for=\"threads\">Threads</label>\n"
+    << "    <input type=\"number\" name=\"threads\" min=\"1\" max=\""
+      << this->maxThreads << "\"/>\n"
+    << "    <button type=\"submit\">Submit</button>\n"
+    << "  </form>\n"
+    << "  <p><a href=\"/heatsim/jobs\">Jobs</a></p>\n"
+    << "</html>\n";
+
+  // Send the response to the client (user agent)
+  return httpResponse.send();
+}
+
+bool HeatSimWebApp::serveSubmitMethod(HttpRequest& httpRequest,
+    HttpResponse& httpResponse) {
+  (void)httpRequest;
+  httpResponse.setHeader("Allow", "POST");
+  return this->serveError(httpResponse, 405, "jobs are submitted with POST");
+}
+
+bool HeatSimWebApp::serveSubmit(HttpRequest& httpRequest
+  , HttpResponse& httpResponse) {
+  // Browsers send the Origin of cross-site forms. Only the form of this
+  // server, or clients that send no Origin such as curl, may submit jobs
+  const std::string_view origin = httpRequest.getHeader("Origin");
+  if (!origin.empty()
+      && origin != "http://" + std::string(httpRequest.getHost())) {
+    return this->serveError(httpResponse, 403, "cross-site submit rejected");
+  }
+
+  HeatSimJob job;
+  job.folder = HttpRequest::decodeComponent(
+    httpRequest.getFormParameter("folder"));
+  job.jobFile = HttpRequest::decodeComponent(
+    httpRequest.getFormParameter("job"));
+  job.threads = this->defaultThreads;
+  if (job.folder.empty() || job.jobFile.empty()) {
+    return this->serveError(httpResponse, 400, "folder and job are required");
+  }
+  const std::string threads = HttpRequest::decodeComponent(
+    httpRequest.getFormParameter("threads"));
+  if (!threads.empty()) {
+    // The whole text must be a number between 1 and the cores, e.g: not "4a"
+    const char* const end = threads.data() + threads.length();
+    const std::from_chars_result result
+      = std::from_chars(threads.data(), end, job.threads);
+    if (result.ec != std::errc() || result.ptr != end || job.threads <= 0
+        || job.threads > this->maxThreads) {
+      return this->serveError(httpResponse, 400, "threads must be between 1"
+        " and " + std::to_string(this->maxThreads));
+    }
+  }
+  // Reject missing job files now, instead of queuing a job that will fail
+  char folder[PATH_MAX];
+  if (!std::ifstream(job.folder + '/' + job.jobFile)
+      || ::realpath(job.folder.c_str(), folder) == nullptr) {
+    return this->serveError(httpResponse, 400, "job file not found");
+  }
+  job.report = std::string(folder) + '/'
+    + HeatSimWebApp::reportName(job.jobFile);
+
+  job.queuedAt = std::chrono::steady_clock::now();
+  {
+    // Jobs with the same report would overwrite the files of each other
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (const size_t active = this->findActiveJob(job.report)) {
+      return this->serveError(httpResponse, 409, "job "
+        + std::to_string(active) + " writes the same report");
+    }
+    job.id = this->jobs.size() + 1;
+    this->jobs.push_back(job);
+  }
+  this->jobQueue.enqueue(job.id);
+  Log::append(Log::INFO, "heatsim", "job " + std::to_string(job.id)
+    + " queued: " + job.folder + '/' + job.jobFile);
+
+  httpResponse.setHeader("Location", "/heatsim/jobs/"
+    + std::to_string(job.id));
+  return HeatSimWebApp::sendJson(httpResponse, 202
+    , HeatSimWebApp::toJson(job));
+}
+
+bool HeatSimWebApp::serveJobs(HttpRequest& httpRequest
+  , HttpResponse& httpResponse) {
+  // List of all jobs
+  const std::string_view id = httpRequest.getPathParameter("id");
+  if (id.empty()) {
+    std::string json = "[";
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (const HeatSimJob& job : this->jobs) {
+      json += (job.id > 1 ? ",\n" : "\n") + HeatSimWebApp::toJson(job);
+    }
+    json += "\n]";
+    return HeatSimWebApp::sendJson(httpResponse, 200, json);
+  }
+
+  // A single job in the form "/heatsim/jobs/13"
+  const std::string number(id);
+  if (number.find_first_not_of("0123456789") != std::string::npos) {
+    return this->serveError(httpResponse, 404, "unknown heatsim resource");
+  }
+  const HeatSimJob job = this->getJob(std::strtoull(number.c_str()
+    , nullptr, 10));
+  if (job.id == 0) {
+    return this->serveError(httpResponse, 404, "job not found");
+  }
+  return HeatSimWebApp::sendJson(httpResponse, 200
+    , HeatSimWebApp::toJson(job));
+}
+
+bool HeatSimWebApp::serveError(HttpResponse& httpResponse, int statusCode,
+    const std::string& message) {
+  return HeatSimWebApp::sendJson(httpResponse, statusCode
+    , "{\"error\": \"" + HeatSimWebApp::escapeJson(message) + "\"}");
+}
+
+bool HeatSimWebApp::sendJson(HttpResponse& httpResponse, int statusCode,
+    const std::string& json) {
+  httpResponse.setStatusCode(statusCode);
+  httpResponse.setHeader("Server", "AttoServer v1.1");
+  httpResponse.setHeader("Content-type", "application/json; charset=ascii");
+  httpResponse.body() << json << '\n';
+  return httpResponse.send();
+}
+
+void HeatSimWebApp::runJob(size_t jobId) {
+  const HeatSimJob job = this->getJob(jobId);
+  assert(job.id == jobId);
+  this->setJobState(jobId, HeatSimJob::RUNNING);
+
+  // Same steps that the main of heatsim-pthread does for a job
+  uint64_t lines = 0;
+  params_matrix* variables = read_job_txt(job.jobFile.c_str()
+    , job.folder.c_str(), &lines);
+  if (variables == nullptr) {
+    this->setJobState(jobId, HeatSimJob::FAILED, "could not read job file");
+    return;
+  }
+  // The plates that fail are skipped, but then the report is incomplete
+  const int error = read_bin_plate(job.folder.c_str(), variables, lines
+    , job.jobFile.c_str(), job.threads);
+  for (uint64_t index = 0; index < lines; ++index) {
+    free(variables[index].filename);
+  }
+  free(variables);
+
+  if (error) {
+    this->setJobState(jobId, HeatSimJob::FAILED
+      , "could not simulate every plate or write the report");
+    return;
+  }
+  this->setJobState(jobId, HeatSimJob::DONE);
+}
+
+size_t HeatSimWebApp::findActiveJob(const std::string& report) const {
+  for (const HeatSimJob& job : this->jobs) {
+    if ((job.state == HeatSimJob::QUEUED || job.state == HeatSimJob::RUNNING)
+        && job.report == report) {
+      return job.id;
+    }
+  }
+  return 0;
+}
+
+HeatSimJob HeatSimWebApp::getJob(size_t jobId) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (jobId == 0 || jobId > this->jobs.size()) {
+    return HeatSimJob();
+  }
+  return this->jobs[jobId - 1];
+}
+
+void HeatSimWebApp::setJobState(size_t jobId, HeatSimJob::State state,
+    const std::string& error) {
+  const auto now = std::chrono::steady_clock::now();
+  double seconds = 0.0;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    HeatSimJob& job = this->jobs[jobId - 1];
+    job.state = state;
+    job.error = error;
+    if (state == HeatSimJob::RUNNING) {
+      job.startedAt = now;
+    } else {
+      job.finishedAt = now;
+      seconds = std::chrono::duration<double>(now - job.startedAt).count();
+    }
+  }
+  if (state == HeatSimJob::DONE) {
+    Log::append(Log::INFO, "heatsim", "job " + std::to_string(jobId)
+      + " done in " + std::to_string(seconds) + "s");
+  } else if (state == HeatSimJob::FAILED) {
+    Log::append(Log::ERROR, "heatsim", "job " + std::to_string(jobId)
+      + " failed: " + error);
+  }
+}
+
+std::string HeatSimWebApp::toJson(const HeatSimJob& job) {
+  static const char* const stateNames[] = {
+    "queued", "running", "done", "failed"
+  };
+  typedef std::chrono::duration<double> seconds;
+  const auto now = std::chrono::steady_clock::now();
+
+  std::ostringstream json;
+  json << "{\"id\": " << job.id
+    << ", \"folder\": \"" << HeatSimWebApp::escapeJson(job.folder) << '"'
+    << ", \"job\": \"" << HeatSimWebApp::escapeJson(job.jobFile) << '"'
+    << ", \"threads\": " << job.threads
+    << ", \"state\": \"" << stateNames[job.state] << '"';
+
+  // Time waiting in the queue and running, up to now if not finished yet
+  if (job.state == HeatSimJob::QUEUED) {
+    json << ", \"queued_s\": " << seconds(now - job.queuedAt).count();
+  } else {
+    const auto end = job.state == HeatSimJob::RUNNING ? now : job.finishedAt;
+    json << ", \"queued_s\": " << seconds(job.startedAt - job.queuedAt).count()
+      << ", \"run_s\": " << seconds(end - job.startedAt).count();
+  }
+  if (job.state == HeatSimJob::DONE) {
+    json << ", \"report\": \"" << HeatSimWebApp::escapeJson(job.folder + '/'
+      + HeatSimWebApp::reportName(job.jobFile)) << '"';
+  }
+  if (!job.error.empty()) {
+    json << ", \"error\": \"" << HeatSimWebApp::escapeJson(job.error) << '"';
+  }
+  json << '}';
+  return json.str();
+}
+
+std::string HeatSimWebApp::reportName(const std::string& jobFile) {
+  // The report is named as the job file, without .txt, and with .tsv
+  return jobFile.substr(0, jobFile.find(".txt")) + ".tsv";
+}
+
+std::string HeatSimWebApp::escapeJson(const std::string& text) {
+  std::string result;
+  for (const char character : text) {
+    if (character == '"' || character == '\\') {
+      result += '\\';
+      result += character;
+    } else if (static_cast<unsigned char>(character) < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", character);
+      result += code;
+    } else {
+      result += character;
+    }
+  }
+  return result;
+}
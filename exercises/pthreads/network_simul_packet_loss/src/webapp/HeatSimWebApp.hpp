@@ -0,0 +1,128 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef HEATSIMWEBAPP_HPP
+#define HEATSIMWEBAPP_HPP
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "HttpApp.hpp"
+#include "HttpRouter.hpp"
+#include "Queue.hpp"
+
+class HeatSimWorker;
+
+/// A heat simulation job submitted through the web
+struct HeatSimJob {
+  /// Life cycle of a job
+  enum State {
+    QUEUED,
+    RUNNING,
+    DONE,
+    FAILED,
+  };
+  /// Number that identifies the job, starting at 1
+  size_t id = 0;
+  /// Folder that contains the job file and the plates
+  std::string folder;
+  /// Name of the job file inside the folder
+  std::string jobFile;
+  /// Real path of the report the job writes, it identifies its output files
+  std::string report;
+  /// Threads that simulate each plate of the job
+  int threads = 1;
+  /// Current state of the job
+  State state = QUEUED;
+  /// Reason of a failure, empty otherwise
+  std::string error;
+  /// When the job was submitted, started and finished
+  std::chrono::steady_clock::time_point queuedAt, startedAt, finishedAt;
+};
+
+/**
+@brief A long-lived web application that runs heat simulation jobs
+Jobs are submitted by POST with a folder and a job file, as heatsim-pthread
+does in command line, and queued onto a pool of warm worker threads. Clients
+poll the state of their jobs. A job whose report is written by a job still
+queued or running is rejected, because both would write the same report and
+plates. Only local clients are served, see onlyLocal()
+*/
+class HeatSimWebApp : public HttpApp {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(HeatSimWebApp);
+
+ protected:
+  /// Protects the job records
+  std::mutex mutex;
+  /// Records of all submitted jobs. The job number n is at index n - 1
+  std::vector<HeatSimJob> jobs;
+  /// Numbers of the jobs waiting for a worker
+  Queue<size_t> jobQueue;
+  /// Warm threads that run the jobs
+  std::vector<HeatSimWorker*> workers;
+  /// Default threads that simulate each plate of a job
+  int defaultThreads = 1;
+  /// Most threads a client may ask for each job, one per core
+  int maxThreads = 1;
+
+ public:
+  /// Constructor
+  HeatSimWebApp();
+  /// Destructor
+  ~HeatSimWebApp();
+  /// Register the routes under "/heatsim", only for local clients
+  bool registerRoutes(HttpRouter& router) override;
+  /// Start the workers. Their count is taken from the HEATSIM_WORKERS
+  /// environment variable, 1 by default
+  void start() override;
+  /// Let the workers finish the queued jobs and wait for them
+  void stop() override;
+  /// Run the job with the given number. Called by workers
+  void runJob(size_t jobId);
+
+ protected:
+  /// Sends a form to submit jobs
+  bool serveHomepage(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Handle a POST to "/heatsim/submit" with the form
+  /// "folder=F&job=J[&threads=N]" in the body. Forms from other sites are
+  /// rejected by their Origin
+  bool serveSubmit(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Answer 405 to the other methods on "/heatsim/submit"
+  bool serveSubmitMethod(HttpRequest& httpRequest,
+    HttpResponse& httpResponse);
+  /// Handle "/heatsim/jobs" and "/heatsim/jobs/N", whose number is the path
+  /// parameter "id"
+  bool serveJobs(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Sends an error for the resources under "/heatsim" that do not exist
+  bool serveUnknown(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Wrap a serve method in a route handler that rejects remote clients with
+  /// 403. Jobs read and write files of the server, so every route under
+  /// "/heatsim" is wrapped
+  HttpRouter::Handler onlyLocal(
+    bool (HeatSimWebApp::*serve)(HttpRequest&, HttpResponse&));
+  /// Sends a JSON object with an error message
+  bool serveError(HttpResponse& httpResponse, int statusCode,
+    const std::string& message);
+  /// Sends a JSON body with the given status code
+  static bool sendJson(HttpResponse& httpResponse, int statusCode,
+    const std::string& json);
+  /// Return a copy of the job record, or one with id 0 if it does not exist
+  HeatSimJob getJob(size_t jobId);
+  /// Return the number of a queued or running job that writes the given
+  /// report, or 0 if there is none. The mutex must be locked
+  size_t findActiveJob(const std::string& report) const;
+  /// Update the state of a job
+  void setJobState(size_t jobId, HeatSimJob::State state,
+    const std::string& error = "");
+  /// Name of the report of a job file, without .txt and with .tsv, as
+  /// heatsim-pthread names it
+  static std::string reportName(const std::string& jobFile);
+  /// Serialize a job record as a JSON object
+  static std::string toJson(const HeatSimJob& job);
+  /// Escape a string to be used as a JSON string value
+  static std::string escapeJson(const std::string& text);
+};
+
+#endif  // HEATSIMWEBAPP_HPP
@@ -0,0 +1,20 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <cstdlib>
+
+#include "HeatSimWebApp.hpp"
+#include "HeatSimWorker.hpp"
+
+HeatSimWorker::HeatSimWorker(Queue<size_t>* jobQueue, HeatSimWebApp& webApp)
+  : Consumer<size_t>(jobQueue, 0)
+  , webApp(webApp) {
+}
+
+int HeatSimWorker::run() {
+  this->consumeForever();
+  return EXIT_SUCCESS;
+}
+
+void HeatSimWorker::consume(size_t jobId) {
+  this->webApp.runJob(jobId);
+}
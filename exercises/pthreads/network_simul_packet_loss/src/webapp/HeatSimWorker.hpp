@@ -0,0 +1,34 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef HEATSIMWORKER_HPP
+#define HEATSIMWORKER_HPP
+
+#include <cstddef>
+
+#include "Consumer.hpp"
+
+class HeatSimWebApp;
+
+/**
+@brief A warm thread that runs heat simulation jobs queued by HeatSimWebApp
+Jobs are identified by their number, starting at 1. The number 0 is the stop
+condition of the worker
+*/
+class HeatSimWorker : public Consumer<size_t> {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(HeatSimWorker);
+
+ protected:
+  /// The application that owns the job records
+  HeatSimWebApp& webApp;
+
+ public:
+  /// Constructor. All workers of an application share the same queue
+  HeatSimWorker(Queue<size_t>* jobQueue, HeatSimWebApp& webApp);
+  /// Consume jobs until the stop condition is dequeued
+  int run() override;
+  /// Run the job with the given number
+  void consume(size_t jobId) override;
+};
+
+#endif  // HEATSIMWORKER_HPP
@@ -0,0 +1,145 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <iomanip>
+#include <vector>
+
+#include "HttpMetrics.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "HttpRouter.hpp"
+#include "HttpServer.hpp"
+#include "MetricsWebApp.hpp"
+
+MetricsWebApp::MetricsWebApp(HttpServer& server)
+  : server(server) {
+}
+
+MetricsWebApp::~MetricsWebApp() {
+}
+
+bool MetricsWebApp::registerRoutes(HttpRouter& router) {
+  router.addRoute("GET", "/metrics", [this](HttpRequest& httpRequest
+      , HttpResponse& httpResponse) {
+    return this->serveMetrics(httpRequest, httpResponse);
+  });
+  return true;
+}
+
+bool MetricsWebApp::serveMetrics(HttpRequest& httpRequest,
+    HttpResponse& httpResponse) {
+  (void)httpRequest;
+  const size_t routeCount = this->server.getRouter().getRouteCount();
+  const std::vector<HttpMetrics::RouteCounters<uint64_t>> totals
+    = this->server.getMetrics().getTotals(routeCount);
+
+  httpResponse.setHeader("Server", "AttoServer v1.1");
+  httpResponse.setHeader("Content-type"
+    , "text/plain; version=0.0.4; charset=utf-8");
+  std::ostream& output = httpResponse.body();
+
+  // Only the status codes that were answered are listed
+  output << "# HELP http_requests_total Requests served, by route and status"
+    " code\n# TYPE http_requests_total counter\n";
+  for (size_t route = 0; route < totals.size(); ++route) {
+    const HttpMetrics::RouteCounters<uint64_t>& counters = totals[route];
+    for (size_t index = 0; index < counters.statusCodes.size(); ++index) {
+      if (counters.statusCodes[index] > 0) {
+        output << "http_requests_total{";
+        this->writeRouteLabels(output, route);
+        output << ",code=\"";
+        if (index + 1 < counters.statusCodes.size()) {
+          output << index + HttpMetrics::minStatusCode;
+        } else {
+          output << "invalid";
+        }
+        output << "\"} " << counters.statusCodes[index] << '\n';
+      }
+    }
+  }
+
+  output << "# HELP http_request_bytes_total Bytes of the requests, header and"
+    " body\n# TYPE http_request_bytes_total counter\n";
+  for (size_t route = 0; route < totals.size(); ++route) {
+    output << "http_request_bytes_total{";
+    this->writeRouteLabels(output, route);
+    output << "} " << totals[route].bytesReceived << '\n';
+  }
+
+  output << "# HELP http_response_bytes_total Bytes of the responses, header"
+    " and body\n# TYPE http_response_bytes_total counter\n";
+  for (size_t route = 0; route < totals.size(); ++route) {
+    output << "http_response_bytes_total{";
+    this->writeRouteLabels(output, route);
+    output << "} " << totals[route].bytesSent << '\n';
+  }
+
+  // The buckets of Prometheus are cumulative
+  output << "# HELP http_request_duration_seconds Time to answer the requests,"
+    " since they were received\n"
+    "# TYPE http_request_duration_seconds histogram\n";
+  for (size_t route = 0; route < totals.size(); ++route) {
+    const HttpMetrics::RouteCounters<uint64_t>& counters = totals[route];
+    uint64_t count = 0;
+    for (size_t index = 0; index < counters.durations.size(); ++index) {
+      count += counters.durations[index];
+      output << "http_request_duration_seconds_bucket{";
+      this->writeRouteLabels(output, route);
+      output << ",le=\"";
+      if (index < HttpMetrics::durationBounds.size()) {
+        MetricsWebApp::writeSeconds(output
+          , HttpMetrics::durationBounds[index]);
+      } else {
+        output << "+Inf";
+      }
+      output << "\"} " << count << '\n';
+    }
+    output << "http_request_duration_seconds_sum{";
+    this->writeRouteLabels(output, route);
+    output << "} ";
+    MetricsWebApp::writeSeconds(output, counters.durationSum);
+    output << "\nhttp_request_duration_seconds_count{";
+    this->writeRouteLabels(output, route);
+    output << "} " << count << '\n';
+  }
+
+  output << "# HELP http_handler_queue_depth Clients waiting for a handler\n"
+    "# TYPE http_handler_queue_depth gauge\n"
+    "http_handler_queue_depth " << this->server.getQueueDepth() << '\n'
+    << "# HELP http_active_connections Open client connections\n"
+    "# TYPE http_active_connections gauge\n"
+    "http_active_connections " << this->server.getConnectionCount() << '\n';
+
+  return httpResponse.send();
+}
+
+void MetricsWebApp::writeRouteLabels(std::ostream& output, size_t route)
+    const {
+  const HttpRouter& router = this->server.getRouter();
+  // The extra route counts the requests that matched no route
+  if (route >= router.getRouteCount()) {
+    output << "method=\"*\",route=\"unmatched\"";
+    return;
+  }
+  output << "method=\"";
+  MetricsWebApp::writeLabelValue(output, router.getRouteMethod(route));
+  output << "\",route=\"";
+  MetricsWebApp::writeLabelValue(output, router.getRoutePattern(route));
+  output << '"';
+}
+
+void MetricsWebApp::writeLabelValue(std::ostream& output,
+    std::string_view value) {
+  for (const char character : value) {
+    switch (character) {
+      case '\\': output << "\\\\"; break;
+      case '"': output << "\\\""; break;
+      case '\n': output << "\\n"; break;
+      default: output << character; break;
+    }
+  }
+}
+
+void MetricsWebApp::writeSeconds(std::ostream& output, uint64_t microseconds) {
+  output << microseconds / 1000000 << '.' << std::setfill('0') << std::setw(6)
+    << microseconds % 1000000 << std::setfill(' ');
+}
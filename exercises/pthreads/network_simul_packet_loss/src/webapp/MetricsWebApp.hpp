@@ -0,0 +1,50 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef METRICSWEBAPP_HPP
+#define METRICSWEBAPP_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "HttpApp.hpp"
+
+class HttpServer;
+
+/**
+@brief A web application that publishes the metrics of the web server
+The "/metrics" page shows the requests served by each route, by status code,
+their bytes and a histogram of their durations, and the current number of
+queued clients and open connections. Requests that matched no route, or whose
+route declined them, e.g: a missing static file, are labelled
+route="unmatched". It uses the text format of Prometheus, so the server can be
+monitored by scraping this page
+*/
+class MetricsWebApp : public HttpApp {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(MetricsWebApp);
+
+ protected:
+  /// The server whose metrics are published
+  HttpServer& server;
+
+ public:
+  /// Constructor
+  explicit MetricsWebApp(HttpServer& server);
+  /// Destructor
+  ~MetricsWebApp();
+  /// Register the metrics page
+  bool registerRoutes(HttpRouter& router) override;
+
+ protected:
+  /// Sends the metrics of the server in the Prometheus text format
+  bool serveMetrics(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Write the labels that identify a route, e.g: method="GET",route="/"
+  void writeRouteLabels(std::ostream& output, size_t route) const;
+  /// Write a label value, escaping the backslashes, quotes, and new lines
+  static void writeLabelValue(std::ostream& output, std::string_view value);
+  /// Write an amount of microseconds as seconds, without losing precision
+  static void writeSeconds(std::ostream& output, uint64_t microseconds);
+};
+
+#endif  // METRICSWEBAPP_HPP
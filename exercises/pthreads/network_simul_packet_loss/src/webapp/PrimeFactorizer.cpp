@@ -0,0 +1,182 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <algorithm>
+#include <numeric>
+
+#include "PrimeFactorizer.hpp"
+
+PrimeFactorizer::Factorization PrimeFactorizer::factorize(uint64_t number) {
+  Factorization factors;
+  if (number < 2) {
+    return factors;
+  }
+
+  // Remove the small factors by trial division
+  for (const uint32_t prime : PrimeFactorizer::getPrimes()) {
+    if (uint64_t(prime) * prime > number) {
+      break;
+    }
+    if (number % prime == 0) {
+      int exponent = 0;
+      do {
+        number /= prime;
+        ++exponent;
+      } while (number % prime == 0);
+      factors.emplace_back(prime, exponent);
+    }
+  }
+
+  // The cofactor has no factors below the limit. If it is below the square
+  // of the limit, it is prime. Otherwise split it until all parts are prime
+  std::vector<uint64_t> pending;
+  if (number > 1) {
+    pending.push_back(number);
+  }
+  const size_t smallFactors = factors.size();
+  while (!pending.empty()) {
+    const uint64_t part = pending.back();
+    pending.pop_back();
+    if (part < uint64_t(sieveLimit) * sieveLimit
+        || PrimeFactorizer::isPrime(part)) {
+      factors.emplace_back(part, 1);
+    } else {
+      const uint64_t divisor = PrimeFactorizer::findDivisor(part);
+      pending.push_back(divisor);
+      pending.push_back(part / divisor);
+    }
+  }
+
+  // Large primes may be found in any order and repeated, e.g: p * p
+  std::sort(factors.begin() + smallFactors, factors.end());
+  size_t last = smallFactors;
+  for (size_t index = smallFactors + 1; index < factors.size(); ++index) {
+    if (factors[index].first == factors[last].first) {
+      factors[last].second += factors[index].second;
+    } else {
+      factors[++last] = factors[index];
+    }
+  }
+  if (factors.size() > smallFactors) {
+    factors.resize(last + 1);
+  }
+  return factors;
+}
+
+bool PrimeFactorizer::isPrime(uint64_t number) {
+  if (number < 2) {
+    return false;
+  }
+  for (const uint64_t prime : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}) {
+    if (number % prime == 0) {
+      return number == prime;
+    }
+  }
+
+  // number - 1 = odd * 2^twos
+  uint64_t odd = number - 1;
+  int twos = 0;
+  while (odd % 2 == 0) {
+    odd /= 2;
+    ++twos;
+  }
+
+  // These bases make Miller-Rabin exact for all 64-bit numbers. See
+  // https://miller-rabin.appspot.com/
+  for (const uint64_t base : {2ull, 325ull, 9375ull, 28178ull, 450775ull
+      , 9780504ull, 1795265022ull}) {
+    const uint64_t witness = base % number;
+    if (witness == 0) {
+      continue;
+    }
+    uint64_t power = PrimeFactorizer::powerModulo(witness, odd, number);
+    if (power == 1 || power == number - 1) {
+      continue;
+    }
+    bool composite = true;
+    for (int square = 1; square < twos && composite; ++square) {
+      power = PrimeFactorizer::multiplyModulo(power, power, number);
+      composite = power != number - 1;
+    }
+    if (composite) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const std::vector<uint32_t>& PrimeFactorizer::getPrimes() {
+  // Sieve of Eratosthenes. Static locals are initialized once, even if
+  // several threads call this method at the same time
+  static const std::vector<uint32_t> primes = [] {
+    std::vector<bool> composite(sieveLimit, false);
+    std::vector<uint32_t> found;
+    for (uint32_t number = 2; number < sieveLimit; ++number) {
+      if (!composite[number]) {
+        found.push_back(number);
+        for (uint32_t multiple = number * number; multiple < sieveLimit;
+            multiple += number) {
+          composite[multiple] = true;
+        }
+      }
+    }
+    return found;
+  }();
+  return primes;
+}
+
+uint64_t PrimeFactorizer::findDivisor(uint64_t composite) {
+  // Pollard's rho with Brent's cycle detection. The gcd is computed once for
+  // a block of products of differences, instead of once per step
+  constexpr uint64_t blockSize = 128;
+  for (uint64_t increment = 1; ; ++increment) {
+    const auto next = [composite, increment](uint64_t value) {
+      return static_cast<uint64_t>((static_cast<unsigned __int128>(value)
+        * value + increment) % composite);
+    };
+    uint64_t fast = 2, slow = 2, saved = 2, product = 1, divisor = 1;
+    for (uint64_t length = 1; divisor == 1; length *= 2) {
+      slow = fast;
+      for (uint64_t step = 0; step < length; ++step) {
+        fast = next(fast);
+      }
+      for (uint64_t done = 0; done < length && divisor == 1;
+          done += blockSize) {
+        saved = fast;
+        for (uint64_t step = 0; step < std::min(blockSize, length - done);
+            ++step) {
+          fast = next(fast);
+          product = PrimeFactorizer::multiplyModulo(product
+            , fast > slow ? fast - slow : slow - fast, composite);
+        }
+        divisor = std::gcd(product, composite);
+      }
+    }
+
+    // The block overshot the cycle, repeat its steps one by one
+    if (divisor == composite) {
+      do {
+        saved = next(saved);
+        divisor = std::gcd(saved > slow ? saved - slow : slow - saved
+          , composite);
+      } while (divisor == 1);
+    }
+    // Otherwise try with another polynomial
+    if (divisor != composite) {
+      return divisor;
+    }
+  }
+}
+
+uint64_t PrimeFactorizer::powerModulo(uint64_t base, uint64_t exponent,
+    uint64_t modulus) {
+  uint64_t result = 1;
+  base %= modulus;
+  while (exponent > 0) {
+    if (exponent & 1) {
+      result = PrimeFactorizer::multiplyModulo(result, base, modulus);
+    }
+    base = PrimeFactorizer::multiplyModulo(base, base, modulus);
+    exponent >>= 1;
+  }
+  return result;
+}
@@ -0,0 +1,55 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef PRIMEFACTORIZER_HPP
+#define PRIMEFACTORIZER_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+/**
+ * @brief Factors 64-bit integers into primes.
+ * @details Small factors are removed by trial division with the primes of a
+ * sieve computed once. The remaining cofactor is tested with a deterministic
+ * Miller-Rabin test, and composite cofactors are split with the Pollard's rho
+ * algorithm, using the cycle detection of Brent.
+ */
+class PrimeFactorizer {
+  DISABLE_COPY(PrimeFactorizer);
+  /// Constructor
+  PrimeFactorizer() = delete;
+  /// Destructor
+  ~PrimeFactorizer() = delete;
+
+ public:
+  /// Prime factors of a number and their exponents, in increasing order,
+  /// e.g: {{2, 3}, {5, 2}} for 200
+  typedef std::vector<std::pair<uint64_t, int>> Factorization;
+  /// Trial division uses the primes below this limit
+  static constexpr uint32_t sieveLimit = 1 << 16;
+
+ public:
+  /// Factor the given number. 0 and 1 have no prime factors
+  static Factorization factorize(uint64_t number);
+  /// Return true if the number is prime. The test is exact for 64-bit numbers
+  static bool isPrime(uint64_t number);
+
+ protected:
+  /// Get the primes below sieveLimit. They are computed on the first call
+  static const std::vector<uint32_t>& getPrimes();
+  /// Find a non-trivial divisor of an odd composite number
+  static uint64_t findDivisor(uint64_t composite);
+  /// Return (a * b) mod modulus without overflow
+  static inline uint64_t multiplyModulo(uint64_t a, uint64_t b,
+      uint64_t modulus) {
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b
+      % modulus);
+  }
+  /// Return (base ^ exponent) mod modulus
+  static uint64_t powerModulo(uint64_t base, uint64_t exponent,
+    uint64_t modulus);
+};
+
+#endif  // PRIMEFACTORIZER_HPP
@@ -0,0 +1,449 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include "HttpMessage.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "HttpRouter.hpp"
+#include "Log.hpp"
+#include "StaticFileWebApp.hpp"
+
+/// Abbreviated day names used by HTTP-dates, starting on Sunday
+static const char* const dayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu"
+  , "Fri", "Sat"};
+/// Abbreviated month names used by HTTP-dates
+static const char* const monthNames[] = {"Jan", "Feb", "Mar", "Apr", "May"
+  , "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+/// Parse the given digits as a number
+/// @return true if all the text is a number
+static bool parseNumber(std::string_view text, int& number) {
+  const std::from_chars_result result =
+    std::from_chars(text.data(), text.data() + text.length(), number);
+  return result.ec == std::errc() && result.ptr == text.data() + text.length();
+}
+
+/// Decode %XX escapes of a URI path
+/// @return false if an escape is invalid or encodes a null character
+static bool decodePath(std::string_view text, std::string& path) {
+  path.reserve(path.length() + text.length());
+  for (size_t index = 0; index < text.length(); ++index) {
+    if (text[index] != '%') {
+      path += text[index];
+      continue;
+    }
+    int value = 0;
+    if (index + 2 >= text.length()
+        || std::from_chars(text.data() + index + 1, text.data() + index + 3
+          , value, 16).ptr != text.data() + index + 3 || value <= 0) {
+      return false;
+    }
+    path += static_cast<char>(value);
+    index += 2;
+  }
+  return true;
+}
+
+StaticFileWebApp::StaticFileWebApp(const std::string& prefix,
+    const std::string& directory, size_t cacheCapacity,
+    size_t maxCachedFileSize)
+  : prefix{prefix}
+  , directory{directory}
+  , cacheCapacity{cacheCapacity}
+  , maxCachedFileSize{maxCachedFileSize} {
+}
+
+StaticFileWebApp::~StaticFileWebApp() {
+}
+
+void StaticFileWebApp::start() {
+  // Without a real directory no file is served
+  char real[PATH_MAX];
+  if (::realpath(this->directory.c_str(), real) == nullptr) {
+    this->realDirectory.clear();
+    Log::append(Log::WARNING, "static", "directory not found: "
+      + this->directory);
+    return;
+  }
+  this->realDirectory = real;
+  Log::append(Log::INFO, "static", "serving " + this->realDirectory + " at "
+    + this->prefix);
+}
+
+void StaticFileWebApp::stop() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->cache.clear();
+  this->recentFiles.clear();
+  this->cacheSize = 0;
+}
+
+bool StaticFileWebApp::registerRoutes(HttpRouter& router) {
+  const HttpRouter::Handler& serveFile = [this](HttpRequest& httpRequest
+      , HttpResponse& httpResponse) {
+    return this->servePath(httpRequest, httpResponse);
+  };
+  router.addRoute("GET", this->prefix + "/*path", serveFile);
+  router.addRoute("HEAD", this->prefix + "/*path", serveFile);
+  return true;
+}
+
+bool StaticFileWebApp::servePath(HttpRequest& httpRequest,
+    HttpResponse& httpResponse) {
+  // Files that do not exist are left to other applications
+  const std::string& path = this->resolvePath(this->mapPath(
+    httpRequest.getPathParameter("path")));
+  struct stat status;
+  if (path.empty() || ::stat(path.c_str(), &status) != 0
+      || !S_ISREG(status.st_mode)) {
+    return false;
+  }
+
+  // Use the cached file if it was not modified, otherwise load it again
+  int fileDescriptor = -1;
+  std::shared_ptr<const StaticFile> file = this->findCached(path, status);
+  if (!file) {
+    const std::shared_ptr<StaticFile>& loaded =
+      this->loadFile(path, fileDescriptor);
+    if (!loaded) {
+      return false;
+    }
+    if (loaded->cached) {
+      this->addCached(loaded);
+    }
+    file = loaded;
+  }
+
+  // The file is kept alive by this function while the response is sent
+  const bool sent = this->serveFile(httpRequest, httpResponse, *file
+    , fileDescriptor);
+  if (fileDescriptor >= 0) {
+    ::close(fileDescriptor);
+  }
+  return sent;
+}
+
+std::string StaticFileWebApp::mapPath(std::string_view relative) const {
+  std::string decoded;
+  if (!decodePath(relative, decoded)) {
+    return "";
+  }
+
+  // Copy the segments, rejecting the ones that reach outside the directory
+  std::string path = this->directory;
+  size_t start = 0;
+  while (start < decoded.length()) {
+    size_t end = decoded.find('/', start);
+    if (end == std::string::npos) {
+      end = decoded.length();
+    }
+    const std::string_view segment(decoded.data() + start, end - start);
+    if (segment == "..") {
+      return "";
+    }
+    if (!segment.empty() && segment != ".") {
+      path.append(1, '/').append(segment);
+    }
+    start = end + 1;
+  }
+
+  // Directories are served by their index page
+  if (decoded.empty() || decoded.back() == '/') {
+    path.append("/index.html");
+  }
+  return path;
+}
+
+std::string StaticFileWebApp::resolvePath(const std::string& path) const {
+  if (path.empty() || this->realDirectory.empty()) {
+    return "";
+  }
+  // Symbolic links may point anywhere, only their targets are checked
+  char real[PATH_MAX];
+  if (::realpath(path.c_str(), real) == nullptr) {
+    return "";
+  }
+  const std::string_view resolved = real;
+  const std::string_view root = this->realDirectory;
+  if (resolved.length() <= root.length() || resolved.rfind(root, 0) != 0
+      || (root.back() != '/' && resolved[root.length()] != '/')) {
+    return "";
+  }
+  return real;
+}
+
+std::shared_ptr<const StaticFile> StaticFileWebApp::findCached(
+    const std::string& path, const struct stat& status) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  const auto& found = this->cache.find(path);
+  if (found == this->cache.end()) {
+    return nullptr;
+  }
+
+  // If the file was not modified, move it to the front as the most recent
+  const std::shared_ptr<const StaticFile> file = *found->second;
+  if (file->size == status.st_size
+      && file->modified.tv_sec == status.st_mtim.tv_sec
+      && file->modified.tv_nsec == status.st_mtim.tv_nsec) {
+    this->recentFiles.splice(this->recentFiles.begin(), this->recentFiles
+      , found->second);
+    return file;
+  }
+
+  // The file was modified, the cached copy is stale
+  this->cacheSize -= file->contents.length();
+  this->recentFiles.erase(found->second);
+  this->cache.erase(found);
+  return nullptr;
+}
+
+void StaticFileWebApp::addCached(
+    const std::shared_ptr<const StaticFile>& file) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  // Other connection handler may have loaded the same file concurrently
+  const auto& found = this->cache.find(file->path);
+  if (found != this->cache.end()) {
+    this->cacheSize -= (*found->second)->contents.length();
+    this->recentFiles.erase(found->second);
+    this->cache.erase(found);
+  }
+
+  // Evict the least recently used files until the new one fits
+  while (!this->recentFiles.empty()
+      && this->cacheSize + file->contents.length() > this->cacheCapacity) {
+    const std::shared_ptr<const StaticFile>& oldest = this->recentFiles.back();
+    this->cacheSize -= oldest->contents.length();
+    this->cache.erase(oldest->path);
+    this->recentFiles.pop_back();
+  }
+
+  this->recentFiles.push_front(file);
+  this->cache[file->path] = this->recentFiles.begin();
+  this->cacheSize += file->contents.length();
+}
+
+std::shared_ptr<StaticFile> StaticFileWebApp::loadFile(const std::string& path,
+    int& fileDescriptor) const {
+  // The size and modification time are taken from the open file, so they
+  // describe the contents that are read
+  fileDescriptor = -1;
+  const int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file < 0) {
+    return nullptr;
+  }
+  struct stat status;
+  if (::fstat(file, &status) != 0 || !S_ISREG(status.st_mode)) {
+    ::close(file);
+    return nullptr;
+  }
+
+  // Build the metadata and the header lines once, they are reused while the
+  // file is cached
+  const std::shared_ptr<StaticFile>& loaded = std::make_shared<StaticFile>();
+  loaded->path = path;
+  loaded->size = status.st_size;
+  loaded->modified = status.st_mtim;
+  char etag[64];
+  std::snprintf(etag, sizeof(etag), "\"%llx-%llx-%lx\""
+    , static_cast<unsigned long long>(status.st_size)  // NOLINT(runtime/int)
+    , static_cast<unsigned long long>(status.st_mtim.tv_sec)  // NOLINT
+    , static_cast<unsigned long>(status.st_mtim.tv_nsec));  // NOLINT
+  loaded->etag = etag;
+  loaded->lastModified = StaticFileWebApp::formatHttpDate(
+    status.st_mtim.tv_sec);
+  const std::string& sep = HttpMessage::lineSeparator;
+  loaded->headerLines = std::string("Content-Type: ")
+    + StaticFileWebApp::getContentType(path) + sep
+    + "Last-Modified: " + loaded->lastModified + sep
+    + "ETag: " + loaded->etag + sep;
+
+  // Large files are sent from disk, keep them open
+  const size_t size = status.st_size;
+  if (size > this->maxCachedFileSize || size > this->cacheCapacity) {
+    fileDescriptor = file;
+    return loaded;
+  }
+
+  // Small files are read to memory. If the file shrank meanwhile, its size
+  // will not match on the next request and it will be loaded again
+  loaded->contents.resize(size);
+  size_t total = 0;
+  while (total < size) {
+    const ssize_t result = ::read(file, loaded->contents.data() + total
+      , size - total);
+    if (result < 0) {
+      ::close(file);
+      return nullptr;
+    }
+    if (result == 0) {
+      break;
+    }
+    total += result;
+  }
+  ::close(file);
+  loaded->contents.resize(total);
+  loaded->cached = true;
+  return loaded;
+}
+
+bool StaticFileWebApp::serveFile(HttpRequest& httpRequest,
+    HttpResponse& httpResponse, const StaticFile& file, int fileDescriptor) {
+  // Set HTTP response metadata (headers)
+  httpResponse.setHeader("Server", "AttoServer v1.0");
+  httpResponse.setHeaderLines(file.headerLines);
+
+  // The client already has this version of the file
+  if (StaticFileWebApp::isNotModified(httpRequest, file)) {
+    httpResponse.setStatusCode(304);
+    return httpResponse.send();
+  }
+
+  httpResponse.setStatusCode(200);
+  if (file.cached) {
+    httpResponse.setBodyView(file.contents);
+  } else {
+    httpResponse.setBodyFile(fileDescriptor, file.size);
+  }
+  if (httpRequest.getMethod() == "HEAD") {
+    httpResponse.skipBody();
+  }
+  return httpResponse.send();
+}
+
+bool StaticFileWebApp::isNotModified(const HttpRequest& httpRequest,
+    const StaticFile& file) {
+  // If-None-Match takes precedence over If-Modified-Since. See RFC 7232
+  const std::string_view noneMatch = httpRequest.getHeader("If-None-Match");
+  if (!noneMatch.empty()) {
+    return StaticFileWebApp::matchesEtag(noneMatch, file.etag);
+  }
+
+  const std::string_view since = httpRequest.getHeader("If-Modified-Since");
+  if (since.empty()) {
+    return false;
+  }
+  // Clients usually send back the same date they received
+  if (since == file.lastModified) {
+    return true;
+  }
+  const time_t time = StaticFileWebApp::parseHttpDate(since);
+  return time >= 0 && file.modified.tv_sec <= time;
+}
+
+bool StaticFileWebApp::matchesEtag(std::string_view list,
+    std::string_view etag) {
+  // The list is a comma-separated list of entity tags, or "*"
+  size_t start = 0;
+  while (start < list.length()) {
+    size_t end = list.find(',', start);
+    if (end == std::string_view::npos) {
+      end = list.length();
+    }
+    std::string_view tag = list.substr(start, end - start);
+    while (!tag.empty() && (tag.front() == ' ' || tag.front() == '\t')) {
+      tag.remove_prefix(1);
+    }
+    while (!tag.empty() && (tag.back() == ' ' || tag.back() == '\t')) {
+      tag.remove_suffix(1);
+    }
+    // If-None-Match uses the weak comparison, that ignores the W/ prefix
+    if (tag.rfind("W/", 0) == 0) {
+      tag.remove_prefix(2);
+    }
+    if (tag == "*" || tag == etag) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+std::string StaticFileWebApp::formatHttpDate(time_t time) {
+  // Names are not taken from the locale, HTTP requires English ones
+  struct tm date;
+  ::gmtime_r(&time, &date);
+  char text[32];
+  std::snprintf(text, sizeof(text), "%s, %02d %s %04d %02d:%02d:%02d GMT"
+    , dayNames[date.tm_wday], date.tm_mday, monthNames[date.tm_mon]
+    , date.tm_year + 1900, date.tm_hour, date.tm_min, date.tm_sec);
+  return text;
+}
+
+time_t StaticFileWebApp::parseHttpDate(std::string_view text) {
+  // E.g: "Sun, 06 Nov 1994 08:49:37 GMT". Obsolete formats are not accepted
+  if (text.length() != 29 || text.substr(3, 2) != ", " || text[7] != ' '
+      || text[11] != ' ' || text[16] != ' ' || text[19] != ':'
+      || text[22] != ':' || text.substr(25) != " GMT") {
+    return -1;
+  }
+  struct tm date = {};
+  date.tm_mon = -1;
+  for (int month = 0; month < 12; ++month) {
+    if (text.substr(8, 3) == monthNames[month]) {
+      date.tm_mon = month;
+    }
+  }
+  if (date.tm_mon < 0 || !parseNumber(text.substr(5, 2), date.tm_mday)
+      || !parseNumber(text.substr(12, 4), date.tm_year)
+      || !parseNumber(text.substr(17, 2), date.tm_hour)
+      || !parseNumber(text.substr(20, 2), date.tm_min)
+      || !parseNumber(text.substr(23, 2), date.tm_sec)) {
+    return -1;
+  }
+  date.tm_year -= 1900;
+  return ::timegm(&date);
+}
+
+const char* StaticFileWebApp::getContentType(const std::string& path) {
+  // The extension is taken from the file name, not from the directories
+  const size_t dot = path.rfind('.');
+  const size_t slash = path.rfind('/');
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+    std::string extension = path.substr(dot + 1);
+    for (char& character : extension) {
+      character = static_cast<char>(::tolower(
+        static_cast<unsigned char>(character)));
+    }
+    const ContentTypes::const_iterator& itr =
+      StaticFileWebApp::contentTypes.find(extension);
+    if (itr != StaticFileWebApp::contentTypes.end()) {
+      return itr->second;
+    }
+  }
+  return "application/octet-stream";
+}
+
+// {extension, "MIME type"}
+const StaticFileWebApp::ContentTypes StaticFileWebApp::contentTypes = {
+  {"css", "text/css; charset=utf-8"},
+  {"csv", "text/csv; charset=utf-8"},
+  {"gif", "image/gif"},
+  {"htm", "text/html; charset=utf-8"},
+  {"html", "text/html; charset=utf-8"},
+  {"ico", "image/x-icon"},
+  {"jpeg", "image/jpeg"},
+  {"jpg", "image/jpeg"},
+  {"js", "text/javascript; charset=utf-8"},
+  {"json", "application/json"},
+  {"md", "text/markdown; charset=utf-8"},
+  {"pdf", "application/pdf"},
+  {"png", "image/png"},
+  {"svg", "image/svg+xml"},
+  {"txt", "text/plain; charset=utf-8"},
+  {"wasm", "application/wasm"},
+  {"webp", "image/webp"},
+  {"woff", "font/woff"},
+  {"woff2", "font/woff2"},
+  {"xml", "application/xml"},
+};
@@ -0,0 +1,150 @@
+// Copyright 2021 Jeisson Hidalgo-Cespedes. Universidad de Costa Rica. CC BY 4.0
+
+#ifndef STATICFILEWEBAPP_HPP
+#define STATICFILEWEBAPP_HPP
+
+#include <sys/stat.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "HttpApp.hpp"
+
+/// A file served by StaticFileWebApp, with its response headers precomputed
+struct StaticFile {
+  /// Path of the file in the file system
+  std::string path;
+  /// Size of the file in bytes when it was loaded
+  off_t size = 0;
+  /// Last modification time of the file when it was loaded
+  struct timespec modified = {0, 0};
+  /// Entity tag built from size and modification time, including the quotes
+  std::string etag;
+  /// Modification time as HTTP-date, e.g: "Sun, 06 Nov 1994 08:49:37 GMT"
+  std::string lastModified;
+  /// Content-Type, Last-Modified and ETag header lines
+  std::string headerLines;
+  /// Contents of the file if it is cached, empty otherwise
+  std::string contents;
+  /// True if contents holds the file, false if it is sent from disk
+  bool cached = false;
+};
+
+/**
+@brief A web application that serves the files of a directory
+Requests whose URI starts with a prefix, e.g: "/static", are mapped to files
+of a directory, e.g: "/static/css/app.css" to "www/css/app.css". Small files
+are kept in a memory cache bounded in bytes, with their headers precomputed,
+and the least recently used ones are evicted first. The modification time of
+the file is checked on each request, and a modified file is loaded again.
+Large files are sent from disk with sendfile(). Clients that already have the
+file get 304 responses through If-None-Match and If-Modified-Since. Symbolic
+links are followed, but only files whose real path is within the directory
+are served
+*/
+class StaticFileWebApp : public HttpApp {
+  /// Objects of this class cannot be copied
+  DISABLE_COPY(StaticFileWebApp);
+
+ public:
+  /// Associate file name extensions with MIME types
+  typedef std::map<std::string, const char*> ContentTypes;
+  /// MIME types of the file extensions commonly served
+  static const ContentTypes contentTypes;
+  /// Default amount of bytes of file contents kept in memory
+  static constexpr size_t defaultCacheCapacity = 64 * 1024 * 1024;
+  /// Default size of the largest file that is cached. Larger ones are sent
+  /// from disk
+  static constexpr size_t defaultMaxCachedFileSize = 1024 * 1024;
+
+ protected:
+  /// URIs that start with this prefix are served by this app
+  std::string prefix;
+  /// Directory where the files are looked up
+  std::string directory;
+  /// Absolute path of the directory with the symbolic links resolved, set by
+  /// start(). Files whose real path is not within it are not served
+  std::string realDirectory;
+  /// Maximum amount of bytes of file contents kept in memory
+  size_t cacheCapacity = defaultCacheCapacity;
+  /// Files larger than this are not cached
+  size_t maxCachedFileSize = defaultMaxCachedFileSize;
+  /// Protects the cache, because connection handlers serve concurrently
+  std::mutex mutex;
+  /// Cached files, the most recently used first. Files are shared with the
+  /// responses being sent, so evicting a file does not invalidate them
+  std::list<std::shared_ptr<const StaticFile>> recentFiles;
+  /// Find a cached file by path
+  std::unordered_map<std::string
+    , std::list<std::shared_ptr<const StaticFile>>::iterator> cache;
+  /// Sum of the sizes of the cached files
+  size_t cacheSize = 0;
+
+ public:
+  /// Constructor
+  /// @param prefix URIs that start with this text are served by this app
+  /// @param directory Directory where the files are looked up
+  StaticFileWebApp(const std::string& prefix, const std::string& directory,
+    size_t cacheCapacity = defaultCacheCapacity,
+    size_t maxCachedFileSize = defaultMaxCachedFileSize);
+  /// Destructor
+  ~StaticFileWebApp();
+  /// Register GET and HEAD routes for the paths under the prefix
+  bool registerRoutes(HttpRouter& router) override;
+  /// Called by the web server when the web server is started. Resolves the
+  /// real path of the directory
+  void start() override;
+  /// Called when the web server stops. Releases the cached files
+  void stop() override;
+
+ protected:
+  /// Serve the file named by the path parameter "path", the rest of the path
+  /// after the prefix
+  /// @return true if the file exists and was sent, false otherwise
+  bool servePath(HttpRequest& httpRequest, HttpResponse& httpResponse);
+  /// Map the path relative to the prefix to a path within the directory
+  /// @return The path, or empty if it is not valid or tries to reach files
+  /// outside the directory, e.g: "/../secret"
+  std::string mapPath(std::string_view relative) const;
+  /// Resolve the symbolic links of a mapped path
+  /// @return The real path, or empty if it does not exist or it is outside
+  /// the directory, e.g: through a link to "/etc"
+  std::string resolvePath(const std::string& path) const;
+  /// Get the cached file for the path if it was not modified since it was
+  /// loaded. A modified file is removed from the cache
+  /// @return The file, or null if it is not cached
+  std::shared_ptr<const StaticFile> findCached(const std::string& path,
+    const struct stat& status);
+  /// Add a file to the cache, evicting the least recently used files until
+  /// it fits
+  void addCached(const std::shared_ptr<const StaticFile>& file);
+  /// Open and describe a file, and load its contents if it is small enough to
+  /// be cached
+  /// @param fileDescriptor Set to the open file if it is not cached, or -1
+  /// @return The file, or null if it is not a regular file or cannot be read
+  std::shared_ptr<StaticFile> loadFile(const std::string& path,
+    int& fileDescriptor) const;
+  /// Sends the file, or a 304 response if the client has it already
+  bool serveFile(HttpRequest& httpRequest, HttpResponse& httpResponse,
+    const StaticFile& file, int fileDescriptor);
+  /// Return true if the conditional headers of the request tell that the
+  /// client has the current version of the file
+  static bool isNotModified(const HttpRequest& httpRequest,
+    const StaticFile& file);
+  /// Return true if the entity tag is in the If-None-Match list
+  static bool matchesEtag(std::string_view list, std::string_view etag);
+  /// Format a time as HTTP-date, e.g: "Sun, 06 Nov 1994 08:49:37 GMT"
+  static std::string formatHttpDate(time_t time);
+  /// Parse a HTTP-date in the preferred format of RFC 7231
+  /// @return The time, or -1 if the text is not a valid date
+  static time_t parseHttpDate(std::string_view text);
+  /// Get the MIME type of the file from its extension
+  static const char* getContentType(const std::string& path);
+};
+
+#endif  // STATICFILEWEBAPP_HPP
@@ -5,6 +5,9 @@
 
 #include "HttpServer.hpp"
 #include "FactWebApp.hpp"
+#include "HeatSimWebApp.hpp"
+#include "MetricsWebApp.hpp"
+#include "StaticFileWebApp.hpp"
 
 // TODO(you): Register a signal handler for Ctrl+C and kill, and stop the server
 // TODO(you): Make your signal handler to print the thread id running it
@@ -15,8 +18,14 @@ int main(int argc, char* argv[]) {
   HttpServer httpServer;
   // Create a factorization web application, and other apps if you want
   FactWebApp factWebApp;
+  HeatSimWebApp heatSimWebApp;
+  StaticFileWebApp staticFileWebApp("/static", "www");
+  MetricsWebApp metricsWebApp(httpServer);
   // Register the web application(s) with the web server
   httpServer.chainWebApp(&factWebApp);
+  httpServer.chainWebApp(&heatSimWebApp);
+  httpServer.chainWebApp(&staticFileWebApp);
+  httpServer.chainWebApp(&metricsWebApp);
   // Run the web server
   return httpServer.run(argc, argv);
 }
@@ -0,0 +1,5 @@
+# webtest  ## Run the web server tests of scripts/webtest.sh
+# The web server is built by the script, e.g: make webtest MODE=epoll
+.PHONY: webtest
+webtest:
+	scripts/webtest.sh
@@ -72,9 +72,11 @@ void read_bin_plate(const char* folder, params_matrix* variables,
                                                     delta_t, alpha, h, epsilon);
         array_state_k[i] = states_k;
 
-        // Generar el archivo binario con el estado final
-        generate_bin_file(matrix, rows, columns, folder, variables[i].filename,
-                                                                      states_k);
+        // Solo el proceso raíz tiene la lámina completa y la escribe
+        if (rank == 0) {
+            generate_bin_file(matrix, rows, columns, folder,
+                                             variables[i].filename, states_k);
+        }
 
         // Liberar la memoria de la matriz
         free_matrix(matrix, rows);
@@ -88,6 +90,23 @@ void read_bin_plate(const char* folder, params_matrix* variables,
     free(array_state_k);
 }
 
+/**
+ * @brief Calcula el bloque de filas internas que le corresponde a un proceso.
+ *
+ * @param inner_rows Cantidad de filas internas de la lámina.
+ * @param parts Cantidad de procesos entre los que se reparten las filas.
+ * @param part Proceso del que se quiere conocer el bloque.
+ * @param start Fila global donde inicia el bloque.
+ * @param count Cantidad de filas del bloque.
+ */
+static void partition_rows(uint64_t inner_rows, uint64_t parts, uint64_t part,
+                                            uint64_t* start, uint64_t* count) {
+    const uint64_t extra = inner_rows % parts;
+    *count = inner_rows / parts + (part < extra ? 1 : 0);
+    // La fila 0 es borde, por eso los bloques inician en la fila 1
+    *start = 1 + part * (inner_rows / parts) + (part < extra ? part : extra);
+}
+
 uint64_t heat_transfer_simulation(double** matrix, uint64_t rows,
                                  uint64_t columns, double delta_t, double alpha,
                                 double h, double epsilon) {
@@ -95,21 +114,36 @@ uint64_t heat_transfer_simulation(double** matrix, uint64_t rows,
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
-    // Calcular el rango de filas para este proceso
-    uint64_t local_rows = rows / world_size + (rank < rows % world_size ?
-                                                                         1 : 0);
-    uint64_t start_row = rank * (rows / world_size) + (rank < rows % world_size
-                                                    ? rank : rows % world_size);
-
-    // Crear matrices locales
-    double** current_matrix = create_empty_matrix(local_rows + 2, columns);
-    // Incluye filas fantasma
-    double** next_matrix = create_empty_matrix(local_rows + 2, columns);
-
-    // Copiar las filas correspondientes de la matriz global
-    for (uint64_t i = 0; i < local_rows; i++) {
-        memcpy(current_matrix[i + 1], matrix[start_row + i], columns *
-        sizeof(double));
+    // Solo las filas internas se reparten; los bordes nunca cambian
+    const uint64_t inner_rows = rows > 2 ? rows - 2 : 0;
+    // Si hay menos filas internas que procesos, los últimos quedan ociosos
+    const uint64_t active = inner_rows < (uint64_t)world_size ?
+                                            inner_rows : (uint64_t)world_size;
+
+    // Calcular el rango de filas internas para este proceso
+    uint64_t local_rows = 0;
+    uint64_t start_row = 1;
+    if ((uint64_t)rank < active) {
+        partition_rows(inner_rows, active, rank, &start_row, &local_rows);
+    }
+
+    // Crear matrices locales con una fila fantasma arriba y otra abajo. Se
+    // inicializan con la lámina para que las columnas y filas de borde queden
+    // fijas en ambas
+    double** current_matrix = NULL;
+    double** next_matrix = NULL;
+    if (local_rows > 0) {
+        current_matrix = create_empty_matrix(local_rows + 2, columns);
+        next_matrix = create_empty_matrix(local_rows + 2, columns);
+        if (current_matrix == NULL || next_matrix == NULL) {
+            fprintf(stderr,
+                "Proceso %d: Error al asignar memoria para la matriz\n", rank);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        copy_matrix(current_matrix, &matrix[start_row - 1], local_rows + 2,
+                                                                       columns);
+        copy_matrix(next_matrix, &matrix[start_row - 1], local_rows + 2,
+                                                                       columns);
     }
 
     uint64_t states_k = 0;
@@ -118,30 +152,34 @@ uint64_t heat_transfer_simulation(double** matrix, uint64_t rows,
     while (!balance_point) {
         balance_point = true;
 
-        // Intercambiar filas frontera con procesos vecinos
-        if (rank > 0) {
-            MPI_Sendrecv(current_matrix[1], columns, MPI_DOUBLE, rank - 1, 0,
-                         current_matrix[0], columns, MPI_DOUBLE, rank - 1, 0,
-                        MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        }
-        if (rank < world_size - 1) {
-            MPI_Sendrecv(current_matrix[local_rows], columns, MPI_DOUBLE,
-                                                                    rank + 1, 0,
-                         current_matrix[local_rows + 1], columns, MPI_DOUBLE,
-                        rank + 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        }
+        if (local_rows > 0) {
+            // Intercambiar filas frontera con procesos vecinos
+            if (rank > 0) {
+                MPI_Sendrecv(current_matrix[1], columns, MPI_DOUBLE, rank - 1,
+                             0, current_matrix[0], columns, MPI_DOUBLE,
+                             rank - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+            if ((uint64_t)rank + 1 < active) {
+                MPI_Sendrecv(current_matrix[local_rows], columns, MPI_DOUBLE,
+                             rank + 1, 0, current_matrix[local_rows + 1],
+                             columns, MPI_DOUBLE, rank + 1, 0, MPI_COMM_WORLD,
+                             MPI_STATUS_IGNORE);
+            }
 
-        // Actualizar las celdas internas
-        for (uint64_t i = 1; i <= local_rows; i++) {
-            for (uint64_t j = 1; j < columns - 1; j++) {
-                next_matrix[i][j] = current_matrix[i][j] +
+            // Actualizar las celdas internas
+            for (uint64_t i = 1; i <= local_rows; i++) {
+                for (uint64_t j = 1; j < columns - 1; j++) {
+                    double new_temperature = current_matrix[i][j] +
                     ((delta_t * alpha) / (h * h)) * (current_matrix[i - 1][j] +
                                                      current_matrix[i + 1][j] +
                                                      current_matrix[i][j - 1] +
                                                      current_matrix[i][j + 1] -
                                                      4 * current_matrix[i][j]);
-                if (fabs(next_matrix[i][j] - current_matrix[i][j]) > epsilon) {
-                    balance_point = false;
+                    next_matrix[i][j] = new_temperature;
+                    if (fabs(new_temperature - current_matrix[i][j]) >
+                                                                     epsilon) {
+                        balance_point = false;
+                    }
                 }
             }
         }
@@ -160,11 +198,20 @@ uint64_t heat_transfer_simulation(double** matrix, uint64_t rows,
         states_k++;
     }
 
-    // Enviar datos al proceso raíz
+    // Reunir las filas de todos los procesos en la matriz del proceso raíz
     if (rank == 0) {
-        for (uint64_t i = 0; i < local_rows; i++) {
-            memcpy(matrix[start_row + i], current_matrix[i + 1], columns *
-                                                                sizeof(double));
+        if (local_rows > 0) {
+            copy_matrix(&matrix[start_row], &current_matrix[1], local_rows,
+                                                                       columns);
+        }
+        for (uint64_t source = 1; source < active; source++) {
+            uint64_t source_start, source_rows;
+            partition_rows(inner_rows, active, source, &source_start,
+                                                                 &source_rows);
+            for (uint64_t i = 0; i < source_rows; i++) {
+                MPI_Recv(matrix[source_start + i], columns, MPI_DOUBLE,
+                           (int)source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
         }
     } else {
         for (uint64_t i = 0; i < local_rows; i++) {
@@ -174,8 +221,10 @@ uint64_t heat_transfer_simulation(double** matrix, uint64_t rows,
     }
 
     // Liberar memoria
-    free_matrix(current_matrix, local_rows + 2);
-    free_matrix(next_matrix, local_rows + 2);
+    if (local_rows > 0) {
+        free_matrix(current_matrix, local_rows + 2);
+        free_matrix(next_matrix, local_rows + 2);
+    }
 
     return states_k;
 }
@@ -39,52 +39,18 @@ int main(int argc, char *argv[]) {
         clock_gettime(CLOCK_MONOTONIC, &start_time);  // Medir tiempo de inicio
     }
 
-    // Proceso raíz (rank 0) lee el archivo de trabajo
+    // Cada proceso lee el archivo de trabajo: los nombres de archivo son
+    // punteros y no se pueden enviar como bytes a otros procesos
     uint64_t lines;
-    params_matrix* variables = NULL;
-    if (rank == 0) {
-        variables = read_job_txt(jobName, folder, &lines);
-        if (!variables) {
-            fprintf(stderr, "Error al leer el archivo de trabajo.\n");
-            MPI_Finalize();
-            return 1;
-        }
+    params_matrix* variables = read_job_txt(jobName, folder, &lines);
+    if (!variables) {
+        fprintf(stderr, "Proceso %d: Error al leer el archivo de trabajo.\n",
+                                                                          rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    // Broadcast del número de simulaciones
-    MPI_Bcast(&lines, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
-
-    // Distribuir trabajo entre procesos
-    uint64_t rows_per_proc = lines / world_size;
-    uint64_t extra_rows = lines % world_size;
-    uint64_t local_start = rank * rows_per_proc + (rank < extra_rows ?
-                                                             rank : extra_rows);
-    uint64_t local_lines = rows_per_proc + (rank < extra_rows ? 1 : 0);
-
-    params_matrix* local_variables = malloc(local_lines *
-                                                         sizeof(params_matrix));
-
-    // Scatter los parámetros de las simulaciones
-    if (rank == 0) {
-        for (int i = 0; i < world_size; i++) {
-            uint64_t start = i * rows_per_proc + (i < extra_rows ? i :
-                                                                    extra_rows);
-            uint64_t count = rows_per_proc + (i < extra_rows ? 1 : 0);
-            if (i == 0) {
-                memcpy(local_variables, variables + start, count *
-                                                         sizeof(params_matrix));
-            } else {
-                MPI_Send(variables + start, count * sizeof(params_matrix),
-                                                MPI_BYTE, i, 0, MPI_COMM_WORLD);
-            }
-        }
-    } else {
-        MPI_Recv(local_variables, local_lines * sizeof(params_matrix),
-                             MPI_BYTE, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    }
-
-    // Cada proceso realiza su porción de simulación
-    read_bin_plate(folder, local_variables, local_lines, jobName);
+    // Todos los procesos simulan cada lámina repartiéndose sus filas
+    read_bin_plate(folder, variables, lines, jobName);
 
     // Proceso raíz mide el tiempo de finalización
     if (rank == 0) {
@@ -95,13 +61,10 @@ int main(int argc, char *argv[]) {
     }
 
     // Liberar memoria
-    free(local_variables);
-    if (rank == 0) {
-        for (uint64_t i = 0; i < lines; i++) {
-            free(variables[i].filename);
-        }
-        free(variables);
+    for (uint64_t i = 0; i < lines; i++) {
+        free(variables[i].filename);
     }
+    free(variables);
 
     MPI_Finalize();  // Finalizar MPI
     printf("Proceso %d: Simulación completada.\n", rank);
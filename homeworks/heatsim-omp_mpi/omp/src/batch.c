@@ -0,0 +1,435 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#define _XOPEN_SOURCE 600
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "batch.h"
+
+/**
+ * @brief Trabajo de un lote con el avance de sus láminas.
+ */
+typedef struct {
+    char folder[512];           /**< Carpeta del archivo de trabajo. */
+    char name[256];             /**< Nombre del archivo de trabajo. */
+    params_matrix* variables;   /**< Parámetros de cada lámina. */
+    uint64_t lines;             /**< Número de láminas. */
+    uint64_t* states;           /**< Estados de cada lámina. */
+    uint64_t pending;           /**< Láminas que faltan por simular. */
+    int failed;                 /**< 1 si alguna lámina falló. */
+    ooc_config ooc;             /**< Configuración fuera de memoria. */
+} batch_job;
+
+/**
+ * @brief Lámina de un trabajo pendiente en la cola del lote.
+ */
+typedef struct {
+    batch_job* job;             /**< Trabajo al que pertenece. */
+    uint64_t line;              /**< Índice de la lámina en el trabajo. */
+    uint64_t cells;             /**< Celdas de la lámina, para ordenar. */
+} batch_task;
+
+/**
+ * @brief Simula una lámina de un trabajo y escribe su archivo binario final.
+ *
+ * @param folder Carpeta donde se encuentran los archivos binarios.
+ * @param params Parámetros de la lámina.
+ * @param tuning Forma de recorrer la lámina y cantidad de hilos.
+ * @param tuner Afinador que elige la forma de recorrer, o NULL.
+ * @param ooc Configuración fuera de memoria.
+ * @param format Versión y compresión del archivo binario final.
+ * @param arena Arena de donde se toman las matrices.
+ * @param states Recibe el número de estados, o 0 si hubo un error.
+ * @return 0 si tuvo éxito, 1 si hubo un error.
+ */
+int simulate_plate(const char* folder,
+                   const params_matrix* params,
+                   const heat_tuning* tuning,
+                   heat_tuner* tuner,
+                   const ooc_config* ooc,
+                   const plate_format* format,
+                   plate_arena* arena,
+                   uint64_t* states) {
+    *states = 0;
+    char direction[512];
+    const int threads = tuning->threads;
+    const double coef = (params->delta_t * params->alpha) /
+                                                    (params->h * params->h);
+
+    // Construir la ruta del archivo binario
+    snprintf(direction, sizeof(direction), "%s/%s", folder, params->filename);
+
+    // Abrir el archivo binario (versión 1 o 2) y leer sus dimensiones
+    plate_reader reader;
+    if (plate_reader_open(&reader, direction) != 0) {
+        fprintf(stderr, "No se pudo simular la lámina %s\n", direction);
+        return 1;
+    }
+    const uint64_t rows = reader.rows;
+    const uint64_t columns = reader.columns;
+
+    if (out_of_core_needed(ooc, rows, columns)) {
+        plate_reader_close(&reader);
+        // Escribe también el archivo binario final; 0 estados es un error
+        *states = out_of_core_simulation(ooc, direction, rows, columns, coef,
+                                         params->epsilon, threads, arena,
+                                         format, folder, params->filename);
+        if (*states == 0) {
+            fprintf(stderr, "No se pudo simular la lámina %s\n", direction);
+            return 1;
+        }
+        return 0;
+    }
+
+    // Tomar la matriz de la arena (sin ponerla en cero)
+    double **matrix = plate_arena_acquire(arena, PLATE_SLOT_INPUT, rows,
+                                                                      columns);
+    if (matrix == NULL) {
+        fprintf(stderr, "Error al asignar memoria para la matriz\n");
+        plate_reader_close(&reader);
+        fprintf(stderr, "No se pudo simular la lámina %s\n", direction);
+        return 1;
+    }
+
+    // Los bloques de filas se leen en paralelo
+    const int read_error = plate_reader_read(&reader, matrix, threads);
+    plate_reader_close(&reader);
+    if (read_error) {
+        fprintf(stderr, "No se pudo simular la lámina %s\n", direction);
+        return 1;
+    }
+
+    heat_tuning chosen = *tuning;
+    uint64_t tuned_states = 0;
+    bool balance_point = false;
+    if (tuner != NULL) {
+        chosen = heat_tuner_choose(tuner, matrix, rows, columns, coef,
+                                   params->epsilon, arena, &tuned_states,
+                                   &balance_point);
+        printf("%s: %s, %d hilos", params->filename,
+               heat_backend_name(chosen.backend), chosen.threads);
+        if (chosen.backend == HEAT_BACKEND_TILED ||
+                                    chosen.backend == HEAT_BACKEND_ACTIVE) {
+            printf(", bloques de %lux%lu", chosen.tile_rows,
+                                                          chosen.tile_columns);
+        }
+        printf("\n");
+    }
+
+    // Ejecutar la simulación desde donde quedó el afinador y capturar el
+    // número de estados
+    uint64_t states_k = tuned_states;
+    if (!balance_point) {
+        const uint64_t simulated = heat_transfer_simulation(matrix, rows,
+                                                            columns,
+                                                            params->delta_t,
+                                                            params->alpha,
+                                                            params->h,
+                                                            params->epsilon,
+                                                            &chosen, arena);
+        states_k = simulated == 0 ? 0 : tuned_states + simulated;
+    }
+
+    // Generar archivo binario con el estado final. Sin matrices alternas en
+    // la arena no se simula ningún estado
+    if (states_k == 0 || generate_bin_file(matrix, rows, columns, folder,
+                                     params->filename, states_k, format)) {
+        fprintf(stderr, "No se pudo simular la lámina %s\n", direction);
+        return 1;
+    }
+    *states = states_k;
+    return 0;
+}
+
+/**
+ * @brief Agrega a `paths` los archivos que coinciden con un patrón.
+ *
+ * @details Un patrón sin coincidencias se agrega tal cual, para que el error
+ * aparezca al leer el archivo de trabajo.
+ *
+ * @param pattern Archivo de trabajo, patrón o `@lista`.
+ * @param paths Resultado acumulado de `glob`.
+ * @param first Verdadero si es la primera llamada sobre `paths`.
+ * @return 0 si tuvo éxito, 1 si no se pudo leer la lista.
+ */
+static int expand_pattern(const char* pattern, glob_t* paths, bool* first) {
+    if (pattern[0] != '@') {
+        glob(pattern, GLOB_NOCHECK | (*first ? 0 : GLOB_APPEND), NULL, paths);
+        *first = false;
+        return 0;
+    }
+
+    FILE* list = fopen(pattern + 1, "r");
+    if (list == NULL) {
+        fprintf(stderr, "No se pudo abrir la lista de trabajos %s\n",
+                pattern + 1);
+        return 1;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), list) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        // Se ignoran las líneas vacías y los comentarios
+        if (line[0] != '\0' && line[0] != '#' && line[0] != '@') {
+            expand_pattern(line, paths, first);
+        }
+    }
+    fclose(list);
+    return 0;
+}
+
+/**
+ * @brief Lee un archivo de trabajo y prepara su avance.
+ *
+ * @details Un trabajo sin láminas no tiene nada que simular, así que su
+ * reporte (vacío) se escribe aquí.
+ *
+ * @param job Trabajo a preparar.
+ * @param path Ruta del archivo de trabajo.
+ * @return 0 si tuvo éxito, 1 si no se pudo leer el trabajo o escribir el
+ * reporte de un trabajo vacío.
+ */
+static int batch_job_init(batch_job* job, const char* path) {
+    memset(job, 0, sizeof(batch_job));
+    const char* slash = strrchr(path, '/');
+    if (slash == NULL) {
+        snprintf(job->folder, sizeof(job->folder), ".");
+        snprintf(job->name, sizeof(job->name), "%s", path);
+    } else {
+        snprintf(job->folder, sizeof(job->folder), "%.*s",
+                 (int)(slash - path), path);
+        snprintf(job->name, sizeof(job->name), "%s", slash + 1);
+    }
+
+    if (access(path, R_OK) == 0 && count_lines(path) == 0) {
+        if (generate_report_file(job->folder, job->name, NULL, NULL, 0)) {
+            return 1;
+        }
+        printf("Trabajo completado: %s/%s\n", job->folder, job->name);
+        return 0;
+    }
+
+    job->variables = read_job_txt(job->name, job->folder, &job->lines);
+    if (job->variables == NULL) {
+        fprintf(stderr, "Error al leer el archivo de trabajo %s.\n", path);
+        return 1;
+    }
+    job->states = calloc(job->lines, sizeof(uint64_t));
+    if (job->states == NULL) {
+        fprintf(stderr,
+                      "Error al asignar memoria para el arreglo de estados.\n");
+        return 1;
+    }
+    job->pending = job->lines;
+    out_of_core_init(&job->ooc, job->folder);
+    return 0;
+}
+
+/**
+ * @brief Libera la memoria de un trabajo.
+ *
+ * @param job Trabajo a liberar.
+ */
+static void batch_job_destroy(batch_job* job) {
+    if (job->variables != NULL) {
+        for (uint64_t i = 0; i < job->lines; i++) {
+            free(job->variables[i].filename);
+        }
+    }
+    free(job->variables);
+    free(job->states);
+}
+
+/**
+ * @brief Ordena las láminas de la más grande a la más pequeña.
+ *
+ * @param a Primera lámina.
+ * @param b Segunda lámina.
+ * @return Negativo si `a` va antes que `b`.
+ */
+static int compare_tasks(const void* a, const void* b) {
+    const uint64_t cells_a = ((const batch_task*)a)->cells;
+    const uint64_t cells_b = ((const batch_task*)b)->cells;
+    return (cells_a < cells_b) - (cells_a > cells_b);
+}
+
+/**
+ * @brief Simula las láminas del lote con un grupo de hilos y escribe el
+ * reporte de cada trabajo al terminar su última lámina.
+ *
+ * @param tasks Láminas del lote, de la más grande a la más pequeña.
+ * @param task_count Cantidad de láminas.
+ * @param outer Número de hilos del grupo.
+ * @param tuning Forma de recorrer cada lámina y cantidad de hilos internos.
+ * @param format Versión y compresión de los archivos binarios finales.
+ * @param arenas Una arena lista por cada hilo del grupo.
+ * @return 0 si todas las láminas y reportes se escribieron, 1 si no.
+ */
+static int run_tasks(batch_task* tasks, uint64_t task_count, int outer,
+                     const heat_tuning* tuning, const plate_format* format,
+                     plate_arena* arenas) {
+    int error = 0;
+    #pragma omp parallel num_threads(outer) reduction(|:error) \
+        default(none) shared(tasks, task_count, tuning, format, arenas)
+    {
+        plate_arena* arena = &arenas[omp_get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 1)
+        for (uint64_t t = 0; t < task_count; t++) {
+            batch_job* job = tasks[t].job;
+            const uint64_t i = tasks[t].line;
+            // Una lámina que falla queda con 0 estados y se omite del reporte
+            if (simulate_plate(job->folder, &job->variables[i], tuning, NULL,
+                               &job->ooc, format, arena,
+                               &job->states[i]) != 0) {
+                #pragma omp atomic write
+                job->failed = 1;
+                error = 1;
+            }
+            // La arena no conserva entre láminas más que la parte del hilo
+            plate_arena_trim(arena, job->ooc.memory_limit);
+
+            /* La última lámina de cada trabajo escribe su reporte. Con
+            acq_rel, el hilo que llega a 0 ve los estados de los demás*/
+            uint64_t pending;
+            #pragma omp atomic capture acq_rel
+            pending = --job->pending;
+            if (pending == 0) {
+                const int report_error = generate_report_file(job->folder,
+                                  job->name, job->variables, job->states,
+                                  job->lines);
+                error |= report_error;
+                #pragma omp critical(batch_output)
+                printf("Trabajo %s: %s/%s\n", report_error || job->failed ?
+                       "fallido" : "completado", job->folder, job->name);
+            }
+        }
+    }
+    return error;
+}
+
+/**
+ * @brief Ejecuta varios trabajos con un solo grupo de hilos.
+ *
+ * @param patterns Archivos de trabajo, patrones o `@lista`.
+ * @param count Cantidad de elementos de `patterns`.
+ * @param num_threads Número de hilos del grupo.
+ * @return 0 si todos los trabajos se leyeron, 1 si alguno no.
+ */
+int run_batch(char* const* patterns, int count, int num_threads) {
+    int error = 0;
+    glob_t paths;
+    memset(&paths, 0, sizeof(paths));
+    bool first = true;
+    for (int i = 0; i < count; i++) {
+        error |= expand_pattern(patterns[i], &paths, &first);
+    }
+
+    // Leer todos los trabajos antes de empezar
+    const size_t job_count = paths.gl_pathc;
+    batch_job* jobs = calloc(job_count > 0 ? job_count : 1, sizeof(batch_job));
+    if (jobs == NULL) {
+        fprintf(stderr, "Error al asignar memoria para los trabajos.\n");
+        globfree(&paths);
+        return 1;
+    }
+    uint64_t task_count = 0;
+    for (size_t j = 0; j < job_count; j++) {
+        if (batch_job_init(&jobs[j], paths.gl_pathv[j]) != 0) {
+            batch_job_destroy(&jobs[j]);
+            memset(&jobs[j], 0, sizeof(batch_job));
+            error = 1;
+        }
+        task_count += jobs[j].lines;
+    }
+    globfree(&paths);
+
+    /* **Optimización**: Las láminas de todos los trabajos se reparten de la
+    más grande a la más pequeña, así las pequeñas rellenan los huecos al final
+    en vez de dejar hilos ociosos esperando a una grande*/
+    batch_task* tasks = malloc((task_count > 0 ? task_count : 1) *
+                                                           sizeof(batch_task));
+    if (tasks == NULL) {
+        fprintf(stderr, "Error al asignar memoria para las láminas.\n");
+        task_count = 0;
+        error = 1;
+    }
+    uint64_t next_task = 0;
+    for (size_t j = 0; j < job_count && tasks != NULL; j++) {
+        for (uint64_t i = 0; i < jobs[j].lines; i++) {
+            char direction[1024];
+            snprintf(direction, sizeof(direction), "%s/%s", jobs[j].folder,
+                     jobs[j].variables[i].filename);
+            plate_reader reader;
+            uint64_t cells = 0;
+            if (plate_reader_open(&reader, direction) == 0) {
+                cells = reader.rows * reader.columns;
+                plate_reader_close(&reader);
+            }
+            tasks[next_task++] = (batch_task){&jobs[j], i, cells};
+        }
+    }
+    qsort(tasks, task_count, sizeof(batch_task), compare_tasks);
+
+    /* Cada lámina usa un hilo; si hay menos láminas que hilos, los que
+    sobran se reparten dentro de cada lámina con paralelismo anidado*/
+    int outer = num_threads;
+    if (task_count > 0 && task_count < (uint64_t)outer) {
+        outer = (int)task_count;
+    }
+    const int inner = num_threads / outer;
+    if (inner > 1) {
+        omp_set_max_active_levels(2);
+    }
+
+    /* Las láminas del grupo están en memoria al mismo tiempo, así que cada
+    una decide si cabe, y dimensiona sus bandas, con su parte del límite*/
+    for (size_t j = 0; j < job_count; j++) {
+        uint64_t* limit = &jobs[j].ooc.memory_limit;
+        if (*limit > 0) {
+            *limit = *limit / outer > 0 ? *limit / outer : 1;
+        }
+    }
+
+    // HEATSIM_ACTIVE_TILES=1 salta los bloques que no cambian
+    const char* active = getenv("HEATSIM_ACTIVE_TILES");
+    heat_tuning tuning = {inner > 1 ? HEAT_BACKEND_STATIC : HEAT_BACKEND_SERIAL,
+                          inner, 0, 0};
+    if (active != NULL && atoi(active) == 1) {
+        tuning = (heat_tuning){HEAT_BACKEND_ACTIVE, inner, ACTIVE_TILE_ROWS,
+                               ACTIVE_TILE_COLUMNS};
+    }
+    plate_format format;
+    plate_format_init(&format, inner);
+
+    // Cada hilo conserva su propia arena entre las láminas que toma
+    const char* huge_pages = getenv("HEATSIM_HUGEPAGES");
+    plate_arena* arenas = calloc(outer, sizeof(plate_arena));
+    int ready = 0;
+    while (arenas != NULL && ready < outer &&
+           plate_arena_init(&arenas[ready], PLATE_SLOTS,
+                    huge_pages != NULL && atoi(huge_pages) == 1) == 0) {
+        ready++;
+    }
+    if (ready < outer) {
+        // Sin una arena por hilo no se simula ninguna lámina
+        fprintf(stderr, "Error al asignar memoria para la arena.\n");
+        error = 1;
+    } else {
+        error |= run_tasks(tasks, task_count, outer, &tuning, &format,
+                                                                      arenas);
+    }
+
+    for (int a = 0; a < ready; a++) {
+        plate_arena_destroy(&arenas[a]);
+    }
+    free(arenas);
+    free(tasks);
+    for (size_t j = 0; j < job_count; j++) {
+        batch_job_destroy(&jobs[j]);
+    }
+    free(jobs);
+    return error;
+}
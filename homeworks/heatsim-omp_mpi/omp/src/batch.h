@@ -0,0 +1,67 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+
+#include "heat_simulation.h"
+#include "heat_tuner.h"
+#include "out_of_core.h"
+#include "plate_arena.h"
+#include "plate_format.h"
+
+/// Filas por bloque de la forma `ACTIVE` cuando no se afina
+#define ACTIVE_TILE_ROWS 32
+/// Columnas por bloque de la forma `ACTIVE` cuando no se afina
+#define ACTIVE_TILE_COLUMNS 512
+
+/**
+ * @brief Simula una lámina de un trabajo y escribe su archivo binario final.
+ *
+ * @details Lee la lámina (versión 1 o 2), la simula fuera de memoria si no
+ * cabe y si no con la configuración indicada o la que elija el afinador.
+ *
+ * @param folder Carpeta donde se encuentran los archivos binarios.
+ * @param params Parámetros de la lámina.
+ * @param tuning Forma de recorrer la lámina y cantidad de hilos cuando no se
+ * afina; los hilos también se usan para leer y escribir.
+ * @param tuner Afinador que elige la forma de recorrer, o NULL.
+ * @param ooc Configuración fuera de memoria.
+ * @param format Versión y compresión del archivo binario final.
+ * @param arena Arena de donde se toman las matrices. Debe tener al menos
+ * `PLATE_SLOTS` ranuras.
+ * @param states Recibe el número de estados hasta alcanzar el punto de
+ * equilibrio; queda en 0 si hubo un error.
+ * @return 0 si tuvo éxito, 1 si no se pudo leer, simular o escribir la
+ * lámina. El error se informa en la salida de error.
+ */
+int simulate_plate(const char* folder,
+                   const params_matrix* params,
+                   const heat_tuning* tuning,
+                   heat_tuner* tuner,
+                   const ooc_config* ooc,
+                   const plate_format* format,
+                   plate_arena* arena,
+                   uint64_t* states);
+
+/**
+ * @brief Ejecuta varios trabajos con un solo grupo de hilos.
+ *
+ * @details Las láminas de todos los trabajos forman una sola cola, de la más
+ * grande a la más pequeña, que los hilos toman dinámicamente. Cada hilo tiene
+ * su propia arena y simula cada lámina con un hilo, o con varios si hay menos
+ * láminas que hilos. Cuando termina la última lámina de un trabajo se escribe
+ * el reporte (.tsv) de ese trabajo, igual al de ejecutarlo solo. Las
+ * láminas que fallan se omiten del reporte. Un trabajo vacío tiene un reporte
+ * vacío.
+ *
+ * @param patterns Archivos de trabajo, patrones como `tests/job*.txt` o
+ * `@lista` con un archivo o patrón por línea.
+ * @param count Cantidad de elementos de `patterns`.
+ * @param num_threads Número de hilos del grupo.
+ * @return 0 si todos los trabajos se completaron, 1 si alguno no se pudo
+ * leer, o alguna lámina o reporte fallaron.
+ */
+int run_batch(char* const* patterns, int count, int num_threads);
+
+#endif  // BATCH_H
@@ -1,8 +1,9 @@
 //  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#define _XOPEN_SOURCE 600
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>  // Para la función gmtime
+#include <time.h>  // Para la función gmtime_r
 
 #include "heat_simulation.h"
 
@@ -13,9 +14,11 @@
  * @param jobName Nombre del archivo de trabajo.
  * @param variables Arreglo de estructuras `params_matrix` que contiene los parámetros de la simulación.
  * @param states_k Arreglo que contiene los estados finales de cada simulación.
+ * Las láminas con 0 estados no se pudieron simular y se omiten.
  * @param lines Número de líneas (simulaciones) en el archivo de trabajo.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el reporte.
  */
-void generate_report_file(const char* folder,
+int generate_report_file(const char* folder,
                         const char* jobName,
                         params_matrix* variables,
                         uint64_t* states_k,
@@ -36,10 +39,14 @@ void generate_report_file(const char* folder,
     if (report_file == NULL) {
         fprintf(stderr, "No se pudo crear el archivo de reporte %s\n",
                 report_name);
-        return;
+        return 1;
     }
 
     for (uint64_t i = 0; i < lines; i++) {
+        // Toda lámina simulada tiene al menos un estado
+        if (states_k[i] == 0) {
+            continue;
+        }
         time_t tiempo_transcurrido = states_k[i] * variables[i].delta_t;
         format_time(tiempo_transcurrido, formatted_time,
                     sizeof(formatted_time));
@@ -53,7 +60,37 @@ void generate_report_file(const char* folder,
                 formatted_time);
     }
 
-    fclose(report_file);
+    // Un disco lleno se detecta al vaciar el búfer
+    const int error = ferror(report_file);
+    if (fclose(report_file) != 0 || error) {
+        fprintf(stderr, "No se pudo escribir el archivo de reporte %s\n",
+                report_name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Construye la ruta del archivo binario con el estado final.
+ *
+ * @param file_name Buffer donde se almacenará la ruta.
+ * @param capacity Capacidad del buffer `file_name`.
+ * @param folder Carpeta donde se guardará el archivo binario.
+ * @param jobName Nombre del archivo binario de la lámina.
+ * @param states_k Estado final alcanzado en la simulación.
+ */
+void bin_file_name(char* file_name, size_t capacity, const char* folder,
+                   const char* jobName, uint64_t states_k) {
+    char base_name[512];
+    strncpy(base_name, jobName, sizeof(base_name) - 1);
+    base_name[sizeof(base_name) - 1] = '\0';
+    char* pos = strstr(base_name, ".bin");
+    if (pos) {
+        *pos = '\0';
+    }
+
+    snprintf(file_name, capacity, "%s/%s-%lu.bin", folder, base_name,
+                                                                      states_k);
 }
 
 /**
@@ -65,36 +102,19 @@ void generate_report_file(const char* folder,
  * @param folder Carpeta donde se guardará el archivo binario.
  * @param jobName Nombre del archivo de trabajo.
  * @param states_k Estado final alcanzado en la simulación.
+ * @param format Versión y compresión del archivo.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el archivo.
  */
-void generate_bin_file(double** matrix,
+int generate_bin_file(double** matrix,
                         uint64_t rows,
                         uint64_t columns,
                         const char* folder,
                         const char* jobName,
-                        uint64_t states_k) {
+                        uint64_t states_k,
+                        const plate_format* format) {
     char file_name[1024];
-    char base_name[512];
-    strncpy(base_name, jobName, sizeof(base_name) - 1);
-    base_name[sizeof(base_name) - 1] = '\0';
-    char* pos = strstr(base_name, ".bin");
-    if (pos) {
-        *pos = '\0';
-    }
-
-    snprintf(file_name, sizeof(file_name), "%s/%s-%lu.bin",
-            folder, base_name, states_k);
-    FILE* output_file = fopen(file_name, "wb");
-    if (output_file == NULL) {
-        fprintf(stderr, "No se pudo crear el archivo binario %s\n", file_name);
-        return;
-    }
-
-    fwrite(&rows, sizeof(uint64_t), 1, output_file);
-    fwrite(&columns, sizeof(uint64_t), 1, output_file);
-    for (uint64_t i = 0; i < rows; i++) {
-        fwrite(matrix[i], sizeof(double), columns, output_file);
-    }
-    fclose(output_file);
+    bin_file_name(file_name, sizeof(file_name), folder, jobName, states_k);
+    return plate_write(file_name, matrix, rows, columns, format);
 }
 
 /**
@@ -107,12 +127,14 @@ void generate_bin_file(double** matrix,
  * @return Un puntero al buffer `text` que contiene el tiempo formateado.
  */
 char* format_time(const time_t seconds, char* text, const size_t capacity) {
-    const struct tm* gmt = gmtime(&seconds);//NOLINT
+    // gmtime_r porque los lotes escriben reportes desde varios hilos
+    struct tm gmt;
+    gmtime_r(&seconds, &gmt);
     snprintf(text, capacity,
             "%04d/%02d/%02d\t%02d:%02d:%02d",
-            gmt->tm_year + 1900,
-             gmt->tm_mon + 1, gmt->tm_mday,
-             gmt->tm_hour, gmt->tm_min,
-             gmt->tm_sec);
+            gmt.tm_year + 1900,
+             gmt.tm_mon + 1, gmt.tm_mday,
+             gmt.tm_hour, gmt.tm_min,
+             gmt.tm_sec);
     return text;
 }
@@ -8,6 +8,21 @@
 #include <time.h>
 #include <pthread.h>
 
+#include "heat_tuner.h"
+#include "plate_arena.h"
+#include "plate_format.h"
+#include "tile_activity.h"
+
+/**
+ * @brief Ranuras de la arena de memoria que usa cada simulación.
+ */
+enum {
+    PLATE_SLOT_INPUT = 0,    /**< Lámina leída del archivo binario. */
+    PLATE_SLOT_CURRENT = 1,  /**< Matriz del estado actual. */
+    PLATE_SLOT_NEXT = 2,     /**< Matriz del estado siguiente. */
+    PLATE_SLOTS = 3,         /**< Cantidad de ranuras por simulación. */
+};
+
 /**
  * @brief Estructura para almacenar los parámetros de cada simulación.
  */
@@ -48,13 +63,19 @@ uint64_t count_lines(const char* fileName);
  * @param variables_formula Arreglo de estructuras `params_matrix` que contiene los parámetros de cada simulación.
  * @param lines Número de simulaciones a realizar.
  * @param jobName Nombre del archivo de trabajo.
- * @param num_threads Número de hilos a utilizar en la simulación.
+ * @param num_threads Número de hilos a utilizar en la simulación. Si
+ * `auto_tune` es verdadero es el máximo de hilos que puede elegir el afinador.
+ * @param auto_tune Si es verdadero se elige la forma de recorrer, los hilos y
+ * el tamaño de bloque de cada lámina con `heat_tuner_choose`.
+ * @return 0 si se simularon todas las láminas y se escribió el reporte, 1 si
+ * alguna lámina o el reporte fallaron.
  */
-void read_bin_plate(const char* folder,
+int read_bin_plate(const char* folder,
                     params_matrix* variables_formula,
                     uint64_t lines,
                     const char* jobName,
-                    int num_threads);
+                    int num_threads,
+                    bool auto_tune);
 
 /**
  * @brief Realiza la simulación de transferencia de calor en una matriz.
@@ -66,7 +87,9 @@ void read_bin_plate(const char* folder,
  * @param alpha Difusividad térmica.
  * @param h Tamaño de las celdas.
  * @param epsilon Sensitividad del punto de equilibrio.
- * @param num_threads Número de hilos a utilizar.
+ * @param tuning Forma de recorrer la lámina y cantidad de hilos.
+ * @param arena Arena de donde se toman las matrices auxiliares. Debe tener al
+ * menos `PLATE_SLOTS` ranuras.
  * @return Número de estados hasta alcanzar el punto de equilibrio.
  */
 uint64_t heat_transfer_simulation(double** matrix,
@@ -76,7 +99,50 @@ uint64_t heat_transfer_simulation(double** matrix,
                                     double alpha,
                                     double h,
                                     double epsilon,
-                                    int num_threads);
+                                    const heat_tuning* tuning,
+                                    plate_arena* arena);
+
+/**
+ * @brief Calcula un estado de la lámina con la configuración indicada.
+ *
+ * @details Todas las formas aplican la misma fórmula a cada celda, por lo que
+ * producen exactamente los mismos resultados; solo cambia el recorrido.
+ *
+ * @param tuning Forma de recorrer la lámina y cantidad de hilos.
+ * @param current_matrix Matriz con el estado actual.
+ * @param next_matrix Matriz donde se escribe el estado siguiente.
+ * @param rows Número de filas de la matriz.
+ * @param columns Número de columnas de la matriz.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param activity Mapa de actividad de la forma `ACTIVE`, o NULL para
+ * calcular todos los bloques. Supone que `next_matrix` es la
+ * `current_matrix` de la llamada anterior con el mismo mapa.
+ * @return Verdadero si ninguna celda cambió más que `epsilon`.
+ */
+bool heat_step(const heat_tuning* tuning,
+               double** current_matrix,
+               double** next_matrix,
+               uint64_t rows,
+               uint64_t columns,
+               double coef,
+               double epsilon,
+               tile_activity* activity);
+
+/**
+ * @brief Calcula la nueva temperatura de una fila entre dos columnas.
+ *
+ * @param current_matrix Matriz con el estado actual.
+ * @param next_matrix Matriz donde se escribe el estado siguiente.
+ * @param i Fila a calcular.
+ * @param first Primera columna a calcular.
+ * @param last Columna siguiente a la última a calcular.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @return 1 si ninguna celda cambió más que `epsilon`, 0 si alguna sí.
+ */
+int heat_row(double** current_matrix, double** next_matrix, uint64_t i,
+             uint64_t first, uint64_t last, double coef, double epsilon);
 
 /**
  * @brief Función ejecutada por cada hilo durante la simulación de transferencia de calor.
@@ -142,14 +208,28 @@ char* format_time(const time_t seconds, char* text, const size_t capacity);
  * @param jobName Nombre del archivo de trabajo.
  * @param variables_formula Arreglo de estructuras `params_matrix` que contiene los parámetros de la simulación.
  * @param states_k Arreglo que contiene el número de iteraciones para alcanzar el equilibrio en cada simulación.
+ * Las láminas con 0 estados no se pudieron simular y se omiten.
  * @param lines Número de simulaciones realizadas.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el reporte.
  */
-void generate_report_file(const char* folder,
+int generate_report_file(const char* folder,
                         const char* jobName,
                         params_matrix* variables_formula,
                         uint64_t* states_k,
                         uint64_t lines);
 
+/**
+ * @brief Construye la ruta del archivo binario con el estado final.
+ *
+ * @param file_name Buffer donde se almacenará la ruta.
+ * @param capacity Capacidad del buffer `file_name`.
+ * @param folder Carpeta donde se guardará el archivo binario.
+ * @param jobName Nombre del archivo binario de la lámina.
+ * @param states_k Número de iteraciones realizadas hasta alcanzar el equilibrio.
+ */
+void bin_file_name(char* file_name, size_t capacity, const char* folder,
+                   const char* jobName, uint64_t states_k);
+
 /**
  * @brief Genera un archivo binario con el estado final de la matriz después de la simulación.
  * 
@@ -159,12 +239,15 @@ void generate_report_file(const char* folder,
  * @param folder Carpeta donde se guardará el archivo binario.
  * @param jobName Nombre del archivo de trabajo.
  * @param states_k Número de iteraciones realizadas hasta alcanzar el equilibrio.
+ * @param format Versión y compresión del archivo.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el archivo.
  */
-void generate_bin_file(double** matrix,
+int generate_bin_file(double** matrix,
                         uint64_t rows,
                         uint64_t columns,
                         const char* folder,
                         const char* jobName,
-                        uint64_t states_k);
+                        uint64_t states_k,
+                        const plate_format* format);
 
 #endif  // HEAT_SIMULATION_H
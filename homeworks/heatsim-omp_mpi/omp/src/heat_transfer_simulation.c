@@ -8,6 +8,8 @@
 #include <omp.h>
 
 #include "heat_simulation.h"
+#include "out_of_core.h"
+#include "batch.h"
 
 /**
  * @brief Lee el archivo binario correspondiente a cada lámina y ejecuta la simulación de transferencia de calor.
@@ -21,105 +23,88 @@
  * @param lines Número de simulaciones a realizar.
  * @param jobName Nombre del archivo de trabajo.
  * @param num_threads Cantidad de hilos para la simulación.
+ * @param auto_tune Si es verdadero se afina cada lámina automáticamente.
+ * @return 0 si se simularon todas las láminas y se escribió el reporte, 1 si
+ * alguna lámina o el reporte fallaron.
  */
-void read_bin_plate(const char* folder,
+int read_bin_plate(const char* folder,
                     params_matrix* variables,
                     uint64_t lines,
                     const char* jobName,
-                    int num_threads) {
-    FILE *bin_file;
-    uint64_t rows, columns;
-    char direction[512];
-
+                    int num_threads,
+                    bool auto_tune) {
     // Crear un arreglo para almacenar los estados por cada simulación
-    uint64_t* array_state_k = malloc(lines * sizeof(uint64_t));
+    uint64_t* array_state_k = calloc(lines, sizeof(uint64_t));
     if (array_state_k == NULL) {
         fprintf(stderr,
                       "Error al asignar memoria para el arreglo de estados.\n");
-        return;
+        return 1;
     }
 
-    for (uint64_t i = 0; i < lines; i++) {
-        // Construir la ruta del archivo binario
-        snprintf(direction, sizeof(direction),
-                                        "%s/%s", folder, variables[i].filename);
-
-        // Abrir el archivo binario para leer
-        bin_file = fopen(direction, "rb");
-        if (bin_file == NULL) {
-            fprintf(stderr,
-             "No se pudo abrir el archivo binario %s\n", variables[i].filename);
-            continue;  // Continuar con la siguiente simulación en caso de error
-        }
+    /* **Optimización**: Las matrices de todas las láminas del trabajo salen
+    de una arena que conserva los búferes más grandes vistos hasta ahora*/
+    const char* huge_pages = getenv("HEATSIM_HUGEPAGES");
+    plate_arena arena;
+    if (plate_arena_init(&arena, PLATE_SLOTS,
+                         huge_pages != NULL && atoi(huge_pages) == 1) != 0) {
+        fprintf(stderr, "Error al asignar memoria para la arena.\n");
+        free(array_state_k);
+        return 1;
+    }
 
-        // Leer el número de filas y columnas de la matriz
-        fread(&rows, sizeof(uint64_t), 1, bin_file);
-        fread(&columns, sizeof(uint64_t), 1, bin_file);
-
-        // Asignar memoria para la matriz
-        double **matrix = malloc(rows * sizeof(double*));
-        if (matrix == NULL) {
-            fprintf(stderr,
-                      "Error al asignar memoria para las filas de la matriz\n");
-            fclose(bin_file);
-            continue;
-        }
+    /* El afinador guarda sus decisiones en HEATSIM_TUNING_FILE para que los
+    trabajos siguientes no tengan que volver a medir*/
+    heat_tuner tuner;
+    if (auto_tune) {
+        const char* tuning_file = getenv("HEATSIM_TUNING_FILE");
+        heat_tuner_init(&tuner, tuning_file != NULL ? tuning_file :
+                                          "heatsim-tuning.tsv", num_threads);
+    }
 
-        for (uint64_t j = 0; j < rows; j++) {
-            matrix[j] = malloc(columns * sizeof(double));
-            if (matrix[j] == NULL) {
-                fprintf(stderr,
-                   "Error al asignar memoria para las columnas de la matriz\n");
-                for (uint64_t k = 0; k < j; k++) {
-                    free(matrix[k]);
-                }
-                free(matrix);
-                fclose(bin_file);
-                continue;
-            }
+    /* Las láminas que no caben en HEATSIM_MEMORY_LIMIT se simulan por bandas
+    sin cargarlas completas*/
+    ooc_config ooc;
+    out_of_core_init(&ooc, folder);
+
+    // Versión y compresión de los archivos binarios que se escriben
+    plate_format format;
+    plate_format_init(&format, num_threads);
+
+    // HEATSIM_ACTIVE_TILES=1 salta los bloques que no cambian sin afinar
+    const char* active = getenv("HEATSIM_ACTIVE_TILES");
+    const bool active_tiles = active != NULL && atoi(active) == 1;
+
+    /* Sin afinador se usan las filas estáticas con todos los hilos, o los
+    bloques que saltan las regiones sin cambios si se pidieron*/
+    heat_tuning tuning = {HEAT_BACKEND_STATIC, num_threads, 0, 0};
+    if (active_tiles) {
+        tuning = (heat_tuning){HEAT_BACKEND_ACTIVE, num_threads,
+                               ACTIVE_TILE_ROWS, ACTIVE_TILE_COLUMNS};
+    }
 
-            // Leer cada fila del archivo binario y almacenarla en la matriz
-            size_t elements_read = fread(matrix[j], sizeof(double),
-                                                             columns, bin_file);
-            if (elements_read != columns) {
-                fprintf(stderr, "Error al leer los datos de la fila %lu\n", j);
-                for (uint64_t k = 0; k <= j; k++) {
-                    free(matrix[k]);
-                }
-                free(matrix);
-                fclose(bin_file);
-                continue;
-            }
-        }
-        // Cerrar el archivo binario después de leer los datos
-        fclose(bin_file);
-        // Ejecutar la simulación y capturar el número de estados
-        uint64_t states_k = heat_transfer_simulation(matrix, rows, columns,
-                                                     variables[i].delta_t,
-                                                     variables[i].alpha,
-                                                     variables[i].h,
-                                                     variables[i].epsilon,
-                                                     num_threads);
-
-        // Guardar el número de estados en el arreglo
-        array_state_k[i] = states_k;
-
-        // Generar archivo binario con el estado final
-        generate_bin_file(matrix, rows, columns, folder,
-                                       variables[i].filename, array_state_k[i]);
-
-        // Liberar la memoria de la matriz
-        for (uint64_t j = 0; j < rows; j++) {
-            free(matrix[j]);
+    // Las láminas que fallan se omiten del reporte, y el trabajo falla
+    int error = 0;
+    for (uint64_t i = 0; i < lines; i++) {
+        if (simulate_plate(folder, &variables[i], &tuning,
+                           auto_tune ? &tuner : NULL, &ooc, &format, &arena,
+                           &array_state_k[i]) != 0) {
+            error = 1;
         }
-        free(matrix);
     }
 
     // Generar el archivo de reporte con todos los resultados
-    generate_report_file(folder, jobName, variables, array_state_k, lines);
+    if (generate_report_file(folder, jobName, variables, array_state_k,
+                                                                     lines)) {
+        error = 1;
+    }
 
-    // Liberar el arreglo de estados
+    // Liberar el afinador, la arena y el arreglo de estados
+    if (auto_tune) {
+        heat_tuner_destroy(&tuner);
+    }
+    plate_arena_destroy(&arena);
     free(array_state_k);
+    return error;
 }
 
 /**
@@ -136,7 +121,8 @@ void read_bin_plate(const char* folder,
  * @param alpha Difusividad térmica.
  * @param h Tamaño de las celdas.
  * @param epsilon Sensitividad del punto de equilibrio.
- * @param num_threads Cantidad de hilos de ejecución.
+ * @param tuning Forma de recorrer la lámina y cantidad de hilos.
+ * @param arena Arena de donde se toman las dos matrices alternas.
  * 
  * @return Número de estados hasta alcanzar el punto de equilibrio.
  */
@@ -147,59 +133,267 @@ uint64_t heat_transfer_simulation(double** matrix,
                                   double alpha,
                                   double h,
                                   double epsilon,
-                                  int num_threads) {
-    // Configurar el número de hilos para OpenMP
-    omp_set_num_threads(num_threads);
-
-    double** matrix_a = create_empty_matrix(rows, columns);
-    double** matrix_b = create_empty_matrix(rows, columns);
+                                  const heat_tuning* tuning,
+                                  plate_arena* arena) {
+    // Las matrices alternas salen de la arena y se reutilizan entre láminas
+    double** matrix_a = plate_arena_acquire(arena, PLATE_SLOT_CURRENT,
+                                                                 rows, columns);
+    double** matrix_b = plate_arena_acquire(arena, PLATE_SLOT_NEXT,
+                                                                 rows, columns);
+    if (matrix_a == NULL || matrix_b == NULL) {
+        return 0;
+    }
 
     copy_matrix(matrix_a, matrix, rows, columns);
     copy_matrix(matrix_b, matrix, rows, columns);
 
     bool balance_point = false;
     uint64_t states_k = 0;
+    const double coef = (delta_t * alpha) / (h * h);
+
+    // La forma ACTIVE salta los bloques que no pueden cambiar
+    tile_activity activity_data;
+    tile_activity* activity = NULL;
+    if (tuning->backend == HEAT_BACKEND_ACTIVE &&
+            tile_activity_init(&activity_data, rows, columns,
+                               tuning->tile_rows, tuning->tile_columns) == 0) {
+        activity = &activity_data;
+    }
 
     while (!balance_point) {
-        balance_point = true;
-
         double** current_matrix = (states_k % 2 == 1) ? matrix_a : matrix_b;
         double** next_matrix = (states_k % 2 == 1) ? matrix_b : matrix_a;
 
-        double coef = (delta_t * alpha) / (h * h);
+        balance_point = heat_step(tuning, current_matrix, next_matrix, rows,
+                                              columns, coef, epsilon, activity);
+        states_k++;
+    }
+    if (activity != NULL) {
+        tile_activity_destroy(activity);
+    }
 
-        // Paralelizar solo el cálculo de cada fila
-        // (no afectando la parte de lectura/escritura)
-        #pragma omp parallel for schedule(static)
-        for (uint64_t i = 1; i < rows - 1; i++) {
-            for (uint64_t j = 1; j < columns - 1; j++) {
-                double new_temperature = current_matrix[i][j] +
-                    coef * (current_matrix[i-1][j] + current_matrix[i+1][j] +
-                            current_matrix[i][j-1] + current_matrix[i][j+1] -
-                            4 * current_matrix[i][j]);
+    copy_matrix(matrix, (states_k % 2 == 1) ?
+                                            matrix_b : matrix_a, rows, columns);
 
-                next_matrix[i][j] = new_temperature;
+    return states_k;
+}
 
-                // Verificar si el cambio es mayor que epsilon
-                if (fabs(new_temperature - current_matrix[i][j]) > epsilon) {
-                    #pragma omp atomic write
-                    balance_point = false;
-                }
-            }
+
+/**
+ * @brief Calcula la nueva temperatura de una fila entre dos columnas.
+ *
+ * @param current_matrix Matriz con el estado actual.
+ * @param next_matrix Matriz donde se escribe el estado siguiente.
+ * @param i Fila a calcular.
+ * @param first Primera columna a calcular.
+ * @param last Columna siguiente a la última a calcular.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @return 1 si ninguna celda cambió más que `epsilon`, 0 si alguna sí.
+ */
+int heat_row(double** current_matrix, double** next_matrix, uint64_t i,
+             uint64_t first, uint64_t last, double coef, double epsilon) {
+    int stable = 1;
+    for (uint64_t j = first; j < last; j++) {
+        double new_temperature = current_matrix[i][j] +
+            coef * (current_matrix[i-1][j] + current_matrix[i+1][j] +
+                    current_matrix[i][j-1] + current_matrix[i][j+1] -
+                    4 * current_matrix[i][j]);
+
+        next_matrix[i][j] = new_temperature;
+
+        // Verificar si el cambio es mayor que epsilon
+        if (fabs(new_temperature - current_matrix[i][j]) > epsilon) {
+            stable = 0;
         }
+    }
+    return stable;
+}
 
-        states_k++;
+/**
+ * @brief Calcula una fila como `heat_row` y anota si alguna celda cambió.
+ *
+ * @param current_matrix Matriz con el estado actual.
+ * @param next_matrix Matriz donde se escribe el estado siguiente.
+ * @param i Fila a calcular.
+ * @param first Primera columna a calcular.
+ * @param last Columna siguiente a la última a calcular.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param changed Se pone en 1 si alguna celda nueva difiere, bit a bit, de la
+ * actual.
+ * @return 1 si ninguna celda cambió más que `epsilon`, 0 si alguna sí.
+ */
+static int heat_row_tracked(double** current_matrix, double** next_matrix,
+                            uint64_t i, uint64_t first, uint64_t last,
+                            double coef, double epsilon, uint8_t* changed) {
+    int stable = 1;
+    uint64_t differences = 0;
+    for (uint64_t j = first; j < last; j++) {
+        double new_temperature = current_matrix[i][j] +
+            coef * (current_matrix[i-1][j] + current_matrix[i+1][j] +
+                    current_matrix[i][j-1] + current_matrix[i][j+1] -
+                    4 * current_matrix[i][j]);
+
+        next_matrix[i][j] = new_temperature;
+
+        if (fabs(new_temperature - current_matrix[i][j]) > epsilon) {
+            stable = 0;
+        }
+        // Se comparan los bits: 0.0 y -0.0 no dan el mismo estado siguiente
+        uint64_t new_bits, old_bits;
+        memcpy(&new_bits, &new_temperature, sizeof(double));
+        memcpy(&old_bits, &current_matrix[i][j], sizeof(double));
+        differences |= new_bits ^ old_bits;
+    }
+    if (differences != 0) {
+        *changed = 1;
     }
+    return stable;
+}
 
-    copy_matrix(matrix, (states_k % 2 == 1) ?
-                                            matrix_b : matrix_a, rows, columns);
+/**
+ * @brief Calcula un estado recorriendo bloques y saltando los inactivos.
+ *
+ * @details Un bloque inactivo no cambió en el estado anterior, así que la
+ * matriz siguiente (que fue la actual del estado anterior) ya tiene sus
+ * valores: no se calcula ni se copia nada.
+ *
+ * @param tuning Cantidad de hilos.
+ * @param activity Mapa de actividad con el tamaño de los bloques.
+ * @param current_matrix Matriz con el estado actual.
+ * @param next_matrix Matriz donde se escribe el estado siguiente.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @return Verdadero si ninguna celda cambió más que `epsilon`.
+ */
+static bool active_step(const heat_tuning* tuning, tile_activity* activity,
+                        double** current_matrix, double** next_matrix,
+                        uint64_t rows, uint64_t columns, double coef,
+                        double epsilon) {
+    // Las celdas de un bloque inactivo cambian exactamente 0
+    const int idle_stable = !(0.0 > epsilon);
+    const uint64_t tile_rows = activity->tile_rows;
+    const uint64_t tile_columns = activity->tile_columns;
+    const uint64_t row_tiles = activity->row_tiles;
+    const uint64_t column_tiles = activity->column_tiles;
+    int stable = 1;
+    uint64_t skipped = 0;
+
+    // Dinámico porque los bloques inactivos no cuestan nada
+    #pragma omp parallel for collapse(2) schedule(dynamic) \
+        num_threads(tuning->threads) reduction(&&: stable) \
+        reduction(+: skipped)
+    for (uint64_t ti = 0; ti < row_tiles; ti++) {
+        for (uint64_t tj = 0; tj < column_tiles; tj++) {
+            uint8_t* changed = &activity->next_changed[ti * column_tiles + tj];
+            *changed = 0;
+            if (tile_activity_idle(activity, ti, tj)) {
+                skipped++;
+                stable = idle_stable && stable;
+                continue;
+            }
+            const uint64_t first_row = 1 + ti * tile_rows;
+            const uint64_t last_row = first_row + tile_rows < rows - 1
+                                ? first_row + tile_rows : rows - 1;
+            const uint64_t first = 1 + tj * tile_columns;
+            const uint64_t last = first + tile_columns < columns - 1
+                                ? first + tile_columns : columns - 1;
+            for (uint64_t i = first_row; i < last_row; i++) {
+                // Basta una diferencia para marcar el bloque
+                stable = (*changed ? heat_row(current_matrix, next_matrix, i,
+                                              first, last, coef, epsilon)
+                                   : heat_row_tracked(current_matrix,
+                                              next_matrix, i, first, last,
+                                              coef, epsilon, changed))
+                         && stable;
+            }
+        }
+    }
+    activity->skipped += skipped;
+    activity->updated += row_tiles * column_tiles - skipped;
+    tile_activity_advance(activity);
+    return stable;
+}
 
-    free_matrix(matrix_a, rows);
-    free_matrix(matrix_b, rows);
+/**
+ * @brief Calcula un estado de la lámina con la configuración indicada.
+ *
+ * @param tuning Forma de recorrer la lámina y cantidad de hilos.
+ * @param current_matrix Matriz con el estado actual.
+ * @param next_matrix Matriz donde se escribe el estado siguiente.
+ * @param rows Número de filas de la matriz.
+ * @param columns Número de columnas de la matriz.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param activity Mapa de actividad de la forma `ACTIVE`, o NULL.
+ * @return Verdadero si ninguna celda cambió más que `epsilon`.
+ */
+bool heat_step(const heat_tuning* tuning,
+               double** current_matrix,
+               double** next_matrix,
+               uint64_t rows,
+               uint64_t columns,
+               double coef,
+               double epsilon,
+               tile_activity* activity) {
+    int stable = 1;
+    switch (tuning->backend) {
+        case HEAT_BACKEND_SERIAL:
+            for (uint64_t i = 1; i < rows - 1; i++) {
+                stable &= heat_row(current_matrix, next_matrix, i, 1,
+                                               columns - 1, coef, epsilon);
+            }
+            break;
+
+        case HEAT_BACKEND_STATIC:
+            // Paralelizar solo el cálculo de cada fila
+            #pragma omp parallel for schedule(static) \
+                num_threads(tuning->threads) reduction(&&: stable)
+            for (uint64_t i = 1; i < rows - 1; i++) {
+                stable = heat_row(current_matrix, next_matrix, i, 1,
+                                      columns - 1, coef, epsilon) && stable;
+            }
+            break;
 
-    return states_k;
-}
+        case HEAT_BACKEND_ACTIVE:
+            if (activity != NULL) {
+                return active_step(tuning, activity, current_matrix,
+                                   next_matrix, rows, columns, coef, epsilon);
+            }
+            // Sin mapa de actividad se calculan todos los bloques
+            /* fall through */
+        case HEAT_BACKEND_TILED: {
+            // Bloques de filas x columnas para que cada uno quepa en caché
+            const uint64_t tile_rows = tuning->tile_rows;
+            const uint64_t tile_columns = tuning->tile_columns;
+            const uint64_t row_tiles = (rows - 2 + tile_rows - 1) / tile_rows;
+            const uint64_t column_tiles = (columns - 2 + tile_columns - 1) /
+                                                                   tile_columns;
+            #pragma omp parallel for collapse(2) schedule(static) \
+                num_threads(tuning->threads) reduction(&&: stable)
+            for (uint64_t ti = 0; ti < row_tiles; ti++) {
+                for (uint64_t tj = 0; tj < column_tiles; tj++) {
+                    const uint64_t first_row = 1 + ti * tile_rows;
+                    const uint64_t last_row = first_row + tile_rows < rows - 1
+                                        ? first_row + tile_rows : rows - 1;
+                    const uint64_t first = 1 + tj * tile_columns;
+                    const uint64_t last = first + tile_columns < columns - 1
+                                        ? first + tile_columns : columns - 1;
+                    for (uint64_t i = first_row; i < last_row; i++) {
+                        stable = heat_row(current_matrix, next_matrix, i,
+                                   first, last, coef, epsilon) && stable;
+                    }
+                }
+            }
+            break;
+        }
 
+        default:
+            break;
+    }
+    return stable;
+}
 
 /**
  * @brief Crea una matriz vacía de tamaño especificado.
@@ -0,0 +1,512 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "heat_simulation.h"
+#include "heat_tuner.h"
+
+/// Láminas con menos celdas internas que esto se simulan en serie sin medir
+#define SMALL_PLATE_CELLS 4096
+/// Estados que se simulan al probar cada candidato
+#define PROBE_STATES 200
+/// Mínimo de estados por candidato aunque la lámina sea enorme
+#define PROBE_MIN_STATES 4
+/// Celdas actualizadas como máximo al probar un candidato
+#define PROBE_CELL_BUDGET 50000000ULL
+/// Máximo de candidatos que se prueban por lámina
+#define MAX_CANDIDATES 32
+/// Estados que se simulan para estimar cuánto tarda la lámina
+#define PILOT_STATES 8
+/// Fracción del tiempo estimado de la simulación que pueden tomar las pruebas
+#define PROBE_BUDGET_FRACTION 0.05
+
+/// Tamaños de bloque que se prueban en la forma `TILED` (filas, columnas)
+static const uint64_t tile_shapes[][2] = {{16, 512}, {64, 512}, {32, 2048}};
+/// Tamaños de bloque que se prueban en la forma `ACTIVE` (filas, columnas)
+static const uint64_t active_tile_shapes[][2] = {{16, 256}, {32, 512}};
+
+/**
+ * @brief Retorna el nombre de una forma de recorrer la lámina.
+ *
+ * @param backend Forma de recorrer la lámina.
+ * @return Nombre corto: serial, static, tiled o active.
+ */
+const char* heat_backend_name(heat_backend backend) {
+    static const char* const names[HEAT_BACKEND_COUNT] = {
+        "serial", "static", "tiled", "active"
+    };
+    return backend < HEAT_BACKEND_COUNT ? names[backend] : "?";
+}
+
+/**
+ * @brief Convierte un nombre corto a una forma de recorrer la lámina.
+ *
+ * @param name Nombre corto.
+ * @param backend Puntero donde se almacena la forma reconocida.
+ * @return 0 si el nombre es válido, 1 si no.
+ */
+static int parse_backend(const char* name, heat_backend* backend) {
+    for (int i = 0; i < HEAT_BACKEND_COUNT; i++) {
+        if (strcmp(name, heat_backend_name((heat_backend)i)) == 0) {
+            *backend = (heat_backend)i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Agrega o reemplaza una decisión en memoria.
+ *
+ * @param tuner Afinador del trabajo.
+ * @param entry Decisión a guardar.
+ * @return 0 si tuvo éxito, 1 si no hay memoria.
+ */
+static int remember(heat_tuner* tuner, const tuning_entry* entry) {
+    for (size_t i = 0; i < tuner->count; i++) {
+        tuning_entry* known = &tuner->entries[i];
+        if (known->rows == entry->rows && known->columns == entry->columns &&
+                                    known->max_threads == entry->max_threads) {
+            *known = *entry;
+            return 0;
+        }
+    }
+    if (tuner->count == tuner->capacity) {
+        size_t capacity = tuner->capacity ? 2 * tuner->capacity : 16;
+        tuning_entry* entries = realloc(tuner->entries,
+                                        capacity * sizeof(tuning_entry));
+        if (entries == NULL) {
+            return 1;
+        }
+        tuner->entries = entries;
+        tuner->capacity = capacity;
+    }
+    tuner->entries[tuner->count++] = *entry;
+    return 0;
+}
+
+/**
+ * @brief Inicializa el afinador y carga las decisiones guardadas.
+ *
+ * @param tuner Afinador a inicializar.
+ * @param path Ruta del archivo de afinamiento; si no existe se creará.
+ * @param max_threads Máximo de hilos que se pueden usar.
+ */
+void heat_tuner_init(heat_tuner* tuner, const char* path, int max_threads) {
+    memset(tuner, 0, sizeof(heat_tuner));
+    tuner->max_threads = max_threads > 0 ? max_threads : 1;
+    snprintf(tuner->path, sizeof(tuner->path), "%s", path);
+
+    FILE* tuning_file = fopen(path, "r");
+    if (tuning_file == NULL) {
+        return;  // Todavía no hay decisiones guardadas
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), tuning_file) != NULL) {
+        if (line[0] == '#') {
+            continue;
+        }
+        tuning_entry entry;
+        char backend[16];
+        if (sscanf(line, "%lu %lu %d %15s %d %lu %lu", &entry.rows,
+                   &entry.columns, &entry.max_threads, backend,
+                   &entry.tuning.threads, &entry.tuning.tile_rows,
+                   &entry.tuning.tile_columns) == 7 &&
+            parse_backend(backend, &entry.tuning.backend) == 0 &&
+            entry.tuning.backend != HEAT_BACKEND_ACTIVE &&
+            entry.tuning.threads > 0) {
+            // Las líneas posteriores reemplazan a las anteriores. ACTIVE no
+            // se guarda porque depende de los datos, no solo de la forma
+            remember(tuner, &entry);
+        }
+    }
+    fclose(tuning_file);
+}
+
+/**
+ * @brief Agrega una decisión al final del archivo de afinamiento.
+ *
+ * @param tuner Afinador del trabajo.
+ * @param entry Decisión a guardar.
+ * @param seconds Duración de la prueba del candidato elegido.
+ */
+static void persist(const heat_tuner* tuner, const tuning_entry* entry,
+                    double seconds) {
+    FILE* tuning_file = fopen(tuner->path, "a");
+    if (tuning_file == NULL) {
+        fprintf(stderr, "No se pudo escribir el archivo de afinamiento %s\n",
+                tuner->path);
+        return;
+    }
+    if (ftell(tuning_file) == 0) {
+        fprintf(tuning_file, "# rows\tcolumns\tmax_threads\tbackend\tthreads"
+                             "\ttile_rows\ttile_columns\tprobe_s\n");
+    }
+    fprintf(tuning_file, "%lu\t%lu\t%d\t%s\t%d\t%lu\t%lu\t%.9lf\n",
+            entry->rows, entry->columns, entry->max_threads,
+            heat_backend_name(entry->tuning.backend), entry->tuning.threads,
+            entry->tuning.tile_rows, entry->tuning.tile_columns, seconds);
+    fclose(tuning_file);
+}
+
+/**
+ * @brief Agrega las configuraciones de la forma `ACTIVE` a probar.
+ *
+ * @param tuner Afinador del trabajo.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param candidates Arreglo donde se guardan las configuraciones.
+ * @param count Cantidad de configuraciones que ya tiene el arreglo.
+ * @return Cantidad de configuraciones.
+ */
+static size_t list_active_candidates(const heat_tuner* tuner, uint64_t rows,
+                                     uint64_t columns, heat_tuning* candidates,
+                                     size_t count) {
+    // Bloques más pequeños al saltar los que no cambian, para que el frente
+    // de calor active poca área
+    const size_t active_shapes = sizeof(active_tile_shapes) /
+                                 sizeof(active_tile_shapes[0]);
+    for (size_t s = 0; s < active_shapes && count < MAX_CANDIDATES; s++) {
+        if (active_tile_shapes[s][0] < rows - 2 &&
+                                  active_tile_shapes[s][1] < columns - 2) {
+            candidates[count++] = (heat_tuning){HEAT_BACKEND_ACTIVE,
+                tuner->max_threads, active_tile_shapes[s][0],
+                active_tile_shapes[s][1]};
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Construye la lista de configuraciones a probar para una lámina.
+ *
+ * @param tuner Afinador del trabajo.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param candidates Arreglo donde se guardan las configuraciones.
+ * @return Cantidad de configuraciones.
+ */
+static size_t list_candidates(const heat_tuner* tuner, uint64_t rows,
+                              uint64_t columns, heat_tuning* candidates) {
+    size_t count = 0;
+    candidates[count++] = (heat_tuning){HEAT_BACKEND_SERIAL, 1, 0, 0};
+
+    // Potencias de dos menores que el máximo y luego el máximo
+    for (int threads = 2; threads < tuner->max_threads &&
+                                  count < MAX_CANDIDATES / 2; threads *= 2) {
+        candidates[count++] = (heat_tuning){HEAT_BACKEND_STATIC, threads, 0, 0};
+    }
+    if (tuner->max_threads > 1) {
+        candidates[count++] = (heat_tuning){HEAT_BACKEND_STATIC,
+                                            tuner->max_threads, 0, 0};
+    }
+
+    // Los bloques solo tienen sentido si la lámina es más ancha que un bloque
+    const size_t shapes = sizeof(tile_shapes) / sizeof(tile_shapes[0]);
+    for (size_t s = 0; s < shapes && count < MAX_CANDIDATES; s++) {
+        if (tile_shapes[s][0] < rows - 2 && tile_shapes[s][1] < columns - 2) {
+            candidates[count++] = (heat_tuning){HEAT_BACKEND_TILED,
+                tuner->max_threads, tile_shapes[s][0], tile_shapes[s][1]};
+        }
+    }
+
+    return list_active_candidates(tuner, rows, columns, candidates, count);
+}
+
+/**
+ * @brief Mide cuánto tarda una configuración en simular unos estados.
+ *
+ * @details Todas las formas dan los mismos resultados, así que cada prueba
+ * continúa la simulación donde la dejó la anterior: la forma `ACTIVE` se
+ * mide después de los primeros estados, que son los que más cambian.
+ *
+ * @param tuning Configuración a medir.
+ * @param matrix_a Matriz de prueba.
+ * @param matrix_b Matriz de prueba.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param coef Coeficiente de la lámina.
+ * @param epsilon Sensitividad del punto de equilibrio; negativa para no
+ * detenerse.
+ * @param states Estados a simular como máximo.
+ * @param step Estados simulados hasta ahora; se actualiza.
+ * @return Segundos que tardó, o negativo si alcanzó el equilibrio.
+ */
+static double probe(const heat_tuning* tuning, double** matrix_a,
+                    double** matrix_b, uint64_t rows, uint64_t columns,
+                    double coef, double epsilon, uint64_t states,
+                    uint64_t* step) {
+    // La forma ACTIVE se mide con su mapa, como en la simulación
+    tile_activity activity_data;
+    tile_activity* activity = NULL;
+    if (tuning->backend == HEAT_BACKEND_ACTIVE &&
+            tile_activity_init(&activity_data, rows, columns,
+                               tuning->tile_rows, tuning->tile_columns) == 0) {
+        activity = &activity_data;
+    }
+
+    bool balance_point = false;
+    const double start = omp_get_wtime();
+    for (uint64_t k = 0; k < states && !balance_point; k++, (*step)++) {
+        balance_point = heat_step(tuning, *step % 2 ? matrix_a : matrix_b,
+                                  *step % 2 ? matrix_b : matrix_a, rows,
+                                  columns, coef, epsilon, activity);
+    }
+    const double seconds = omp_get_wtime() - start;
+    if (activity != NULL) {
+        tile_activity_destroy(activity);
+    }
+    return balance_point ? -1.0 : seconds;
+}
+
+/**
+ * @brief Calcula el máximo cambio de una celda entre dos estados.
+ *
+ * @param matrix_a Matriz con un estado.
+ * @param matrix_b Matriz con el estado siguiente o el anterior.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @return Máximo de |a - b|.
+ */
+static double max_change(double** matrix_a, double** matrix_b, uint64_t rows,
+                         uint64_t columns) {
+    double change = 0.0;
+    #pragma omp parallel for reduction(max: change)
+    for (uint64_t i = 1; i < rows - 1; i++) {
+        for (uint64_t j = 1; j < columns - 1; j++) {
+            const double difference = fabs(matrix_a[i][j] - matrix_b[i][j]);
+            change = difference > change ? difference : change;
+        }
+    }
+    return change;
+}
+
+/**
+ * @brief Estima los estados que faltan para alcanzar el equilibrio.
+ *
+ * @details Mientras el calor se difunde, el máximo cambio baja más o menos
+ * como una potencia del número de estados, `t^-p`, y al final baja
+ * geométricamente con el factor del modo más lento. Se usa la menor de ambas
+ * estimaciones; en las láminas de `tests` quedan entre 1 y 1.5 veces los
+ * estados reales.
+ *
+ * @param early Máximo cambio en el estado `states / 2`.
+ * @param late Máximo cambio en el estado `states`.
+ * @param states Estados simulados hasta la medición `late`.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param coef Coeficiente de la lámina.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @return Estados estimados, o `HUGE_VAL` si la lámina nunca converge.
+ */
+static double remaining_states(double early, double late, uint64_t states,
+                               uint64_t rows, uint64_t columns, double coef,
+                               double epsilon) {
+    if (!(epsilon > 0.0)) {
+        return HUGE_VAL;
+    }
+    if (late <= epsilon) {
+        return 0.0;
+    }
+
+    // Factores de los modos más lento y más rápido
+    const double angle_rows = acos(-1.0) / (2.0 * (rows - 1));
+    const double angle_columns = acos(-1.0) / (2.0 * (columns - 1));
+    const double low = sin(angle_rows) * sin(angle_rows) +
+                       sin(angle_columns) * sin(angle_columns);
+    const double slow = fabs(1.0 - 4.0 * coef * low);
+    const double fast = fabs(1.0 - 4.0 * coef * (2.0 - low));
+    const double rate = slow > fast ? slow : fast;
+    const double geometric = rate < 1.0 ?
+                             log(epsilon / late) / log(rate) : HUGE_VAL;
+
+    // Exponente medido entre los estados states / 2 y states
+    const double power = log(early / late) / log(2.0);
+    const double potential = power > 0.0 ?
+                states * (pow(late / epsilon, 1.0 / power) - 1.0) : HUGE_VAL;
+    return potential < geometric ? potential : geometric;
+}
+
+/**
+ * @brief Mide la lámina y prueba los candidatos sobre las matrices alternas.
+ *
+ * @param tuner Afinador del trabajo.
+ * @param known Decisión guardada para la forma de la lámina, o NULL.
+ * @param candidates Configuraciones a probar.
+ * @param count Cantidad de configuraciones.
+ * @param matrix_a Matriz alterna con el estado actual.
+ * @param matrix_b Matriz alterna con el estado actual.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param coef Coeficiente de la lámina.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param step Estados simulados; se actualiza.
+ * @param best Configuración inicial; queda con la elegida.
+ * @return Verdadero si la lámina alcanzó el equilibrio.
+ */
+static bool tune_plate(heat_tuner* tuner, const tuning_entry* known,
+                       const heat_tuning* candidates, size_t count,
+                       double** matrix_a, double** matrix_b, uint64_t rows,
+                       uint64_t columns, double coef, double epsilon,
+                       uint64_t* step, heat_tuning* best) {
+    /* Una prueba inicial con la forma por defecto mide cuánto tarda un estado
+    y cuánto bajan los cambios. Si la lámina alcanza el equilibrio en ella,
+    o el resto es corto, probar candidatos costaría más que lo que ahorran*/
+    const double first_half = probe(best, matrix_a, matrix_b, rows, columns,
+                                    coef, epsilon, PILOT_STATES / 2, step);
+    if (first_half < 0.0) {
+        return true;
+    }
+    const double early = max_change(matrix_a, matrix_b, rows, columns);
+    const double second_half = probe(best, matrix_a, matrix_b, rows, columns,
+                                     coef, epsilon, PILOT_STATES / 2, step);
+    if (second_half < 0.0) {
+        return true;
+    }
+    const double late = max_change(matrix_a, matrix_b, rows, columns);
+    double best_per_state = (first_half + second_half) / PILOT_STATES;
+    const double remaining = remaining_states(early, late, PILOT_STATES, rows,
+                                              columns, coef, epsilon);
+    const double budget = isinf(remaining) ? HUGE_VAL :
+                          PROBE_BUDGET_FRACTION * best_per_state * remaining;
+
+    // Menos estados en láminas enormes o cortas para que la prueba no domine
+    const uint64_t cells = (rows - 2) * (columns - 2);
+    uint64_t states = PROBE_CELL_BUDGET / cells;
+    states = states > PROBE_STATES ? PROBE_STATES : states;
+    if (budget < best_per_state * states * count) {
+        states = (uint64_t)(budget / (best_per_state * count));
+    }
+    if (states < PROBE_MIN_STATES) {
+        return false;
+    }
+
+    // Se guarda el mejor sin ACTIVE, que solo depende de la forma. Un
+    // candidato lento puede agotar el presupuesto antes de probar todos
+    heat_tuning shape_best = *best;
+    double shape_per_state = best_per_state;
+    double spent = 0.0;
+    size_t probed = 0;
+    for (; probed < count && spent < budget; probed++) {
+        const double seconds = probe(&candidates[probed], matrix_a, matrix_b,
+                                     rows, columns, coef, epsilon, states,
+                                     step);
+        if (seconds < 0.0) {
+            return true;
+        }
+        spent += seconds;
+        const double per_state = seconds / states;
+        if (per_state < best_per_state) {
+            best_per_state = per_state;
+            *best = candidates[probed];
+        }
+        if (candidates[probed].backend != HEAT_BACKEND_ACTIVE &&
+                                            per_state < shape_per_state) {
+            shape_per_state = per_state;
+            shape_best = candidates[probed];
+        }
+    }
+
+    // Solo se guarda una decisión que comparó todos los candidatos
+    if (known == NULL && probed == count) {
+        const tuning_entry entry = {rows, columns, tuner->max_threads,
+                                    shape_best};
+        remember(tuner, &entry);
+        persist(tuner, &entry, shape_per_state * states);
+    }
+    return false;
+}
+
+/**
+ * @brief Elige la configuración para simular una lámina.
+ *
+ * @param tuner Afinador del trabajo.
+ * @param matrix Lámina con los datos iniciales; queda con el último estado
+ * simulado al elegir.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param coef Coeficiente `delta_t * alpha / h^2` de la lámina.
+ * @param epsilon Sensitividad del punto de equilibrio de la lámina.
+ * @param arena Arena de donde se toman las matrices de prueba.
+ * @param states Estados simulados al elegir.
+ * @param balance_point Si la lámina alcanzó el equilibrio al elegir.
+ * @return Configuración elegida.
+ */
+heat_tuning heat_tuner_choose(heat_tuner* tuner, double** matrix,
+                              uint64_t rows, uint64_t columns, double coef,
+                              double epsilon, plate_arena* arena,
+                              uint64_t* states, bool* balance_point) {
+    heat_tuning best = {HEAT_BACKEND_SERIAL, 1, 0, 0};
+    *states = 0;
+    *balance_point = false;
+    if (rows < 3 || columns < 3 ||
+                              (rows - 2) * (columns - 2) < SMALL_PLATE_CELLS) {
+        return best;
+    }
+
+    const tuning_entry* known = NULL;
+    for (size_t i = 0; i < tuner->count && known == NULL; i++) {
+        const tuning_entry* entry = &tuner->entries[i];
+        if (entry->rows == rows && entry->columns == columns &&
+                                    entry->max_threads == tuner->max_threads) {
+            known = entry;
+        }
+    }
+
+    // Si la forma ya se decidió solo falta compararla con ACTIVE, que depende
+    // de cuánto de esta lámina cambia. Si no, se parte de la forma estática
+    heat_tuning candidates[MAX_CANDIDATES];
+    size_t count = 0;
+    if (known != NULL) {
+        best = known->tuning;
+        count = list_active_candidates(tuner, rows, columns, candidates, 0);
+        if (count == 0) {
+            return best;
+        }
+    } else {
+        best = (heat_tuning){HEAT_BACKEND_STATIC, tuner->max_threads, 0, 0};
+        count = list_candidates(tuner, rows, columns, candidates);
+    }
+
+    // Las matrices de prueba son las mismas que luego usa la simulación
+    double** matrix_a = plate_arena_acquire(arena, PLATE_SLOT_CURRENT,
+                                                                 rows, columns);
+    double** matrix_b = plate_arena_acquire(arena, PLATE_SLOT_NEXT,
+                                                                 rows, columns);
+    if (matrix_a == NULL || matrix_b == NULL) {
+        return best;
+    }
+    copy_matrix(matrix_a, matrix, rows, columns);
+    copy_matrix(matrix_b, matrix, rows, columns);
+
+    /* Todas las formas dan los mismos resultados, así que los estados de las
+    pruebas son los primeros de la simulación y no se repiten. Se deja en la
+    lámina el estado que `heat_transfer_simulation` dejaría en ese punto*/
+    uint64_t step = 0;
+    *balance_point = tune_plate(tuner, known, candidates, count, matrix_a,
+                                matrix_b, rows, columns, coef, epsilon, &step,
+                                &best);
+    *states = step;
+    if (*balance_point) {
+        copy_matrix(matrix, step % 2 == 1 ? matrix_b : matrix_a, rows,
+                                                                     columns);
+    } else if (step > 0) {
+        copy_matrix(matrix, step % 2 == 1 ? matrix_a : matrix_b, rows,
+                                                                     columns);
+    }
+    return best;
+}
+
+/**
+ * @brief Libera la memoria del afinador.
+ *
+ * @param tuner Afinador a destruir.
+ */
+void heat_tuner_destroy(heat_tuner* tuner) {
+    free(tuner->entries);
+    tuner->entries = NULL;
+    tuner->count = tuner->capacity = 0;
+}
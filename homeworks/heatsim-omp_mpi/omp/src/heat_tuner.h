@@ -0,0 +1,113 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef HEAT_TUNER_H
+#define HEAT_TUNER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "plate_arena.h"
+
+/**
+ * @brief Formas de recorrer la lámina en cada estado.
+ */
+typedef enum {
+    HEAT_BACKEND_SERIAL,    /**< Un solo hilo, sin OpenMP. */
+    HEAT_BACKEND_STATIC,    /**< Filas repartidas con `schedule(static)`. */
+    HEAT_BACKEND_TILED,     /**< Bloques de filas x columnas entre hilos. */
+    HEAT_BACKEND_ACTIVE,    /**< Bloques que saltan los que no cambian. */
+    HEAT_BACKEND_COUNT      /**< Cantidad de formas. */
+} heat_backend;
+
+/**
+ * @brief Configuración con la que se simula una lámina.
+ */
+typedef struct {
+    heat_backend backend;   /**< Forma de recorrer la lámina. */
+    int threads;            /**< Hilos de OpenMP a utilizar. */
+    uint64_t tile_rows;     /**< Filas por bloque (`TILED` y `ACTIVE`). */
+    uint64_t tile_columns;  /**< Columnas por bloque (`TILED` y
+                                 `ACTIVE`). */
+} heat_tuning;
+
+/**
+ * @brief Decisión guardada para una forma de lámina.
+ */
+typedef struct {
+    uint64_t rows;          /**< Filas de la lámina. */
+    uint64_t columns;       /**< Columnas de la lámina. */
+    int max_threads;        /**< Hilos disponibles cuando se decidió. */
+    heat_tuning tuning;     /**< Configuración elegida. */
+} tuning_entry;
+
+/**
+ * @brief Afinador automático de un trabajo.
+ *
+ * @details Conserva las decisiones leídas del archivo de afinamiento y las que
+ * se toman durante el trabajo. Las decisiones nuevas se agregan al final del
+ * archivo en cuanto se toman, así otros trabajos ya no tienen que medirlas.
+ */
+typedef struct {
+    tuning_entry* entries;  /**< Decisiones conocidas. */
+    size_t count;           /**< Cantidad de decisiones conocidas. */
+    size_t capacity;        /**< Capacidad del arreglo `entries`. */
+    int max_threads;        /**< Máximo de hilos que se pueden usar. */
+    char path[512];         /**< Ruta del archivo de afinamiento. */
+} heat_tuner;
+
+/**
+ * @brief Retorna el nombre de una forma de recorrer la lámina.
+ *
+ * @param backend Forma de recorrer la lámina.
+ * @return Nombre corto: serial, static, tiled o active.
+ */
+const char* heat_backend_name(heat_backend backend);
+
+/**
+ * @brief Inicializa el afinador y carga las decisiones guardadas.
+ *
+ * @param tuner Afinador a inicializar.
+ * @param path Ruta del archivo de afinamiento; si no existe se creará.
+ * @param max_threads Máximo de hilos que se pueden usar.
+ */
+void heat_tuner_init(heat_tuner* tuner, const char* path, int max_threads);
+
+/**
+ * @brief Elige la configuración para simular una lámina.
+ *
+ * @details Primero se simulan unos estados con la decisión guardada para la
+ * forma de la lámina, o con la forma estática, para estimar cuánto tardará la
+ * simulación. Las pruebas de los candidatos se limitan a una fracción de
+ * ese tiempo: si la lámina converge pronto no se prueba nada y se usa esa
+ * decisión. Si la forma ya está en el archivo de afinamiento solo se prueban
+ * los candidatos `ACTIVE`. Si no, se prueba cada candidato y se guarda el más
+ * rápido que no sea `ACTIVE`, porque lo que ahorra esa forma depende de los
+ * datos de cada lámina y no solo de su forma. Las láminas muy pequeñas
+ * siempre se simulan en serie sin medir. Como todas las formas dan los mismos
+ * resultados, los estados simulados al elegir cuentan para la simulación.
+ *
+ * @param tuner Afinador del trabajo.
+ * @param matrix Lámina con los datos iniciales; queda con el estado desde el
+ * que debe seguir la simulación.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param coef Coeficiente `delta_t * alpha / h^2` de la lámina.
+ * @param epsilon Sensitividad del punto de equilibrio de la lámina.
+ * @param arena Arena de donde se toman las matrices de prueba.
+ * @param states Estados simulados al elegir.
+ * @param balance_point Si la lámina alcanzó el equilibrio al elegir.
+ * @return Configuración elegida.
+ */
+heat_tuning heat_tuner_choose(heat_tuner* tuner, double** matrix,
+                              uint64_t rows, uint64_t columns, double coef,
+                              double epsilon, plate_arena* arena,
+                              uint64_t* states, bool* balance_point);
+
+/**
+ * @brief Libera la memoria del afinador.
+ *
+ * @param tuner Afinador a destruir.
+ */
+void heat_tuner_destroy(heat_tuner* tuner);
+
+#endif  // HEAT_TUNER_H
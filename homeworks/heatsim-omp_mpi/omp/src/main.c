@@ -2,9 +2,53 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <unistd.h>  // Para obtener el número de CPUs (núcleos) disponibles
 #include <time.h>    // Para la función clock_gettime
 #include "heat_simulation.h"
+#include "batch.h"
+
+/**
+ * @brief Ejecuta varios trabajos a la vez con un solo grupo de hilos.
+ *
+ * @param argc Número de argumentos después de `--batch`.
+ * @param argv Argumentos después de `--batch`: `[-t num_hilos]` y los
+ * trabajos, patrones o listas `@archivo`.
+ * @return 0 si todos los trabajos se completaron, 1 si alguno falló.
+ */
+static int batch_main(int argc, char *argv[]) {
+    int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc >= 2 && strcmp(argv[0], "-t") == 0) {
+        if (atoi(argv[1]) > 0) {
+            num_threads = atoi(argv[1]);
+        } else {
+            fprintf(stderr,
+             "Número de hilos inválido. Usando número de CPUs disponibles.\n");
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc < 1) {
+        fprintf(stderr, "No se indicó ningún archivo de trabajo.\n");
+        return 1;
+    }
+    printf("Número de hilos a utilizar: %d\n", num_threads);
+
+    struct timespec start_time, finish_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    const int error = run_batch(argv, argc, num_threads);
+    clock_gettime(CLOCK_MONOTONIC, &finish_time);
+
+    double elapsed = (finish_time.tv_sec - start_time.tv_sec) +
+                     (finish_time.tv_nsec - start_time.tv_nsec) * 1e-9;
+    printf("Tiempo de ejecución: %.9lfs\n", elapsed);
+    if (error) {
+        fprintf(stderr, "La simulación terminó con errores.\n");
+        return 1;
+    }
+    printf("Simulación completada.\n");
+    return 0;
+}
 
 /**
  * @brief Programa principal para ejecutar la simulación de transferencia de calor.
@@ -15,8 +59,14 @@
  * @return 0 si la simulación se ejecuta correctamente, 1 si hay un error.
  */
 int main(int argc, char *argv[]) {
+    // Modo por lotes: varios trabajos comparten los mismos hilos
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        return batch_main(argc - 2, argv + 2);
+    }
     if (argc < 3) {
-        printf("Uso: %s <carpeta> <archivo de trabajo> [num_hilos]\n", argv[0]);
+        printf("Uso: %s <carpeta> <archivo de trabajo> [num_hilos|auto]\n"
+               "     %s --batch [-t num_hilos] <trabajo|patrón|@lista>...\n",
+                                                              argv[0], argv[0]);
         return 1;
     }
 
@@ -25,7 +75,9 @@ int main(int argc, char *argv[]) {
 
     // Determinar el número de hilos
     int num_threads;
-    if (argc >= 4) {
+    // Con "auto" el afinador elige por lámina hasta el número de CPUs
+    bool auto_tune = argc >= 4 && strcmp(argv[3], "auto") == 0;
+    if (argc >= 4 && !auto_tune) {
         num_threads = atoi(argv[3]);  // Convertir argumento a entero
         if (num_threads <= 0) {
             fprintf(stderr,
@@ -38,7 +90,12 @@ int main(int argc, char *argv[]) {
         // Obtener núcleos de la máquina si no se proporciona el argumento
     }
 
-    printf("Número de hilos a utilizar: %d\n", num_threads);
+    if (auto_tune) {
+        printf("Número de hilos a utilizar: automático (máximo %d)\n",
+                                                                   num_threads);
+    } else {
+        printf("Número de hilos a utilizar: %d\n", num_threads);
+    }
 
     // Iniciar el reloj para medir el tiempo
     struct timespec start_time, finish_time;
@@ -53,7 +110,8 @@ int main(int argc, char *argv[]) {
     }
 
     // Simulación de transferencia de calor
-    read_bin_plate(folder, variables, lines, jobName, num_threads);
+    const int error = read_bin_plate(folder, variables, lines, jobName,
+                                     num_threads, auto_tune);
 
     // Medir el tiempo después de completar la simulación
     clock_gettime(CLOCK_MONOTONIC, &finish_time);
@@ -69,6 +127,10 @@ int main(int argc, char *argv[]) {
     }
     free(variables);
 
+    if (error) {
+        fprintf(stderr, "La simulación terminó con errores.\n");
+        return 1;
+    }
     printf("Simulación completada.\n");
     return 0;
 }
@@ -0,0 +1,435 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "heat_simulation.h"
+#include "out_of_core.h"
+
+/// Bytes del encabezado del archivo binario (filas y columnas)
+#define HEADER_BYTES (2 * sizeof(uint64_t))
+/// Memoria para las bandas si solo se fuerza el modo, sin límite (256 MiB)
+#define DEFAULT_MEMORY_LIMIT (256ULL * 1024 * 1024)
+/// Estados por pasada si no se indica `HEATSIM_OOC_DEPTH`
+#define DEFAULT_DEPTH 8
+
+/**
+ * @brief Bandas en que se recorre una lámina y búferes donde se calculan.
+ */
+typedef struct {
+    uint64_t rows;          /**< Número de filas de la lámina. */
+    uint64_t columns;       /**< Número de columnas de la lámina. */
+    uint64_t band_rows;     /**< Filas que escribe cada banda. */
+    uint64_t depth;         /**< Estados que avanza cada banda por pasada. */
+    double coef;            /**< Coeficiente `delta_t * alpha / h^2`. */
+    double epsilon;         /**< Sensitividad del punto de equilibrio. */
+    int threads;            /**< Hilos de OpenMP por banda. */
+    double** window;        /**< Filas de la banda leídas del disco. */
+    double** work[2];       /**< Estados alternos de la banda. */
+} stream_plan;
+
+/**
+ * @brief Lee un número positivo de una variable de ambiente.
+ *
+ * @param name Nombre de la variable.
+ * @param fallback Valor si la variable no existe o no es válida.
+ * @return Valor de la variable o `fallback`.
+ */
+static uint64_t env_number(const char* name, uint64_t fallback) {
+    const char* text = getenv(name);
+    if (text == NULL) {
+        return fallback;
+    }
+    char* end = NULL;
+    const unsigned long long value = strtoull(text, &end, 10);
+    return end != text && *end == '\0' && value > 0 ? value : fallback;
+}
+
+/**
+ * @brief Lee la configuración fuera de memoria de las variables de ambiente.
+ *
+ * @param config Configuración a inicializar.
+ * @param folder Carpeta del trabajo.
+ */
+void out_of_core_init(ooc_config* config, const char* folder) {
+    const char* forced = getenv("HEATSIM_OUT_OF_CORE");
+    config->forced = forced != NULL && atoi(forced) == 1;
+    // El límite se indica en MiB; uno que no se puede representar es como
+    // no tener límite
+    const uint64_t limit_mib = env_number("HEATSIM_MEMORY_LIMIT", 0);
+    if (__builtin_mul_overflow(limit_mib, 1024 * 1024,
+                                                    &config->memory_limit)) {
+        config->memory_limit = 0;
+    }
+    config->depth = env_number("HEATSIM_OOC_DEPTH", DEFAULT_DEPTH);
+    const char* scratch_dir = getenv("HEATSIM_OOC_DIR");
+    snprintf(config->scratch_dir, sizeof(config->scratch_dir), "%s",
+                                    scratch_dir != NULL ? scratch_dir : folder);
+}
+
+/**
+ * @brief Indica si una lámina se debe simular fuera de memoria.
+ *
+ * @param config Configuración fuera de memoria.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @return Verdadero si se debe simular fuera de memoria.
+ */
+bool out_of_core_needed(const ooc_config* config, uint64_t rows,
+                        uint64_t columns) {
+    if (config->forced) {
+        return true;
+    }
+    if (config->memory_limit == 0) {
+        return false;
+    }
+    // En memoria se usan la lámina leída y las dos matrices alternas. Las
+    // dimensiones vienen del archivo: si el producto desborda, no cabe
+    uint64_t bytes = 0;
+    return __builtin_mul_overflow(rows, columns, &bytes) ||
+           __builtin_mul_overflow(bytes, 3 * sizeof(double), &bytes) ||
+           bytes > config->memory_limit;
+}
+
+/**
+ * @brief Lee o escribe filas completas en una posición de un archivo.
+ *
+ * @param fd Descriptor del archivo.
+ * @param base Posición de la fila 0 en el archivo.
+ * @param first Primera fila a transferir.
+ * @param count Cantidad de filas a transferir.
+ * @param columns Número de columnas de la lámina.
+ * @param data Filas contiguas en memoria.
+ * @param write Verdadero para escribir, falso para leer.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+static int transfer_rows(int fd, off_t base, uint64_t first, uint64_t count,
+                         uint64_t columns, double* data, bool write) {
+    char* bytes = (char*)data;
+    size_t remaining = count * columns * sizeof(double);
+    off_t offset = base + (off_t)(first * columns * sizeof(double));
+    while (remaining > 0) {
+        const ssize_t done = write ? pwrite(fd, bytes, remaining, offset)
+                                   : pread(fd, bytes, remaining, offset);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return 1;
+        }
+        bytes += done;
+        remaining -= (size_t)done;
+        offset += done;
+    }
+    return 0;
+}
+
+/**
+ * @brief Avanza toda la lámina varios estados, banda por banda.
+ *
+ * @param plan Bandas y búferes de la simulación.
+ * @param source Archivo con el estado inicial de la pasada.
+ * @param source_base Posición de la fila 0 en `source`.
+ * @param target Archivo donde se escribe el estado final de la pasada.
+ * @param depth Estados que avanza la pasada, a lo sumo `plan->depth`.
+ * @param stable Arreglo de `depth` elementos; el elemento `s` queda en 1 si
+ * ninguna celda cambió más que epsilon en el estado `s` de la pasada.
+ * @return 0 si tuvo éxito, 1 si falló la lectura o la escritura.
+ */
+static int sweep(const stream_plan* plan, int source, off_t source_base,
+                 int target, uint64_t depth, int* stable) {
+    const uint64_t rows = plan->rows;
+    const uint64_t columns = plan->columns;
+    const size_t row_bytes = columns * sizeof(double);
+    double** window = plan->window;
+    for (uint64_t s = 0; s < depth; s++) {
+        stable[s] = 1;
+    }
+
+    // Filas de la lámina que hay en la ventana: [held_first, held_last)
+    uint64_t held_first = 0, held_last = 0;
+    for (uint64_t band = 0; band < rows; band += plan->band_rows) {
+        const uint64_t band_last = band + plan->band_rows < rows ?
+                                            band + plan->band_rows : rows;
+        const uint64_t first = band > depth ? band - depth : 0;
+        const uint64_t last = band_last + depth < rows ?
+                                            band_last + depth : rows;
+
+        // Deslizar la ventana: las filas que ya se leyeron pasan al inicio
+        uint64_t kept = 0;
+        if (held_last > first) {
+            kept = held_last - first;
+            memmove(window[0], window[first - held_first], kept * row_bytes);
+        }
+        if (transfer_rows(source, source_base, first + kept,
+                          last - first - kept, columns, window[kept], false)) {
+            return 1;
+        }
+        held_first = first;
+        held_last = last;
+        if (last < rows) {
+            // Pedir al sistema las filas de la siguiente banda por adelantado
+            posix_fadvise(source, source_base + (off_t)(last * row_bytes),
+                    (off_t)(plan->band_rows * row_bytes), POSIX_FADV_WILLNEED);
+        }
+
+        // Los bordes de la lámina no cambian; se copian a ambos estados
+        memcpy(plan->work[0][0], window[0], (last - first) * row_bytes);
+        memcpy(plan->work[1][0], window[0], (last - first) * row_bytes);
+
+        // Solo las filas propias de la banda cuentan para el equilibrio
+        const uint64_t owned_first = band > 1 ? band : 1;
+        const uint64_t owned_last = band_last < rows - 1 ? band_last : rows - 1;
+        for (uint64_t s = 0; s < depth; s++) {
+            double** current = s == 0 ? window : plan->work[(s - 1) % 2];
+            double** next = plan->work[s % 2];
+            // Cada estado pierde una fila válida de cada lado de la ventana
+            const uint64_t low = first == 0 ? 1 : first + s + 1;
+            const uint64_t high = last == rows ? rows - 1 : last - s - 1;
+            int band_stable = 1;
+            #pragma omp parallel for schedule(static) \
+                num_threads(plan->threads) reduction(&&: band_stable)
+            for (uint64_t i = low; i < high; i++) {
+                const int row_stable = heat_row(current, next, i - first, 1,
+                                   columns - 1, plan->coef, plan->epsilon);
+                if (i >= owned_first && i < owned_last) {
+                    band_stable = row_stable && band_stable;
+                }
+            }
+            stable[s] = stable[s] && band_stable;
+        }
+
+        double** result = plan->work[(depth - 1) % 2];
+        if (transfer_rows(target, 0, band, band_last - band, columns,
+                          result[band - first], true)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Crea un archivo temporal que se borra al cerrarlo.
+ *
+ * @param dir Carpeta del archivo temporal.
+ * @return Descriptor del archivo, o -1 si no se pudo crear.
+ */
+static int open_scratch(const char* dir) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/.heatsim-XXXXXX", dir);
+    const int fd = mkstemp(path);
+    if (fd >= 0) {
+        unlink(path);
+    }
+    return fd;
+}
+
+/**
+ * @brief Escribe el archivo binario final a partir de un estado en disco.
+ *
+ * @param plan Bandas y búferes de la simulación.
+ * @param source Archivo con el estado a escribir.
+ * @param source_base Posición de la fila 0 en `source`.
+ * @param format Versión y compresión del archivo binario.
+ * @param folder Carpeta donde se guarda el archivo binario.
+ * @param filename Nombre del archivo binario de la lámina.
+ * @param states_k Estados hasta alcanzar el punto de equilibrio.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+static int write_result(const stream_plan* plan, int source,
+                        off_t source_base, const plate_format* format,
+                        const char* folder, const char* filename,
+                        uint64_t states_k) {
+    char file_name[1024];
+    bin_file_name(file_name, sizeof(file_name), folder, filename, states_k);
+    plate_writer writer;
+    if (plate_writer_open(&writer, file_name, plan->rows, plan->columns,
+                                                                 format) != 0) {
+        return 1;
+    }
+
+    // Cada bloque del archivo pasa por la ventana
+    const uint64_t chunk_rows = plate_writer_chunk_rows(&writer);
+    int error = 0;
+    for (uint64_t chunk = 0; chunk < writer.chunk_count && !error; chunk++) {
+        const uint64_t first = chunk * chunk_rows;
+        const uint64_t count = first + chunk_rows < plan->rows ?
+                                               chunk_rows : plan->rows - first;
+        error = transfer_rows(source, source_base, first, count, plan->columns,
+                              plan->window[0], false) ||
+                plate_writer_chunk(&writer, chunk, plan->window);
+    }
+    if (plate_writer_close(&writer) != 0 || error) {
+        fprintf(stderr, "Error al escribir el archivo binario %s\n", file_name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copia una lámina versión 2 a un archivo temporal sin encabezado.
+ *
+ * @param plan Bandas y búferes de la simulación.
+ * @param reader Lector de la lámina.
+ * @param target Archivo temporal.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+static int unpack_input(const stream_plan* plan, const plate_reader* reader,
+                        int target) {
+    for (uint64_t chunk = 0; chunk < reader->chunk_count; chunk++) {
+        const uint64_t first = chunk * reader->chunk_rows;
+        const uint64_t count = first + reader->chunk_rows < plan->rows ?
+                                        reader->chunk_rows : plan->rows - first;
+        if (plate_reader_chunk(reader, chunk, plan->window) != 0 ||
+            transfer_rows(target, 0, first, count, plan->columns,
+                          plan->window[0], true) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Reparte la memoria disponible entre las filas de las bandas.
+ *
+ * @param config Configuración fuera de memoria.
+ * @param plan Plan donde se guardan las filas por banda y los estados por
+ * pasada.
+ */
+static void plan_bands(const ooc_config* config, stream_plan* plan) {
+    const uint64_t limit = config->memory_limit > 0 ? config->memory_limit
+                                                    : DEFAULT_MEMORY_LIMIT;
+    // La ventana y los dos estados alternos tienen las mismas filas
+    const uint64_t budget_rows = limit / (3 * plan->columns * sizeof(double));
+    uint64_t depth = config->depth;
+    // Con bandas angostas casi todo el trabajo sería recalcular vecinas
+    while (depth > 1 && budget_rows < 4 * depth) {
+        depth /= 2;
+    }
+    uint64_t band_rows = budget_rows > 2 * depth ? budget_rows - 2 * depth : 1;
+    plan->band_rows = band_rows < plan->rows ? band_rows : plan->rows;
+    plan->depth = depth;
+}
+
+/**
+ * @brief Simula una lámina sin cargarla completa en memoria.
+ *
+ * @param config Configuración fuera de memoria.
+ * @param input_path Ruta del archivo binario de la lámina.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param threads Hilos de OpenMP que calculan cada banda.
+ * @param arena Arena de donde se toman los búferes de las bandas.
+ * @param format Versión y compresión del archivo binario final.
+ * @param folder Carpeta donde se guarda el archivo binario final.
+ * @param filename Nombre del archivo binario de la lámina.
+ * @return Número de estados hasta alcanzar el punto de equilibrio, o 0 si
+ * hubo un error.
+ */
+uint64_t out_of_core_simulation(const ooc_config* config,
+                                const char* input_path,
+                                uint64_t rows,
+                                uint64_t columns,
+                                double coef,
+                                double epsilon,
+                                int threads,
+                                plate_arena* arena,
+                                const plate_format* format,
+                                const char* folder,
+                                const char* filename) {
+    stream_plan plan = {rows, columns, 0, 0, coef, epsilon, threads, NULL,
+                                                                {NULL, NULL}};
+    plan_bands(config, &plan);
+    printf("%s: fuera de memoria, bandas de %lu filas, %lu estados por "
+           "pasada\n", filename, plan.band_rows, plan.depth);
+
+    // Las ranuras de la arena no se usan en este modo; guardan las bandas
+    plate_reader reader;
+    if (plate_reader_open(&reader, input_path) != 0) {
+        return 0;
+    }
+    const uint64_t height = plan.band_rows + 2 * plan.depth;
+    // La ventana también recibe bloques completos del archivo de entrada y
+    // del archivo final
+    uint64_t window_rows = height > reader.chunk_rows ? height
+                                                      : reader.chunk_rows;
+    const uint64_t output_rows = plate_format_chunk_rows(format, columns);
+    window_rows = window_rows > output_rows ? window_rows : output_rows;
+    plan.window = plate_arena_acquire(arena, PLATE_SLOT_INPUT, window_rows,
+                                                                       columns);
+    plan.work[0] = plate_arena_acquire(arena, PLATE_SLOT_CURRENT, height,
+                                                                       columns);
+    plan.work[1] = plate_arena_acquire(arena, PLATE_SLOT_NEXT, height, columns);
+    int* stable = malloc(plan.depth * sizeof(int));
+    const int scratch[2] = {open_scratch(config->scratch_dir),
+                            open_scratch(config->scratch_dir)};
+    uint64_t states_k = 0;
+    if (plan.window == NULL || plan.work[0] == NULL || plan.work[1] == NULL ||
+        stable == NULL) {
+        fprintf(stderr, "Error al asignar memoria para las bandas.\n");
+    } else if (scratch[0] < 0 || scratch[1] < 0) {
+        fprintf(stderr, "No se pudieron crear los archivos temporales en %s\n",
+                                                          config->scratch_dir);
+    } else if (reader.version == 2 &&
+                                unpack_input(&plan, &reader, scratch[1]) != 0) {
+        fprintf(stderr, "Error al leer los datos de %s\n", filename);
+    } else {
+        /* La primera pasada lee directamente del archivo de la lámina si es
+        versión 1, o de su copia sin comprimir si es versión 2*/
+        int source = reader.version == 1 ? reader.fd : scratch[1];
+        off_t source_base = reader.version == 1 ? HEADER_BYTES : 0;
+        int target = scratch[0];
+        uint64_t states = 0;
+        while (states_k == 0) {
+            if (sweep(&plan, source, source_base, target, plan.depth,
+                                                                   stable)) {
+                fprintf(stderr, "Error de lectura o escritura en %s\n",
+                                                                     filename);
+                break;
+            }
+            uint64_t s = 0;
+            while (s < plan.depth && !stable[s]) {
+                s++;
+            }
+            if (s < plan.depth) {
+                /* Igual que en memoria, el archivo final tiene el estado
+                previo al que alcanzó el equilibrio; se repite la pasada hasta
+                ese estado*/
+                if (s > 0 && sweep(&plan, source, source_base, target, s,
+                                                                    stable)) {
+                    fprintf(stderr, "Error de lectura o escritura en %s\n",
+                                                                     filename);
+                    break;
+                }
+                if (s > 0) {
+                    source = target;
+                    source_base = 0;
+                }
+                if (write_result(&plan, source, source_base, format, folder,
+                                 filename, states + s + 1) == 0) {
+                    states_k = states + s + 1;
+                }
+                break;
+            }
+            states += plan.depth;
+            source = target;
+            source_base = 0;
+            target = target == scratch[0] ? scratch[1] : scratch[0];
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (scratch[i] >= 0) {
+            close(scratch[i]);
+        }
+    }
+    plate_reader_close(&reader);
+    free(stable);
+    return states_k;
+}
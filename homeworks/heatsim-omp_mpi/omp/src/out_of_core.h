@@ -0,0 +1,85 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "plate_arena.h"
+#include "plate_format.h"
+
+/**
+ * @brief Configuración de la simulación fuera de memoria.
+ *
+ * @details Se lee de las variables de ambiente `HEATSIM_OUT_OF_CORE`,
+ * `HEATSIM_MEMORY_LIMIT`, `HEATSIM_OOC_DEPTH` y `HEATSIM_OOC_DIR`.
+ */
+typedef struct {
+    bool forced;            /**< Simular siempre fuera de memoria. */
+    uint64_t memory_limit;  /**< Bytes disponibles para la lámina; 0 si no
+                                 hay límite. */
+    uint64_t depth;         /**< Estados que avanza cada banda por pasada. */
+    char scratch_dir[512];  /**< Carpeta de los archivos temporales. */
+} ooc_config;
+
+/**
+ * @brief Lee la configuración fuera de memoria de las variables de ambiente.
+ *
+ * @param config Configuración a inicializar.
+ * @param folder Carpeta del trabajo; se usa para los archivos temporales si
+ * no se indica `HEATSIM_OOC_DIR`.
+ */
+void out_of_core_init(ooc_config* config, const char* folder);
+
+/**
+ * @brief Indica si una lámina se debe simular fuera de memoria.
+ *
+ * @param config Configuración fuera de memoria.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @return Verdadero si se forzó el modo o si las tres matrices de la
+ * simulación en memoria no caben en `memory_limit`.
+ */
+bool out_of_core_needed(const ooc_config* config, uint64_t rows,
+                        uint64_t columns);
+
+/**
+ * @brief Simula una lámina sin cargarla completa en memoria.
+ *
+ * @details Los estados actual y siguiente viven en dos archivos temporales y
+ * la lámina se recorre en bandas de filas. Cada banda se lee con `depth` filas
+ * vecinas de cada lado y avanza `depth` estados seguidos en memoria antes de
+ * escribirse, de modo que cada pasada por disco cuenta como varios estados.
+ * Las filas vecinas se recalculan en las dos bandas que las comparten, y la
+ * ventana se desliza: las filas que comparten dos bandas seguidas no se leen
+ * dos veces. El equilibrio se verifica estado por estado, así que los estados
+ * y el archivo final son idénticos a los de la simulación en memoria.
+ *
+ * @param config Configuración fuera de memoria.
+ * @param input_path Ruta del archivo binario de la lámina, versión 1 o 2.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param threads Hilos de OpenMP que calculan cada banda.
+ * @param arena Arena de donde se toman los búferes de las bandas. Debe tener
+ * al menos tres ranuras.
+ * @param format Versión y compresión del archivo binario final.
+ * @param folder Carpeta donde se guarda el archivo binario final.
+ * @param filename Nombre del archivo binario de la lámina.
+ * @return Número de estados hasta alcanzar el punto de equilibrio, o 0 si
+ * hubo un error.
+ */
+uint64_t out_of_core_simulation(const ooc_config* config,
+                                const char* input_path,
+                                uint64_t rows,
+                                uint64_t columns,
+                                double coef,
+                                double epsilon,
+                                int threads,
+                                plate_arena* arena,
+                                const plate_format* format,
+                                const char* folder,
+                                const char* filename);
+
+#endif  // OUT_OF_CORE_H
@@ -0,0 +1 @@
+../../../heatsim-pthread/src/plate_arena.c
\ No newline at end of file
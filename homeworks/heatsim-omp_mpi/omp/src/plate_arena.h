@@ -0,0 +1 @@
+../../../heatsim-pthread/src/plate_arena.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../heatsim-pthread/src/plate_format.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../../heatsim-pthread/src/plate_format.h
\ No newline at end of file
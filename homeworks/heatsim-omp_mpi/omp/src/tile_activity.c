@@ -0,0 +1,62 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tile_activity.h"
+
+/**
+ * @brief Crea el mapa con todos los bloques activos.
+ *
+ * @param activity Mapa a inicializar.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param tile_rows Filas por bloque.
+ * @param tile_columns Columnas por bloque.
+ * @return 0 si tuvo éxito, 1 si no hay memoria.
+ */
+int tile_activity_init(tile_activity* activity, uint64_t rows,
+                       uint64_t columns, uint64_t tile_rows,
+                       uint64_t tile_columns) {
+    memset(activity, 0, sizeof(tile_activity));
+    if (rows < 3 || columns < 3 || tile_rows == 0 || tile_columns == 0) {
+        return 1;
+    }
+    activity->tile_rows = tile_rows;
+    activity->tile_columns = tile_columns;
+    activity->row_tiles = (rows - 2 + tile_rows - 1) / tile_rows;
+    activity->column_tiles = (columns - 2 + tile_columns - 1) / tile_columns;
+
+    const uint64_t tiles = activity->row_tiles * activity->column_tiles;
+    activity->changed = malloc(tiles);
+    activity->next_changed = malloc(tiles);
+    if (activity->changed == NULL || activity->next_changed == NULL) {
+        tile_activity_destroy(activity);
+        return 1;
+    }
+    // Antes del primer estado no se sabe nada: todos los bloques cambiaron
+    memset(activity->changed, 1, tiles);
+    memset(activity->next_changed, 1, tiles);
+    return 0;
+}
+
+/**
+ * @brief Pasa al siguiente estado: lo que cambió ahora es el estado anterior.
+ *
+ * @param activity Mapa de actividad.
+ */
+void tile_activity_advance(tile_activity* activity) {
+    uint8_t* swap = activity->changed;
+    activity->changed = activity->next_changed;
+    activity->next_changed = swap;
+}
+
+/**
+ * @brief Libera la memoria del mapa.
+ *
+ * @param activity Mapa a destruir.
+ */
+void tile_activity_destroy(tile_activity* activity) {
+    free(activity->changed);
+    free(activity->next_changed);
+    activity->changed = activity->next_changed = NULL;
+}
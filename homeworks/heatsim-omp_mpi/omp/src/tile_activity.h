@@ -0,0 +1,78 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef TILE_ACTIVITY_H
+#define TILE_ACTIVITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Mapa de actividad de los bloques de una lámina.
+ *
+ * @details Cada estado marca los bloques en los que alguna celda cambió, bit
+ * a bit, entre el estado actual y el siguiente. Un bloque cuyas celdas y
+ * cuyos cuatro vecinos no cambiaron en el estado anterior recibe exactamente
+ * los mismos datos que en ese estado, así que su resultado también es el
+ * mismo: no cambia y no hace falta calcularlo.
+ */
+typedef struct {
+    uint64_t tile_rows;       /**< Filas por bloque. */
+    uint64_t tile_columns;    /**< Columnas por bloque. */
+    uint64_t row_tiles;       /**< Bloques a lo alto de la lámina. */
+    uint64_t column_tiles;    /**< Bloques a lo ancho de la lámina. */
+    uint8_t* changed;         /**< Bloques que cambiaron en el estado
+                                   anterior. */
+    uint8_t* next_changed;    /**< Bloques que cambian en el estado en
+                                   curso. */
+    uint64_t updated;         /**< Bloques calculados hasta ahora. */
+    uint64_t skipped;         /**< Bloques saltados hasta ahora. */
+} tile_activity;
+
+/**
+ * @brief Crea el mapa con todos los bloques activos.
+ *
+ * @param activity Mapa a inicializar.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param tile_rows Filas por bloque.
+ * @param tile_columns Columnas por bloque.
+ * @return 0 si tuvo éxito, 1 si no hay memoria.
+ */
+int tile_activity_init(tile_activity* activity, uint64_t rows,
+                       uint64_t columns, uint64_t tile_rows,
+                       uint64_t tile_columns);
+
+/**
+ * @brief Indica si un bloque se puede saltar en el estado en curso.
+ *
+ * @param activity Mapa de actividad.
+ * @param ti Fila del bloque.
+ * @param tj Columna del bloque.
+ * @return Verdadero si ni el bloque ni sus cuatro vecinos cambiaron en el
+ * estado anterior.
+ */
+static inline bool tile_activity_idle(const tile_activity* activity,
+                                      uint64_t ti, uint64_t tj) {
+    const uint64_t width = activity->column_tiles;
+    const uint8_t* changed = activity->changed + ti * width;
+    return !changed[tj] &&
+           (tj == 0 || !changed[tj - 1]) &&
+           (tj + 1 == width || !changed[tj + 1]) &&
+           (ti == 0 || !changed[tj - width]) &&
+           (ti + 1 == activity->row_tiles || !changed[tj + width]);
+}
+
+/**
+ * @brief Pasa al siguiente estado: lo que cambió ahora es el estado anterior.
+ *
+ * @param activity Mapa de actividad.
+ */
+void tile_activity_advance(tile_activity* activity);
+
+/**
+ * @brief Libera la memoria del mapa.
+ *
+ * @param activity Mapa a destruir.
+ */
+void tile_activity_destroy(tile_activity* activity);
+
+#endif  // TILE_ACTIVITY_H
@@ -1,8 +1,9 @@
 //  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#define _XOPEN_SOURCE 600
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>  // Para la función gmtime
+#include <time.h>  // Para la función gmtime_r
 
 #include "heat_simulation.h"
 
@@ -13,9 +14,11 @@
  * @param jobName Nombre del archivo de trabajo.
  * @param variables Arreglo de estructuras `params_matrix` que contiene los parámetros de la simulación.
  * @param states_k Arreglo que contiene los estados finales de cada simulación.
+ * Las láminas con 0 estados no se pudieron simular y se omiten.
  * @param lines Número de líneas (simulaciones) en el archivo de trabajo.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el reporte.
  */
-void generate_report_file(const char* folder,
+int generate_report_file(const char* folder,
                         const char* jobName,
                         params_matrix* variables,
                         uint64_t* states_k,
@@ -36,10 +39,14 @@ void generate_report_file(const char* folder,
     if (report_file == NULL) {
         fprintf(stderr, "No se pudo crear el archivo de reporte %s\n",
                 report_name);
-        return;
+        return 1;
     }
 
     for (uint64_t i = 0; i < lines; i++) {
+        // Toda lámina simulada tiene al menos un estado
+        if (states_k[i] == 0) {
+            continue;
+        }
         time_t tiempo_transcurrido = states_k[i] * variables[i].delta_t;
         format_time(tiempo_transcurrido, formatted_time,
                     sizeof(formatted_time));
@@ -53,7 +60,93 @@ void generate_report_file(const char* folder,
                 formatted_time);
     }
 
-    fclose(report_file);
+    // Un disco lleno se detecta al vaciar el búfer
+    const int error = ferror(report_file);
+    if (fclose(report_file) != 0 || error) {
+        fprintf(stderr, "No se pudo escribir el archivo de reporte %s\n",
+                report_name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Genera el archivo de mediciones (.profile.tsv) junto al reporte.
+ *
+ * @param folder Carpeta donde se guardará el archivo.
+ * @param jobName Nombre del archivo de trabajo.
+ * @param variables Arreglo de estructuras `params_matrix` que contiene los parámetros de la simulación.
+ * @param profile Mediciones del trabajo.
+ */
+void generate_profile_file(const char* folder,
+                           const char* jobName,
+                           params_matrix* variables,
+                           const heat_profile* profile) {
+    static const char* const phase_names[PHASE_COUNT] = {
+        "read", "stencil", "convergence", "copy", "sync", "write"
+    };
+    char profile_name[1024];
+    char jobName_no_txt[512];
+
+    strncpy(jobName_no_txt, jobName, sizeof(jobName_no_txt) - 1);
+    jobName_no_txt[sizeof(jobName_no_txt) - 1] = '\0';
+    char* position = strstr(jobName_no_txt, ".txt");
+    if (position) {
+        *position = '\0';
+    }
+    snprintf(profile_name, sizeof(profile_name), "%s/%s.profile.tsv",
+            folder, jobName_no_txt);
+    FILE* profile_file = fopen(profile_name, "w");
+    if (profile_file == NULL) {
+        fprintf(stderr, "No se pudo crear el archivo de mediciones %s\n",
+                profile_name);
+        return;
+    }
+
+    // Encabezado: ciclos y segundos de cada fase
+    const double ticks_per_second = heat_profile_ticks_per_second(profile);
+    fprintf(profile_file, "plate\trows\tcolumns\tstates\tsteps_per_s");
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        fprintf(profile_file, "\t%s_cycles", phase_names[phase]);
+    }
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        fprintf(profile_file, "\t%s_s", phase_names[phase]);
+    }
+    fprintf(profile_file, "\tthread_wait_s\n");
+
+    for (uint64_t i = 0; i < profile->lines; i++) {
+        const plate_profile* plate = &profile->plates[i];
+        // Las láminas que fallaron no tienen estados; se omiten como en el
+        // reporte para no confundirlas con láminas de medición nula
+        if (plate->states == 0) {
+            continue;
+        }
+        // Los estados por segundo solo cuentan el tiempo de simulación
+        const uint64_t simulation_ticks = plate->phase_ticks[PHASE_STENCIL] +
+                                      plate->phase_ticks[PHASE_CONVERGENCE] +
+                                      plate->phase_ticks[PHASE_COPY] +
+                                      plate->phase_ticks[PHASE_SYNC];
+        const double steps_per_second = simulation_ticks > 0 ?
+            plate->states * ticks_per_second / simulation_ticks : 0.0;
+
+        fprintf(profile_file, "%s\t%lu\t%lu\t%lu\t%.3lf",
+                variables[i].filename, plate->rows, plate->columns,
+                plate->states, steps_per_second);
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            fprintf(profile_file, "\t%lu", plate->phase_ticks[phase]);
+        }
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            fprintf(profile_file, "\t%.9lf",
+                    plate->phase_ticks[phase] / ticks_per_second);
+        }
+        for (int t = 0; t < profile->num_threads; t++) {
+            fprintf(profile_file, "%c%.9lf", t == 0 ? '\t' : ',',
+                    plate->wait_ticks[t] / ticks_per_second);
+        }
+        fprintf(profile_file, "\n");
+    }
+
+    fclose(profile_file);
 }
 
 /**
@@ -65,13 +158,16 @@ void generate_report_file(const char* folder,
  * @param folder Carpeta donde se guardará el archivo binario.
  * @param jobName Nombre del archivo de trabajo.
  * @param states_k Estado final alcanzado en la simulación.
+ * @param format Versión y compresión del archivo.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el archivo.
  */
-void generate_bin_file(double** matrix,
+int generate_bin_file(double** matrix,
                         uint64_t rows,
                         uint64_t columns,
                         const char* folder,
                         const char* jobName,
-                        uint64_t states_k) {
+                        uint64_t states_k,
+                        const plate_format* format) {
     char file_name[1024];
     char base_name[512];
     strncpy(base_name, jobName, sizeof(base_name) - 1);
@@ -83,18 +179,7 @@ void generate_bin_file(double** matrix,
 
     snprintf(file_name, sizeof(file_name), "%s/%s-%lu.bin",
             folder, base_name, states_k);
-    FILE* output_file = fopen(file_name, "wb");
-    if (output_file == NULL) {
-        fprintf(stderr, "No se pudo crear el archivo binario %s\n", file_name);
-        return;
-    }
-
-    fwrite(&rows, sizeof(uint64_t), 1, output_file);
-    fwrite(&columns, sizeof(uint64_t), 1, output_file);
-    for (uint64_t i = 0; i < rows; i++) {
-        fwrite(matrix[i], sizeof(double), columns, output_file);
-    }
-    fclose(output_file);
+    return plate_write(file_name, matrix, rows, columns, format);
 }
 
 /**
@@ -107,12 +192,14 @@ void generate_bin_file(double** matrix,
  * @return Un puntero al buffer `text` que contiene el tiempo formateado.
  */
 char* format_time(const time_t seconds, char* text, const size_t capacity) {
-    const struct tm* gmt = gmtime(&seconds);//NOLINT
+    // gmtime_r porque el servidor web escribe reportes desde varios hilos
+    struct tm gmt;
+    gmtime_r(&seconds, &gmt);
     snprintf(text, capacity,
             "%04d/%02d/%02d\t%02d:%02d:%02d",
-            gmt->tm_year + 1900,
-             gmt->tm_mon + 1, gmt->tm_mday,
-             gmt->tm_hour, gmt->tm_min,
-             gmt->tm_sec);
+            gmt.tm_year + 1900,
+             gmt.tm_mon + 1, gmt.tm_mday,
+             gmt.tm_hour, gmt.tm_min,
+             gmt.tm_sec);
     return text;
 }
@@ -0,0 +1,276 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "heat_estimate.h"
+
+/// Estados que se simulan por defecto para hacer la predicción
+#define ESTIMATE_STATES 300
+/// Mínimo de estados por lámina aunque la lámina sea enorme
+#define ESTIMATE_MIN_STATES 16
+/// Celdas actualizadas como máximo al muestrear una lámina
+#define ESTIMATE_CELL_BUDGET 50000000ULL
+
+/**
+ * @brief Calcula el factor por estado del modo más lento de la lámina.
+ *
+ * @details Con los bordes fijos, la diferencia entre dos estados seguidos es
+ * una suma de modos `sin(p*pi*i/(rows-1)) * sin(q*pi*j/(columns-1))`. Si cada
+ * estado se calculara del anterior completo, multiplicaría el modo (p, q) por
+ * `1 - w + w*mu`, con `w = 4*coef` y
+ * `mu = 1 - sin²(p*pi/(2*(rows-1))) - sin²(q*pi/(2*(columns-1)))`. Pero los
+ * hilos actualizan sus filas en el lugar, en orden, como una sobrerrelajación
+ * (SOR) con factor `w`. Para ese orden el factor `l` de cada modo cumple
+ * `(l + w - 1)² = l * w² * mu²`, y el más lento es el del modo (1, 1). Las
+ * filas de borde de cada hilo usan el estado anterior, así que con varios
+ * hilos el factor real está entre ambos; si el medido es mayor, se usa ese.
+ *
+ * @param coef Coeficiente `delta_t * alpha / h^2`.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @return Mayor valor absoluto de los factores de los modos.
+ */
+static double slowest_rate(double coef, uint64_t rows, uint64_t columns) {
+    const double angle_rows = acos(-1.0) / (2.0 * (rows - 1));
+    const double angle_columns = acos(-1.0) / (2.0 * (columns - 1));
+    const double mu = 1.0 - sin(angle_rows) * sin(angle_rows) -
+                      sin(angle_columns) * sin(angle_columns);
+    const double w = 4.0 * coef;
+    const double discriminant = w * w * mu * mu - 4.0 * (w - 1.0);
+    if (discriminant < 0.0) {
+        return fabs(w - 1.0);  // Factores complejos, todos de igual módulo
+    }
+    const double root = (fabs(w * mu) + sqrt(discriminant)) / 2.0;
+    return root * root;
+}
+
+/**
+ * @brief Cuenta los estados hasta que el máximo cambio baje de epsilon.
+ *
+ * @details El factor empieza en `rate` y la distancia al factor `asymptotic`
+ * se multiplica por `relax` en cada estado.
+ *
+ * @param change Máximo cambio del último estado muestreado.
+ * @param rate Factor medido al final de la muestra.
+ * @param asymptotic Factor del modo más lento.
+ * @param relax Cuánto se acerca el factor al asintótico en cada estado.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @return Estados adicionales, o `HEAT_ESTIMATE_NEVER`.
+ */
+static uint64_t extrapolate(double change, double rate, double asymptotic,
+                            double relax, double epsilon) {
+    if (rate >= asymptotic) {
+        // El factor medido ya es el del final (o lo supera por redondeo)
+        asymptotic = rate;
+    }
+    if (asymptotic >= 1.0) {
+        return HEAT_ESTIMATE_NEVER;
+    }
+    const double target = log(epsilon);
+    double log_change = log(change);
+    double gap = asymptotic - rate;
+    uint64_t states = 0;
+
+    // Estado por estado mientras el factor siga cambiando
+    while (log_change >= target && gap > 1e-9 * (1.0 - asymptotic)) {
+        gap *= relax;
+        log_change += log(asymptotic - gap);
+        states++;
+    }
+    // Luego el factor es constante y se despeja la cantidad de estados
+    if (log_change >= target) {
+        const double remaining = (target - log_change) / log(asymptotic);
+        if (remaining >= (double)(HEAT_ESTIMATE_NEVER - states - 1)) {
+            return HEAT_ESTIMATE_NEVER;
+        }
+        states += (uint64_t)floor(remaining) + 1;
+    }
+    return states;
+}
+
+/**
+ * @brief Predice cuántos estados tarda una lámina en alcanzar el equilibrio.
+ *
+ * @param matrix Lámina con los datos iniciales; no se modifica.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param delta_t Diferencial de tiempo.
+ * @param alpha Difusividad térmica.
+ * @param h Tamaño de las celdas.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param samples Estados a simular; 0 para el valor por defecto.
+ * @param num_threads Hilos con que se simula la muestra.
+ * @param arena Arena de donde se toman las matrices de la muestra.
+ * @param estimate Predicción resultante.
+ * @return 0 si tuvo éxito, 1 si no hay memoria.
+ */
+int heat_estimate_states(double** matrix,
+                         uint64_t rows,
+                         uint64_t columns,
+                         double delta_t,
+                         double alpha,
+                         double h,
+                         double epsilon,
+                         uint64_t samples,
+                         int num_threads,
+                         plate_arena* arena,
+                         heat_estimate* estimate) {
+    const double coef = alpha * delta_t / (h * h);
+    estimate->states = HEAT_ESTIMATE_NEVER;
+    estimate->sampled = 0;
+    estimate->exact = false;
+    estimate->measured_rate = 1.0;
+    estimate->asymptotic_rate = rows > 2 && columns > 2 ?
+                                slowest_rate(coef, rows, columns) : 0.0;
+    estimate->seconds_per_state = 0.0;
+    if (!(epsilon > 0.0)) {
+        return 0;  // Ningún cambio es menor que epsilon
+    }
+
+    // Menos estados en láminas enormes para que la predicción sea barata
+    if (samples == 0) {
+        const uint64_t cells = rows > 2 && columns > 2 ?
+                               (rows - 2) * (columns - 2) : 1;
+        samples = ESTIMATE_CELL_BUDGET / cells;
+        samples = samples > ESTIMATE_STATES ? ESTIMATE_STATES : samples;
+    }
+    // Los factores se miden en cuartos de la muestra
+    samples = samples < ESTIMATE_MIN_STATES ? ESTIMATE_MIN_STATES : samples;
+
+    /* La muestra se toma del mismo cálculo que la simulación, que actualiza
+    las celdas en el lugar y cuyo resultado depende de los hilos */
+    double** sample = plate_arena_acquire(arena,
+                                          PLATE_SLOT_THREADS + num_threads,
+                                          rows, columns);
+    double* changes = malloc(samples * sizeof(double));
+    if (sample == NULL || changes == NULL) {
+        free(changes);
+        return 1;
+    }
+    copy_matrix(sample, matrix, rows, columns);
+
+    // Simular la muestra y guardar el máximo cambio de cada estado
+    struct timespec start_time, finish_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    bool balance_point = false;
+    const uint64_t k = heat_transfer_sample(sample, rows, columns, delta_t,
+                                            alpha, h, epsilon, num_threads,
+                                            arena, NULL, samples, changes,
+                                            &balance_point);
+    clock_gettime(CLOCK_MONOTONIC, &finish_time);
+    if (!balance_point && k < samples) {
+        free(changes);
+        return 1;  // La simulación no obtuvo sus matrices de la arena
+    }
+    if (balance_point) {
+        estimate->states = k;
+        estimate->exact = true;
+    }
+    estimate->sampled = k;
+    estimate->seconds_per_state = ((finish_time.tv_sec - start_time.tv_sec) +
+                   (finish_time.tv_nsec - start_time.tv_nsec) * 1e-9) / k;
+
+    if (!estimate->exact) {
+        /* Factores por estado en el segundo y el último cuarto de la
+        muestra; sus centros están a `samples / 2` estados */
+        const uint64_t quarter = samples / 4;
+        const uint64_t half = samples / 2;
+        const double early = pow(changes[half - 1] / changes[quarter - 1],
+                                 1.0 / (half - quarter));
+        const double late = pow(changes[samples - 1] /
+                                changes[samples - 1 - quarter], 1.0 / quarter);
+        const double asymptotic = estimate->asymptotic_rate;
+        double relax = 0.0;
+        if (early < late && late < asymptotic) {
+            relax = pow((asymptotic - late) / (asymptotic - early),
+                        1.0 / half);
+        }
+        estimate->measured_rate = late;
+        const uint64_t more = extrapolate(changes[samples - 1], late,
+                                          asymptotic, relax, epsilon);
+        if (more != HEAT_ESTIMATE_NEVER) {
+            estimate->states = samples + more;
+        }
+    }
+    free(changes);
+    return 0;
+}
+
+/**
+ * @brief Imprime la predicción de cada lámina de un trabajo sin simularlo.
+ *
+ * @param folder Carpeta donde se encuentran los archivos binarios.
+ * @param variables Parámetros de cada lámina del trabajo.
+ * @param lines Número de láminas del trabajo.
+ * @param num_threads Hilos para leer los archivos binarios y simular.
+ * @return 0 si se predijeron todas las láminas, 1 si alguna falló.
+ */
+int estimate_job(const char* folder,
+                  params_matrix* variables,
+                  uint64_t lines,
+                  int num_threads) {
+    char direction[512];
+    char formatted_time[48];
+    plate_arena arena;
+    if (plate_arena_init(&arena, PLATE_SLOT_THREADS + num_threads + 1,
+                         false) != 0) {
+        fprintf(stderr, "Error al asignar memoria para la arena.\n");
+        return 1;
+    }
+
+    int error = 0;
+    printf("# lámina\tepsilon\testados\tpredicción\ttiempo"
+           "\tsegundos\n");
+    for (uint64_t i = 0; i < lines; i++) {
+        snprintf(direction, sizeof(direction),
+                                        "%s/%s", folder, variables[i].filename);
+        plate_reader reader;
+        if (plate_reader_open(&reader, direction) != 0) {
+            fprintf(stderr, "No se pudo estimar la lámina %s\n", direction);
+            error = 1;
+            continue;
+        }
+        const uint64_t rows = reader.rows;
+        const uint64_t columns = reader.columns;
+        double** matrix = plate_arena_acquire(&arena, PLATE_SLOT_INPUT, rows,
+                                                                      columns);
+        if (matrix == NULL) {
+            fprintf(stderr, "Error al asignar memoria para la matriz\n");
+            plate_reader_close(&reader);
+            error = 1;
+            continue;
+        }
+        const int read_error = plate_reader_read(&reader, matrix, num_threads);
+        plate_reader_close(&reader);
+        if (read_error) {
+            fprintf(stderr, "No se pudo estimar la lámina %s\n", direction);
+            error = 1;
+            continue;
+        }
+
+        heat_estimate estimate;
+        if (heat_estimate_states(matrix, rows, columns, variables[i].delta_t,
+                                 variables[i].alpha, variables[i].h,
+                                 variables[i].epsilon, 0, num_threads,
+                                 &arena, &estimate) != 0) {
+            fprintf(stderr, "Error al asignar memoria para la predicción\n");
+            error = 1;
+            continue;
+        }
+        if (estimate.states == HEAT_ESTIMATE_NEVER) {
+            printf("%s\t%lg\tnunca\t-\t-\t-\n", variables[i].filename,
+                   variables[i].epsilon);
+            continue;
+        }
+        format_time((time_t)(estimate.states * variables[i].delta_t),
+                    formatted_time, sizeof(formatted_time));
+        printf("%s\t%lg\t%lu\t%s\t%s\t%.6lf\n", variables[i].filename,
+               variables[i].epsilon, estimate.states,
+               estimate.exact ? "exacta" : "estimada", formatted_time,
+               estimate.states * estimate.seconds_per_state);
+    }
+    plate_arena_destroy(&arena);
+    return error;
+}
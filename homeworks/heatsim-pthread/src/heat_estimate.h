@@ -0,0 +1,89 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef HEAT_ESTIMATE_H
+#define HEAT_ESTIMATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "heat_simulation.h"
+
+/// Estados predichos para una lámina que nunca alcanza el equilibrio
+#define HEAT_ESTIMATE_NEVER UINT64_MAX
+
+/**
+ * @brief Predicción de los estados que tarda una lámina en equilibrarse.
+ */
+typedef struct {
+    uint64_t states;          /**< Estados predichos hasta el equilibrio, o
+                                   `HEAT_ESTIMATE_NEVER`. */
+    uint64_t sampled;         /**< Estados simulados para hacer la
+                                   predicción. */
+    bool exact;               /**< El equilibrio se alcanzó al muestrear, así
+                                   que `states` es exacto. */
+    double measured_rate;     /**< Factor por estado con que bajaba el máximo
+                                   cambio al final de la muestra. */
+    double asymptotic_rate;   /**< Factor por estado del modo más lento de la
+                                   lámina. */
+    double seconds_per_state; /**< Segundos por estado medidos con los hilos
+                                   de la muestra. */
+} heat_estimate;
+
+/**
+ * @brief Predice cuántos estados tarda una lámina en alcanzar el equilibrio.
+ *
+ * @details Simula los primeros estados con `heat_transfer_sample`, el mismo
+ * cálculo y la misma condición de equilibrio de la simulación, y guarda el
+ * máximo cambio |Δ| de cada uno. Como los hilos actualizan las celdas en el
+ * lugar, los estados dependen de `num_threads`. Si el equilibrio llega
+ * durante la muestra, la predicción es exacta.
+ * Si no, el máximo cambio se extrapola: al inicio baja con el factor medido
+ * al final de la muestra, y ese factor se acerca geométricamente al del modo
+ * más lento de la lámina, que es el que domina al final.
+ *
+ * @param matrix Lámina con los datos iniciales; no se modifica.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param delta_t Diferencial de tiempo.
+ * @param alpha Difusividad térmica.
+ * @param h Tamaño de las celdas.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param samples Estados a simular; 0 para unos cientos, menos en láminas
+ * enormes.
+ * @param num_threads Hilos con que se simula la muestra.
+ * @param arena Arena de donde se toman las matrices de la muestra. Debe tener
+ * al menos `PLATE_SLOT_THREADS + num_threads + 1` ranuras.
+ * @param estimate Predicción resultante.
+ * @return 0 si tuvo éxito, 1 si no hay memoria.
+ */
+int heat_estimate_states(double** matrix,
+                         uint64_t rows,
+                         uint64_t columns,
+                         double delta_t,
+                         double alpha,
+                         double h,
+                         double epsilon,
+                         uint64_t samples,
+                         int num_threads,
+                         plate_arena* arena,
+                         heat_estimate* estimate);
+
+/**
+ * @brief Imprime la predicción de cada lámina de un trabajo sin simularlo.
+ *
+ * @details Imprime una línea por lámina con los estados predichos, si son
+ * exactos, el tiempo simulado y los segundos que tardaría con `num_threads`
+ * hilos.
+ *
+ * @param folder Carpeta donde se encuentran los archivos binarios.
+ * @param variables Parámetros de cada lámina del trabajo.
+ * @param lines Número de láminas del trabajo.
+ * @param num_threads Hilos para leer los archivos binarios y simular.
+ * @return 0 si se predijeron todas las láminas, 1 si alguna no se pudo leer
+ * o predecir; esas láminas se informan en la salida de error y se omiten.
+ */
+int estimate_job(const char* folder,
+                  params_matrix* variables,
+                  uint64_t lines,
+                  int num_threads);
+
+#endif  // HEAT_ESTIMATE_H
@@ -0,0 +1,121 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heat_profile.h"
+
+/**
+ * @brief Prepara las mediciones de un trabajo si `HEATSIM_PROFILE=1`.
+ *
+ * @param profile Mediciones a inicializar.
+ * @param lines Cantidad de láminas del trabajo.
+ * @param num_threads Hilos usados en la simulación.
+ * @return `profile` si se debe medir, o NULL en caso contrario.
+ */
+heat_profile* heat_profile_init(heat_profile* profile, uint64_t lines,
+                                int num_threads) {
+    memset(profile, 0, sizeof(heat_profile));
+#ifndef HEATSIM_NO_PROFILING
+    const char* enabled = getenv("HEATSIM_PROFILE");
+    if (enabled == NULL || atoi(enabled) != 1) {
+        return NULL;
+    }
+
+    profile->plates = calloc(lines, sizeof(plate_profile));
+    // Un solo bloque con los contadores de espera de todas las láminas
+    uint64_t* waits = calloc(lines * num_threads, sizeof(uint64_t));
+    if (profile->plates == NULL || waits == NULL) {
+        fprintf(stderr, "Error al asignar memoria para las mediciones.\n");
+        free(profile->plates);
+        free(waits);
+        profile->plates = NULL;
+        return NULL;
+    }
+    for (uint64_t i = 0; i < lines; i++) {
+        profile->plates[i].wait_ticks = waits + i * num_threads;
+    }
+
+    profile->lines = lines;
+    profile->num_threads = num_threads;
+    clock_gettime(CLOCK_MONOTONIC, &profile->start_time);
+    profile->start_ticks = heat_profile_ticks();
+    return profile;
+#else
+    (void)lines;
+    (void)num_threads;
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Indica que inicia la medición de una lámina.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param line Línea del trabajo que corresponde a la lámina.
+ */
+void heat_profile_begin_plate(heat_profile* profile, uint64_t line) {
+    if (profile != NULL && line < profile->lines) {
+        profile->current = &profile->plates[line];
+    }
+}
+
+/**
+ * @brief Registra el tamaño y los estados de la lámina en curso.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param states Estados hasta el equilibrio.
+ */
+void heat_profile_end_plate(heat_profile* profile, uint64_t rows,
+                            uint64_t columns, uint64_t states) {
+    if (profile != NULL && profile->current != NULL) {
+        profile->current->rows = rows;
+        profile->current->columns = columns;
+        profile->current->states = states;
+    }
+}
+
+/**
+ * @brief Suma los ciclos que un hilo esperó a que terminaran los demás.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param thread Número del hilo.
+ * @param ticks Ciclos de espera.
+ */
+void heat_profile_add_wait(heat_profile* profile, int thread, uint64_t ticks) {
+    if (profile != NULL && profile->current != NULL &&
+                                                thread < profile->num_threads) {
+        profile->current->wait_ticks[thread] += ticks;
+    }
+}
+
+/**
+ * @brief Calcula cuántos ciclos del contador equivalen a un segundo.
+ *
+ * @param profile Mediciones del trabajo.
+ * @return Ciclos por segundo.
+ */
+double heat_profile_ticks_per_second(const heat_profile* profile) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const uint64_t ticks = heat_profile_ticks() - profile->start_ticks;
+    const double seconds = (now.tv_sec - profile->start_time.tv_sec) +
+                           (now.tv_nsec - profile->start_time.tv_nsec) * 1e-9;
+    return seconds > 0 ? ticks / seconds : 1.0;
+}
+
+/**
+ * @brief Libera la memoria de las mediciones.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ */
+void heat_profile_destroy(heat_profile* profile) {
+    if (profile != NULL && profile->plates != NULL && profile->lines > 0) {
+        free(profile->plates[0].wait_ticks);
+        free(profile->plates);
+        profile->plates = NULL;
+        profile->current = NULL;
+    }
+}
@@ -0,0 +1,179 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef HEAT_PROFILE_H
+#define HEAT_PROFILE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if !defined(HEATSIM_NO_PROFILING) && (defined(__x86_64__) || \
+                                       defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+/**
+ * @brief Fases de la simulación que se miden por separado.
+ */
+typedef enum {
+    PHASE_READ,         /**< Lectura del archivo binario. */
+    PHASE_STENCIL,      /**< Cálculo de las nuevas temperaturas. */
+    PHASE_CONVERGENCE,  /**< Verificación del punto de equilibrio. */
+    PHASE_COPY,         /**< Copias entre matrices globales y locales. */
+    PHASE_SYNC,         /**< Creación y espera de los hilos. */
+    PHASE_WRITE,        /**< Escritura del archivo binario final. */
+    PHASE_COUNT         /**< Cantidad de fases. */
+} profile_phase;
+
+/**
+ * @brief Mediciones de una lámina del trabajo.
+ */
+typedef struct {
+    uint64_t phase_ticks[PHASE_COUNT];  /**< Ciclos acumulados por fase. */
+    uint64_t* wait_ticks;   /**< Ciclos de espera en la unión, por hilo. */
+    uint64_t rows;          /**< Número de filas de la lámina. */
+    uint64_t columns;       /**< Número de columnas de la lámina. */
+    uint64_t states;        /**< Estados hasta el equilibrio. */
+} plate_profile;
+
+/**
+ * @brief Mediciones de un trabajo completo.
+ *
+ * @details Pertenece a una única llamada de `read_bin_plate`; no hay estado
+ * global, de modo que dos trabajos no mezclan sus mediciones.
+ */
+typedef struct {
+    plate_profile* plates;      /**< Una medición por línea del trabajo. */
+    plate_profile* current;     /**< Lámina que se está simulando. */
+    uint64_t lines;             /**< Cantidad de láminas del trabajo. */
+    int num_threads;            /**< Hilos usados en la simulación. */
+    uint64_t start_ticks;       /**< Contador al iniciar el trabajo. */
+    struct timespec start_time; /**< Reloj al iniciar el trabajo. */
+} heat_profile;
+
+#ifndef HEATSIM_NO_PROFILING
+/**
+ * @brief Lee el contador de ciclos del procesador.
+ *
+ * @details En x86 usa la instrucción rdtsc; en otras arquitecturas usa
+ * nanosegundos del reloj monotónico.
+ *
+ * @return Valor actual del contador.
+ */
+static inline uint64_t heat_profile_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Suma ciclos a una fase de la lámina en curso.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param phase Fase a la que pertenecen los ciclos.
+ * @param ticks Ciclos a sumar.
+ */
+static inline void heat_profile_add(heat_profile* profile,
+                                    profile_phase phase, uint64_t ticks) {
+    if (profile != NULL && profile->current != NULL) {
+        profile->current->phase_ticks[phase] += ticks;
+    }
+}
+
+/**
+ * @brief Suma a una fase los ciclos transcurridos desde `start`.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param phase Fase a la que pertenece el intervalo.
+ * @param start Contador al inicio del intervalo.
+ * @return Contador al final del intervalo, para encadenar la siguiente fase.
+ */
+static inline uint64_t heat_profile_lap(heat_profile* profile,
+                                        profile_phase phase, uint64_t start) {
+    const uint64_t now = heat_profile_ticks();
+    heat_profile_add(profile, phase, now - start);
+    return now;
+}
+#else
+static inline uint64_t heat_profile_ticks(void) {
+    return 0;
+}
+
+static inline void heat_profile_add(heat_profile* profile,
+                                    profile_phase phase, uint64_t ticks) {
+    (void)profile;
+    (void)phase;
+    (void)ticks;
+}
+
+static inline uint64_t heat_profile_lap(heat_profile* profile,
+                                        profile_phase phase, uint64_t start) {
+    (void)profile;
+    (void)phase;
+    (void)start;
+    return 0;
+}
+#endif
+
+/**
+ * @brief Prepara las mediciones de un trabajo si `HEATSIM_PROFILE=1`.
+ *
+ * @param profile Mediciones a inicializar.
+ * @param lines Cantidad de láminas del trabajo.
+ * @param num_threads Hilos usados en la simulación.
+ * @return `profile` si se debe medir, o NULL si la variable de ambiente no
+ * está definida, no hay memoria o la medición se excluyó al compilar con
+ * `-DHEATSIM_NO_PROFILING`.
+ */
+heat_profile* heat_profile_init(heat_profile* profile, uint64_t lines,
+                                int num_threads);
+
+/**
+ * @brief Indica que inicia la medición de una lámina.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param line Línea del trabajo que corresponde a la lámina.
+ */
+void heat_profile_begin_plate(heat_profile* profile, uint64_t line);
+
+/**
+ * @brief Registra el tamaño y los estados de la lámina en curso.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param states Estados hasta el equilibrio.
+ */
+void heat_profile_end_plate(heat_profile* profile, uint64_t rows,
+                            uint64_t columns, uint64_t states);
+
+/**
+ * @brief Suma los ciclos que un hilo esperó a que terminaran los demás.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param thread Número del hilo.
+ * @param ticks Ciclos de espera.
+ */
+void heat_profile_add_wait(heat_profile* profile, int thread, uint64_t ticks);
+
+/**
+ * @brief Calcula cuántos ciclos del contador equivalen a un segundo.
+ *
+ * @details Compara el contador con el reloj monotónico desde que inició el
+ * trabajo, de modo que no depende de la frecuencia nominal del procesador.
+ *
+ * @param profile Mediciones del trabajo.
+ * @return Ciclos por segundo.
+ */
+double heat_profile_ticks_per_second(const heat_profile* profile);
+
+/**
+ * @brief Libera la memoria de las mediciones.
+ *
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ */
+void heat_profile_destroy(heat_profile* profile);
+
+#endif  // HEAT_PROFILE_H
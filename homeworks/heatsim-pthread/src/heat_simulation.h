@@ -8,6 +8,22 @@
 #include <time.h>
 #include <pthread.h>
 
+#include "heat_profile.h"
+#include "plate_arena.h"
+#include "plate_format.h"
+
+/**
+ * @brief Ranuras de la arena de memoria que usa cada simulación.
+ *
+ * @details Las copias locales de los hilos ocupan las ranuras a partir de
+ * `PLATE_SLOT_THREADS`, una por hilo.
+ */
+enum {
+    PLATE_SLOT_INPUT = 0,    /**< Lámina leída del archivo binario. */
+    PLATE_SLOT_NEXT = 1,     /**< Matriz con el resultado de cada estado. */
+    PLATE_SLOT_THREADS = 2,  /**< Primera copia local de los hilos. */
+};
+
 /**
  * @brief Estructura para almacenar los parámetros de cada simulación.
  */
@@ -50,6 +66,8 @@ typedef struct {
     int id;                  /**< ID del hilo para identificarlo. */
     const double* local_coef; /**< Coeficiente precalculado */
     shared_data* shared;     /**< Estructura compartida entre los hilos. */
+    uint64_t stencil_ticks;  /**< Ciclos que tardó el último cálculo. */
+    uint64_t finish_ticks;   /**< Contador al terminar el último cálculo. */
 } private_data;
 
 /**
@@ -82,8 +100,10 @@ uint64_t count_lines(const char* fileName);
  * @param lines Número de simulaciones a realizar.
  * @param jobName Nombre del archivo de trabajo.
  * @param num_threads Número de hilos a utilizar en la simulación.
+ * @return 0 si se simularon todas las láminas y se escribió el reporte, 1 si
+ * alguna lámina o el reporte fallaron.
  */
-void read_bin_plate(const char* folder,
+int read_bin_plate(const char* folder,
                     params_matrix* variables_formula,
                     uint64_t lines,
                     const char* jobName,
@@ -100,7 +120,11 @@ void read_bin_plate(const char* folder,
  * @param h Tamaño de las celdas.
  * @param epsilon Sensitividad del punto de equilibrio.
  * @param num_threads Número de hilos a utilizar.
- * @return Número de estados hasta alcanzar el punto de equilibrio.
+ * @param arena Arena de donde se toman las matrices auxiliares. Debe tener al
+ * menos `PLATE_SLOT_THREADS + num_threads` ranuras.
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @return Número de estados hasta alcanzar el punto de equilibrio, o 0 si no
+ * se obtuvieron de la arena las matrices auxiliares.
  */
 uint64_t heat_transfer_simulation(double** matrix,
                                     uint64_t rows,
@@ -109,7 +133,45 @@ uint64_t heat_transfer_simulation(double** matrix,
                                     double alpha,
                                     double h,
                                     double epsilon,
-                                    int num_threads);
+                                    int num_threads,
+                                    plate_arena* arena,
+                                    heat_profile* profile);
+
+/**
+ * @brief Simula a lo sumo `max_states` estados con el mismo cálculo de
+ * `heat_transfer_simulation`.
+ *
+ * @param matrix Matriz de la lámina; queda con el último estado simulado.
+ * @param rows Número de filas de la matriz.
+ * @param columns Número de columnas de la matriz.
+ * @param delta_t Diferencial de tiempo.
+ * @param alpha Difusividad térmica.
+ * @param h Tamaño de las celdas.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param num_threads Número de hilos a utilizar.
+ * @param arena Arena de donde se toman las matrices auxiliares. Debe tener al
+ * menos `PLATE_SLOT_THREADS + num_threads` ranuras.
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param max_states Estados a simular como máximo.
+ * @param changes Arreglo de al menos `max_states` elementos donde se guarda
+ * el máximo cambio |Δ| de cada estado, o NULL.
+ * @param balance_point Si se alcanzó el equilibrio, o NULL.
+ * @return Número de estados simulados, o 0 si no se obtuvieron de la arena
+ * las matrices auxiliares.
+ */
+uint64_t heat_transfer_sample(double** matrix,
+                              uint64_t rows,
+                              uint64_t columns,
+                              double delta_t,
+                              double alpha,
+                              double h,
+                              double epsilon,
+                              int num_threads,
+                              plate_arena* arena,
+                              heat_profile* profile,
+                              uint64_t max_states,
+                              double* changes,
+                              bool* balance_point);
 
 /**
  * @brief Función ejecutada por cada hilo durante la simulación de transferencia de calor.
@@ -175,14 +237,33 @@ char* format_time(const time_t seconds, char* text, const size_t capacity);
  * @param jobName Nombre del archivo de trabajo.
  * @param variables_formula Arreglo de estructuras `params_matrix` que contiene los parámetros de la simulación.
  * @param states_k Arreglo que contiene el número de iteraciones para alcanzar el equilibrio en cada simulación.
+ * Las láminas con 0 estados no se pudieron simular y se omiten.
  * @param lines Número de simulaciones realizadas.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el reporte.
  */
-void generate_report_file(const char* folder,
+int generate_report_file(const char* folder,
                         const char* jobName,
                         params_matrix* variables_formula,
                         uint64_t* states_k,
                         uint64_t lines);
 
+/**
+ * @brief Genera el archivo de mediciones (.profile.tsv) junto al reporte.
+ *
+ * @details Escribe una fila por lámina con los ciclos y segundos de cada fase,
+ * los estados por segundo de la simulación y los segundos que cada hilo
+ * esperó en la unión, separados por comas.
+ *
+ * @param folder Carpeta donde se guardará el archivo.
+ * @param jobName Nombre del archivo de trabajo.
+ * @param variables_formula Arreglo de estructuras `params_matrix` que contiene los parámetros de la simulación.
+ * @param profile Mediciones del trabajo.
+ */
+void generate_profile_file(const char* folder,
+                           const char* jobName,
+                           params_matrix* variables_formula,
+                           const heat_profile* profile);
+
 /**
  * @brief Genera un archivo binario con el estado final de la matriz después de la simulación.
  * 
@@ -192,12 +273,15 @@ void generate_report_file(const char* folder,
  * @param folder Carpeta donde se guardará el archivo binario.
  * @param jobName Nombre del archivo de trabajo.
  * @param states_k Número de iteraciones realizadas hasta alcanzar el equilibrio.
+ * @param format Versión y compresión del archivo.
+ * @return 0 si tuvo éxito, 1 si no se pudo escribir el archivo.
  */
-void generate_bin_file(double** matrix,
+int generate_bin_file(double** matrix,
                         uint64_t rows,
                         uint64_t columns,
                         const char* folder,
                         const char* jobName,
-                        uint64_t states_k);
+                        uint64_t states_k,
+                        const plate_format* format);
 
 #endif  // HEAT_SIMULATION_H
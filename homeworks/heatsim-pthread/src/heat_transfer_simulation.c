@@ -20,105 +20,125 @@
  * @param lines Número de simulaciones a realizar.
  * @param jobName Nombre del archivo de trabajo.
  * @param num_threads Cantidad de hilos para la simulación.
+ * @return 0 si se simularon todas las láminas y se escribió el reporte, 1 si
+ * alguna lámina o el reporte fallaron.
  */
-void read_bin_plate(const char* folder,
+int read_bin_plate(const char* folder,
                     params_matrix* variables,
                     uint64_t lines,
                     const char* jobName,
                     int num_threads) {
-    FILE *bin_file;
     uint64_t rows, columns;
     char direction[512];
 
     // Crear un arreglo para almacenar los estados por cada simulación
-    uint64_t* array_state_k = malloc(lines * sizeof(uint64_t));
+    uint64_t* array_state_k = calloc(lines, sizeof(uint64_t));
     if (array_state_k == NULL) {
         fprintf(stderr,
                       "Error al asignar memoria para el arreglo de estados.\n");
-        return;
+        return 1;
     }
 
+    /* **Optimización**: Las matrices de todas las láminas del trabajo salen
+    de una arena que conserva los búferes más grandes vistos hasta ahora*/
+    const char* huge_pages = getenv("HEATSIM_HUGEPAGES");
+    plate_arena arena;
+    if (plate_arena_init(&arena, PLATE_SLOT_THREADS + num_threads,
+                         huge_pages != NULL && atoi(huge_pages) == 1) != 0) {
+        fprintf(stderr, "Error al asignar memoria para la arena.\n");
+        free(array_state_k);
+        return 1;
+    }
+
+    // Versión y compresión de los archivos binarios que se escriben
+    plate_format format;
+    plate_format_init(&format, num_threads);
+
+    // Mediciones por fase, solo si se definió HEATSIM_PROFILE=1
+    heat_profile profile_data;
+    heat_profile* profile = heat_profile_init(&profile_data, lines,
+                                                                   num_threads);
+
+    // Las láminas que fallan se omiten, pero el trabajo se reporta fallido
+    int error = 0;
     for (uint64_t i = 0; i < lines; i++) {
+        heat_profile_begin_plate(profile, i);
+        uint64_t ticks = heat_profile_ticks();
+
         // Construir la ruta del archivo binario
         snprintf(direction, sizeof(direction),
                                         "%s/%s", folder, variables[i].filename);
 
-        // Abrir el archivo binario para leer
-        bin_file = fopen(direction, "rb");
-        if (bin_file == NULL) {
-            fprintf(stderr,
-             "No se pudo abrir el archivo binario %s\n", variables[i].filename);
+        // Abrir el archivo binario (versión 1 o 2) y leer sus dimensiones
+        plate_reader reader;
+        if (plate_reader_open(&reader, direction) != 0) {
+            error = 1;
             continue;  // Continuar con la siguiente simulación en caso de error
         }
+        rows = reader.rows;
+        columns = reader.columns;
 
-        // Leer el número de filas y columnas de la matriz
-        fread(&rows, sizeof(uint64_t), 1, bin_file);
-        fread(&columns, sizeof(uint64_t), 1, bin_file);
-
-        // Asignar memoria para la matriz
-        double **matrix = malloc(rows * sizeof(double*));
+        // Tomar la matriz de la arena (sin ponerla en cero)
+        double **matrix = plate_arena_acquire(&arena, PLATE_SLOT_INPUT,
+                                                                 rows, columns);
         if (matrix == NULL) {
-            fprintf(stderr,
-                      "Error al asignar memoria para las filas de la matriz\n");
-            fclose(bin_file);
+            fprintf(stderr, "Error al asignar memoria para la matriz\n");
+            plate_reader_close(&reader);
+            error = 1;
             continue;
         }
 
-        for (uint64_t j = 0; j < rows; j++) {
-            matrix[j] = malloc(columns * sizeof(double));
-            if (matrix[j] == NULL) {
-                fprintf(stderr,
-                   "Error al asignar memoria para las columnas de la matriz\n");
-                for (uint64_t k = 0; k < j; k++) {
-                    free(matrix[k]);
-                }
-                free(matrix);
-                fclose(bin_file);
-                continue;
-            }
-
-            // Leer cada fila del archivo binario y almacenarla en la matriz
-            size_t elements_read = fread(matrix[j], sizeof(double),
-                                                             columns, bin_file);
-            if (elements_read != columns) {
-                fprintf(stderr, "Error al leer los datos de la fila %lu\n", j);
-                for (uint64_t k = 0; k <= j; k++) {
-                    free(matrix[k]);
-                }
-                free(matrix);
-                fclose(bin_file);
-                continue;
-            }
+        // Leer los bloques de filas y verificar su CRC si es versión 2
+        const int read_error = plate_reader_read(&reader, matrix, num_threads);
+        plate_reader_close(&reader);
+        if (read_error) {
+            error = 1;
+            continue;
         }
-        // Cerrar el archivo binario después de leer los datos
-        fclose(bin_file);
+        heat_profile_lap(profile, PHASE_READ, ticks);
+
         // Ejecutar la simulación y capturar el número de estados
         uint64_t states_k = heat_transfer_simulation(matrix, rows, columns,
                                                      variables[i].delta_t,
                                                      variables[i].alpha,
                                                      variables[i].h,
                                                      variables[i].epsilon,
-                                                     num_threads);
+                                                     num_threads, &arena,
+                                                     profile);
+
+        if (states_k == 0) {
+            fprintf(stderr, "No se pudo simular la lámina %s\n", direction);
+            error = 1;
+            continue;
+        }
 
         // Guardar el número de estados en el arreglo
         array_state_k[i] = states_k;
 
         // Generar archivo binario con el estado final
-        generate_bin_file(matrix, rows, columns, folder,
-                                       variables[i].filename, array_state_k[i]);
-
-        // Liberar la memoria de la matriz
-        for (uint64_t j = 0; j < rows; j++) {
-            free(matrix[j]);
+        ticks = heat_profile_ticks();
+        if (generate_bin_file(matrix, rows, columns, folder,
+                         variables[i].filename, array_state_k[i], &format)) {
+            error = 1;
         }
-        free(matrix);
+        heat_profile_lap(profile, PHASE_WRITE, ticks);
+        heat_profile_end_plate(profile, rows, columns, states_k);
     }
 
     // Generar el archivo de reporte con todos los resultados
-    generate_report_file(folder, jobName, variables, array_state_k, lines);
+    if (generate_report_file(folder, jobName, variables, array_state_k,
+                                                                     lines)) {
+        error = 1;
+    }
+    if (profile != NULL) {
+        generate_profile_file(folder, jobName, variables, profile);
+    }
 
-    // Liberar el arreglo de estados
+    // Liberar las mediciones, la arena y el arreglo de estados
+    heat_profile_destroy(profile);
+    plate_arena_destroy(&arena);
     free(array_state_k);
+    return error;
 }
 
 /**
@@ -136,8 +156,11 @@ void read_bin_plate(const char* folder,
  * @param h Tamaño de las celdas.
  * @param epsilon Sensitividad del punto de equilibrio.
  * @param num_threads Cantidad de hilos de ejecución.
+ * @param arena Arena de donde se toman las matrices locales y `new_matrix`.
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
  * 
- * @return Número de estados hasta alcanzar el punto de equilibrio.
+ * @return Número de estados hasta alcanzar el punto de equilibrio, o 0 si no
+ * se obtuvieron de la arena las matrices auxiliares.
  */
 uint64_t heat_transfer_simulation(double** matrix,
                                   uint64_t rows,
@@ -146,7 +169,52 @@ uint64_t heat_transfer_simulation(double** matrix,
                                   double alpha,
                                   double h,
                                   double epsilon,
-                                  int num_threads) {
+                                  int num_threads,
+                                  plate_arena* arena,
+                                  heat_profile* profile) {
+    return heat_transfer_sample(matrix, rows, columns, delta_t, alpha, h,
+                                epsilon, num_threads, arena, profile,
+                                UINT64_MAX, NULL, NULL);
+}
+
+/**
+ * @brief Simula a lo sumo una cantidad de estados de la transferencia de
+ * calor.
+ *
+ * @details Es el mismo cálculo de `heat_transfer_simulation`, que lo usa sin
+ * límite. Si se piden los cambios, la verificación del equilibrio recorre
+ * todas las celdas para obtener el máximo cambio de cada estado.
+ *
+ * @param matrix Matriz de la lámina; queda con el último estado simulado.
+ * @param rows Número de filas de la matriz.
+ * @param columns Número de columnas de la matriz.
+ * @param delta_t Diferencial de tiempo.
+ * @param alpha Difusividad térmica.
+ * @param h Tamaño de las celdas.
+ * @param epsilon Sensitividad del punto de equilibrio.
+ * @param num_threads Cantidad de hilos de ejecución.
+ * @param arena Arena de donde se toman las matrices locales y `new_matrix`.
+ * @param profile Mediciones del trabajo, o NULL si no se está midiendo.
+ * @param max_states Estados a simular como máximo.
+ * @param changes Máximo cambio |Δ| de cada estado, o NULL.
+ * @param balance_point Si se alcanzó el equilibrio, o NULL.
+ *
+ * @return Número de estados simulados, o 0 si no se obtuvieron de la arena
+ * las matrices auxiliares.
+ */
+uint64_t heat_transfer_sample(double** matrix,
+                              uint64_t rows,
+                              uint64_t columns,
+                              double delta_t,
+                              double alpha,
+                              double h,
+                              double epsilon,
+                              int num_threads,
+                              plate_arena* arena,
+                              heat_profile* profile,
+                              uint64_t max_states,
+                              double* changes,
+                              bool* balance_point) {
     // Array de hilos
     pthread_t threads[num_threads]; //NOLINT
     // Array de datos privados de cada hilo
@@ -157,6 +225,9 @@ uint64_t heat_transfer_simulation(double** matrix,
     // Inicializar los datos compartidos
     shared.balance_point = false;
     shared.global_matrix = matrix;
+    if (balance_point != NULL) {
+        *balance_point = false;
+    }
 
     /* **Optimización**: Calcular el coeficiente constante
     y almacenarlo en shared_data*/
@@ -183,33 +254,41 @@ uint64_t heat_transfer_simulation(double** matrix,
         thread_args[t].shared = &shared;
         thread_args[t].id = t;
         thread_args[t].local_coef = &coef_local;
-        // Asignar una nueva matriz local para cada hilo
-        thread_args[t].local_matrix = create_empty_matrix(rows, columns);
+        // Tomar de la arena la matriz local de cada hilo
+        thread_args[t].local_matrix = plate_arena_acquire(arena,
+                                          PLATE_SLOT_THREADS + t, rows, columns);
+        if (thread_args[t].local_matrix == NULL) {
+            return 0;
+        }
         copy_matrix(thread_args[t].local_matrix, shared.global_matrix,
                                                                  rows, columns);
     }
 
-    /*Crear una matriz nueva donde se almacenarán
+    /*Tomar de la arena la matriz donde se almacenarán
     los resultados al final de cada iteración*/
-    double** new_matrix = create_empty_matrix(rows, columns);
-    copy_matrix(new_matrix, shared.global_matrix, rows, columns);
+    double** new_matrix = plate_arena_acquire(arena, PLATE_SLOT_NEXT,
+                                                                 rows, columns);
     if (new_matrix == NULL) {
         // Retornar inmediatamente si no se puede crear la matriz
-        return total_states_k;
+        return 0;
     }
+    copy_matrix(new_matrix, shared.global_matrix, rows, columns);
 
     // Simulación de transferencia de calor
-    while (!shared.balance_point) {
+    while (!shared.balance_point && total_states_k < max_states) {
         // Inicializar la variable como true al inicio de la iteración
         shared.balance_point = true;
+        uint64_t ticks = heat_profile_ticks();
         if (num_threads == 1) {
             // Solo hay un hilo, así que se hace de una vez
             // Actualizar la matriz local directamente
             copy_matrix(thread_args[0].local_matrix,
                                            shared.global_matrix, rows, columns);
+            ticks = heat_profile_lap(profile, PHASE_COPY, ticks);
 
             // Ejecutar la simulación de transferencia de calor directamente
             heat_transfer_simulation_thread(&thread_args[0]);
+            ticks = heat_profile_lap(profile, PHASE_STENCIL, ticks);
 
             // Copiar los cambios de la matriz local a la new_matrix
             copy_matrix(new_matrix, thread_args[0].local_matrix, rows, columns);
@@ -221,6 +300,7 @@ uint64_t heat_transfer_simulation(double** matrix,
                 copy_matrix(thread_args[t].local_matrix,
                                            shared.global_matrix, rows, columns);
             }
+            ticks = heat_profile_lap(profile, PHASE_COPY, ticks);
 
             // Crear los hilos para procesar las filas
             for (int t = 0; t < num_threads; t++) {
@@ -232,6 +312,21 @@ uint64_t heat_transfer_simulation(double** matrix,
             for (int t = 0; t < num_threads; t++) {
                 pthread_join(threads[t], NULL);
             }
+            if (profile != NULL) {
+                // El hilo más lento marca el cálculo; el resto es sincronizar
+                const uint64_t joined = heat_profile_ticks();
+                uint64_t slowest = 0;
+                for (int t = 0; t < num_threads; t++) {
+                    if (thread_args[t].stencil_ticks > slowest) {
+                        slowest = thread_args[t].stencil_ticks;
+                    }
+                    heat_profile_add_wait(profile, t,
+                                         joined - thread_args[t].finish_ticks);
+                }
+                heat_profile_add(profile, PHASE_STENCIL, slowest);
+                heat_profile_add(profile, PHASE_SYNC, joined - ticks - slowest);
+                ticks = joined;
+            }
 
             // Copiar matrices locales de los hilos a la new_matrix
             for (int t = 0; t < num_threads; t++) {
@@ -243,29 +338,40 @@ uint64_t heat_transfer_simulation(double** matrix,
                 }
             }
         }
+        ticks = heat_profile_lap(profile, PHASE_COPY, ticks);
+
         // Verificar el balance point
+        double max_change = 0.0;
         for (uint64_t i = 1; i < rows - 1; i++) {
             for (uint64_t j = 1; j < columns - 1; j++) {
-                if (fabs(new_matrix[i][j] - shared.global_matrix[i][j]) >=
-                                                                      epsilon) {
+                const double change = fabs(new_matrix[i][j] -
+                                           shared.global_matrix[i][j]);
+                if (change >= epsilon) {
                     shared.balance_point = false;
-                    break;  // Salir del bucle de columnas
+                    if (changes == NULL) {
+                        break;  // Salir del bucle de columnas
+                    }
                 }
+                max_change = change > max_change ? change : max_change;
             }
-            if (!shared.balance_point) {
+            if (!shared.balance_point && changes == NULL) {
                 break;  // Salir del bucle de filas si detectó una diferencia
             }
         }
+        if (changes != NULL) {
+            changes[total_states_k] = max_change;
+        }
+        ticks = heat_profile_lap(profile, PHASE_CONVERGENCE, ticks);
+
         // Copiar la nueva matriz a la matriz global para la siguiente iteración
         copy_matrix(shared.global_matrix, new_matrix, rows, columns);
+        heat_profile_lap(profile, PHASE_COPY, ticks);
         total_states_k++;
     }
-    // Liberar las matrices locales después de que los hilos hayan terminado
-    for (int t = 0; t < num_threads; t++) {
-        free_matrix(thread_args[t].local_matrix, rows);
+    // Las matrices locales y new_matrix pertenecen a la arena: no se liberan
+    if (balance_point != NULL) {
+        *balance_point = shared.balance_point;
     }
-    // Liberar memoria de la matriz temporal
-    free_matrix(new_matrix, rows);
 
     return total_states_k;  // Devolver el número total de estados
 }
@@ -288,6 +394,7 @@ void* heat_transfer_simulation_thread(void* arg) {
     /* **Optimización**: Copiar el coeficiente localmente
     para evitar acceder a shared_data repetidamente*/
     double coef_local = *(data->shared->coef);
+    const uint64_t start_ticks = heat_profile_ticks();
 
     // Calcular las nuevas temperaturas para las celdas asignadas a este hilo
     for (uint64_t i = data->start_row; i < data->end_row; i++) {
@@ -301,6 +408,10 @@ void* heat_transfer_simulation_thread(void* arg) {
             data->local_matrix[i][j] = new_temp;
         }
     }
+
+    // Para medir cuánto espera este hilo a los demás antes de la unión
+    data->finish_ticks = heat_profile_ticks();
+    data->stencil_ticks = data->finish_ticks - start_ticks;
     return NULL;
 }
 
@@ -1,11 +1,17 @@
 //  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include <unistd.h>  // Para obtener el número de CPUs (núcleos) disponibles
 #include <time.h>    // Para la función clock_gettime
+#include "heat_estimate.h"
 #include "heat_simulation.h"
 
+// Otros programas pueden enlazar la simulación con su propio main, como el
+// servidor web de exercises/pthreads/network_simul_packet_loss
+#ifndef HEATSIM_EMBEDDED
+
 /**
  * @brief Programa principal para ejecutar la simulación de transferencia de calor.
  * 
@@ -15,8 +21,16 @@
  * @return 0 si la simulación se ejecuta correctamente, 1 si hay un error.
  */
 int main(int argc, char *argv[]) {
+    // Con --estimate solo se predicen los estados de cada lámina
+    const char* program = argv[0];
+    bool estimate = argc > 1 && strcmp(argv[1], "--estimate") == 0;
+    if (estimate) {
+        argc--;
+        argv++;
+    }
     if (argc < 3) {
-        printf("Uso: %s <carpeta> <archivo de trabajo> [num_hilos]\n", argv[0]);
+        printf("Uso: %s [--estimate] <carpeta> <archivo de trabajo> "
+               "[num_hilos]\n", program);
         return 1;
     }
 
@@ -38,7 +52,9 @@ int main(int argc, char *argv[]) {
         // Obtener núcleos de la máquina si no se proporciona el argumento
     }
 
-    printf("Número de hilos a utilizar: %d\n", num_threads);
+    if (!estimate) {
+        printf("Número de hilos a utilizar: %d\n", num_threads);
+    }
 
     // Iniciar el reloj para medir el tiempo
     struct timespec start_time, finish_time;
@@ -52,8 +68,15 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    // Simulación de transferencia de calor
-    read_bin_plate(folder, variables, lines, jobName, num_threads);
+    int error = 0;
+    if (estimate) {
+        // Predecir los estados sin simular hasta el equilibrio
+        error = estimate_job(folder, variables, lines, num_threads);
+    } else {
+        // Simulación de transferencia de calor
+        error = read_bin_plate(folder, variables, lines, jobName,
+                                                                  num_threads);
+    }
 
     // Medir el tiempo después de completar la simulación
     clock_gettime(CLOCK_MONOTONIC, &finish_time);
@@ -69,6 +92,15 @@ int main(int argc, char *argv[]) {
     }
     free(variables);
 
-    printf("Simulación completada.\n");
+    if (error) {
+        fprintf(stderr, estimate ? "La predicción terminó con errores.\n"
+                                 : "La simulación terminó con errores.\n");
+        return 1;
+    }
+    if (!estimate) {
+        printf("Simulación completada.\n");
+    }
     return 0;
 }
+
+#endif  // HEATSIM_EMBEDDED
@@ -0,0 +1,153 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "plate_arena.h"
+
+/// Tamaño de una página enorme en Linux x86-64 (2 MiB)
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+/// Alineación de los bloques normales: una línea de caché
+#define CACHE_LINE_SIZE 64UL
+/// Máximo de celdas de un bloque, para que sus bytes redondeados quepan
+#define MAX_BLOCK_CELLS ((SIZE_MAX - HUGE_PAGE_SIZE) / sizeof(double))
+
+/**
+ * @brief Inicializa una arena vacía con la cantidad de ranuras indicada.
+ *
+ * @param arena Arena a inicializar.
+ * @param slots Cantidad de matrices distintas que se pueden solicitar.
+ * @param huge_pages Si es verdadero se solicitan páginas enormes.
+ * @return 0 si tuvo éxito, 1 si no se pudo asignar memoria.
+ */
+int plate_arena_init(plate_arena* arena, size_t slots, bool huge_pages) {
+    arena->buffers = calloc(slots, sizeof(plate_buffer));
+    if (arena->buffers == NULL) {
+        arena->slots = 0;
+        return 1;
+    }
+    arena->slots = slots;
+    arena->huge_pages = huge_pages;
+    return 0;
+}
+
+/**
+ * @brief Asigna un bloque de celdas nuevo, alineado según el tipo de página.
+ *
+ * @param arena Arena dueña del bloque.
+ * @param cells Cantidad de celdas que debe contener el bloque.
+ * @return Puntero al bloque o NULL si no hay memoria.
+ */
+static double* plate_arena_allocate_block(plate_arena* arena, size_t cells) {
+    const size_t bytes = cells * sizeof(double);
+    const bool use_huge = arena->huge_pages && bytes >= HUGE_PAGE_SIZE;
+    const size_t alignment = use_huge ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+    // Redondear al múltiplo de la alineación para que madvise cubra todo
+    const size_t rounded = (bytes + alignment - 1) / alignment * alignment;
+
+    void* block = NULL;
+    if (posix_memalign(&block, alignment, rounded) != 0) {
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (use_huge) {
+        // Es solo una sugerencia: si el kernel no la acepta se sigue igual
+        madvise(block, rounded, MADV_HUGEPAGE);
+    }
+#endif
+    return (double*)block;
+}
+
+/**
+ * @brief Obtiene una matriz de `rows` x `columns` de la ranura indicada.
+ *
+ * @param arena Arena de donde se toma la memoria.
+ * @param slot Ranura a utilizar.
+ * @param rows Número de filas de la matriz.
+ * @param columns Número de columnas de la matriz.
+ * @return Puntero a la matriz o NULL si la ranura no existe, las dimensiones
+ * no caben en memoria o falla la memoria.
+ */
+double** plate_arena_acquire(plate_arena* arena, size_t slot, uint64_t rows,
+                                                             uint64_t columns) {
+    if (slot >= arena->slots) {
+        fprintf(stderr, "La arena no tiene la ranura %zu\n", slot);
+        return NULL;
+    }
+    plate_buffer* buffer = &arena->buffers[slot];
+
+    // Las dimensiones vienen del archivo: rows * columns podría desbordarse
+    if ((columns > 0 && rows > MAX_BLOCK_CELLS / columns) ||
+                                          rows > SIZE_MAX / sizeof(double*)) {
+        fprintf(stderr, "Una lámina de %lux%lu no cabe en memoria\n", rows,
+                                                                     columns);
+        return NULL;
+    }
+
+    // Solo crecer: se conserva el búfer más grande visto hasta ahora
+    const size_t cells = rows * columns;
+    if (cells > buffer->cell_capacity) {
+        double* block = plate_arena_allocate_block(arena, cells);
+        if (block == NULL) {
+            return NULL;
+        }
+        free(buffer->block);
+        buffer->block = block;
+        buffer->cell_capacity = cells;
+    }
+    if (rows > buffer->row_capacity) {
+        double** row_pointers = realloc(buffer->rows, rows * sizeof(double*));
+        if (row_pointers == NULL) {
+            return NULL;
+        }
+        buffer->rows = row_pointers;
+        buffer->row_capacity = rows;
+    }
+
+    // Las filas apuntan al bloque contiguo según el ancho de esta lámina
+    for (uint64_t i = 0; i < rows; i++) {
+        buffer->rows[i] = buffer->block + i * columns;
+    }
+    return buffer->rows;
+}
+
+/**
+ * @brief Libera los búferes de la arena si retienen más de lo permitido.
+ *
+ * @param arena Arena a recortar.
+ * @param max_bytes Bytes que la arena puede conservar; 0 si no hay límite.
+ */
+void plate_arena_trim(plate_arena* arena, uint64_t max_bytes) {
+    uint64_t retained = 0;
+    for (size_t slot = 0; slot < arena->slots; slot++) {
+        retained += arena->buffers[slot].cell_capacity * sizeof(double);
+    }
+    if (max_bytes == 0 || retained <= max_bytes) {
+        return;
+    }
+
+    // La próxima lámina vuelve a pedir solo los búferes que necesita
+    for (size_t slot = 0; slot < arena->slots; slot++) {
+        plate_buffer* buffer = &arena->buffers[slot];
+        free(buffer->block);
+        free(buffer->rows);
+        *buffer = (plate_buffer){NULL, NULL, 0, 0};
+    }
+}
+
+/**
+ * @brief Libera toda la memoria retenida por la arena.
+ *
+ * @param arena Arena a destruir.
+ */
+void plate_arena_destroy(plate_arena* arena) {
+    for (size_t slot = 0; slot < arena->slots; slot++) {
+        free(arena->buffers[slot].block);
+        free(arena->buffers[slot].rows);
+    }
+    free(arena->buffers);
+    arena->buffers = NULL;
+    arena->slots = 0;
+}
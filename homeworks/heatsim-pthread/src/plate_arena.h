@@ -0,0 +1,84 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef PLATE_ARENA_H
+#define PLATE_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Búfer reutilizable para una matriz de la lámina.
+ *
+ * @details Las celdas se almacenan en un bloque contiguo y `rows` contiene
+ * punteros a cada fila dentro del bloque, de modo que el resto del programa
+ * puede seguir usando la matriz como `double**`.
+ */
+typedef struct {
+    double* block;          /**< Bloque contiguo con todas las celdas. */
+    double** rows;          /**< Punteros a cada fila dentro del bloque. */
+    size_t cell_capacity;   /**< Cantidad de celdas que caben en el bloque. */
+    size_t row_capacity;    /**< Cantidad de punteros de fila reservados. */
+} plate_buffer;
+
+/**
+ * @brief Arena de memoria para las matrices de un trabajo.
+ *
+ * @details La arena conserva el búfer más grande visto hasta el momento en
+ * cada ranura. Las láminas siguientes del mismo trabajo reutilizan esa memoria
+ * sin volver a pedirla al sistema, sin ponerla en cero y sin provocar fallos de
+ * página nuevos. Cada ranura corresponde a una matriz distinta (por ejemplo la
+ * lámina leída, la matriz siguiente o la copia local de un hilo).
+ */
+typedef struct {
+    plate_buffer* buffers;  /**< Un búfer por ranura. */
+    size_t slots;           /**< Cantidad de ranuras disponibles. */
+    bool huge_pages;        /**< Pedir páginas enormes con madvise. */
+} plate_arena;
+
+/**
+ * @brief Inicializa una arena vacía con la cantidad de ranuras indicada.
+ *
+ * @param arena Arena a inicializar.
+ * @param slots Cantidad de matrices distintas que se pueden solicitar.
+ * @param huge_pages Si es verdadero, los bloques grandes se alinean a 2 MiB y
+ * se marcan con `madvise(MADV_HUGEPAGE)`.
+ * @return 0 si tuvo éxito, 1 si no se pudo asignar memoria.
+ */
+int plate_arena_init(plate_arena* arena, size_t slots, bool huge_pages);
+
+/**
+ * @brief Obtiene una matriz de `rows` x `columns` de la ranura indicada.
+ *
+ * @details Si el búfer de la ranura ya tiene capacidad suficiente se reutiliza
+ * tal cual; el contenido previo no se borra. La matriz retornada pertenece a la
+ * arena y no debe liberarse con `free_matrix`.
+ *
+ * @param arena Arena de donde se toma la memoria.
+ * @param slot Ranura a utilizar.
+ * @param rows Número de filas de la matriz.
+ * @param columns Número de columnas de la matriz.
+ * @return Puntero a la matriz o NULL si la ranura no existe, las dimensiones
+ * no caben en memoria o falla la memoria.
+ */
+double** plate_arena_acquire(plate_arena* arena, size_t slot, uint64_t rows,
+                                                              uint64_t columns);
+
+/**
+ * @brief Libera los búferes de la arena si retienen más de lo permitido.
+ *
+ * @details Sirve cuando varias arenas conviven con un límite de memoria: cada
+ * una puede conservar a lo sumo su parte entre una lámina y la siguiente.
+ *
+ * @param arena Arena a recortar.
+ * @param max_bytes Bytes que la arena puede conservar; 0 si no hay límite.
+ */
+void plate_arena_trim(plate_arena* arena, uint64_t max_bytes);
+
+/**
+ * @brief Libera toda la memoria retenida por la arena.
+ *
+ * @param arena Arena a destruir.
+ */
+void plate_arena_destroy(plate_arena* arena);
+
+#endif  // PLATE_ARENA_H
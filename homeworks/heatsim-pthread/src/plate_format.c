@@ -0,0 +1,750 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "plate_format.h"
+
+/// Marca al inicio de los archivos versión 2
+static const char plate_magic[8] = {'H', 'E', 'A', 'T', 'P', 'L', 'T', '2'};
+/// Bytes del encabezado versión 1: filas y columnas
+#define V1_HEADER_BYTES (2 * sizeof(uint64_t))
+/// Bytes del encabezado versión 2: marca, filas, columnas, filas por bloque
+/// y cantidad de bloques
+#define V2_HEADER_BYTES (sizeof(plate_magic) + 4 * sizeof(uint64_t))
+/// Tamaño aproximado de cada bloque si no se indica (1 MiB)
+#define DEFAULT_CHUNK_BYTES (1024 * 1024)
+/// Planos de bytes de un `double`
+#define PLANES 8
+
+/// Tabla del CRC-32 (polinomio reflejado 0xEDB88320)
+static uint32_t crc_table[256];
+/// Garantiza que la tabla se llene una sola vez
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Llena la tabla del CRC-32.
+ */
+static void crc_init(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        }
+        crc_table[n] = c;
+    }
+}
+
+/**
+ * @brief Calcula el CRC-32 de un bloque de bytes.
+ *
+ * @param data Bytes a verificar.
+ * @param size Cantidad de bytes.
+ * @return CRC-32 de los bytes.
+ */
+static uint32_t crc32(const uint8_t* data, size_t size) {
+    pthread_once(&crc_once, crc_init);
+    uint32_t crc = 0xFFFFFFFFU;
+    for (size_t i = 0; i < size; i++) {
+        crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFU;
+}
+
+/**
+ * @brief Lee o escribe todos los bytes indicados en una posición.
+ *
+ * @param fd Descriptor del archivo.
+ * @param data Bytes a transferir.
+ * @param size Cantidad de bytes.
+ * @param offset Posición en el archivo.
+ * @param writing Verdadero para escribir, falso para leer.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+static int transfer(int fd, void* data, size_t size, uint64_t offset,
+                    int writing) {
+    char* bytes = data;
+    while (size > 0) {
+        const ssize_t done = writing ? pwrite(fd, bytes, size, (off_t)offset)
+                                     : pread(fd, bytes, size, (off_t)offset);
+        if (done < 0 && errno == EINTR) {
+            continue;
+        }
+        if (done <= 0) {
+            return 1;
+        }
+        bytes += done;
+        size -= (size_t)done;
+        offset += (uint64_t)done;
+    }
+    return 0;
+}
+
+/**
+ * @brief Filas por bloque para que cada bloque ocupe cerca de 1 MiB.
+ *
+ * @param columns Número de columnas de la lámina.
+ * @return Filas por bloque, al menos 1.
+ */
+static uint64_t default_chunk_rows(uint64_t columns) {
+    const uint64_t row_bytes = columns * sizeof(double);
+    return row_bytes > 0 && row_bytes < DEFAULT_CHUNK_BYTES ?
+                                        DEFAULT_CHUNK_BYTES / row_bytes : 1;
+}
+
+/**
+ * @brief Filas de un bloque, considerando que el último puede ser menor.
+ *
+ * @param rows Número de filas de la lámina.
+ * @param chunk_rows Filas por bloque.
+ * @param chunk Número del bloque.
+ * @return Filas del bloque.
+ */
+static uint64_t rows_in_chunk(uint64_t rows, uint64_t chunk_rows,
+                              uint64_t chunk) {
+    const uint64_t first = chunk * chunk_rows;
+    return first + chunk_rows < rows ? chunk_rows : rows - first;
+}
+
+/**
+ * @brief Lee o escribe filas en formato versión 1.
+ *
+ * @details Si las filas son contiguas en memoria, como en la arena, se
+ * transfieren con una sola llamada.
+ *
+ * @param fd Descriptor del archivo.
+ * @param rows Punteros a las filas.
+ * @param first Fila de la lámina que corresponde a `rows[0]`.
+ * @param count Cantidad de filas.
+ * @param columns Número de columnas.
+ * @param writing Verdadero para escribir, falso para leer.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+static int transfer_v1_rows(int fd, double** rows, uint64_t first,
+                            uint64_t count, uint64_t columns, int writing) {
+    const size_t row_bytes = columns * sizeof(double);
+    uint64_t i = 0;
+    while (i < count) {
+        // Agrupar las filas que siguen contiguas a rows[i]
+        uint64_t run = 1;
+        while (i + run < count && rows[i + run] == rows[i] + run * columns) {
+            run++;
+        }
+        if (transfer(fd, rows[i], run * row_bytes,
+                     V1_HEADER_BYTES + (first + i) * row_bytes,
+                     writing) != 0) {
+            return 1;
+        }
+        i += run;
+    }
+    return 0;
+}
+
+/**
+ * @brief Codifica un plano de bytes con corridas de ceros.
+ *
+ * @details Cada byte de control `c` indica `c + 1` bytes literales si es menor
+ * que 128, o una corrida de `c - 126` ceros en caso contrario.
+ *
+ * @param in Plano a codificar.
+ * @param size Bytes del plano.
+ * @param out Destino; debe tener espacio para `size + size / 128 + 1` bytes.
+ * @return Bytes escritos en `out`.
+ */
+static size_t encode_zero_runs(const uint8_t* in, size_t size, uint8_t* out) {
+    size_t written = 0;
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 0;
+        while (i + run < size && in[i + run] == 0 && run < 129) {
+            run++;
+        }
+        if (run >= 2) {
+            out[written++] = (uint8_t)(126 + run);
+            i += run;
+            continue;
+        }
+        // Literales hasta 128 bytes o hasta la siguiente corrida de ceros
+        const size_t start = i;
+        while (i < size && i - start < 128 &&
+                        !(in[i] == 0 && i + 1 < size && in[i + 1] == 0)) {
+            i++;
+        }
+        out[written++] = (uint8_t)(i - start - 1);
+        memcpy(out + written, in + start, i - start);
+        written += i - start;
+    }
+    return written;
+}
+
+/**
+ * @brief Decodifica un plano de bytes con corridas de ceros.
+ *
+ * @param in Plano codificado.
+ * @param in_size Bytes codificados.
+ * @param out Destino del plano.
+ * @param out_size Bytes que debe tener el plano.
+ * @return 0 si tuvo éxito, 1 si los datos no son válidos.
+ */
+static int decode_zero_runs(const uint8_t* in, size_t in_size, uint8_t* out,
+                            size_t out_size) {
+    size_t read = 0, written = 0;
+    while (read < in_size) {
+        const uint8_t control = in[read++];
+        if (control < 128) {
+            const size_t count = (size_t)control + 1;
+            if (read + count > in_size || written + count > out_size) {
+                return 1;
+            }
+            memcpy(out + written, in + read, count);
+            read += count;
+            written += count;
+        } else {
+            const size_t count = (size_t)control - 126;
+            if (written + count > out_size) {
+                return 1;
+            }
+            memset(out + written, 0, count);
+            written += count;
+        }
+    }
+    return written != out_size;
+}
+
+/**
+ * @brief Predice una celda a partir de sus vecinas ya procesadas.
+ *
+ * @details Usa `izquierda + arriba - diagonal`, que en láminas suaves queda
+ * muy cerca del valor real. En la primera fila del bloque se usa la celda de
+ * la izquierda y en la primera columna la de arriba, de modo que cada bloque
+ * se puede descomprimir sin los demás.
+ *
+ * @param rows Punteros a las filas del bloque.
+ * @param i Fila de la celda dentro del bloque.
+ * @param j Columna de la celda.
+ * @return Bits del valor predicho.
+ */
+static uint64_t predict(double** rows, uint64_t i, uint64_t j) {
+    double prediction = 0.0;
+    if (i > 0 && j > 0) {
+        prediction = rows[i][j - 1] + rows[i - 1][j] - rows[i - 1][j - 1];
+    } else if (j > 0) {
+        prediction = rows[i][j - 1];
+    } else if (i > 0) {
+        prediction = rows[i - 1][0];
+    }
+    uint64_t word;
+    memcpy(&word, &prediction, sizeof(word));
+    return word;
+}
+
+/**
+ * @brief Comprime un bloque de filas sin pérdida.
+ *
+ * @details Cada `double` se combina con XOR con su valor predicho por
+ * `predict`. En láminas suaves los bytes altos del resultado son casi siempre
+ * cero, así que se separan en ocho planos (byte 0 de todas las celdas, luego
+ * byte 1, ...) y cada plano se codifica con corridas de ceros. La salida son
+ * los ocho tamaños de plano como `uint32_t` seguidos de los planos.
+ *
+ * @param rows Punteros a las filas del bloque.
+ * @param count Filas del bloque.
+ * @param columns Número de columnas.
+ * @param planes Espacio temporal de `count * columns * 8` bytes.
+ * @param out Destino; ver `encoded_bound`.
+ * @return Bytes escritos en `out`.
+ */
+static size_t encode_chunk(double** rows, uint64_t count, uint64_t columns,
+                           uint8_t* planes, uint8_t* out) {
+    const size_t cells = count * columns;
+    size_t cell = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        for (uint64_t j = 0; j < columns; j++, cell++) {
+            uint64_t value;
+            memcpy(&value, &rows[i][j], sizeof(value));
+            const uint64_t word = value ^ predict(rows, i, j);
+            for (int p = 0; p < PLANES; p++) {
+                planes[p * cells + cell] = (uint8_t)(word >> (8 * p));
+            }
+        }
+    }
+
+    size_t written = PLANES * sizeof(uint32_t);
+    for (int p = 0; p < PLANES; p++) {
+        const uint32_t size = (uint32_t)encode_zero_runs(planes + p * cells,
+                                                       cells, out + written);
+        memcpy(out + p * sizeof(uint32_t), &size, sizeof(size));
+        written += size;
+    }
+    return written;
+}
+
+/**
+ * @brief Descomprime un bloque de filas escrito por `encode_chunk`.
+ *
+ * @param in Bloque comprimido.
+ * @param in_size Bytes del bloque comprimido.
+ * @param rows Punteros a las filas del bloque.
+ * @param count Filas del bloque.
+ * @param columns Número de columnas.
+ * @param planes Espacio temporal de `count * columns * 8` bytes.
+ * @return 0 si tuvo éxito, 1 si los datos no son válidos.
+ */
+static int decode_chunk(const uint8_t* in, size_t in_size, double** rows,
+                        uint64_t count, uint64_t columns, uint8_t* planes) {
+    const size_t cells = count * columns;
+    size_t read = PLANES * sizeof(uint32_t);
+    if (in_size < read) {
+        return 1;
+    }
+    for (int p = 0; p < PLANES; p++) {
+        uint32_t size;
+        memcpy(&size, in + p * sizeof(uint32_t), sizeof(size));
+        if (read + size > in_size ||
+            decode_zero_runs(in + read, size, planes + p * cells, cells)) {
+            return 1;
+        }
+        read += size;
+    }
+
+    size_t cell = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        for (uint64_t j = 0; j < columns; j++, cell++) {
+            uint64_t word = 0;
+            for (int p = 0; p < PLANES; p++) {
+                word |= (uint64_t)planes[p * cells + cell] << (8 * p);
+            }
+            // Las vecinas de la predicción ya se descomprimieron
+            word ^= predict(rows, i, j);
+            memcpy(&rows[i][j], &word, sizeof(word));
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Bytes que puede ocupar un bloque comprimido en el peor caso.
+ *
+ * @param cells Celdas del bloque.
+ * @return Cota superior de bytes.
+ */
+static size_t encoded_bound(size_t cells) {
+    return PLANES * (sizeof(uint32_t) + cells + cells / 128 + 1);
+}
+
+/**
+ * @brief Lee el formato de salida de las variables de ambiente.
+ *
+ * @param format Formato a inicializar.
+ * @param threads Hilos para comprimir y escribir bloques.
+ */
+void plate_format_init(plate_format* format, int threads) {
+    const char* version = getenv("HEATSIM_PLATE_FORMAT");
+    const char* compress = getenv("HEATSIM_PLATE_COMPRESS");
+    format->version = version != NULL && atoi(version) == 2 ? 2 : 1;
+    format->codec = compress != NULL && atoi(compress) == 1 ?
+                                    PLATE_CODEC_XOR_PLANES : PLATE_CODEC_RAW;
+    format->chunk_rows = 0;
+    format->threads = threads > 0 ? threads : 1;
+}
+
+/**
+ * @brief Filas por bloque con que se escribe una lámina.
+ *
+ * @param format Formato del archivo.
+ * @param columns Número de columnas de la lámina.
+ * @return `format->chunk_rows`, o el valor por defecto si es 0.
+ */
+uint64_t plate_format_chunk_rows(const plate_format* format,
+                                 uint64_t columns) {
+    return format->chunk_rows > 0 ? format->chunk_rows
+                                  : default_chunk_rows(columns);
+}
+
+/**
+ * @brief Verifica que cada bloque del índice esté dentro del archivo.
+ *
+ * @details El índice viene del archivo, así que se valida antes de reservar
+ * memoria o leer según sus valores. Un bloque crudo no puede ocupar más que
+ * sus celdas y uno comprimido no más que `encoded_bound`.
+ *
+ * @param reader Lector con el índice ya leído.
+ * @param file_size Bytes del archivo.
+ * @return 0 si el índice es válido, 1 si no.
+ */
+static int check_index(const plate_reader* reader, uint64_t file_size) {
+    const uint64_t data_start = V2_HEADER_BYTES +
+                                reader->chunk_count * sizeof(plate_chunk);
+    for (uint64_t chunk = 0; chunk < reader->chunk_count; chunk++) {
+        const plate_chunk* entry = &reader->index[chunk];
+        const uint64_t cells = rows_in_chunk(reader->rows, reader->chunk_rows,
+                                             chunk) * reader->columns;
+        const uint64_t limit = entry->codec == PLATE_CODEC_RAW ?
+                        cells * sizeof(double) : encoded_bound(cells);
+        if (entry->offset < data_start || entry->offset > file_size ||
+            entry->size > file_size - entry->offset || entry->size > limit) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Abre un archivo binario de cualquier versión y lee sus dimensiones.
+ *
+ * @param reader Lector a inicializar.
+ * @param path Ruta del archivo.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_reader_open(plate_reader* reader, const char* path) {
+    memset(reader, 0, sizeof(plate_reader));
+    reader->path = path;
+    reader->fd = open(path, O_RDONLY);
+    if (reader->fd < 0) {
+        fprintf(stderr, "No se pudo abrir el archivo binario %s\n", path);
+        return 1;
+    }
+
+    // Un archivo versión 1 inicia con el número de filas
+    uint64_t header[5];
+    if (transfer(reader->fd, header, V1_HEADER_BYTES, 0, 0) != 0) {
+        fprintf(stderr, "Error al leer las dimensiones de %s\n", path);
+        plate_reader_close(reader);
+        return 1;
+    }
+    if (memcmp(header, plate_magic, sizeof(plate_magic)) != 0) {
+        reader->version = 1;
+        reader->rows = header[0];
+        reader->columns = header[1];
+        reader->chunk_rows = default_chunk_rows(reader->columns);
+    } else {
+        reader->version = 2;
+        if (transfer(reader->fd, header, V2_HEADER_BYTES, 0, 0) != 0 ||
+            header[3] == 0) {
+            fprintf(stderr, "Encabezado inválido en %s\n", path);
+            plate_reader_close(reader);
+            return 1;
+        }
+        reader->rows = header[1];
+        reader->columns = header[2];
+        reader->chunk_rows = header[3];
+    }
+    reader->chunk_count = (reader->rows + reader->chunk_rows - 1) /
+                                                            reader->chunk_rows;
+
+    if (reader->version == 2) {
+        // El índice debe caber en el archivo antes de reservarlo, y los
+        // bytes de un bloque, aun comprimido, deben caber en 64 bits
+        struct stat status;
+        if (header[4] != reader->chunk_count || fstat(reader->fd, &status) ||
+            reader->columns > UINT64_MAX / (2 * sizeof(double)) /
+                                                        reader->chunk_rows ||
+            reader->chunk_count > ((uint64_t)status.st_size -
+                                   V2_HEADER_BYTES) / sizeof(plate_chunk)) {
+            fprintf(stderr, "Encabezado inválido en %s\n", path);
+            plate_reader_close(reader);
+            return 1;
+        }
+        reader->index = malloc(reader->chunk_count * sizeof(plate_chunk) + 1);
+        if (reader->index == NULL ||
+            transfer(reader->fd, reader->index,
+                     reader->chunk_count * sizeof(plate_chunk),
+                     V2_HEADER_BYTES, 0) != 0) {
+            fprintf(stderr, "Error al leer el índice de %s\n", path);
+            plate_reader_close(reader);
+            return 1;
+        }
+        if (check_index(reader, (uint64_t)status.st_size) != 0) {
+            fprintf(stderr, "Índice inválido en %s\n", path);
+            plate_reader_close(reader);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Lee un bloque de filas y verifica su CRC-32.
+ *
+ * @param reader Lector del archivo.
+ * @param chunk Número del bloque.
+ * @param rows Punteros a las filas del bloque.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_reader_chunk(const plate_reader* reader, uint64_t chunk,
+                       double** rows) {
+    const uint64_t count = rows_in_chunk(reader->rows, reader->chunk_rows,
+                                                                        chunk);
+    const size_t row_bytes = reader->columns * sizeof(double);
+
+    if (reader->version == 1) {
+        if (transfer_v1_rows(reader->fd, rows, chunk * reader->chunk_rows,
+                             count, reader->columns, 0) != 0) {
+            fprintf(stderr, "Error al leer los datos de %s\n", reader->path);
+            return 1;
+        }
+        return 0;
+    }
+
+    const plate_chunk* entry = &reader->index[chunk];
+    const size_t cells = count * reader->columns;
+    uint8_t* stored = malloc(entry->size + 1);
+    uint8_t* planes = entry->codec == PLATE_CODEC_XOR_PLANES ?
+                                        malloc(cells * sizeof(double)) : NULL;
+    int error = stored == NULL ||
+                (entry->codec == PLATE_CODEC_XOR_PLANES && planes == NULL);
+    if (!error && transfer(reader->fd, stored, entry->size, entry->offset, 0)) {
+        fprintf(stderr, "Error al leer los datos de %s\n", reader->path);
+        error = 1;
+    } else if (!error && crc32(stored, entry->size) != entry->crc) {
+        fprintf(stderr, "CRC incorrecto en el bloque %lu de %s\n", chunk,
+                                                                reader->path);
+        error = 1;
+    } else if (!error && entry->codec == PLATE_CODEC_RAW) {
+        error = entry->size != count * row_bytes;
+        for (uint64_t i = 0; i < count && !error; i++) {
+            memcpy(rows[i], stored + i * row_bytes, row_bytes);
+        }
+    } else if (!error) {
+        error = entry->codec != PLATE_CODEC_XOR_PLANES ||
+                decode_chunk(stored, entry->size, rows, count,
+                             reader->columns, planes);
+        if (error) {
+            fprintf(stderr, "Bloque %lu inválido en %s\n", chunk,
+                                                                reader->path);
+        }
+    }
+    free(planes);
+    free(stored);
+    return error;
+}
+
+/**
+ * @brief Lee toda la lámina, repartiendo los bloques entre hilos.
+ *
+ * @param reader Lector del archivo.
+ * @param matrix Matriz donde se guardan los datos.
+ * @param threads Hilos para leer bloques.
+ * @return 0 si tuvo éxito, 1 si algún bloque falló.
+ */
+int plate_reader_read(const plate_reader* reader, double** matrix,
+                      int threads) {
+    int error = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        reduction(||: error)
+#else
+    (void)threads;
+#endif
+    for (uint64_t chunk = 0; chunk < reader->chunk_count; chunk++) {
+        double** rows = matrix + chunk * reader->chunk_rows;
+        error = plate_reader_chunk(reader, chunk, rows) || error;
+    }
+    return error;
+}
+
+/**
+ * @brief Cierra el archivo y libera el índice.
+ *
+ * @param reader Lector a cerrar.
+ */
+void plate_reader_close(plate_reader* reader) {
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    reader->fd = -1;
+    free(reader->index);
+    reader->index = NULL;
+}
+
+/**
+ * @brief Crea un archivo binario para escribirlo por bloques de filas.
+ *
+ * @param writer Escritor a inicializar.
+ * @param path Ruta del archivo.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param format Formato del archivo.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_writer_open(plate_writer* writer, const char* path, uint64_t rows,
+                      uint64_t columns, const plate_format* format) {
+    memset(writer, 0, sizeof(plate_writer));
+    writer->path = path;
+    writer->format = *format;
+    writer->rows = rows;
+    writer->columns = columns;
+    writer->format.chunk_rows = plate_format_chunk_rows(format, columns);
+    writer->chunk_count = (rows + writer->format.chunk_rows - 1) /
+                                                      writer->format.chunk_rows;
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->fd < 0) {
+        fprintf(stderr, "No se pudo crear el archivo binario %s\n", path);
+        return 1;
+    }
+    if (writer->format.version == 1) {
+        const uint64_t header[2] = {rows, columns};
+        writer->end = V1_HEADER_BYTES + rows * columns * sizeof(double);
+        writer->failed = transfer(writer->fd, (void*)header, sizeof(header),
+                                                                        0, 1);
+    } else {
+        // El encabezado y el índice se escriben al cerrar
+        writer->index = calloc(writer->chunk_count + 1, sizeof(plate_chunk));
+        writer->end = V2_HEADER_BYTES + writer->chunk_count *
+                                                        sizeof(plate_chunk);
+        writer->failed = writer->index == NULL;
+    }
+    if (writer->failed) {
+        fprintf(stderr, "Error al escribir el archivo binario %s\n", path);
+        plate_writer_close(writer);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Filas por bloque que espera `plate_writer_chunk`.
+ *
+ * @param writer Escritor del archivo.
+ * @return Filas por bloque.
+ */
+uint64_t plate_writer_chunk_rows(const plate_writer* writer) {
+    return writer->format.chunk_rows;
+}
+
+/**
+ * @brief Comprime si corresponde y escribe un bloque de filas.
+ *
+ * @param writer Escritor del archivo.
+ * @param chunk Número del bloque.
+ * @param rows Punteros a las filas del bloque.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_writer_chunk(plate_writer* writer, uint64_t chunk, double** rows) {
+    const uint64_t count = rows_in_chunk(writer->rows,
+                                         writer->format.chunk_rows, chunk);
+    const size_t row_bytes = writer->columns * sizeof(double);
+
+    if (writer->format.version == 1) {
+        const uint64_t first = chunk * writer->format.chunk_rows;
+        if (transfer_v1_rows(writer->fd, rows, first, count, writer->columns,
+                                                                     1) != 0) {
+            writer->failed = 1;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Se guarda sin comprimir si la compresión no reduce el bloque
+    const size_t cells = count * writer->columns;
+    const size_t raw_size = count * row_bytes;
+    uint8_t* planes = NULL;
+    uint8_t* stored = NULL;
+    size_t size = 0;
+    uint32_t codec = PLATE_CODEC_RAW;
+    if (writer->format.codec == PLATE_CODEC_XOR_PLANES) {
+        planes = malloc(raw_size + 1);
+        stored = malloc(encoded_bound(cells));
+        if (planes != NULL && stored != NULL) {
+            size = encode_chunk(rows, count, writer->columns, planes, stored);
+            codec = PLATE_CODEC_XOR_PLANES;
+        }
+    }
+    if (codec == PLATE_CODEC_RAW || size >= raw_size) {
+        free(stored);
+        stored = malloc(raw_size + 1);
+        if (stored == NULL) {
+            free(planes);
+            writer->failed = 1;
+            return 1;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            memcpy(stored + i * row_bytes, rows[i], row_bytes);
+        }
+        size = raw_size;
+        codec = PLATE_CODEC_RAW;
+    }
+
+    // Reservar el espacio del bloque; los bloques quedan en orden de llegada
+    uint64_t offset;
+#ifdef _OPENMP
+    #pragma omp critical(plate_writer)
+#endif
+    {
+        offset = writer->end;
+        writer->end += size;
+    }
+    writer->index[chunk] = (plate_chunk){offset, size, crc32(stored, size),
+                                                                        codec};
+    const int error = transfer(writer->fd, stored, size, offset, 1);
+    if (error) {
+        writer->failed = 1;
+    }
+    free(planes);
+    free(stored);
+    return error;
+}
+
+/**
+ * @brief Escribe el encabezado y el índice, y cierra el archivo.
+ *
+ * @param writer Escritor a cerrar.
+ * @return 0 si todo el archivo se escribió, 1 si no.
+ */
+int plate_writer_close(plate_writer* writer) {
+    if (writer->fd >= 0 && writer->format.version == 2 && !writer->failed) {
+        uint8_t header[V2_HEADER_BYTES];
+        const uint64_t fields[4] = {writer->rows, writer->columns,
+                                writer->format.chunk_rows, writer->chunk_count};
+        memcpy(header, plate_magic, sizeof(plate_magic));
+        memcpy(header + sizeof(plate_magic), fields, sizeof(fields));
+        writer->failed = transfer(writer->fd, header, sizeof(header), 0, 1) ||
+                         transfer(writer->fd, writer->index,
+                                  writer->chunk_count * sizeof(plate_chunk),
+                                  V2_HEADER_BYTES, 1);
+    }
+    if (writer->fd >= 0 && close(writer->fd) != 0) {
+        writer->failed = 1;
+    }
+    writer->fd = -1;
+    free(writer->index);
+    writer->index = NULL;
+    return writer->failed;
+}
+
+/**
+ * @brief Escribe una lámina completa, repartiendo los bloques entre hilos.
+ *
+ * @param path Ruta del archivo.
+ * @param matrix Matriz con los datos de la lámina.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param format Formato del archivo.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_write(const char* path, double** matrix, uint64_t rows,
+                uint64_t columns, const plate_format* format) {
+    plate_writer writer;
+    if (plate_writer_open(&writer, path, rows, columns, format) != 0) {
+        return 1;
+    }
+    const uint64_t chunk_rows = plate_writer_chunk_rows(&writer);
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(format->threads)
+#endif
+    for (uint64_t chunk = 0; chunk < writer.chunk_count; chunk++) {
+        plate_writer_chunk(&writer, chunk, matrix + chunk * chunk_rows);
+    }
+    if (plate_writer_close(&writer) != 0) {
+        fprintf(stderr, "Error al escribir el archivo binario %s\n", path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef PLATE_FORMAT_H
+#define PLATE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Formas de guardar los datos de cada bloque de filas.
+ */
+typedef enum {
+    PLATE_CODEC_RAW = 0,        /**< Los `double` tal cual. */
+    PLATE_CODEC_XOR_PLANES = 1, /**< XOR con la predicción, planos de bytes
+                                     y corridas de ceros. */
+} plate_codec;
+
+/**
+ * @brief Formato con el que se escriben los archivos binarios.
+ *
+ * @details La versión 1 es el formato original: filas y columnas seguidas de
+ * todos los `double`. La versión 2 agrega un encabezado con versión, un
+ * índice de bloques de filas con su CRC-32 y, opcionalmente, compresión sin
+ * pérdida de cada bloque.
+ */
+typedef struct {
+    int version;            /**< 1 o 2. */
+    plate_codec codec;      /**< Compresión de los bloques (versión 2). */
+    uint64_t chunk_rows;    /**< Filas por bloque; 0 para el valor por
+                                 defecto de unos 1 MiB por bloque. */
+    int threads;            /**< Hilos para comprimir y escribir bloques. */
+} plate_format;
+
+/**
+ * @brief Entrada del índice de bloques de un archivo versión 2.
+ */
+typedef struct {
+    uint64_t offset;        /**< Posición del bloque en el archivo. */
+    uint64_t size;          /**< Bytes guardados del bloque. */
+    uint32_t crc;           /**< CRC-32 de los bytes guardados. */
+    uint32_t codec;         /**< `plate_codec` del bloque. */
+} plate_chunk;
+
+/**
+ * @brief Archivo binario abierto para leer bloques de filas.
+ */
+typedef struct {
+    int fd;                 /**< Descriptor del archivo. */
+    int version;            /**< Versión detectada. */
+    uint64_t rows;          /**< Número de filas de la lámina. */
+    uint64_t columns;       /**< Número de columnas de la lámina. */
+    uint64_t chunk_rows;    /**< Filas por bloque. */
+    uint64_t chunk_count;   /**< Cantidad de bloques. */
+    plate_chunk* index;     /**< Índice de bloques (solo versión 2). */
+    const char* path;       /**< Ruta del archivo, para los mensajes. */
+} plate_reader;
+
+/**
+ * @brief Archivo binario abierto para escribir bloques de filas.
+ */
+typedef struct {
+    int fd;                 /**< Descriptor del archivo. */
+    plate_format format;    /**< Formato del archivo. */
+    uint64_t rows;          /**< Número de filas de la lámina. */
+    uint64_t columns;       /**< Número de columnas de la lámina. */
+    uint64_t chunk_count;   /**< Cantidad de bloques. */
+    plate_chunk* index;     /**< Índice de bloques (solo versión 2). */
+    uint64_t end;           /**< Posición donde se agrega el siguiente
+                                 bloque. */
+    int failed;             /**< Distinto de 0 si alguna escritura falló. */
+    const char* path;       /**< Ruta del archivo, para los mensajes. */
+} plate_writer;
+
+/**
+ * @brief Lee el formato de salida de las variables de ambiente.
+ *
+ * @details `HEATSIM_PLATE_FORMAT=2` escribe la versión 2 y
+ * `HEATSIM_PLATE_COMPRESS=1` además comprime los bloques. Sin ellas se
+ * escribe la versión 1.
+ *
+ * @param format Formato a inicializar.
+ * @param threads Hilos para comprimir y escribir bloques.
+ */
+void plate_format_init(plate_format* format, int threads);
+
+/**
+ * @brief Filas por bloque con que se escribe una lámina.
+ *
+ * @param format Formato del archivo.
+ * @param columns Número de columnas de la lámina.
+ * @return `format->chunk_rows`, o el valor por defecto si es 0.
+ */
+uint64_t plate_format_chunk_rows(const plate_format* format, uint64_t columns);
+
+/**
+ * @brief Abre un archivo binario de cualquier versión y lee sus dimensiones.
+ *
+ * @param reader Lector a inicializar.
+ * @param path Ruta del archivo; debe seguir existiendo mientras se lee.
+ * @return 0 si tuvo éxito, 1 si no se pudo abrir o el encabezado es inválido.
+ */
+int plate_reader_open(plate_reader* reader, const char* path);
+
+/**
+ * @brief Lee un bloque de filas y verifica su CRC-32.
+ *
+ * @details Se puede llamar desde varios hilos a la vez con bloques distintos.
+ *
+ * @param reader Lector del archivo.
+ * @param chunk Número del bloque.
+ * @param rows Punteros a las filas del bloque; `rows[0]` es su primera fila.
+ * @return 0 si tuvo éxito, 1 si falló la lectura o el bloque está dañado.
+ */
+int plate_reader_chunk(const plate_reader* reader, uint64_t chunk,
+                       double** rows);
+
+/**
+ * @brief Lee toda la lámina, repartiendo los bloques entre hilos.
+ *
+ * @param reader Lector del archivo.
+ * @param matrix Matriz de `rows` x `columns` donde se guardan los datos.
+ * @param threads Hilos para leer bloques (solo con OpenMP).
+ * @return 0 si tuvo éxito, 1 si algún bloque falló.
+ */
+int plate_reader_read(const plate_reader* reader, double** matrix,
+                      int threads);
+
+/**
+ * @brief Cierra el archivo y libera el índice.
+ *
+ * @param reader Lector a cerrar.
+ */
+void plate_reader_close(plate_reader* reader);
+
+/**
+ * @brief Crea un archivo binario para escribirlo por bloques de filas.
+ *
+ * @param writer Escritor a inicializar.
+ * @param path Ruta del archivo; debe seguir existiendo mientras se escribe.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param format Formato del archivo.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_writer_open(plate_writer* writer, const char* path, uint64_t rows,
+                      uint64_t columns, const plate_format* format);
+
+/**
+ * @brief Filas por bloque que espera `plate_writer_chunk`.
+ *
+ * @param writer Escritor del archivo.
+ * @return Filas por bloque; el último bloque puede tener menos.
+ */
+uint64_t plate_writer_chunk_rows(const plate_writer* writer);
+
+/**
+ * @brief Comprime si corresponde y escribe un bloque de filas.
+ *
+ * @details Los bloques se pueden escribir en cualquier orden y, en la versión
+ * con OpenMP, desde varios hilos a la vez.
+ *
+ * @param writer Escritor del archivo.
+ * @param chunk Número del bloque.
+ * @param rows Punteros a las filas del bloque; `rows[0]` es su primera fila.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_writer_chunk(plate_writer* writer, uint64_t chunk, double** rows);
+
+/**
+ * @brief Escribe el encabezado y el índice, y cierra el archivo.
+ *
+ * @param writer Escritor a cerrar.
+ * @return 0 si todo el archivo se escribió, 1 si no.
+ */
+int plate_writer_close(plate_writer* writer);
+
+/**
+ * @brief Escribe una lámina completa, repartiendo los bloques entre hilos.
+ *
+ * @param path Ruta del archivo.
+ * @param matrix Matriz con los datos de la lámina.
+ * @param rows Número de filas de la lámina.
+ * @param columns Número de columnas de la lámina.
+ * @param format Formato del archivo.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+int plate_write(const char* path, double** matrix, uint64_t rows,
+                uint64_t columns, const plate_format* format);
+
+#endif  // PLATE_FORMAT_H
@@ -0,0 +1,6 @@
+# bench  ## Run every heatsim version on synthetic plates and write a CSV
+# Options are read by scripts/bench.sh, e.g:
+#   make bench SIZES="256x256 512x512" WORKERS="1 2 4 8" SCALING=strong
+.PHONY: bench
+bench: $(EXEFILE)
+	scripts/bench.sh
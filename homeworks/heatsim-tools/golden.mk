@@ -0,0 +1,6 @@
+# golden  ## Compare heatsim versions against a reference on the test jobs
+# Options are read by scripts/golden.sh, e.g:
+#   make golden CANDIDATES="omp omp,auto omp,HEATSIM_ACTIVE_TILES=1" ULPS=4
+.PHONY: golden
+golden:
+	scripts/golden.sh
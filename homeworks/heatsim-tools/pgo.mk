@@ -0,0 +1,6 @@
+# pgo  ## Build heatsim versions with -march, LTO and a training profile
+# Options are read by scripts/pgo.sh, e.g:
+#   make pgo BACKENDS="pthread omp" TRAIN="job001 job002" MEASURE=job003
+.PHONY: pgo
+pgo:
+	scripts/pgo.sh
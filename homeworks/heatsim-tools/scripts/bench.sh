@@ -0,0 +1,167 @@
+#!/bin/bash
+#  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#
+# Ejecuta las versiones serial, pthread, omp y mpi de la simulación sobre
+# láminas sintéticas y escribe un CSV con tiempo de pared, celdas por segundo,
+# GB/s efectivos, speedup y eficiencia. Todas las opciones se pasan como
+# variables de ambiente (ver README.md). El speedup siempre es respecto a la
+# versión serial sobre la lámina de referencia.
+set -euo pipefail
+
+HOMEWORKS=$(cd "$(dirname "$0")/../.." && pwd)
+TOOL=${TOOL:-$HOMEWORKS/heatsim-tools/bin/heatsim-tools}
+BENCH_DIR=${BENCH_DIR:-$HOMEWORKS/heatsim-tools/build/bench}
+CSV=${CSV:-$BENCH_DIR/bench.csv}
+SIZES=${SIZES:-256x256}
+WORKERS=${WORKERS:-1 2 4}
+SCALING=${SCALING:-strong weak}
+BACKENDS=${BACKENDS:-serial pthread omp mpi}
+PATTERN=${PATTERN:-top}
+PARAMS=${PARAMS:-1 1 2 0.01}
+REPS=${REPS:-3}
+MPIEXEC=${MPIEXEC:-mpiexec}
+MPIFLAGS=${MPIFLAGS:-}
+# Bytes que mueve cada actualización de celda: leer el estado actual y
+# escribir el siguiente. Los vecinos se asumen en caché.
+BYTES_PER_CELL=${BYTES_PER_CELL:-16}
+
+# Carpeta de cada versión relativa a homeworks/ y nombre de su ejecutable
+declare -A PROJECT=([serial]=heatsim-serial [pthread]=heatsim-pthread
+                    [omp]=heatsim-omp_mpi/omp [mpi]=heatsim-omp_mpi/mpi)
+# Los ejecutables optimizados se compilan aparte para no mezclarse con los de
+# depuración que genera `make` por defecto
+RELEASE_DIR=build/release
+
+# executable <versión>: imprime la ruta del ejecutable optimizado
+executable() {
+    local dir=$HOMEWORKS/${PROJECT[$1]}
+    echo "$dir/$RELEASE_DIR/bin/$(basename "$dir")"
+}
+
+# build <versión>: compila la versión en modo release, falla si no se puede
+build() {
+    make -s -C "$HOMEWORKS/${PROJECT[$1]}" release BUILD="$RELEASE_DIR/obj" \
+        BIN="$RELEASE_DIR/bin" >&2
+}
+
+# plate <filas> <columnas>: genera la lámina una sola vez e imprime su ruta
+plate() {
+    local path=$BENCH_DIR/plates/$PATTERN-$1x$2.bin
+    if [[ ! -f $path ]]; then
+        mkdir -p "$(dirname "$path")"
+        "$TOOL" generate "$path" "$1" "$2" "$PATTERN" >&2
+    fi
+    echo "$path"
+}
+
+# run <versión> <trabajadores> <lámina>: ejecuta REPS veces un trabajo de una
+# lámina e imprime "<segundos> <estados>" de la ejecución más rápida
+run() {
+    local backend=$1 workers=$2 bin_path=$3
+    local work=$BENCH_DIR/run-$backend-$workers
+    local best= states= elapsed
+    for ((rep = 0; rep < REPS; rep++)); do
+        rm -rf "$work" && mkdir -p "$work"
+        ln -s "$bin_path" "$work/plate.bin"
+        echo "plate.bin $PARAMS" > "$work/job.txt"
+        local cmd=("$(executable "$backend")" "$work" job.txt)
+        case $backend in
+            serial) ;;
+            mpi) cmd=("$MPIEXEC" $MPIFLAGS -n "$workers" "${cmd[@]}") ;;
+            *) cmd+=("$workers") ;;
+        esac
+        elapsed=$("${cmd[@]}" | sed -n \
+                  's/^Tiempo de ejecución: \([0-9.]*\)s$/\1/p') || true
+        if [[ -z $elapsed ]]; then
+            echo "bench: falló $backend con $workers trabajadores" >&2
+            return 1
+        fi
+        states=$(awk -F'\t' '{ total += $6 } END { print total }' \
+                                                               "$work/job.tsv")
+        if [[ -z $best ]] || awk "BEGIN { exit !($elapsed < $best) }"; then
+            best=$elapsed
+        fi
+    done
+    rm -rf "$work"
+    echo "$best $states"
+}
+
+# Compilar la herramienta y las versiones; las que no compilan se omiten
+make -s -C "$HOMEWORKS/heatsim-tools" release >&2
+available=()
+for backend in serial $BACKENDS; do
+    if [[ " ${available[*]} " != *" $backend "* ]]; then
+        if build "$backend"; then
+            available+=("$backend")
+        else
+            echo "bench: se omite $backend porque no compiló" >&2
+        fi
+    fi
+done
+if [[ " ${available[*]} " != *" serial "* ]]; then
+    echo "bench: la versión serial es necesaria como referencia" >&2
+    exit 1
+fi
+
+mkdir -p "$(dirname "$CSV")"
+echo "backend,scaling,workers,rows,columns,states,wall_s,cells_per_s,\
+gb_per_s,speedup,efficiency" > "$CSV"
+
+# record <versión> <escalamiento> <trabajadores> <filas> <columnas>
+# <resultado> <resultado serial de referencia>: agrega una fila al CSV a partir
+# de los "<segundos> <estados>" de una ejecución
+record() {
+    awk -v backend="$1" -v scaling="$2" -v workers="$3" -v rows="$4" \
+        -v columns="$5" -v result="$6" -v reference="$7" \
+        -v reference_rows="$reference_rows" -v bytes="$BYTES_PER_CELL" '
+        function throughput(text, plate_rows,    fields) {
+            split(text, fields, " ")
+            return (plate_rows - 2) * (columns - 2) * fields[2] / fields[1]
+        }
+        BEGIN {
+            split(result, fields, " ")
+            cells = throughput(result, rows)
+            speedup = cells / throughput(reference, reference_rows)
+            printf "%s,%s,%d,%d,%d,%d,%.6f,%.6g,%.4f,%.4f,%.4f\n", backend,
+                scaling, workers, rows, columns, fields[2], fields[1], cells,
+                cells * bytes / 1e9, speedup, speedup / workers
+        }' >> "$CSV"
+    tail -n 1 "$CSV" >&2
+}
+
+for size in $SIZES; do
+    rows=${size%x*}
+    columns=${size#*x}
+    # La versión serial sobre la lámina base es la referencia del speedup
+    reference_rows=$rows
+    reference=$(run serial 1 "$(plate "$rows" "$columns")")
+    for scaling in $SCALING; do
+        for backend in "${available[@]}"; do
+            if [[ " $BACKENDS " != *" $backend "* ]]; then
+                continue
+            fi
+            for workers in $WORKERS; do
+                # La serial no escala: solo se reporta con un trabajador
+                if [[ $backend == serial ]]; then
+                    if [[ $workers == 1 ]]; then
+                        record serial "$scaling" 1 "$rows" "$columns" \
+                                                    "$reference" "$reference"
+                    fi
+                    continue
+                fi
+                # En escalamiento débil cada trabajador aporta `rows` filas
+                scaled_rows=$rows
+                if [[ $scaling == weak ]]; then
+                    scaled_rows=$((rows * workers))
+                fi
+                if result=$(run "$backend" "$workers" \
+                                    "$(plate "$scaled_rows" "$columns")"); then
+                    record "$backend" "$scaling" "$workers" "$scaled_rows" \
+                                        "$columns" "$result" "$reference"
+                fi
+            done
+        done
+    done
+done
+
+echo "bench: resultados en $CSV" >&2
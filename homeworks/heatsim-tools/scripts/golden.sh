@@ -0,0 +1,189 @@
+#!/bin/bash
+#  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#
+# Ejecuta una versión de referencia sobre los trabajos de tests/ para obtener
+# las salidas doradas, y luego cada versión o variante candidata sobre los
+# mismos trabajos. Compara los reportes (.tsv) exactamente y las láminas
+# finales (.bin) con una tolerancia en ULP, y escribe un CSV con una fila por
+# lámina y los tiempos de ambas versiones. Todas las opciones se pasan como
+# variables de ambiente (ver README.md). Termina con error si alguna lámina
+# no coincide.
+set -euo pipefail
+
+HOMEWORKS=$(cd "$(dirname "$0")/../.." && pwd)
+TOOL=${TOOL:-$HOMEWORKS/heatsim-tools/bin/heatsim-tools}
+GOLDEN_DIR=${GOLDEN_DIR:-$HOMEWORKS/heatsim-tools/build/golden}
+CSV=${CSV:-$GOLDEN_DIR/golden.csv}
+REFERENCE=${REFERENCE:-serial}
+# La última variante escribe las láminas en versión 2 comprimida
+CANDIDATES=${CANDIDATES:-pthread omp mpi \
+            omp,HEATSIM_PLATE_FORMAT=2,HEATSIM_PLATE_COMPRESS=1}
+JOBS=${JOBS:-job001 job002 job003}
+THREADS=${THREADS:-$(nproc)}
+ULPS=${ULPS:-0}
+REFRESH=${REFRESH:-0}
+CANDIDATE_OPTF=${CANDIDATE_OPTF:-}
+MPIEXEC=${MPIEXEC:-mpiexec}
+MPIFLAGS=${MPIFLAGS:-}
+
+# Carpeta de cada versión relativa a homeworks/
+declare -A PROJECT=([serial]=heatsim-serial [pthread]=heatsim-pthread
+                    [omp]=heatsim-omp_mpi/omp [mpi]=heatsim-omp_mpi/mpi)
+# La referencia y los candidatos usan la compilación release de `make bench`;
+# con CANDIDATE_OPTF los candidatos se compilan aparte
+RELEASE_DIR=build/release
+VARIANT_DIR=build/golden
+# La compilación guiada por perfiles que deja `make pgo`
+GUIDED_DIR=build/pgo
+
+# executable <versión> <carpeta>: imprime la ruta del ejecutable compilado en
+# la carpeta
+executable() {
+    local dir=$HOMEWORKS/${PROJECT[$1]}
+    echo "$dir/$2/bin/$(basename "$dir")"
+}
+
+# build <versión> <carpeta> <opciones>: compila la versión en modo release en
+# la carpeta, agregando las opciones a las de release
+build() {
+    make -s -C "$HOMEWORKS/${PROJECT[$1]}" release BUILD="$2/obj" \
+        BIN="$2/bin" OPTF="$3" >&2
+}
+
+# run <versión> <ejecutable> <trabajo> <carpeta> <argumento> [VAR=valor...]:
+# copia el trabajo de tests/ a la carpeta, lo ejecuta con las variables de
+# ambiente indicadas y escribe el tiempo de pared reportado en <carpeta>.time
+run() {
+    local backend=$1 executable=$2 job=$3 work=$4 argument=$5
+    shift 5
+    rm -rf "$work" && mkdir -p "$(dirname "$work")"
+    cp -r "$HOMEWORKS/${PROJECT[$backend]}/tests/$job" "$work"
+    # Las salidas esperadas de tests/ no se comparan: se comparan las nuevas
+    rm -rf "$work"/*-*.bin "$work/tsv"
+    local cmd=("$executable" "$work" "$job.txt")
+    case $backend in
+        serial) ;;
+        mpi) cmd=("$MPIEXEC" $MPIFLAGS -n "$THREADS" "${cmd[@]}") ;;
+        *) cmd+=("$argument") ;;
+    esac
+    local elapsed
+    elapsed=$(env "$@" "${cmd[@]}" | sed -n \
+              's/^Tiempo de ejecución: \([0-9.]*\)s$/\1/p') || true
+    if [[ -z $elapsed ]]; then
+        echo "golden: falló $backend con $job" >&2
+        return 1
+    fi
+    echo "$elapsed" > "$work.time"
+}
+
+# compare <candidato> <trabajo> <carpeta>: compara la salida del candidato con
+# la dorada, agrega una fila al CSV por lámina e imprime las que no coinciden
+compare() {
+    local candidate=$1 job=$2 work=$3
+    local golden=$GOLDEN_DIR/$REFERENCE/$job
+    local golden_s actual_s
+    golden_s=$(cat "$golden.time")
+    actual_s=$(cat "$work.time")
+    local line=0 mismatches=0 plate reference actual
+    local golden_states states report result
+    while IFS= read -r reference; do
+        line=$((line + 1))
+        actual=$(sed -n "${line}p" "$work/$job.tsv" 2>/dev/null || true)
+        plate=$(cut -f1 <<< "$reference")
+        golden_states=$(cut -f6 <<< "$reference")
+        states=$(cut -f6 <<< "$actual")
+        report=equal
+        if [[ $reference != "$actual" ]]; then
+            report=different
+        fi
+        # El nombre de la lámina final lleva los estados de cada ejecución
+        result=$("$TOOL" compare \
+                 "$golden/${plate%.bin}-$golden_states.bin" \
+                 "$work/${plate%.bin}-$states.bin" "$ULPS" 2> /dev/null) ||
+                 true
+        if [[ -z $result ]]; then
+            result=$'-\t-\t-'
+        fi
+        local cells_over max_ulps max_difference
+        IFS=$'\t' read -r cells_over max_ulps max_difference _ <<< "$result"
+        echo "$candidate,$job,$plate,$golden_states,${states:--},$report,\
+$cells_over,$max_ulps,$max_difference,$golden_s,$actual_s" >> "$CSV"
+        if [[ $report != equal || $cells_over != 0 ]]; then
+            mismatches=$((mismatches + 1))
+            echo "  $plate: estados $golden_states y ${states:--}," \
+                 "reporte $report, celdas fuera de tolerancia $cells_over," \
+                 "máximo $max_ulps ULP" >&2
+        fi
+    done < "$golden/$job.tsv"
+    echo "golden: $candidate $job: $((line - mismatches))/$line láminas" \
+         "iguales, ${actual_s}s contra ${golden_s}s de $REFERENCE" >&2
+    [[ $mismatches == 0 ]]
+}
+
+# Compilar la herramienta y la referencia
+make -s -C "$HOMEWORKS/heatsim-tools" release >&2
+build "$REFERENCE" "$RELEASE_DIR" ""
+
+# Las salidas doradas se conservan entre ejecuciones; REFRESH=1 las regenera
+for job in $JOBS; do
+    golden=$GOLDEN_DIR/$REFERENCE/$job
+    if [[ $REFRESH == 1 || ! -f $golden.time ]]; then
+        run "$REFERENCE" "$(executable "$REFERENCE" "$RELEASE_DIR")" "$job" \
+            "$golden" 1
+        # Los estados deben ser los que esperan los casos de prueba
+        expected=$HOMEWORKS/${PROJECT[$REFERENCE]}/tests/$job/$job.out
+        if [[ -f $expected ]] && ! diff -q <(cut -f1,6 "$expected") \
+                            <(cut -f1,6 "$golden/$job.tsv") > /dev/null; then
+            echo "golden: los estados de $REFERENCE no coinciden con" \
+                 "$expected" >&2
+        fi
+    fi
+done
+
+mkdir -p "$(dirname "$CSV")"
+echo "candidate,job,plate,golden_states,states,report,cells_over,max_ulps,\
+max_difference,golden_s,candidate_s" > "$CSV"
+
+failed=0
+for candidate in $CANDIDATES; do
+    # <versión>[,VAR=valor][,pgo][,argumento]: variables de ambiente, la
+    # compilación de `make pgo` o un argumento en lugar de los hilos
+    IFS=, read -r -a options <<< "$candidate"
+    backend=${options[0]}
+    environment=()
+    argument=$THREADS
+    build_dir=$RELEASE_DIR
+    if [[ -n $CANDIDATE_OPTF ]]; then
+        build_dir=$VARIANT_DIR
+    fi
+    for option in "${options[@]:1}"; do
+        case $option in
+            *=*) environment+=("$option") ;;
+            pgo) build_dir=$GUIDED_DIR ;;
+            *) argument=$option ;;
+        esac
+    done
+    if [[ -z ${PROJECT[$backend]:-} ]]; then
+        echo "golden: versión desconocida $backend" >&2
+        failed=1
+        continue
+    fi
+    if [[ $build_dir != "$GUIDED_DIR" ]] &&
+       ! build "$backend" "$build_dir" "$CANDIDATE_OPTF"; then
+        echo "golden: se omite $candidate porque no compiló" >&2
+        failed=1
+        continue
+    fi
+    label=$(tr ',=/' '_-_' <<< "$candidate")
+    for job in $JOBS; do
+        work=$GOLDEN_DIR/run/$label/$job
+        if ! run "$backend" "$(executable "$backend" "$build_dir")" "$job" \
+                 "$work" "$argument" "${environment[@]}" ||
+           ! compare "$candidate" "$job" "$work"; then
+            failed=1
+        fi
+    done
+done
+
+echo "golden: resultados en $CSV" >&2
+exit $failed
@@ -0,0 +1,132 @@
+#!/bin/bash
+#  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#
+# Compila las versiones de la simulación con -march, LTO y optimización guiada
+# por perfiles: una compilación instrumentada ejecuta los trabajos de
+# entrenamiento y la compilación final usa el perfil recolectado. Luego mide
+# el trabajo de medición con la compilación release normal y con la guiada, y
+# escribe un CSV con el speedup. Todas las opciones se pasan como variables de
+# ambiente (ver README.md).
+set -euo pipefail
+
+HOMEWORKS=$(cd "$(dirname "$0")/../.." && pwd)
+PGO_DIR=${PGO_DIR:-$HOMEWORKS/heatsim-tools/build/pgo}
+CSV=${CSV:-$PGO_DIR/pgo.csv}
+BACKENDS=${BACKENDS:-serial pthread omp mpi}
+TRAIN=${TRAIN:-job001 job002}
+MEASURE=${MEASURE:-job003}
+THREADS=${THREADS:-$(nproc)}
+REPS=${REPS:-3}
+MPIEXEC=${MPIEXEC:-mpiexec}
+MPIFLAGS=${MPIFLAGS:-}
+# -ffp-contract=off evita que -march convierta sumas y productos en FMA, que
+# redondean distinto y cambiarían los estados del reporte
+PGO_FLAGS=${PGO_FLAGS:--march=native -flto=auto -ffp-contract=off}
+
+# Carpeta de cada versión relativa a homeworks/
+declare -A PROJECT=([serial]=heatsim-serial [pthread]=heatsim-pthread
+                    [omp]=heatsim-omp_mpi/omp [mpi]=heatsim-omp_mpi/mpi)
+# La compilación release normal es la misma que usa `make bench`; la guiada
+# se compila aparte y el perfil queda junto a sus archivos objeto
+RELEASE_DIR=build/release
+GUIDED_DIR=build/pgo
+
+# executable <versión> <carpeta>: imprime la ruta del ejecutable compilado en
+# la carpeta
+executable() {
+    local dir=$HOMEWORKS/${PROJECT[$1]}
+    echo "$dir/$2/bin/$(basename "$dir")"
+}
+
+# build <versión> <carpeta> <opciones>: compila la versión en modo release en
+# la carpeta, agregando las opciones a las de release
+build() {
+    make -s -C "$HOMEWORKS/${PROJECT[$1]}" release BUILD="$2/obj" \
+        BIN="$2/bin" OPTF="$3" >&2
+}
+
+# run <versión> <ejecutable> <trabajo> <carpeta>: copia el trabajo de tests/
+# a la carpeta, lo ejecuta e imprime el tiempo de pared reportado
+run() {
+    local backend=$1 executable=$2 job=$3 work=$4
+    rm -rf "$work" && mkdir -p "$(dirname "$work")"
+    cp -r "$HOMEWORKS/${PROJECT[$backend]}/tests/$job" "$work"
+    local cmd=("$executable" "$work" "$job.txt")
+    case $backend in
+        serial) ;;
+        mpi) cmd=("$MPIEXEC" $MPIFLAGS -n "$THREADS" "${cmd[@]}") ;;
+        *) cmd+=("$THREADS") ;;
+    esac
+    local elapsed
+    elapsed=$("${cmd[@]}" | sed -n \
+              's/^Tiempo de ejecución: \([0-9.]*\)s$/\1/p') || true
+    if [[ -z $elapsed ]]; then
+        echo "pgo: falló $backend con $job" >&2
+        return 1
+    fi
+    echo "$elapsed"
+}
+
+# best <versión> <ejecutable> <carpeta>: ejecuta REPS veces el trabajo de
+# medición e imprime el menor tiempo; la carpeta queda con la última salida
+best() {
+    local best= elapsed
+    for ((rep = 0; rep < REPS; rep++)); do
+        elapsed=$(run "$1" "$2" "$MEASURE" "$3") || return 1
+        if [[ -z $best ]] || awk "BEGIN { exit !($elapsed < $best) }"; then
+            best=$elapsed
+        fi
+    done
+    echo "$best"
+}
+
+# guided <versión>: compila con instrumentación, entrena y recompila con el
+# perfil recolectado
+guided() {
+    local backend=$1 job
+    local dir=$HOMEWORKS/${PROJECT[$backend]}/$GUIDED_DIR
+    rm -rf "$dir"
+    build "$backend" "$GUIDED_DIR" \
+        "$PGO_FLAGS -fprofile-generate -fprofile-update=prefer-atomic" ||
+        return 1
+    for job in $TRAIN; do
+        run "$backend" "$(executable "$backend" "$GUIDED_DIR")" "$job" \
+            "$PGO_DIR/train-$backend" > /dev/null || return 1
+    done
+    # Los .gcda se quedan; solo se borra lo que hay que recompilar
+    find "$dir" -name '*.o' -delete
+    rm -rf "$dir/bin"
+    build "$backend" "$GUIDED_DIR" \
+        "$PGO_FLAGS -fprofile-use -fprofile-correction -Wno-missing-profile"
+}
+
+mkdir -p "$(dirname "$CSV")"
+echo "backend,job,workers,release_s,pgo_s,speedup,identical" > "$CSV"
+
+for backend in $BACKENDS; do
+    if ! build "$backend" "$RELEASE_DIR" "" || ! guided "$backend"; then
+        echo "pgo: se omite $backend porque no compiló o no entrenó" >&2
+        continue
+    fi
+    release=$(best "$backend" "$(executable "$backend" "$RELEASE_DIR")" \
+                                        "$PGO_DIR/run-$backend-release") ||
+        continue
+    pgo=$(best "$backend" "$(executable "$backend" "$GUIDED_DIR")" \
+                                        "$PGO_DIR/run-$backend-pgo") || continue
+    # El reporte y las láminas finales deben ser idénticos a los de release
+    identical=yes
+    if ! diff -rq "$PGO_DIR/run-$backend-release" \
+                        "$PGO_DIR/run-$backend-pgo" > /dev/null; then
+        identical=no
+    fi
+    awk -v backend="$backend" -v job="$MEASURE" -v workers="$THREADS" \
+        -v release="$release" -v pgo="$pgo" -v identical="$identical" '
+        BEGIN {
+            printf "%s,%s,%d,%.6f,%.6f,%.4f,%s\n", backend, job, workers,
+                release, pgo, release / pgo, identical
+        }' >> "$CSV"
+    tail -n 1 "$CSV" >&2
+done
+
+rm -rf "$PGO_DIR"/train-* "$PGO_DIR"/run-*
+echo "pgo: resultados en $CSV" >&2
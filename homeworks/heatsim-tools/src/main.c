@@ -0,0 +1,137 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plate_compare.h"
+#include "plate_generator.h"
+
+/**
+ * @brief Subcomando `generate`: crea una lámina sintética.
+ *
+ * @param argc Número de argumentos del subcomando.
+ * @param argv Argumentos del subcomando, sin el nombre del programa.
+ * @return 0 si tuvo éxito, 1 si hubo un error.
+ */
+static int command_generate(int argc, char* argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Uso: generate <archivo.bin> <filas> <columnas> "
+                        "[patrón] [caliente] [fría] [semilla]\n"
+                        "Patrones: uniform, top, gradient, random\n");
+        return 1;
+    }
+
+    plate_spec spec = {
+        .rows = strtoull(argv[2], NULL, 10),
+        .columns = strtoull(argv[3], NULL, 10),
+        .pattern = BOUNDARY_TOP,
+        .hot = argc >= 6 ? strtod(argv[5], NULL) : 100.0,
+        .cold = argc >= 7 ? strtod(argv[6], NULL) : 0.0,
+        .seed = argc >= 8 ? strtoull(argv[7], NULL, 10) : 0,
+    };
+    if (spec.rows < 3 || spec.columns < 3) {
+        fprintf(stderr, "La lámina debe tener al menos 3x3 celdas\n");
+        return 1;
+    }
+    if (argc >= 5 && parse_boundary_pattern(argv[4], &spec.pattern) != 0) {
+        fprintf(stderr, "Patrón de bordes desconocido: %s\n", argv[4]);
+        return 1;
+    }
+    return generate_plate(argv[1], &spec);
+}
+
+/**
+ * @brief Convierte un texto decimal a un entero sin signo de 64 bits.
+ *
+ * @param text Texto a convertir, que solo debe tener dígitos.
+ * @param value Dónde se guarda el número convertido.
+ * @return 0 si tuvo éxito, 1 si el texto no es un número válido.
+ */
+static int parse_uint64(const char* text, uint64_t* value) {
+    // strtoull acepta espacios y signo, y da 0 si no hay dígitos
+    if (text[0] < '0' || text[0] > '9') {
+        return 1;
+    }
+    char* end = NULL;
+    errno = 0;
+    const unsigned long long number = strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0' || number > UINT64_MAX) {
+        return 1;
+    }
+    *value = number;
+    return 0;
+}
+
+/**
+ * @brief Subcomando `compare`: compara dos láminas con tolerancia en ULP.
+ *
+ * @details Imprime, separados por tabuladores, las celdas fuera de la
+ * tolerancia, la mayor distancia en ULP, la mayor diferencia absoluta y la
+ * fila y columna de la primera celda fuera de la tolerancia.
+ *
+ * @param argc Número de argumentos del subcomando.
+ * @param argv Argumentos del subcomando, sin el nombre del programa.
+ * @return 0 si son iguales dentro de la tolerancia, 2 si no, 1 si hubo un
+ * error.
+ */
+static int command_compare(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Uso: compare <esperada.bin> <lámina.bin> [ulps]\n");
+        return 1;
+    }
+    uint64_t tolerance = 0;
+    if (argc >= 4 && parse_uint64(argv[3], &tolerance) != 0) {
+        fprintf(stderr, "Tolerancia en ULP no válida: %s\n", argv[3]);
+        return 1;
+    }
+    plate_difference difference;
+    if (compare_plates(argv[1], argv[2], tolerance, &difference) != 0) {
+        return 1;
+    }
+    printf("%" PRIu64 "\t%" PRIu64 "\t%.17g\t%" PRIu64 "\t%" PRIu64 "\n",
+           difference.cells_over, difference.max_ulps,
+           difference.max_difference, difference.first_row,
+           difference.first_column);
+    return difference.cells_over == 0 ? 0 : 2;
+}
+
+/**
+ * @brief Subcomando disponible en la herramienta.
+ */
+typedef struct {
+    const char* name;                       /**< Nombre del subcomando. */
+    int (*run)(int argc, char* argv[]);     /**< Función que lo ejecuta. */
+    const char* help;                       /**< Descripción corta. */
+} tool_command;
+
+/// Subcomandos que reconoce la herramienta
+static const tool_command commands[] = {
+    {"generate", command_generate, "Genera una lámina sintética (.bin)"},
+    {"compare", command_compare, "Compara dos láminas con tolerancia en ULP"},
+};
+
+/**
+ * @brief Herramientas de apoyo para las simulaciones de calor.
+ *
+ * @param argc Número de argumentos pasados a la línea de comandos.
+ * @param argv Arreglo de cadenas con los argumentos.
+ * @return 0 si el subcomando tuvo éxito, 1 si hay un error.
+ */
+int main(int argc, char* argv[]) {
+    const size_t count = sizeof(commands) / sizeof(commands[0]);
+    if (argc >= 2) {
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(argv[1], commands[i].name) == 0) {
+                return commands[i].run(argc - 1, argv + 1);
+            }
+        }
+    }
+
+    fprintf(stderr, "Uso: %s <subcomando> [argumentos]\n", argv[0]);
+    for (size_t i = 0; i < count; i++) {
+        fprintf(stderr, "  %-10s %s\n", commands[i].name, commands[i].help);
+    }
+    return 1;
+}
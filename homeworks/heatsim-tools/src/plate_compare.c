@@ -0,0 +1,175 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plate_compare.h"
+#include "plate_format.h"
+
+/**
+ * @brief Lámina que se recorre fila por fila, un bloque a la vez.
+ */
+typedef struct {
+    plate_reader reader;    /**< Archivo de la lámina. */
+    double** rows;          /**< Filas del bloque leído. */
+    double* cells;          /**< Celdas del bloque leído. */
+    uint64_t chunk;         /**< Siguiente bloque a leer. */
+    uint64_t next_row;      /**< Siguiente fila dentro del bloque. */
+    uint64_t loaded_rows;   /**< Filas del bloque leído. */
+} plate_cursor;
+
+/**
+ * @brief Convierte un `double` a un entero que conserva el orden.
+ *
+ * @details Los bits de un `double` positivo ya crecen con su valor; los
+ * negativos se reflejan para que queden antes y en orden. Así la resta de
+ * dos claves es la cantidad de valores representables entre ellos.
+ *
+ * @param value Número a convertir.
+ * @return Clave ordenada del número.
+ */
+static int64_t ordered_key(double value) {
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? INT64_MIN - bits : bits;
+}
+
+/**
+ * @brief Calcula la distancia en ULP entre dos números de punto flotante.
+ *
+ * @param a Primer número.
+ * @param b Segundo número.
+ * @return Distancia en ULP.
+ */
+uint64_t ulp_distance(double a, double b) {
+    if (isnan(a) || isnan(b)) {
+        return isnan(a) && isnan(b) ? 0 : UINT64_MAX;
+    }
+    const int64_t key_a = ordered_key(a);
+    const int64_t key_b = ordered_key(b);
+    // La resta se hace sin signo para que no se desborde
+    return key_a > key_b ? (uint64_t)key_a - (uint64_t)key_b :
+                           (uint64_t)key_b - (uint64_t)key_a;
+}
+
+/**
+ * @brief Abre una lámina de cualquier versión para recorrerla por filas.
+ *
+ * @param cursor Cursor a inicializar.
+ * @param path Ruta de la lámina.
+ * @return 0 si tuvo éxito, 1 si no.
+ */
+static int open_plate(plate_cursor* cursor, const char* path) {
+    memset(cursor, 0, sizeof(plate_cursor));
+    if (plate_reader_open(&cursor->reader, path) != 0) {
+        return 1;
+    }
+    const uint64_t chunk_rows = cursor->reader.chunk_rows;
+    const uint64_t columns = cursor->reader.columns;
+    cursor->rows = malloc(chunk_rows * sizeof(double*));
+    cursor->cells = malloc(chunk_rows * columns * sizeof(double) + 1);
+    if (cursor->rows == NULL || cursor->cells == NULL) {
+        fprintf(stderr, "Error al asignar memoria para un bloque de %s\n",
+                path);
+        return 1;
+    }
+    for (uint64_t i = 0; i < chunk_rows; i++) {
+        cursor->rows[i] = cursor->cells + i * columns;
+    }
+    return 0;
+}
+
+/**
+ * @brief Obtiene la siguiente fila de la lámina, leyendo otro bloque si hace
+ * falta.
+ *
+ * @param cursor Cursor de la lámina.
+ * @return La fila, o NULL si el bloque no se pudo leer o está dañado.
+ */
+static const double* next_row(plate_cursor* cursor) {
+    if (cursor->next_row == cursor->loaded_rows) {
+        const plate_reader* reader = &cursor->reader;
+        if (cursor->chunk >= reader->chunk_count ||
+            plate_reader_chunk(reader, cursor->chunk, cursor->rows) != 0) {
+            return NULL;
+        }
+        const uint64_t first = cursor->chunk * reader->chunk_rows;
+        const uint64_t left = reader->rows - first;
+        cursor->loaded_rows = left < reader->chunk_rows ? left :
+                                                          reader->chunk_rows;
+        cursor->next_row = 0;
+        cursor->chunk++;
+    }
+    return cursor->rows[cursor->next_row++];
+}
+
+/**
+ * @brief Cierra la lámina y libera su bloque.
+ *
+ * @param cursor Cursor de la lámina.
+ */
+static void close_plate(plate_cursor* cursor) {
+    plate_reader_close(&cursor->reader);
+    free(cursor->rows);
+    free(cursor->cells);
+}
+
+/**
+ * @brief Compara dos láminas en formato binario versión 1 o 2.
+ *
+ * @param expected_path Ruta de la lámina esperada.
+ * @param actual_path Ruta de la lámina a verificar.
+ * @param tolerance Distancia máxima en ULP para considerar iguales dos
+ * celdas.
+ * @param difference Resultado de la comparación.
+ * @return 0 si se pudieron comparar, 1 si hubo un error.
+ */
+int compare_plates(const char* expected_path, const char* actual_path,
+                   uint64_t tolerance, plate_difference* difference) {
+    memset(difference, 0, sizeof(plate_difference));
+    plate_cursor expected, actual;
+    int error = open_plate(&expected, expected_path);
+    error = open_plate(&actual, actual_path) || error;
+    difference->rows = expected.reader.rows;
+    difference->columns = expected.reader.columns;
+    if (!error && (actual.reader.rows != difference->rows ||
+                   actual.reader.columns != difference->columns)) {
+        fprintf(stderr, "Las dimensiones no coinciden: %" PRIu64 "x%" PRIu64
+                " y %" PRIu64 "x%" PRIu64 "\n",
+                difference->rows, difference->columns, actual.reader.rows,
+                actual.reader.columns);
+        error = 1;
+    }
+
+    const uint64_t columns = difference->columns;
+    for (uint64_t i = 0; i < difference->rows && !error; i++) {
+        const double* expected_row = next_row(&expected);
+        const double* actual_row = next_row(&actual);
+        if (expected_row == NULL || actual_row == NULL) {
+            fprintf(stderr, "Falta la fila %" PRIu64 " de una de las láminas\n",
+                    i);
+            error = 1;
+            break;
+        }
+        for (uint64_t j = 0; j < columns; j++) {
+            const uint64_t ulps = ulp_distance(expected_row[j], actual_row[j]);
+            const double gap = fabs(expected_row[j] - actual_row[j]);
+            if (ulps > difference->max_ulps) {
+                difference->max_ulps = ulps;
+            }
+            if (gap > difference->max_difference) {
+                difference->max_difference = gap;
+            }
+            if (ulps > tolerance && difference->cells_over++ == 0) {
+                difference->first_row = i;
+                difference->first_column = j;
+            }
+        }
+    }
+
+    close_plate(&expected);
+    close_plate(&actual);
+    return error;
+}
@@ -0,0 +1,54 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef PLATE_COMPARE_H
+#define PLATE_COMPARE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Resultado de comparar dos láminas celda por celda.
+ */
+typedef struct {
+    uint64_t rows;              /**< Número de filas de las láminas. */
+    uint64_t columns;           /**< Número de columnas de las láminas. */
+    uint64_t cells_over;        /**< Celdas a más de la tolerancia. */
+    uint64_t max_ulps;          /**< Mayor distancia en ULP entre celdas. */
+    double max_difference;      /**< Mayor diferencia absoluta. */
+    uint64_t first_row;         /**< Fila de la primera celda fuera de la
+                                     tolerancia. */
+    uint64_t first_column;      /**< Columna de la primera celda fuera de la
+                                     tolerancia. */
+} plate_difference;
+
+/**
+ * @brief Calcula la distancia en ULP entre dos números de punto flotante.
+ *
+ * @details Es la cantidad de valores `double` representables entre ambos
+ * números. 0.0 y -0.0 están a distancia 0; dos NaN también, y un NaN está a
+ * distancia máxima de cualquier otro número.
+ *
+ * @param a Primer número.
+ * @param b Segundo número.
+ * @return Distancia en ULP.
+ */
+uint64_t ulp_distance(double a, double b);
+
+/**
+ * @brief Compara dos láminas en formato binario versión 1 o 2.
+ *
+ * @details Las láminas se leen con el lector de `plate_format`, un bloque de
+ * filas a la vez, así que se pueden comparar láminas más grandes que la
+ * memoria, de versiones distintas o comprimidas. Un bloque dañado (CRC
+ * incorrecto) es un error.
+ *
+ * @param expected_path Ruta de la lámina esperada.
+ * @param actual_path Ruta de la lámina a verificar.
+ * @param tolerance Distancia máxima en ULP para considerar iguales dos
+ * celdas.
+ * @param difference Resultado de la comparación.
+ * @return 0 si se pudieron comparar, 1 si un archivo no se pudo leer o las
+ * dimensiones no coinciden.
+ */
+int compare_plates(const char* expected_path, const char* actual_path,
+                   uint64_t tolerance, plate_difference* difference);
+
+#endif  // PLATE_COMPARE_H
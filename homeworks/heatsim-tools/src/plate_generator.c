@@ -0,0 +1,113 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plate_generator.h"
+
+/**
+ * @brief Convierte el nombre de un patrón de bordes a su valor.
+ *
+ * @param name Nombre del patrón: uniform, top, gradient o random.
+ * @param pattern Puntero donde se almacena el patrón reconocido.
+ * @return 0 si el nombre es válido, 1 si no se reconoce.
+ */
+int parse_boundary_pattern(const char* name, boundary_pattern* pattern) {
+    static const char* const names[] = {"uniform", "top", "gradient", "random"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *pattern = (boundary_pattern)i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Genera el siguiente número pseudoaleatorio en [0, 1).
+ *
+ * @details Se usa xorshift64 en lugar de rand() para que la misma semilla
+ * produzca la misma lámina en cualquier plataforma.
+ *
+ * @param state Estado del generador, no debe ser 0.
+ * @return Número pseudoaleatorio entre 0 y 1.
+ */
+static double next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return (double)(*state >> 11) / (double)(UINT64_C(1) << 53);
+}
+
+/**
+ * @brief Calcula la temperatura de una celda de borde según el patrón.
+ *
+ * @param spec Descripción de la lámina.
+ * @param row Fila de la celda.
+ * @param column Columna de la celda.
+ * @param state Estado del generador aleatorio.
+ * @return Temperatura de la celda.
+ */
+static double border_temperature(const plate_spec* spec, uint64_t row,
+                                 uint64_t column, uint64_t* state) {
+    switch (spec->pattern) {
+        case BOUNDARY_UNIFORM:
+            return spec->hot;
+        case BOUNDARY_TOP:
+            return row == 0 ? spec->hot : spec->cold;
+        case BOUNDARY_GRADIENT: {
+            const double ratio = spec->columns > 1 ?
+                (double)column / (double)(spec->columns - 1) : 0.0;
+            return spec->cold + (spec->hot - spec->cold) * ratio;
+        }
+        case BOUNDARY_RANDOM:
+            return spec->cold + (spec->hot - spec->cold) * next_random(state);
+    }
+    return spec->cold;
+}
+
+/**
+ * @brief Escribe una lámina sintética en formato binario (.bin).
+ *
+ * @param path Ruta del archivo a crear.
+ * @param spec Descripción de la lámina.
+ * @return 0 si tuvo éxito, 1 si hubo un error.
+ */
+int generate_plate(const char* path, const plate_spec* spec) {
+    FILE* bin_file = fopen(path, "wb");
+    if (bin_file == NULL) {
+        fprintf(stderr, "No se pudo crear el archivo %s\n", path);
+        return 1;
+    }
+
+    double* row_values = malloc(spec->columns * sizeof(double));
+    if (row_values == NULL) {
+        fprintf(stderr, "Error al asignar memoria para una fila\n");
+        fclose(bin_file);
+        return 1;
+    }
+
+    int error = fwrite(&spec->rows, sizeof(uint64_t), 1, bin_file) != 1 ||
+                fwrite(&spec->columns, sizeof(uint64_t), 1, bin_file) != 1;
+
+    uint64_t state = spec->seed != 0 ? spec->seed : UINT64_C(88172645463325252);
+    for (uint64_t i = 0; i < spec->rows && !error; i++) {
+        const int border_row = i == 0 || i == spec->rows - 1;
+        for (uint64_t j = 0; j < spec->columns; j++) {
+            if (border_row || j == 0 || j == spec->columns - 1) {
+                row_values[j] = border_temperature(spec, i, j, &state);
+            } else {
+                row_values[j] = spec->cold;
+            }
+        }
+        error = fwrite(row_values, sizeof(double), spec->columns, bin_file)
+                                                              != spec->columns;
+    }
+
+    free(row_values);
+    if (fclose(bin_file) != 0 || error) {
+        fprintf(stderr, "Error al escribir el archivo %s\n", path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+//  Copyright [2024] <jose.guerrarodriguez@ucr.ac.cr>
+#ifndef PLATE_GENERATOR_H
+#define PLATE_GENERATOR_H
+
+#include <stdint.h>
+
+/**
+ * @brief Patrones de temperatura para los bordes de una lámina sintética.
+ */
+typedef enum {
+    BOUNDARY_UNIFORM,   /**< Los cuatro bordes a la temperatura caliente. */
+    BOUNDARY_TOP,       /**< Solo el borde superior caliente. */
+    BOUNDARY_GRADIENT,  /**< Bordes que crecen de izquierda a derecha. */
+    BOUNDARY_RANDOM,    /**< Bordes aleatorios entre fría y caliente. */
+} boundary_pattern;
+
+/**
+ * @brief Descripción de una lámina sintética a generar.
+ */
+typedef struct {
+    uint64_t rows;              /**< Número de filas de la lámina. */
+    uint64_t columns;           /**< Número de columnas de la lámina. */
+    boundary_pattern pattern;   /**< Patrón de los bordes. */
+    double hot;                 /**< Temperatura caliente de los bordes. */
+    double cold;                /**< Temperatura inicial de las celdas. */
+    uint64_t seed;              /**< Semilla para el patrón aleatorio. */
+} plate_spec;
+
+/**
+ * @brief Convierte el nombre de un patrón de bordes a su valor.
+ *
+ * @param name Nombre del patrón: uniform, top, gradient o random.
+ * @param pattern Puntero donde se almacena el patrón reconocido.
+ * @return 0 si el nombre es válido, 1 si no se reconoce.
+ */
+int parse_boundary_pattern(const char* name, boundary_pattern* pattern);
+
+/**
+ * @brief Escribe una lámina sintética en formato binario (.bin).
+ *
+ * @details El archivo tiene el mismo formato que leen todas las versiones de
+ * la simulación: filas y columnas como `uint64_t` seguidos de las celdas en
+ * orden de filas. La lámina se escribe fila por fila, de modo que se pueden
+ * generar láminas más grandes que la memoria disponible.
+ *
+ * @param path Ruta del archivo a crear.
+ * @param spec Descripción de la lámina.
+ * @return 0 si tuvo éxito, 1 si hubo un error.
+ */
+int generate_plate(const char* path, const plate_spec* spec);
+
+#endif  // PLATE_GENERATOR_H